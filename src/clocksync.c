@@ -0,0 +1,75 @@
+#include "clocksync.h"
+
+#include <math.h>
+#include <string.h>
+
+#define CLOCK_SYNC_DRIFT_MIN_SPAN 4.0
+#define CLOCK_SYNC_DRIFT_LIMIT 0.0005
+#define CLOCK_SYNC_RTT_SLACK 0.002
+
+void ClockSyncReset(ClockSync *clock)
+{
+    memset(clock, 0, sizeof(*clock));
+}
+
+void ClockSyncAddSample(ClockSync *clock, double t0, double t1, double t2, double t3)
+{
+    double rtt = (t3 - t0) - (t2 - t1);
+    if (rtt < 0.0)
+        rtt = 0.0;
+    ClockSample *sample = &clock->samples[clock->next];
+    sample->local = (t0 + t3) * 0.5;
+    sample->offset = ((t1 - t0) + (t2 - t3)) * 0.5;
+    sample->rtt = rtt;
+    clock->next = (clock->next + 1) % CLOCK_SYNC_SAMPLES;
+    if (clock->count < CLOCK_SYNC_SAMPLES)
+        clock->count++;
+
+    // The fastest exchange saw the least queueing, so its offset is the most
+    // symmetric; it anchors the estimate.
+    const ClockSample *best = &clock->samples[0];
+    for (int i = 1; i < clock->count; i++)
+    {
+        if (clock->samples[i].rtt < best->rtt)
+            best = &clock->samples[i];
+    }
+
+    // Drift is the least-squares slope of offset over time, fitted only through
+    // exchanges close to the best RTT.
+    double n = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    double first = best->local, last = best->local;
+    for (int i = 0; i < clock->count; i++)
+    {
+        const ClockSample *s = &clock->samples[i];
+        if (s->rtt > best->rtt * 1.5 + CLOCK_SYNC_RTT_SLACK)
+            continue;
+        double x = s->local - best->local;
+        n += 1.0;
+        sx += x;
+        sy += s->offset;
+        sxx += x * x;
+        sxy += x * s->offset;
+        first = fmin(first, s->local);
+        last = fmax(last, s->local);
+    }
+    double drift = clock->drift;
+    double denom = n * sxx - sx * sx;
+    if (n >= 3.0 && last - first >= CLOCK_SYNC_DRIFT_MIN_SPAN && denom > 0.0)
+    {
+        drift = (n * sxy - sx * sy) / denom;
+        drift = fmax(-CLOCK_SYNC_DRIFT_LIMIT, fmin(CLOCK_SYNC_DRIFT_LIMIT, drift));
+    }
+
+    clock->offset = best->offset;
+    clock->reference = best->local;
+    clock->drift = drift;
+    clock->rtt = best->rtt;
+    clock->valid = true;
+}
+
+double ClockSyncToRemote(const ClockSync *clock, double local)
+{
+    if (!clock->valid)
+        return local;
+    return local + clock->offset + clock->drift * (local - clock->reference);
+}
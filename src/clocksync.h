@@ -0,0 +1,35 @@
+#ifndef U8_CLOCKSYNC_H
+#define U8_CLOCKSYNC_H
+
+#include <stdbool.h>
+
+#define CLOCK_SYNC_SAMPLES 8
+
+typedef struct ClockSample
+{
+    double local;
+    double offset;
+    double rtt;
+} ClockSample;
+
+// Offset and drift of a remote clock relative to ours, estimated NTP-style
+// from ping exchanges. Queue-delayed exchanges are filtered by keeping the
+// lowest-RTT sample of the window.
+typedef struct ClockSync
+{
+    ClockSample samples[CLOCK_SYNC_SAMPLES];
+    int count;
+    int next;
+    double offset;
+    double reference;
+    double drift;
+    double rtt;
+    bool valid;
+} ClockSync;
+
+void ClockSyncReset(ClockSync *clock);
+// t0/t3 are our send/receive times, t1/t2 the remote's receive/send times.
+void ClockSyncAddSample(ClockSync *clock, double t0, double t1, double t2, double t3);
+double ClockSyncToRemote(const ClockSync *clock, double local);
+
+#endif
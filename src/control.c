@@ -0,0 +1,224 @@
+#define _POSIX_C_SOURCE 200809L
+#include "control.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef struct ControlClient
+{
+    int fd;
+    char buffer[CONTROL_LINE_BYTES];
+    size_t used;
+    unsigned serial;
+} ControlClient;
+
+typedef struct ControlState
+{
+    int listenFd;
+    int next;
+    unsigned nextSerial;
+    ControlClient clients[CONTROL_MAX_CLIENTS];
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    // Identity of the socket file we bound, so close never removes a
+    // replacement another process put at the same path.
+    dev_t device;
+    ino_t inode;
+} ControlState;
+
+static ControlState gControl = {.listenFd = -1};
+
+static void ControlDrop(ControlClient *client)
+{
+    if (client->fd >= 0)
+        close(client->fd);
+    client->fd = -1;
+    client->used = 0;
+    client->serial = 0;
+}
+
+bool ControlOpen(const char *path)
+{
+    if (gControl.listenFd >= 0)
+        return true;
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return false;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    // A socket file left behind by a crashed run would make bind fail, but
+    // anything else at that path is not ours to remove. A socket is only stale
+    // when nobody is listening on it.
+    struct stat st;
+    if (lstat(path, &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+        {
+            errno = EEXIST;
+            return false;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe < 0)
+            return false;
+        fcntl(probe, F_SETFL, O_NONBLOCK);
+        bool live = connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        int err = errno;
+        close(probe);
+        if (live)
+        {
+            errno = EADDRINUSE;
+            return false;
+        }
+        if (err != ECONNREFUSED)
+        {
+            errno = err == EAGAIN ? EADDRINUSE : err;
+            return false;
+        }
+        if (unlink(path) != 0)
+            return false;
+    }
+    else if (errno != ENOENT)
+    {
+        return false;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    if (lstat(path, &st) != 0 || listen(fd, CONTROL_MAX_CLIENTS) != 0)
+    {
+        int err = errno;
+        close(fd);
+        unlink(path);
+        errno = err;
+        return false;
+    }
+    gControl.device = st.st_dev;
+    gControl.inode = st.st_ino;
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    gControl.listenFd = fd;
+    gControl.next = 0;
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++)
+    {
+        gControl.clients[i].fd = -1;
+        gControl.clients[i].used = 0;
+        gControl.clients[i].serial = 0;
+    }
+    snprintf(gControl.path, sizeof(gControl.path), "%s", path);
+    return true;
+}
+
+static void ControlAccept(void)
+{
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++)
+    {
+        if (gControl.clients[i].fd >= 0)
+            continue;
+        int fd = accept(gControl.listenFd, NULL, NULL);
+        if (fd < 0)
+            return;
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        gControl.clients[i].fd = fd;
+        gControl.clients[i].used = 0;
+        if (++gControl.nextSerial == 0)
+            gControl.nextSerial = 1;
+        gControl.clients[i].serial = gControl.nextSerial;
+    }
+}
+
+static bool ControlTakeLine(ControlClient *client, char *line, size_t cap)
+{
+    char *end = memchr(client->buffer, '\n', client->used);
+    if (!end)
+        return false;
+    size_t length = (size_t)(end - client->buffer);
+    size_t copy = length < cap - 1 ? length : cap - 1;
+    memcpy(line, client->buffer, copy);
+    if (copy > 0 && line[copy - 1] == '\r')
+        copy--;
+    line[copy] = '\0';
+    client->used -= length + 1;
+    memmove(client->buffer, end + 1, client->used);
+    return true;
+}
+
+// At most one recv per call, so a chatty client cannot hold up the frame.
+static void ControlFill(ControlClient *client)
+{
+    ssize_t n = recv(client->fd, client->buffer + client->used, sizeof(client->buffer) - client->used, 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+        ControlDrop(client);
+        return;
+    }
+    if (n > 0)
+        client->used += (size_t)n;
+    if (client->used == sizeof(client->buffer) && !memchr(client->buffer, '\n', client->used))
+        ControlDrop(client);
+}
+
+int ControlPoll(char *line, size_t cap)
+{
+    if (gControl.listenFd < 0 || cap == 0)
+        return -1;
+    ControlAccept();
+    for (int n = 0; n < CONTROL_MAX_CLIENTS; n++)
+    {
+        int i = (gControl.next + n) % CONTROL_MAX_CLIENTS;
+        ControlClient *client = &gControl.clients[i];
+        if (client->fd < 0)
+            continue;
+        if (!ControlTakeLine(client, line, cap))
+        {
+            ControlFill(client);
+            if (client->fd < 0 || !ControlTakeLine(client, line, cap))
+                continue;
+        }
+        gControl.next = (i + 1) % CONTROL_MAX_CLIENTS;
+        return i;
+    }
+    return -1;
+}
+
+unsigned ControlSerial(int client)
+{
+    if (client < 0 || client >= CONTROL_MAX_CLIENTS)
+        return 0;
+    return gControl.clients[client].serial;
+}
+
+void ControlReply(int client, const char *text)
+{
+    if (client < 0 || client >= CONTROL_MAX_CLIENTS || gControl.clients[client].fd < 0)
+        return;
+    char buffer[CONTROL_REPLY_BYTES + 1];
+    int length = snprintf(buffer, sizeof(buffer), "%.*s\n", CONTROL_REPLY_BYTES - 1, text);
+    // Replies are a few hundred bytes against a socket buffer of many
+    // kilobytes; one that does not fit means the client has stopped reading.
+    ssize_t sent = send(gControl.clients[client].fd, buffer, (size_t)length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent != (ssize_t)length)
+        ControlDrop(&gControl.clients[client]);
+}
+
+void ControlClose(void)
+{
+    if (gControl.listenFd < 0)
+        return;
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++)
+        ControlDrop(&gControl.clients[i]);
+    close(gControl.listenFd);
+    gControl.listenFd = -1;
+    struct stat st;
+    if (lstat(gControl.path, &st) == 0 && st.st_dev == gControl.device && st.st_ino == gControl.inode)
+        unlink(gControl.path);
+}
@@ -0,0 +1,30 @@
+#ifndef U8_CONTROL_H
+#define U8_CONTROL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CONTROL_MAX_CLIENTS 4
+#define CONTROL_LINE_BYTES 256
+#define CONTROL_REPLY_BYTES 512
+// Upper bound on lines the game takes off the socket in one frame.
+#define CONTROL_COMMANDS_PER_FRAME 8
+
+// Local automation channel: a Unix stream socket carrying one command per
+// '\n'-terminated line. Nothing here blocks, so the game can poll it once per
+// frame; a client that sends an overlong line or stops reading is dropped.
+// Replaces a stale socket file at path but fails with errno EADDRINUSE when
+// another process still answers on it.
+bool ControlOpen(const char *path);
+// Accepts pending clients and returns the index of one with a complete line,
+// copied into line, or -1 when none has. Clients are served round robin.
+int ControlPoll(char *line, size_t cap);
+// Identifies the connection in a client slot, or 0 when the slot is empty.
+// A new connection reusing the slot gets a different serial.
+unsigned ControlSerial(int client);
+// Sends text plus a newline to that client.
+void ControlReply(int client, const char *text);
+// Disconnects everyone and removes the socket file if it is still the one we bound.
+void ControlClose(void);
+
+#endif
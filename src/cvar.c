@@ -0,0 +1,254 @@
+#include "cvar.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "metrics.h"
+
+typedef struct Cvar
+{
+    char name[CVAR_NAME_BYTES];
+    const char *help;
+    CvarType type;
+    float value;
+    float pending;
+    float minValue;
+    float maxValue;
+    bool hasPending;
+    int metric;
+} Cvar;
+
+static Cvar gCvars[CVAR_MAX];
+static int gCvarCount;
+
+int CvarRegister(CvarType type, const char *name, float value, float minValue, float maxValue, const char *help)
+{
+    if (gCvarCount >= CVAR_MAX)
+        return -1;
+    Cvar *c = &gCvars[gCvarCount];
+    memset(c, 0, sizeof(*c));
+    snprintf(c->name, sizeof(c->name), "%s", name);
+    c->help = help;
+    c->type = type;
+    c->minValue = type == CVAR_BOOL ? 0.0f : minValue;
+    c->maxValue = type == CVAR_BOOL ? 1.0f : maxValue;
+    c->value = value;
+    return gCvarCount++;
+}
+
+float CvarFloat(int id)
+{
+    return (id >= 0 && id < gCvarCount) ? gCvars[id].value : 0.0f;
+}
+
+int CvarInt(int id)
+{
+    return (int)lroundf(CvarFloat(id));
+}
+
+bool CvarBool(int id)
+{
+    return CvarFloat(id) != 0.0f;
+}
+
+int CvarFind(const char *name)
+{
+    for (int i = 0; i < gCvarCount; i++)
+    {
+        if (strcmp(gCvars[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+int CvarCount(void)
+{
+    return gCvarCount;
+}
+
+static bool CvarParse(const Cvar *c, const char *text, float *out)
+{
+    if (c->type == CVAR_BOOL)
+    {
+        static const char *truths[] = {"1", "true", "on", "yes"};
+        static const char *lies[] = {"0", "false", "off", "no"};
+        for (int i = 0; i < 4; i++)
+        {
+            if (strcmp(text, truths[i]) == 0 || strcmp(text, lies[i]) == 0)
+            {
+                *out = strcmp(text, truths[i]) == 0 ? 1.0f : 0.0f;
+                return true;
+            }
+        }
+        return false;
+    }
+    char *end = NULL;
+    float value = strtof(text, &end);
+    if (end == text || *end != '\0' || !isfinite(value))
+        return false;
+    if (c->type == CVAR_INT)
+        value = roundf(value);
+    *out = fminf(fmaxf(value, c->minValue), c->maxValue);
+    return true;
+}
+
+bool CvarSet(int id, const char *text)
+{
+    if (id < 0 || id >= gCvarCount)
+        return false;
+    Cvar *c = &gCvars[id];
+    float value;
+    if (!CvarParse(c, text, &value))
+        return false;
+    c->pending = value;
+    c->hasPending = true;
+    return true;
+}
+
+static void CvarFormatValue(const Cvar *c, float value, char *out, size_t cap)
+{
+    if (c->type == CVAR_BOOL)
+        snprintf(out, cap, "%s", value != 0.0f ? "on" : "off");
+    else if (c->type == CVAR_INT)
+        snprintf(out, cap, "%d", (int)lroundf(value));
+    else
+        snprintf(out, cap, "%g", value);
+}
+
+void CvarFormat(int id, char *out, size_t cap)
+{
+    if (id < 0 || id >= gCvarCount)
+    {
+        snprintf(out, cap, "?");
+        return;
+    }
+    const Cvar *c = &gCvars[id];
+    char value[24];
+    CvarFormatValue(c, c->value, value, sizeof(value));
+    if (c->hasPending)
+    {
+        char pending[24];
+        CvarFormatValue(c, c->pending, pending, sizeof(pending));
+        snprintf(out, cap, "%s = %s (next frame %s)", c->name, value, pending);
+    }
+    else
+    {
+        snprintf(out, cap, "%s = %s", c->name, value);
+    }
+}
+
+bool CvarCommand(const char *line, char *reply, size_t cap)
+{
+    char name[CVAR_NAME_BYTES];
+    char text[32];
+    while (isspace((unsigned char)*line))
+        line++;
+    size_t n = 0;
+    while (line[n] && line[n] != '=' && !isspace((unsigned char)line[n]))
+        n++;
+    if (n == 0 || n >= sizeof(name))
+    {
+        snprintf(reply, cap, "usage: <cvar> [value]");
+        return false;
+    }
+    memcpy(name, line, n);
+    name[n] = '\0';
+    line += n;
+    while (*line == '=' || isspace((unsigned char)*line))
+        line++;
+    size_t t = 0;
+    while (line[t] && !isspace((unsigned char)line[t]) && t + 1 < sizeof(text))
+    {
+        text[t] = line[t];
+        t++;
+    }
+    text[t] = '\0';
+
+    int id = CvarFind(name);
+    if (id < 0)
+    {
+        snprintf(reply, cap, "unknown cvar %s", name);
+        return false;
+    }
+    const Cvar *c = &gCvars[id];
+    if (t == 0)
+    {
+        char current[96];
+        CvarFormat(id, current, sizeof(current));
+        snprintf(reply, cap, "%s - %s", current, c->help ? c->help : "");
+        return true;
+    }
+    if (!CvarSet(id, text))
+    {
+        if (c->type == CVAR_BOOL)
+            snprintf(reply, cap, "%s takes on/off", c->name);
+        else
+            snprintf(reply, cap, "%s takes a number in [%g, %g]", c->name, c->minValue, c->maxValue);
+        return false;
+    }
+    CvarFormat(id, reply, cap);
+    return true;
+}
+
+int CvarLoadFile(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    char line[128];
+    int lineNumber = 0;
+    int loaded = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+        char *p = line;
+        while (isspace((unsigned char)*p))
+            p++;
+        if (*p == '\0')
+            continue;
+        char reply[128];
+        if (CvarCommand(p, reply, sizeof(reply)))
+            loaded++;
+        else
+            printf("%s:%d: %s\n", path, lineNumber, reply);
+    }
+    fclose(f);
+    return loaded;
+}
+
+int CvarApplyPending(void)
+{
+    int changed = 0;
+    for (int i = 0; i < gCvarCount; i++)
+    {
+        Cvar *c = &gCvars[i];
+        if (!c->hasPending)
+            continue;
+        c->hasPending = false;
+        if (c->pending == c->value)
+            continue;
+        c->value = c->pending;
+        LogWrite(LOG_CVAR_SET, i, (double)c->value);
+        MetricsSet(c->metric, c->value);
+        changed++;
+    }
+    return changed;
+}
+
+void CvarExportMetrics(void)
+{
+    char name[METRICS_NAME_BYTES];
+    for (int i = 0; i < gCvarCount; i++)
+    {
+        snprintf(name, sizeof(name), "cvar.%.31s", gCvars[i].name);
+        gCvars[i].metric = MetricsRegister(METRIC_GAUGE, name);
+        MetricsSet(gCvars[i].metric, gCvars[i].value);
+    }
+}
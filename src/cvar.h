@@ -0,0 +1,39 @@
+#ifndef U8_CVAR_H
+#define U8_CVAR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CVAR_MAX 48
+#define CVAR_NAME_BYTES 32
+
+typedef enum CvarType
+{
+    CVAR_BOOL,
+    CVAR_INT,
+    CVAR_FLOAT
+} CvarType;
+
+// Typed tuning knobs. Reads are plain loads and safe from any thread during a
+// frame; writes are queued and only land in CvarApplyPending, which the game
+// calls between frames while no tasks are running. Every applied change is
+// logged and, once exported, mirrored as a "cvar.<name>" gauge.
+int CvarRegister(CvarType type, const char *name, float value, float minValue, float maxValue, const char *help);
+float CvarFloat(int id);
+int CvarInt(int id);
+bool CvarBool(int id);
+int CvarFind(const char *name);
+int CvarCount(void);
+// Queues a value, clamped to the registered range; false if it does not parse.
+bool CvarSet(int id, const char *text);
+// "name" describes the cvar; "name value" or "name=value" queues a change.
+// The reply is one line for a console or stdout.
+bool CvarCommand(const char *line, char *reply, size_t cap);
+// One command per line, '#' starts a comment. Returns -1 if the file is missing.
+int CvarLoadFile(const char *path);
+// Returns how many values changed.
+int CvarApplyPending(void);
+void CvarFormat(int id, char *out, size_t cap);
+void CvarExportMetrics(void);
+
+#endif
@@ -0,0 +1,155 @@
+#include "ecs.h"
+
+#include <string.h>
+
+#include "raylib.h"
+
+static const size_t gEcsComponentSizes[ECS_COMPONENT_COUNT] = {
+    [ECS_POSITION] = sizeof(Vector3),
+    [ECS_LIFETIME] = sizeof(float),
+    [ECS_TINT] = sizeof(Color),
+    [ECS_EXTENT] = sizeof(float),
+};
+
+bool EcsWorldInit(EcsWorld *world, MemRegion region, int maxEntities)
+{
+    memset(world, 0, sizeof(*world));
+    world->region = region;
+    world->slots = (EcsSlot *)RegionAlloc(region, sizeof(EcsSlot) * (size_t)maxEntities);
+    if (!world->slots)
+        return false;
+    world->slotCapacity = maxEntities;
+    for (int i = 0; i < maxEntities; i++)
+    {
+        world->slots[i].generation = 1;
+        world->slots[i].archetype = -1;
+        world->slots[i].nextFree = i + 1 < maxEntities ? i + 1 : -1;
+    }
+    world->freeHead = maxEntities > 0 ? 0 : -1;
+    return true;
+}
+
+int EcsAddArchetype(EcsWorld *world, uint32_t mask, int capacity)
+{
+    if (world->archetypeCount >= ECS_MAX_ARCHETYPES || capacity <= 0)
+        return -1;
+    EcsArchetype *a = &world->archetypes[world->archetypeCount];
+    memset(a, 0, sizeof(*a));
+    a->mask = mask;
+    a->capacity = capacity;
+    a->handles = (EcsHandle *)RegionAlloc(world->region, sizeof(EcsHandle) * (size_t)capacity);
+    if (!a->handles)
+        return -1;
+    for (int c = 0; c < ECS_COMPONENT_COUNT; c++)
+    {
+        if (!(mask & ECS_MASK(c)) || gEcsComponentSizes[c] == 0)
+            continue;
+        a->columns[c] = RegionAlloc(world->region, gEcsComponentSizes[c] * (size_t)capacity);
+        if (!a->columns[c])
+            return -1;
+    }
+    return world->archetypeCount++;
+}
+
+EcsHandle EcsSpawn(EcsWorld *world, int archetype)
+{
+    EcsHandle none = {0, 0};
+    if (archetype < 0 || archetype >= world->archetypeCount || world->freeHead < 0)
+        return none;
+    EcsArchetype *a = &world->archetypes[archetype];
+    if (a->count >= a->capacity)
+        return none;
+
+    int index = world->freeHead;
+    EcsSlot *slot = &world->slots[index];
+    world->freeHead = slot->nextFree;
+    slot->archetype = archetype;
+    slot->row = a->count++;
+    world->liveCount++;
+
+    EcsHandle handle = {(uint32_t)index, slot->generation};
+    a->handles[slot->row] = handle;
+    for (int c = 0; c < ECS_COMPONENT_COUNT; c++)
+    {
+        if (a->columns[c])
+            memset((uint8_t *)a->columns[c] + gEcsComponentSizes[c] * (size_t)slot->row, 0, gEcsComponentSizes[c]);
+    }
+    return handle;
+}
+
+bool EcsAlive(const EcsWorld *world, EcsHandle handle)
+{
+    return handle.generation != 0 && handle.index < (uint32_t)world->slotCapacity &&
+           world->slots[handle.index].generation == handle.generation && world->slots[handle.index].archetype >= 0;
+}
+
+void *EcsGet(EcsWorld *world, EcsHandle handle, EcsComponent component)
+{
+    if (!EcsAlive(world, handle))
+        return NULL;
+    const EcsSlot *slot = &world->slots[handle.index];
+    EcsArchetype *a = &world->archetypes[slot->archetype];
+    if (!a->columns[component])
+        return NULL;
+    return (uint8_t *)a->columns[component] + gEcsComponentSizes[component] * (size_t)slot->row;
+}
+
+void EcsDestroyRow(EcsWorld *world, int archetype, int row)
+{
+    EcsArchetype *a = &world->archetypes[archetype];
+    if (row < 0 || row >= a->count)
+        return;
+
+    EcsSlot *slot = &world->slots[a->handles[row].index];
+    slot->archetype = -1;
+    slot->generation++;
+    if (slot->generation == 0)
+        slot->generation = 1;
+    slot->nextFree = world->freeHead;
+    world->freeHead = (int)a->handles[row].index;
+    world->liveCount--;
+
+    // Keep columns dense by moving the last row into the hole.
+    int last = --a->count;
+    if (row != last)
+    {
+        for (int c = 0; c < ECS_COMPONENT_COUNT; c++)
+        {
+            if (!a->columns[c])
+                continue;
+            size_t size = gEcsComponentSizes[c];
+            memcpy((uint8_t *)a->columns[c] + size * (size_t)row, (uint8_t *)a->columns[c] + size * (size_t)last, size);
+        }
+        a->handles[row] = a->handles[last];
+        world->slots[a->handles[row].index].row = row;
+    }
+}
+
+void EcsDestroy(EcsWorld *world, EcsHandle handle)
+{
+    if (!EcsAlive(world, handle))
+        return;
+    const EcsSlot *slot = &world->slots[handle.index];
+    EcsDestroyRow(world, slot->archetype, slot->row);
+}
+
+void EcsEach(EcsWorld *world, uint32_t mask, EcsSystemFn fn, void *user)
+{
+    for (int i = 0; i < world->archetypeCount; i++)
+    {
+        const EcsArchetype *a = &world->archetypes[i];
+        if ((a->mask & mask) != mask || a->count == 0)
+            continue;
+        EcsView view;
+        view.archetype = i;
+        view.count = a->count;
+        view.handles = a->handles;
+        memcpy(view.columns, a->columns, sizeof(view.columns));
+        fn(world, &view, user);
+    }
+}
+
+int EcsLiveCount(const EcsWorld *world)
+{
+    return world->liveCount;
+}
@@ -0,0 +1,89 @@
+#ifndef U8_ECS_H
+#define U8_ECS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "region.h"
+
+#define ECS_MAX_ARCHETYPES 16
+
+// Components are plain structs stored column by column. Tags carry no data and
+// only split otherwise identical archetypes apart.
+typedef enum EcsComponent
+{
+    ECS_POSITION, // Vector3
+    ECS_LIFETIME, // float seconds left
+    ECS_TINT,     // Color
+    ECS_EXTENT,   // float height/size
+    ECS_TAG_DECAL,
+    ECS_TAG_DISSOLVE,
+    ECS_TAG_TRAIL,
+    ECS_COMPONENT_COUNT
+} EcsComponent;
+
+#define ECS_MASK(component) (1u << (component))
+
+// Handles stay valid across swap-removes; a stale handle fails the generation check.
+typedef struct EcsHandle
+{
+    uint32_t index;
+    uint32_t generation;
+} EcsHandle;
+
+typedef struct EcsArchetype
+{
+    uint32_t mask;
+    int capacity;
+    int count;
+    EcsHandle *handles;
+    void *columns[ECS_COMPONENT_COUNT];
+} EcsArchetype;
+
+typedef struct EcsSlot
+{
+    uint32_t generation;
+    int archetype;
+    int row;
+    int nextFree;
+} EcsSlot;
+
+typedef struct EcsWorld
+{
+    MemRegion region;
+    EcsArchetype archetypes[ECS_MAX_ARCHETYPES];
+    int archetypeCount;
+    EcsSlot *slots;
+    int slotCapacity;
+    int freeHead;
+    int liveCount;
+} EcsWorld;
+
+// One dense chunk handed to a system: every column in the archetype, row-aligned.
+typedef struct EcsView
+{
+    int archetype;
+    int count;
+    const EcsHandle *handles;
+    void *columns[ECS_COMPONENT_COUNT];
+} EcsView;
+
+#define ECS_COLUMN(view, type, component) ((type *)(view)->columns[component])
+
+typedef void (*EcsSystemFn)(EcsWorld *world, const EcsView *view, void *user);
+
+bool EcsWorldInit(EcsWorld *world, MemRegion region, int maxEntities);
+// Columns are carved from the world's region up front; returns the archetype index or -1.
+int EcsAddArchetype(EcsWorld *world, uint32_t mask, int capacity);
+// Components start zeroed. Returns a null handle when the archetype or handle table is full.
+EcsHandle EcsSpawn(EcsWorld *world, int archetype);
+bool EcsAlive(const EcsWorld *world, EcsHandle handle);
+void *EcsGet(EcsWorld *world, EcsHandle handle, EcsComponent component);
+void EcsDestroy(EcsWorld *world, EcsHandle handle);
+// Swap-removes a row; iterate rows back to front when destroying from inside a system.
+void EcsDestroyRow(EcsWorld *world, int archetype, int row);
+// Runs the system once per archetype holding every component in the mask.
+void EcsEach(EcsWorld *world, uint32_t mask, EcsSystemFn fn, void *user);
+int EcsLiveCount(const EcsWorld *world);
+
+#endif
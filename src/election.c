@@ -0,0 +1,113 @@
+#include "election.h"
+
+#include <math.h>
+#include <string.h>
+
+static int ElectionFind(const ElectionNode *nodes, int count, uint32_t id)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (nodes[i].id == id)
+            return i;
+    }
+    return -1;
+}
+
+static float ElectionLink(const ElectionNode *node, uint32_t id)
+{
+    for (int i = 0; i < node->linkCount; i++)
+    {
+        if (node->linkIds[i] == id)
+            return node->linkRttMs[i];
+    }
+    return -1.0f;
+}
+
+float ElectionScore(const ElectionNode *node, const ElectionNode *nodes, int count, const ElectionConfig *config)
+{
+    float rtts[ELECTION_MAX_NODES];
+    int n = 0;
+    for (int i = 0; i < count && n < ELECTION_MAX_NODES; i++)
+    {
+        if (nodes[i].id == node->id)
+            continue;
+        // Both ends measure the same link; average them when both reported it.
+        float there = ElectionLink(node, nodes[i].id);
+        float back = ElectionLink(&nodes[i], node->id);
+        float rtt = ELECTION_UNKNOWN_RTT_MS;
+        if (there >= 0.0f && back >= 0.0f)
+            rtt = (there + back) * 0.5f;
+        else if (there >= 0.0f)
+            rtt = there;
+        else if (back >= 0.0f)
+            rtt = back;
+        int at = n++;
+        while (at > 0 && rtts[at - 1] > rtt)
+        {
+            rtts[at] = rtts[at - 1];
+            at--;
+        }
+        rtts[at] = rtt;
+    }
+    float median = 0.0f;
+    if (n > 0)
+        median = (n & 1) ? rtts[n / 2] : (rtts[n / 2 - 1] + rtts[n / 2]) * 0.5f;
+    float headroom = fminf(fmaxf(node->headroom, 0.0f), 1.0f);
+    float score = median + (1.0f - headroom) * config->headroomMs;
+    if (headroom < config->minHeadroom)
+        score += ELECTION_OVERLOADED_MS;
+    return score;
+}
+
+uint32_t ElectionBest(const ElectionNode *nodes, int count, const ElectionConfig *config)
+{
+    // Two passes so the answer does not depend on report order: find the
+    // lowest score, then the lowest id within ELECTION_TIE_MS of it.
+    float scores[ELECTION_MAX_NODES];
+    float minScore = 0.0f;
+    if (count > ELECTION_MAX_NODES)
+        count = ELECTION_MAX_NODES;
+    for (int i = 0; i < count; i++)
+    {
+        scores[i] = ElectionScore(&nodes[i], nodes, count, config);
+        if (i == 0 || scores[i] < minScore)
+            minScore = scores[i];
+    }
+    uint32_t best = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (scores[i] - minScore <= ELECTION_TIE_MS && (best == 0 || nodes[i].id < best))
+            best = nodes[i].id;
+    }
+    return best;
+}
+
+uint32_t ElectionUpdate(ElectionState *state, const ElectionNode *nodes, int count, uint32_t hostId, float dt,
+                        const ElectionConfig *config)
+{
+    uint32_t best = ElectionBest(nodes, count, config);
+    int host = ElectionFind(nodes, count, hostId);
+    int challenger = ElectionFind(nodes, count, best);
+    if (host < 0 || challenger < 0 || best == hostId)
+    {
+        memset(state, 0, sizeof(*state));
+        return host < 0 ? best : hostId;
+    }
+    float hostScore = ElectionScore(&nodes[host], nodes, count, config);
+    float bestScore = ElectionScore(&nodes[challenger], nodes, count, config);
+    if (bestScore > hostScore * (1.0f - config->margin) || hostScore - bestScore <= ELECTION_TIE_MS)
+    {
+        memset(state, 0, sizeof(*state));
+        return hostId;
+    }
+    if (state->challenger != best)
+    {
+        state->challenger = best;
+        state->pressure = 0.0f;
+    }
+    state->pressure += dt;
+    if (state->pressure < config->holdSeconds)
+        return hostId;
+    memset(state, 0, sizeof(*state));
+    return best;
+}
@@ -0,0 +1,54 @@
+#ifndef U8_ELECTION_H
+#define U8_ELECTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ELECTION_MAX_NODES 9
+#define ELECTION_UNKNOWN_RTT_MS 250.0f
+#define ELECTION_OVERLOADED_MS 1000.0f
+#define ELECTION_TIE_MS 1.0f
+
+// One machine's view as it reports it: spare frame budget and the RTT it
+// measures to every other node it knows.
+typedef struct ElectionNode
+{
+    uint32_t id;
+    float headroom;
+    int linkCount;
+    uint32_t linkIds[ELECTION_MAX_NODES];
+    float linkRttMs[ELECTION_MAX_NODES];
+} ElectionNode;
+
+typedef struct ElectionConfig
+{
+    // Below this headroom a node only hosts if nobody else can.
+    float minHeadroom;
+    // Milliseconds of latency a fully loaded node is worth.
+    float headroomMs;
+    // Fraction of the host's score a challenger has to beat it by...
+    float margin;
+    // ...for this many seconds in a row before the host hands over.
+    float holdSeconds;
+} ElectionConfig;
+
+typedef struct ElectionState
+{
+    uint32_t challenger;
+    float pressure;
+} ElectionState;
+
+// Lower is better: median RTT to the other candidates plus the headroom
+// penalty. Links to nodes outside the set are ignored; missing ones count as
+// ELECTION_UNKNOWN_RTT_MS.
+float ElectionScore(const ElectionNode *node, const ElectionNode *nodes, int count, const ElectionConfig *config);
+// Scores within ELECTION_TIE_MS go to the lower id, so every machine picks
+// the same node from the same reports.
+uint32_t ElectionBest(const ElectionNode *nodes, int count, const ElectionConfig *config);
+// Run by the sitting host once per report interval. Returns the node that
+// should host from now on: hostId until a challenger has stayed better by the
+// margin for holdSeconds, or at once if the host has left the set.
+uint32_t ElectionUpdate(ElectionState *state, const ElectionNode *nodes, int count, uint32_t hostId, float dt,
+                        const ElectionConfig *config);
+
+#endif
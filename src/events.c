@@ -0,0 +1,46 @@
+#include "events.h"
+
+#include <string.h>
+
+void EventBusInit(EventBus *bus)
+{
+    memset(bus, 0, sizeof(*bus));
+}
+
+bool EventBusSubscribe(EventBus *bus, const char *name, EventConsumerFn fn, void *user)
+{
+    if (!fn || bus->consumerCount >= EVENT_BUS_MAX_CONSUMERS)
+        return false;
+    EventConsumer *c = &bus->consumers[bus->consumerCount++];
+    c->name = name;
+    c->fn = fn;
+    c->user = user;
+    return true;
+}
+
+GameEvent *EventBusPush(EventBus *bus, GameEventKind kind)
+{
+    if (!bus)
+        return NULL;
+    int slot = __atomic_fetch_add(&bus->count, 1, __ATOMIC_RELAXED);
+    if (slot >= EVENT_BUS_CAPACITY)
+    {
+        __atomic_fetch_add(&bus->dropped, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    GameEvent *e = &bus->events[slot];
+    memset(e, 0, sizeof(*e));
+    e->kind = kind;
+    return e;
+}
+
+void EventBusDispatch(EventBus *bus)
+{
+    int count = bus->count < EVENT_BUS_CAPACITY ? bus->count : EVENT_BUS_CAPACITY;
+    if (count > 0)
+    {
+        for (int i = 0; i < bus->consumerCount; i++)
+            bus->consumers[i].fn(bus->events, count, bus->consumers[i].user);
+    }
+    bus->count = 0;
+}
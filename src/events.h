@@ -0,0 +1,73 @@
+#ifndef U8_EVENTS_H
+#define U8_EVENTS_H
+
+#include <stdbool.h>
+
+#include "raylib.h"
+
+#define EVENT_BUS_CAPACITY 128
+#define EVENT_BUS_MAX_CONSUMERS 8
+#define GAME_EVENT_NAME_BYTES 16
+
+typedef enum GameEventKind
+{
+    GAME_EVENT_NONE,
+    GAME_EVENT_ENEMY_HIT,
+    GAME_EVENT_ENEMY_KILLED,
+    GAME_EVENT_PEER_HIT,
+    GAME_EVENT_PEER_FRAGGED,
+    GAME_EVENT_PLAYER_HURT,
+    GAME_EVENT_PLAYER_FRAGGED,
+    GAME_EVENT_PLAYER_DOWNED,
+    GAME_EVENT_PLAYER_REVIVED,
+    GAME_EVENT_PEER_REVIVED,
+    GAME_EVENT_MELEE_ASSIST,
+    GAME_EVENT_PERK_PURCHASED,
+    GAME_EVENT_BOX_ROLLED,
+    GAME_EVENT_LAN_FEED,
+    GAME_EVENT_KIND_COUNT
+} GameEventKind;
+
+// One flat record for every kind; the field comments list which kinds use them.
+typedef struct GameEvent
+{
+    GameEventKind kind;
+    int subject;    // enemy type, peer slot, prop kind or LAN event kind
+    int team;       // PEER_FRAGGED, LAN_FEED
+    int amount;     // cash reward, purchase cost or assist cash
+    int bonus;      // assist share on ENEMY_KILLED
+    float damage;   // *_HIT, PLAYER_HURT
+    Vector3 origin; // shot ray for *_HIT
+    Vector3 dir;
+    Vector3 point;  // impact, corpse or splash position
+    char actor[GAME_EVENT_NAME_BYTES];
+    char target[GAME_EVENT_NAME_BYTES];
+} GameEvent;
+
+// Consumers see the whole tick's batch at once, in push order.
+typedef void (*EventConsumerFn)(const GameEvent *events, int count, void *user);
+
+typedef struct EventConsumer
+{
+    const char *name;
+    EventConsumerFn fn;
+    void *user;
+} EventConsumer;
+
+typedef struct EventBus
+{
+    GameEvent events[EVENT_BUS_CAPACITY];
+    int count;
+    int dropped;
+    EventConsumer consumers[EVENT_BUS_MAX_CONSUMERS];
+    int consumerCount;
+} EventBus;
+
+void EventBusInit(EventBus *bus);
+bool EventBusSubscribe(EventBus *bus, const char *name, EventConsumerFn fn, void *user);
+// Safe to call from frame tasks; returns a zeroed slot to fill in, or NULL when the tick's ring is full.
+GameEvent *EventBusPush(EventBus *bus, GameEventKind kind);
+// Runs every consumer once over the batch and clears it; game thread only, outside the frame graph.
+void EventBusDispatch(EventBus *bus);
+
+#endif
@@ -0,0 +1,135 @@
+#include "hitch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "log.h"
+
+static bool HitchWrite(const ProfileFrame *frames, int count, int dump)
+{
+    char path[32];
+    snprintf(path, sizeof(path), "hitch_%03d.csv", dump);
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+
+    fprintf(f, "frame,frame_ms");
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++)
+        fprintf(f, ",%s_ms", ProfileZoneName((ProfileZone)z));
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+        fprintf(f, ",%s", ProfileCounterName((ProfileCounter)c));
+    bool pmu = ProfilePmuActive() != PROFILE_PMU_OFF;
+    for (int z = 0; z < PROFILE_ZONE_COUNT && pmu; z++)
+    {
+        for (int k = 0; k < PROFILE_PMU_COUNT; k++)
+            fprintf(f, ",%s_%s", ProfileZoneName((ProfileZone)z), ProfilePmuName(k));
+    }
+    fprintf(f, ",active_enemies\n");
+
+    for (int i = 0; i < count; i++)
+    {
+        const ProfileFrame *fr = &frames[i];
+        fprintf(f, "%llu,%.3f", (unsigned long long)fr->index, fr->frameMs);
+        for (int z = 0; z < PROFILE_ZONE_COUNT; z++)
+            fprintf(f, ",%.3f", fr->zoneMs[z]);
+        for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+            fprintf(f, ",%u", fr->counters[c]);
+        for (int z = 0; z < PROFILE_ZONE_COUNT && pmu; z++)
+        {
+            for (int k = 0; k < PROFILE_PMU_COUNT; k++)
+                fprintf(f, ",%llu", (unsigned long long)fr->pmu[z][k]);
+        }
+        fprintf(f, ",%d\n", fr->activeEnemies);
+    }
+    fclose(f);
+    LogWrite(LOG_HITCH_DUMPED, dump, (double)frames[count - 1].frameMs);
+    return true;
+}
+
+// Storage on the handhelds can take longer than a frame to open and fill a
+// file, so dumps are written here rather than on the game thread.
+static void *HitchWriterMain(void *arg)
+{
+    HitchRecorder *rec = (HitchRecorder *)arg;
+    pthread_mutex_lock(&rec->lock);
+    for (;;)
+    {
+        while (rec->running && !rec->pending)
+            pthread_cond_wait(&rec->wake, &rec->lock);
+        if (!rec->pending)
+            break;
+        pthread_mutex_unlock(&rec->lock);
+        HitchWrite(rec->window, rec->windowCount, rec->windowDump);
+        pthread_mutex_lock(&rec->lock);
+        rec->pending = false;
+    }
+    pthread_mutex_unlock(&rec->lock);
+    return NULL;
+}
+
+void HitchInit(HitchRecorder *rec, float targetFrameMs, float factor)
+{
+    memset(rec, 0, sizeof(*rec));
+    rec->thresholdMs = targetFrameMs * (factor > 1.0f ? factor : 1.0f);
+    pthread_mutex_init(&rec->lock, NULL);
+    pthread_cond_init(&rec->wake, NULL);
+    rec->running = true;
+    if (pthread_create(&rec->writer, NULL, HitchWriterMain, rec) != 0)
+        rec->running = false;
+}
+
+static bool HitchQueueDump(HitchRecorder *rec)
+{
+    if (!rec->running)
+        return false;
+    pthread_mutex_lock(&rec->lock);
+    bool busy = rec->pending;
+    pthread_mutex_unlock(&rec->lock);
+    if (busy)
+        return false;
+
+    // The writer only reads the window while pending is set, so it can be
+    // filled without the lock held.
+    int start = (rec->next - rec->count + HITCH_HISTORY_FRAMES) % HITCH_HISTORY_FRAMES;
+    int first = HITCH_HISTORY_FRAMES - start < rec->count ? HITCH_HISTORY_FRAMES - start : rec->count;
+    memcpy(rec->window, &rec->frames[start], sizeof(ProfileFrame) * (size_t)first);
+    memcpy(rec->window + first, rec->frames, sizeof(ProfileFrame) * (size_t)(rec->count - first));
+    rec->windowCount = rec->count;
+    rec->windowDump = rec->dumpCount++;
+
+    pthread_mutex_lock(&rec->lock);
+    rec->pending = true;
+    pthread_cond_signal(&rec->wake);
+    pthread_mutex_unlock(&rec->lock);
+    return true;
+}
+
+bool HitchRecordFrame(HitchRecorder *rec, const ProfileFrame *frame)
+{
+    rec->frames[rec->next] = *frame;
+    rec->next = (rec->next + 1) % HITCH_HISTORY_FRAMES;
+    if (rec->count < HITCH_HISTORY_FRAMES)
+        rec->count++;
+
+    // A hitch usually comes in a cluster; one dump covers the whole window.
+    if (rec->cooldown > 0)
+    {
+        rec->cooldown--;
+        return false;
+    }
+    if (frame->frameMs < rec->thresholdMs)
+        return false;
+    rec->cooldown = HITCH_COOLDOWN_FRAMES;
+    return HitchQueueDump(rec);
+}
+
+void HitchShutdown(HitchRecorder *rec)
+{
+    if (!rec->running)
+        return;
+    pthread_mutex_lock(&rec->lock);
+    rec->running = false;
+    pthread_cond_signal(&rec->wake);
+    pthread_mutex_unlock(&rec->lock);
+    pthread_join(rec->writer, NULL);
+}
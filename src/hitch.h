@@ -0,0 +1,40 @@
+#ifndef U8_HITCH_H
+#define U8_HITCH_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "profile.h"
+
+#define HITCH_HISTORY_FRAMES 300
+#define HITCH_COOLDOWN_FRAMES 60
+
+typedef struct HitchRecorder
+{
+    ProfileFrame frames[HITCH_HISTORY_FRAMES];
+    int next;
+    int count;
+    float thresholdMs;
+    int cooldown;
+    int dumpCount;
+    // The window being written, copied out in order so the writer thread
+    // never touches the live history.
+    ProfileFrame window[HITCH_HISTORY_FRAMES];
+    int windowCount;
+    int windowDump;
+    bool pending;
+    bool running;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+} HitchRecorder;
+
+void HitchInit(HitchRecorder *rec, float targetFrameMs, float factor);
+// Returns true when this frame crossed the threshold and the window was
+// handed to the writer thread; a hitch while a dump is still being written
+// is not recorded.
+bool HitchRecordFrame(HitchRecorder *rec, const ProfileFrame *frame);
+// Finishes any dump in flight and stops the writer.
+void HitchShutdown(HitchRecorder *rec);
+
+#endif
@@ -0,0 +1,212 @@
+#include "influence.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#define INFLUENCE_CELLS (INFLUENCE_SIZE * INFLUENCE_SIZE)
+#define INFLUENCE_LANES 4
+#define INFLUENCE_TURN_COST 0.15f
+
+typedef struct InfluenceLayerDesc
+{
+    float spread;
+    float momentum;
+    float halfLife;
+} InfluenceLayerDesc;
+
+// halfLife 0 means the caller rebuilds the source every tick.
+static const InfluenceLayerDesc gInfluenceLayers[INFLUENCE_LAYER_COUNT] = {
+    [INFLUENCE_THREAT] = {0.75f, 0.6f, 0.0f},
+    [INFLUENCE_DEATHS] = {0.6f, 0.3f, 10.0f},
+    [INFLUENCE_DENSITY] = {0.5f, 0.5f, 0.0f},
+};
+
+bool InfluenceInit(InfluenceMap *map, MemRegion region)
+{
+    memset(map, 0, sizeof(*map));
+    float *storage = (float *)RegionAlloc(region, sizeof(float) * INFLUENCE_STORAGE_FLOATS);
+    if (!storage)
+        return false;
+    InfluenceInitStorage(map, storage);
+    return true;
+}
+
+void InfluenceInitStorage(InfluenceMap *map, float *storage)
+{
+    memset(map, 0, sizeof(*map));
+    for (int l = 0; l < INFLUENCE_LAYER_COUNT; l++)
+    {
+        map->value[l] = storage + (2 * l) * INFLUENCE_CELLS;
+        map->source[l] = storage + (2 * l + 1) * INFLUENCE_CELLS;
+    }
+    map->origin = -0.5f * INFLUENCE_SIZE * INFLUENCE_CELL;
+    InfluenceReset(map);
+}
+
+void InfluenceReset(InfluenceMap *map)
+{
+    for (int l = 0; l < INFLUENCE_LAYER_COUNT; l++)
+    {
+        memset(map->value[l], 0, sizeof(float) * INFLUENCE_CELLS);
+        memset(map->source[l], 0, sizeof(float) * INFLUENCE_CELLS);
+    }
+    map->cursor = 0;
+    map->elapsed = 0.0f;
+    map->passDt = 0.0f;
+}
+
+void InfluenceClearSource(InfluenceMap *map, InfluenceLayer layer)
+{
+    memset(map->source[layer], 0, sizeof(float) * INFLUENCE_CELLS);
+}
+
+void InfluenceStamp(InfluenceMap *map, InfluenceLayer layer, Vector3 position, float amount, float radius)
+{
+    float cx = (position.x - map->origin) / INFLUENCE_CELL;
+    float cz = (position.z - map->origin) / INFLUENCE_CELL;
+    float r = radius / INFLUENCE_CELL;
+    int x0 = (int)floorf(cx - r), x1 = (int)ceilf(cx + r);
+    int z0 = (int)floorf(cz - r), z1 = (int)ceilf(cz + r);
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 > INFLUENCE_SIZE - 1) x1 = INFLUENCE_SIZE - 1;
+    if (z1 > INFLUENCE_SIZE - 1) z1 = INFLUENCE_SIZE - 1;
+    float *source = map->source[layer];
+    for (int z = z0; z <= z1; z++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            float dx = (float)x + 0.5f - cx;
+            float dz = (float)z + 0.5f - cz;
+            float d = sqrtf(dx * dx + dz * dz);
+            if (d < r)
+                source[z * INFLUENCE_SIZE + x] += amount * (1.0f - d / r);
+        }
+    }
+}
+
+#if defined(__GNUC__)
+typedef float InfluenceLane __attribute__((vector_size(16)));
+typedef int32_t InfluenceMask __attribute__((vector_size(16)));
+
+static const float gInfluenceZeroRow[INFLUENCE_SIZE] __attribute__((aligned(16)));
+
+static InfluenceLane InfluenceMax(InfluenceLane a, InfluenceLane b)
+{
+    InfluenceMask mask = a > b;
+    return (InfluenceLane)(((InfluenceMask)a & mask) | ((InfluenceMask)b & ~mask));
+}
+
+static void InfluenceRelaxRow(float *row, const float *up, const float *down, const float *source, float spread, float momentum)
+{
+    // Left/right neighbours come from a zero-padded copy so the lanes never read off the edge.
+    float padded[INFLUENCE_SIZE + 2];
+    padded[0] = 0.0f;
+    memcpy(&padded[1], row, sizeof(float) * INFLUENCE_SIZE);
+    padded[INFLUENCE_SIZE + 1] = 0.0f;
+    const InfluenceLane zero = {0.0f, 0.0f, 0.0f, 0.0f};
+    const InfluenceLane spreadLane = zero + spread;
+    const InfluenceLane momentumLane = zero + momentum;
+    for (int x = 0; x < INFLUENCE_SIZE; x += INFLUENCE_LANES)
+    {
+        InfluenceLane left, right;
+        memcpy(&left, &padded[x], sizeof(left));
+        memcpy(&right, &padded[x + 2], sizeof(right));
+        InfluenceLane n = InfluenceMax(InfluenceMax(left, right),
+                                       InfluenceMax(*(const InfluenceLane *)&up[x], *(const InfluenceLane *)&down[x]));
+        InfluenceLane target = InfluenceMax(n * spreadLane, *(const InfluenceLane *)&source[x]);
+        InfluenceLane *cell = (InfluenceLane *)&row[x];
+        *cell += (target - *cell) * momentumLane;
+    }
+}
+#else
+static const float gInfluenceZeroRow[INFLUENCE_SIZE];
+
+static void InfluenceRelaxRow(float *row, const float *up, const float *down, const float *source, float spread, float momentum)
+{
+    float previous = 0.0f;
+    for (int x = 0; x < INFLUENCE_SIZE; x++)
+    {
+        float right = x + 1 < INFLUENCE_SIZE ? row[x + 1] : 0.0f;
+        float n = fmaxf(fmaxf(previous, right), fmaxf(up[x], down[x]));
+        float target = fmaxf(n * spread, source[x]);
+        previous = row[x];
+        row[x] += (target - row[x]) * momentum;
+    }
+}
+#endif
+
+void InfluenceUpdate(InfluenceMap *map, float dt)
+{
+    map->elapsed += dt;
+    for (int r = 0; r < INFLUENCE_ROWS_PER_TICK; r++)
+    {
+        int y = map->cursor;
+        for (int l = 0; l < INFLUENCE_LAYER_COUNT; l++)
+        {
+            const InfluenceLayerDesc *desc = &gInfluenceLayers[l];
+            float *value = map->value[l];
+            float *row = &value[y * INFLUENCE_SIZE];
+            float *source = &map->source[l][y * INFLUENCE_SIZE];
+            // Each row is revisited once per pass, so persistent sources fade by the last pass length.
+            if (desc->halfLife > 0.0f && map->passDt > 0.0f)
+            {
+                float keep = exp2f(-map->passDt / desc->halfLife);
+                for (int x = 0; x < INFLUENCE_SIZE; x++)
+                    source[x] *= keep;
+            }
+            const float *up = y > 0 ? row - INFLUENCE_SIZE : gInfluenceZeroRow;
+            const float *down = y < INFLUENCE_SIZE - 1 ? row + INFLUENCE_SIZE : gInfluenceZeroRow;
+            InfluenceRelaxRow(row, up, down, source, desc->spread, desc->momentum);
+        }
+        map->cursor = (map->cursor + 1) % INFLUENCE_SIZE;
+        if (map->cursor == 0)
+        {
+            map->passDt = map->elapsed;
+            map->elapsed = 0.0f;
+        }
+    }
+}
+
+float InfluenceSample(const InfluenceMap *map, InfluenceLayer layer, Vector3 position)
+{
+    float fx = (position.x - map->origin) / INFLUENCE_CELL - 0.5f;
+    float fz = (position.z - map->origin) / INFLUENCE_CELL - 0.5f;
+    fx = fminf(fmaxf(fx, 0.0f), (float)(INFLUENCE_SIZE - 1));
+    fz = fminf(fmaxf(fz, 0.0f), (float)(INFLUENCE_SIZE - 1));
+    int x0 = (int)fx, z0 = (int)fz;
+    int x1 = x0 + 1 < INFLUENCE_SIZE ? x0 + 1 : x0;
+    int z1 = z0 + 1 < INFLUENCE_SIZE ? z0 + 1 : z0;
+    float tx = fx - (float)x0, tz = fz - (float)z0;
+    const float *v = map->value[layer];
+    float a = v[z0 * INFLUENCE_SIZE + x0] + (v[z0 * INFLUENCE_SIZE + x1] - v[z0 * INFLUENCE_SIZE + x0]) * tx;
+    float b = v[z1 * INFLUENCE_SIZE + x0] + (v[z1 * INFLUENCE_SIZE + x1] - v[z1 * INFLUENCE_SIZE + x0]) * tx;
+    return a + (b - a) * tz;
+}
+
+Vector3 InfluenceSteer(const InfluenceMap *map, Vector3 position, Vector3 dir, float lookahead, const float weights[INFLUENCE_LAYER_COUNT])
+{
+    static const float angles[] = {0.0f, 0.45f, -0.45f, 0.9f, -0.9f};
+    Vector3 best = dir;
+    float bestCost = INFINITY;
+    for (int a = 0; a < (int)(sizeof(angles) / sizeof(angles[0])); a++)
+    {
+        float c = cosf(angles[a]);
+        float s = sinf(angles[a]);
+        Vector3 heading = {dir.x * c - dir.z * s, 0.0f, dir.x * s + dir.z * c};
+        Vector3 probe = {position.x + heading.x * lookahead, 0.0f, position.z + heading.z * lookahead};
+        float cost = (1.0f - c) * INFLUENCE_TURN_COST;
+        for (int l = 0; l < INFLUENCE_LAYER_COUNT; l++)
+        {
+            if (weights[l] != 0.0f)
+                cost += weights[l] * InfluenceSample(map, (InfluenceLayer)l, probe);
+        }
+        if (cost < bestCost)
+        {
+            bestCost = cost;
+            best = heading;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,50 @@
+#ifndef U8_INFLUENCE_H
+#define U8_INFLUENCE_H
+
+#include <stdbool.h>
+
+#include "raylib.h"
+#include "region.h"
+
+#define INFLUENCE_SIZE 32
+#define INFLUENCE_CELL 1.0f
+#define INFLUENCE_ROWS_PER_TICK 8
+// Floats behind one map: a value and a source grid per layer.
+#define INFLUENCE_STORAGE_FLOATS (2 * INFLUENCE_LAYER_COUNT * INFLUENCE_SIZE * INFLUENCE_SIZE)
+
+typedef enum InfluenceLayer
+{
+    INFLUENCE_THREAT,
+    INFLUENCE_DEATHS,
+    INFLUENCE_DENSITY,
+    INFLUENCE_LAYER_COUNT
+} InfluenceLayer;
+
+// Square grids centred on the arena origin. Callers stamp sources; each update
+// relaxes a fixed band of rows towards max(source, decayed neighbours), so the
+// cost per tick is set by the grid, not by how many zombies write into it.
+typedef struct InfluenceMap
+{
+    float *value[INFLUENCE_LAYER_COUNT];
+    float *source[INFLUENCE_LAYER_COUNT];
+    float origin;
+    int cursor;
+    float elapsed;
+    float passDt;
+} InfluenceMap;
+
+bool InfluenceInit(InfluenceMap *map, MemRegion region);
+// For maps that live outside the regions; storage must be 16-byte aligned and
+// INFLUENCE_STORAGE_FLOATS long.
+void InfluenceInitStorage(InfluenceMap *map, float *storage);
+void InfluenceReset(InfluenceMap *map);
+// Threat and density are rebuilt every tick; deaths persist and fade on their own.
+void InfluenceClearSource(InfluenceMap *map, InfluenceLayer layer);
+void InfluenceStamp(InfluenceMap *map, InfluenceLayer layer, Vector3 position, float amount, float radius);
+void InfluenceUpdate(InfluenceMap *map, float dt);
+float InfluenceSample(const InfluenceMap *map, InfluenceLayer layer, Vector3 position);
+// Picks among a fan of headings around dir the one whose lookahead point is
+// cheapest under the weighted layers, with a small penalty for turning.
+Vector3 InfluenceSteer(const InfluenceMap *map, Vector3 position, Vector3 dir, float lookahead, const float weights[INFLUENCE_LAYER_COUNT]);
+
+#endif
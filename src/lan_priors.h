@@ -0,0 +1,20 @@
+// Starting statistics for the LAN codec contexts. Regenerate from live traffic
+// with --train-lan-models <path> and replace this file with the output.
+// Trained on 7781 packets from a loopback soak (--soak 0.1 --bots 4
+// --train-lan-models). Soak bots never switch weapons, fire or raise events,
+// so the weapon, share, flags, ray, id and event rows keep hand-set values.
+static const LanPriorCounts gLanPriorCounts[LAN_CTX_COUNT] = {
+    [LAN_CTX_POSITION] = {{6841, 57, 95, 167, 369, 763, 1659, 2751, 4947, 4420, 1285, 1, 1, 1, 1, 1, 1}, 1, 1},
+    [LAN_CTX_WEAPON] = {{120, 4, 6, 4, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 1, 1},
+    [LAN_CTX_AMMO] = {{6802, 1, 1, 1, 1, 1, 1, 1, 981, 1, 1, 1, 1, 1, 1, 1, 1}, 1, 1},
+    [LAN_CTX_HEALTH] = {{6587, 781, 1, 1, 10, 8, 229, 98, 75, 1, 1, 1, 1, 1, 1, 1, 1}, 1, 1},
+    [LAN_CTX_SHARE] = {{150, 1, 1, 2, 4, 6, 6, 4, 2, 1, 1, 1, 1, 1, 1, 1, 1}, 1, 1},
+    [LAN_CTX_ECONOMY] = {{13251, 1, 1, 1, 1, 1, 1, 465, 489, 110, 774, 106, 233, 142, 1, 1, 1}, 1, 1},
+    [LAN_CTX_FLAGS] = {{1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 120, 6},
+    [LAN_CTX_TEXT] = {{1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 181845, 4901},
+    [LAN_CTX_JOIN] = {{2302, 1, 4192, 330, 16, 26, 56, 105, 177, 349, 238, 1, 1, 1, 1, 1, 1}, 1, 1},
+    [LAN_CTX_RAY] = {{160, 1, 1, 1, 1, 2, 3, 4, 5, 6, 6, 6, 4, 2, 1, 1, 1}, 1, 1},
+    [LAN_CTX_ID] = {{150, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1}, 1, 1},
+    [LAN_CTX_EVENT] = {{150, 4, 4, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 1, 1},
+    [LAN_CTX_CHECKSUM] = {{27, 31, 68, 92, 142, 244, 378, 1116, 1296, 2092, 1284, 43, 932, 50, 1, 1, 1}, 1, 1},
+};
@@ -0,0 +1,351 @@
+#include "lancodec.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "rangecoder.h"
+
+#include "lan_priors.h"
+
+typedef enum LanFieldCoding
+{
+    LAN_FIELD_NUMERIC, // big-endian integer, coded as a zigzag delta
+    LAN_FIELD_BYTES    // opaque bytes, coded as same-as-base or literal
+} LanFieldCoding;
+
+typedef struct LanField
+{
+    uint8_t offset;
+    uint8_t bytes;
+    LanFieldCoding coding;
+    LanFieldContext context;
+} LanField;
+
+// Mirrors the byte layout written by PackLanPayload in main.c.
+static const LanField gLanFields[] = {
+    {0, 2, LAN_FIELD_NUMERIC, LAN_CTX_POSITION},
+    {2, 2, LAN_FIELD_NUMERIC, LAN_CTX_POSITION},
+    {4, 2, LAN_FIELD_NUMERIC, LAN_CTX_POSITION},
+    {6, 1, LAN_FIELD_NUMERIC, LAN_CTX_WEAPON},
+    {7, 2, LAN_FIELD_NUMERIC, LAN_CTX_AMMO},
+    {9, 1, LAN_FIELD_NUMERIC, LAN_CTX_HEALTH},
+    {10, 1, LAN_FIELD_NUMERIC, LAN_CTX_SHARE},
+    {11, 1, LAN_FIELD_NUMERIC, LAN_CTX_SHARE},
+    {12, 2, LAN_FIELD_NUMERIC, LAN_CTX_ECONOMY},
+    {14, 2, LAN_FIELD_NUMERIC, LAN_CTX_ECONOMY},
+    {16, 1, LAN_FIELD_BYTES, LAN_CTX_FLAGS},
+    {17, 12, LAN_FIELD_BYTES, LAN_CTX_TEXT},
+    {29, 2, LAN_FIELD_NUMERIC, LAN_CTX_JOIN},
+    {31, 2, LAN_FIELD_NUMERIC, LAN_CTX_RAY},
+    {33, 2, LAN_FIELD_NUMERIC, LAN_CTX_RAY},
+    {35, 2, LAN_FIELD_NUMERIC, LAN_CTX_RAY},
+    {37, 2, LAN_FIELD_NUMERIC, LAN_CTX_RAY},
+    {39, 2, LAN_FIELD_NUMERIC, LAN_CTX_RAY},
+    {41, 2, LAN_FIELD_NUMERIC, LAN_CTX_RAY},
+    {43, 1, LAN_FIELD_NUMERIC, LAN_CTX_RAY},
+    {44, 1, LAN_FIELD_NUMERIC, LAN_CTX_ID},
+    {45, 1, LAN_FIELD_NUMERIC, LAN_CTX_EVENT},
+    {46, 1, LAN_FIELD_NUMERIC, LAN_CTX_EVENT},
+    {47, 1, LAN_FIELD_NUMERIC, LAN_CTX_ID},
+    {48, 12, LAN_FIELD_BYTES, LAN_CTX_TEXT},
+    {60, 2, LAN_FIELD_NUMERIC, LAN_CTX_CHECKSUM},
+};
+
+#define LAN_FIELD_COUNT ((int)(sizeof(gLanFields) / sizeof(gLanFields[0])))
+#define LAN_LENGTH_TREE_BITS 5
+
+static const char *gLanContextNames[LAN_CTX_COUNT] = {
+    [LAN_CTX_POSITION] = "LAN_CTX_POSITION",
+    [LAN_CTX_WEAPON] = "LAN_CTX_WEAPON",
+    [LAN_CTX_AMMO] = "LAN_CTX_AMMO",
+    [LAN_CTX_HEALTH] = "LAN_CTX_HEALTH",
+    [LAN_CTX_SHARE] = "LAN_CTX_SHARE",
+    [LAN_CTX_ECONOMY] = "LAN_CTX_ECONOMY",
+    [LAN_CTX_FLAGS] = "LAN_CTX_FLAGS",
+    [LAN_CTX_TEXT] = "LAN_CTX_TEXT",
+    [LAN_CTX_JOIN] = "LAN_CTX_JOIN",
+    [LAN_CTX_RAY] = "LAN_CTX_RAY",
+    [LAN_CTX_ID] = "LAN_CTX_ID",
+    [LAN_CTX_EVENT] = "LAN_CTX_EVENT",
+    [LAN_CTX_CHECKSUM] = "LAN_CTX_CHECKSUM",
+};
+
+typedef struct LanContextModel
+{
+    RcProb length[1 << LAN_LENGTH_TREE_BITS];
+    RcProb mantissa[16];
+    RcProb same;
+    RcProb literal[256];
+} LanContextModel;
+
+typedef struct LanModels
+{
+    LanContextModel contexts[LAN_CTX_COUNT];
+} LanModels;
+
+// Models restart from the priors on every packet so each datagram decodes on its own.
+static LanModels gLanPriorModels;
+static bool gLanTraining;
+static LanPriorCounts gLanTrainCounts[LAN_CTX_COUNT];
+static uint32_t gLanTrainPackets;
+
+static RcProb LanProbFromCounts(uint64_t zeros, uint64_t ones)
+{
+    uint64_t p = ((zeros + 1) * RC_PROB_ONE) / (zeros + ones + 2);
+    if (p < 31)
+        p = 31;
+    if (p > RC_PROB_ONE - 31)
+        p = RC_PROB_ONE - 31;
+    return (RcProb)p;
+}
+
+static void LanBuildContext(LanContextModel *m, const LanPriorCounts *counts)
+{
+    // Each tree node's probability is the share of leaf counts under its zero branch.
+    uint64_t leaves[1 << LAN_LENGTH_TREE_BITS] = {0};
+    for (int i = 0; i < LAN_LENGTH_SYMBOLS; i++)
+        leaves[i] = counts->length[i];
+    for (int node = 1; node < (1 << LAN_LENGTH_TREE_BITS); node++)
+    {
+        int depth = 0;
+        while ((node >> (depth + 1)) != 0)
+            depth++;
+        int span = 1 << (LAN_LENGTH_TREE_BITS - depth - 1);
+        int first = (node - (1 << depth)) * span * 2;
+        uint64_t zeros = 0;
+        uint64_t ones = 0;
+        for (int i = 0; i < span; i++)
+        {
+            zeros += leaves[first + i];
+            ones += leaves[first + span + i];
+        }
+        m->length[node] = LanProbFromCounts(zeros, ones);
+    }
+    for (int i = 0; i < 16; i++)
+        m->mantissa[i] = RC_PROB_HALF;
+    m->same = LanProbFromCounts(counts->changed, counts->same);
+    for (int i = 0; i < 256; i++)
+        m->literal[i] = RC_PROB_HALF;
+}
+
+void LanCodecInit(void)
+{
+    for (int c = 0; c < LAN_CTX_COUNT; c++)
+        LanBuildContext(&gLanPriorModels.contexts[c], &gLanPriorCounts[c]);
+}
+
+void LanCodecRequestKeyframe(LanCodecState *tx)
+{
+    tx->sinceKeyframe = LAN_CODEC_KEYFRAME_INTERVAL;
+}
+
+static uint32_t LanReadField(const uint8_t *raw, const LanField *f)
+{
+    return f->bytes == 2 ? (uint32_t)((raw[f->offset] << 8) | raw[f->offset + 1]) : raw[f->offset];
+}
+
+static void LanWriteField(uint8_t *raw, const LanField *f, uint32_t value)
+{
+    if (f->bytes == 2)
+    {
+        raw[f->offset] = (uint8_t)((value >> 8) & 0xFF);
+        raw[f->offset + 1] = (uint8_t)(value & 0xFF);
+    }
+    else
+    {
+        raw[f->offset] = (uint8_t)value;
+    }
+}
+
+static int LanBitLength(uint32_t v)
+{
+    int n = 0;
+    while (v)
+    {
+        n++;
+        v >>= 1;
+    }
+    return n;
+}
+
+static void LanEncodeFields(RangeEncoder *rc, LanModels *m, const uint8_t *raw, const uint8_t *base)
+{
+    for (int i = 0; i < LAN_FIELD_COUNT; i++)
+    {
+        const LanField *f = &gLanFields[i];
+        LanContextModel *ctx = &m->contexts[f->context];
+        if (f->coding == LAN_FIELD_BYTES)
+        {
+            for (int b = 0; b < f->bytes; b++)
+            {
+                uint8_t value = raw[f->offset + b];
+                int changed = value != base[f->offset + b];
+                RcEncodeBit(rc, &ctx->same, changed);
+                if (changed)
+                    RcEncodeTree(rc, ctx->literal, 8, value);
+                if (gLanTraining)
+                {
+                    if (changed)
+                        gLanTrainCounts[f->context].changed++;
+                    else
+                        gLanTrainCounts[f->context].same++;
+                }
+            }
+            continue;
+        }
+
+        int bits = f->bytes * 8;
+        uint32_t mask = (1u << bits) - 1;
+        uint32_t delta = (LanReadField(raw, f) - LanReadField(base, f)) & mask;
+        uint32_t sign = (delta >> (bits - 1)) & 1u;
+        uint32_t zigzag = ((delta << 1) ^ (sign ? mask : 0)) & mask;
+        int length = LanBitLength(zigzag);
+        RcEncodeTree(rc, ctx->length, LAN_LENGTH_TREE_BITS, (uint32_t)length);
+        for (int b = length - 2; b >= 0; b--)
+            RcEncodeBit(rc, &ctx->mantissa[b], (int)((zigzag >> b) & 1u));
+        if (gLanTraining)
+            gLanTrainCounts[f->context].length[length]++;
+    }
+}
+
+static void LanDecodeFields(RangeDecoder *rc, LanModels *m, uint8_t *raw, const uint8_t *base)
+{
+    for (int i = 0; i < LAN_FIELD_COUNT; i++)
+    {
+        const LanField *f = &gLanFields[i];
+        LanContextModel *ctx = &m->contexts[f->context];
+        if (f->coding == LAN_FIELD_BYTES)
+        {
+            for (int b = 0; b < f->bytes; b++)
+            {
+                if (RcDecodeBit(rc, &ctx->same))
+                    raw[f->offset + b] = (uint8_t)RcDecodeTree(rc, ctx->literal, 8);
+                else
+                    raw[f->offset + b] = base[f->offset + b];
+            }
+            continue;
+        }
+
+        int bits = f->bytes * 8;
+        uint32_t mask = (1u << bits) - 1;
+        int length = (int)RcDecodeTree(rc, ctx->length, LAN_LENGTH_TREE_BITS);
+        if (length > bits)
+            length = bits;
+        uint32_t zigzag = length > 0 ? 1u << (length - 1) : 0;
+        for (int b = length - 2; b >= 0; b--)
+            zigzag |= (uint32_t)RcDecodeBit(rc, &ctx->mantissa[b]) << b;
+        uint32_t delta = ((zigzag >> 1) ^ ((zigzag & 1u) ? mask : 0)) & mask;
+        LanWriteField(raw, f, (LanReadField(base, f) + delta) & mask);
+    }
+}
+
+size_t LanCodecEncode(LanCodecState *tx, const uint8_t *raw, uint8_t *out, size_t capacity, bool *keyframe)
+{
+    static const uint8_t zeros[LAN_RAW_PAYLOAD_BYTES] = {0};
+    bool key = !tx->hasBase || tx->sinceKeyframe >= LAN_CODEC_KEYFRAME_INTERVAL;
+    uint8_t seq = (uint8_t)(tx->seq + 1);
+
+    static LanModels models;
+    memcpy(&models, &gLanPriorModels, sizeof(models));
+    RangeEncoder rc;
+    size_t coded = 0;
+    if (capacity > LAN_CODEC_HEADER_BYTES)
+    {
+        RcEncoderInit(&rc, out + LAN_CODEC_HEADER_BYTES, capacity - LAN_CODEC_HEADER_BYTES);
+        LanEncodeFields(&rc, &models, raw, key ? zeros : tx->base);
+        coded = RcEncoderFinish(&rc);
+    }
+    if (gLanTraining)
+        gLanTrainPackets++;
+
+    size_t total = LAN_CODEC_HEADER_BYTES + coded;
+    if (coded == 0 || total >= LAN_CODEC_RAW_BYTES)
+    {
+        // Raw payloads carry no history, so the next coded packet must be a keyframe.
+        if (capacity < LAN_CODEC_RAW_BYTES)
+            return 0;
+        out[0] = LAN_CODEC_RAW_MAGIC;
+        memcpy(out + 1, raw, LAN_RAW_PAYLOAD_BYTES);
+        LanCodecRequestKeyframe(tx);
+        if (keyframe)
+            *keyframe = true;
+        return LAN_CODEC_RAW_BYTES;
+    }
+
+    out[0] = LAN_CODEC_MAGIC;
+    out[1] = seq;
+    out[2] = key ? seq : tx->baseSeq;
+    tx->seq = seq;
+    if (key)
+    {
+        memcpy(tx->base, raw, LAN_RAW_PAYLOAD_BYTES);
+        tx->baseSeq = seq;
+        tx->hasBase = true;
+        tx->sinceKeyframe = 0;
+    }
+    tx->sinceKeyframe++;
+    if (keyframe)
+        *keyframe = key;
+    return total;
+}
+
+bool LanCodecDecode(LanCodecState *rx, const uint8_t *in, size_t len, uint8_t *raw)
+{
+    static const uint8_t zeros[LAN_RAW_PAYLOAD_BYTES] = {0};
+    if (len == LAN_CODEC_RAW_BYTES && in[0] == LAN_CODEC_RAW_MAGIC)
+    {
+        memcpy(raw, in + 1, LAN_RAW_PAYLOAD_BYTES);
+        return true;
+    }
+    if (len < LAN_CODEC_HEADER_BYTES || in[0] != LAN_CODEC_MAGIC)
+        return false;
+
+    uint8_t seq = in[1];
+    uint8_t baseSeq = in[2];
+    bool key = seq == baseSeq;
+    if (!key && (!rx->hasBase || rx->baseSeq != baseSeq))
+        return false;
+
+    static LanModels models;
+    memcpy(&models, &gLanPriorModels, sizeof(models));
+    RangeDecoder rc;
+    RcDecoderInit(&rc, in + LAN_CODEC_HEADER_BYTES, len - LAN_CODEC_HEADER_BYTES);
+    LanDecodeFields(&rc, &models, raw, key ? zeros : rx->base);
+    if (key)
+    {
+        memcpy(rx->base, raw, LAN_RAW_PAYLOAD_BYTES);
+        rx->baseSeq = seq;
+        rx->hasBase = true;
+    }
+    rx->seq = seq;
+    return true;
+}
+
+void LanCodecTrainBegin(void)
+{
+    memset(gLanTrainCounts, 0, sizeof(gLanTrainCounts));
+    gLanTrainPackets = 0;
+    gLanTraining = true;
+}
+
+bool LanCodecWritePriors(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+    fprintf(f, "// Starting statistics for the LAN codec contexts. Regenerate from live traffic\n");
+    fprintf(f, "// with --train-lan-models <path> and replace this file with the output.\n");
+    fprintf(f, "// Trained on %u packets.\n", gLanTrainPackets);
+    fprintf(f, "static const LanPriorCounts gLanPriorCounts[LAN_CTX_COUNT] = {\n");
+    for (int c = 0; c < LAN_CTX_COUNT; c++)
+    {
+        // Add-one smoothing keeps every symbol codable after training.
+        fprintf(f, "    [%s] = {{", gLanContextNames[c]);
+        for (int i = 0; i < LAN_LENGTH_SYMBOLS; i++)
+            fprintf(f, "%s%u", i ? ", " : "", gLanTrainCounts[c].length[i] + 1);
+        fprintf(f, "}, %u, %u},\n", gLanTrainCounts[c].same + 1, gLanTrainCounts[c].changed + 1);
+    }
+    fprintf(f, "};\n");
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef U8_LANCODEC_H
+#define U8_LANCODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of the fixed, quantized LAN payload as laid out by PackLanPayload.
+#define LAN_RAW_PAYLOAD_BYTES 62
+#define LAN_CODEC_MAGIC 0xC5
+// Payloads that coding would not shrink go out whole behind this tag, so no
+// other packet kind of the same length can be mistaken for one.
+#define LAN_CODEC_RAW_MAGIC 0xC6
+#define LAN_CODEC_RAW_BYTES (1 + LAN_RAW_PAYLOAD_BYTES)
+#define LAN_CODEC_HEADER_BYTES 3
+#define LAN_CODEC_KEYFRAME_INTERVAL 8
+#define LAN_LENGTH_SYMBOLS 17
+
+// Fields of the same type share one adaptive context.
+typedef enum LanFieldContext
+{
+    LAN_CTX_POSITION,
+    LAN_CTX_WEAPON,
+    LAN_CTX_AMMO,
+    LAN_CTX_HEALTH,
+    LAN_CTX_SHARE,
+    LAN_CTX_ECONOMY,
+    LAN_CTX_FLAGS,
+    LAN_CTX_TEXT,
+    LAN_CTX_JOIN,
+    LAN_CTX_RAY,
+    LAN_CTX_ID,
+    LAN_CTX_EVENT,
+    LAN_CTX_CHECKSUM,
+    LAN_CTX_COUNT
+} LanFieldContext;
+
+// Symbol statistics a context starts from: how often each delta bit length
+// appears, and how often a byte-wise field repeats its base.
+typedef struct LanPriorCounts
+{
+    uint32_t length[LAN_LENGTH_SYMBOLS];
+    uint32_t same;
+    uint32_t changed;
+} LanPriorCounts;
+
+// Deltas are taken against the sender's latest keyframe rather than the
+// previous packet, so one lost delta never breaks the ones after it.
+typedef struct LanCodecState
+{
+    uint8_t base[LAN_RAW_PAYLOAD_BYTES];
+    uint8_t baseSeq;
+    uint8_t seq;
+    int sinceKeyframe;
+    bool hasBase;
+} LanCodecState;
+
+void LanCodecInit(void);
+// Forces the next encoded packet to be a keyframe (e.g. when a peer joins).
+void LanCodecRequestKeyframe(LanCodecState *tx);
+// Writes a coded packet, or the tagged raw payload when coding would not save space.
+// *keyframe reports whether the packet can be decoded without history.
+size_t LanCodecEncode(LanCodecState *tx, const uint8_t *raw, uint8_t *out, size_t capacity, bool *keyframe);
+// Accepts coded and tagged raw packets; fails on anything else and when a delta's keyframe is missing.
+bool LanCodecDecode(LanCodecState *rx, const uint8_t *in, size_t len, uint8_t *raw);
+
+void LanCodecTrainBegin(void);
+// Writes the symbol counts gathered since LanCodecTrainBegin as a lan_priors.h replacement.
+bool LanCodecWritePriors(const char *path);
+
+#endif
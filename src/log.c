@@ -0,0 +1,313 @@
+#define _POSIX_C_SOURCE 200809L
+#include "log.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG_FILE_MAGIC "U8LG"
+#define LOG_FILE_VERSION 1
+#define LOG_DRAIN_INTERVAL_NS 10000000L
+#define LOG_MAX_DECODE_FORMATS 256
+
+_Static_assert(LOG_MAX_THREADS > TASK_MAX_WORKERS, "the hitch writer needs a log ring beside the frame graph's workers");
+
+typedef struct LogFormatInfo
+{
+    const char *text;
+    const char *types;
+} LogFormatInfo;
+
+static const LogFormatInfo gLogFormats[LOG_FORMAT_COUNT] = {
+    [LOG_NONE] = {"", ""},
+    [LOG_LAN_PEER_JOINED] = {"lan: peer slot %d joined from .%d", "ii"},
+    [LOG_LAN_PEER_TIMEOUT] = {"lan: peer slot %d timed out after %f s", "if"},
+    [LOG_LAN_BAD_PACKET] = {"lan: dropped %d byte packet", "i"},
+    [LOG_LAN_EVENT] = {"lan: event kind %d id %d from slot %d", "iii"},
+    [LOG_LAN_MOVE_CORRECTED] = {"lan: corrected slot %d move by %f m", "if"},
+    [LOG_LAN_JOIN_SYNCED] = {"lan: joined at wave %d from a %d byte snapshot after %f ms", "iif"},
+    [LOG_LAN_JOIN_LAYOUT_MISMATCH] = {"lan: arena %d layout differs from the host's", "i"},
+    [LOG_ZOMBIES_SPAWN] = {"zombies: spawned type %d in wave %d (%d active)", "iii"},
+    [LOG_ZOMBIES_WAVE] = {"zombies: wave %d started", "i"},
+    [LOG_ZOMBIES_PLAYER_HIT] = {"zombies: type %d hit player for %f (health %f)", "iff"},
+    [LOG_COMBAT_KILL] = {"combat: killed type %d for $%d", "ii"},
+    [LOG_COMBAT_FRAG] = {"combat: fragged peer slot %d", "i"},
+    [LOG_PLAYER_DOWNED] = {"player: downed in wave %d", "i"},
+    [LOG_HITCH_DUMPED] = {"hitch: wrote dump %d after a %f ms frame", "if"},
+    [LOG_REGION_OVERFLOW] = {"region: %d refused %d bytes (%d left)", "iii"},
+    [LOG_REGION_REPORT] = {"region: %d high water %d of %d bytes, %d overflows", "iiii"},
+    [LOG_CVAR_SET] = {"cvar: %d set to %f", "if"},
+    [LOG_LAN_HOST_ELECTED] = {"lan: host is now slot %d (-1 is us)", "i"},
+};
+
+// Single-producer/single-consumer ring: the owning thread advances head, the
+// writer thread advances tail. The pad keeps the two indices on separate lines.
+typedef struct LogRing
+{
+    LogRecord records[LOG_RING_CAPACITY];
+    uint32_t head;
+    char pad[60];
+    uint32_t tail;
+    uint64_t dropped;
+} LogRing;
+
+typedef struct LogState
+{
+    LogRing rings[LOG_MAX_THREADS];
+    uint32_t ringCount;
+    uint64_t unregisteredDropped;
+    bool running;
+    FILE *file;
+    pthread_t writer;
+} LogState;
+
+static LogState gLog;
+static __thread LogRing *tLogRing;
+static __thread bool tLogRingFull;
+
+static uint64_t LogNowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static LogRing *LogThreadRing(void)
+{
+    if (tLogRing || tLogRingFull)
+        return tLogRing;
+    uint32_t slot = __atomic_fetch_add(&gLog.ringCount, 1, __ATOMIC_ACQ_REL);
+    if (slot >= LOG_MAX_THREADS)
+    {
+        tLogRingFull = true;
+        return NULL;
+    }
+    tLogRing = &gLog.rings[slot];
+    return tLogRing;
+}
+
+static size_t LogDrainRings(void)
+{
+    size_t written = 0;
+    uint32_t count = __atomic_load_n(&gLog.ringCount, __ATOMIC_ACQUIRE);
+    if (count > LOG_MAX_THREADS)
+        count = LOG_MAX_THREADS;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        LogRing *ring = &gLog.rings[i];
+        uint32_t tail = ring->tail;
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        while (tail != head)
+        {
+            uint32_t index = tail & (LOG_RING_CAPACITY - 1);
+            uint32_t run = head - tail;
+            if (run > LOG_RING_CAPACITY - index)
+                run = LOG_RING_CAPACITY - index;
+            fwrite(&ring->records[index], sizeof(LogRecord), run, gLog.file);
+            tail += run;
+            written += run;
+        }
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+    return written;
+}
+
+static void *LogWriterMain(void *arg)
+{
+    (void)arg;
+    struct timespec interval = {0, LOG_DRAIN_INTERVAL_NS};
+    while (__atomic_load_n(&gLog.running, __ATOMIC_ACQUIRE))
+    {
+        if (LogDrainRings() > 0)
+            fflush(gLog.file);
+        nanosleep(&interval, NULL);
+    }
+    return NULL;
+}
+
+static void LogWriteHeader(FILE *f)
+{
+    uint16_t version = LOG_FILE_VERSION;
+    uint16_t formatCount = LOG_FORMAT_COUNT;
+    uint64_t startNs = LogNowNs();
+    fwrite(LOG_FILE_MAGIC, 1, 4, f);
+    fwrite(&version, sizeof(version), 1, f);
+    fwrite(&formatCount, sizeof(formatCount), 1, f);
+    fwrite(&startNs, sizeof(startNs), 1, f);
+    for (int i = 0; i < LOG_FORMAT_COUNT; i++)
+    {
+        uint8_t textLen = (uint8_t)strlen(gLogFormats[i].text);
+        uint8_t typeLen = (uint8_t)strlen(gLogFormats[i].types);
+        fwrite(&textLen, 1, 1, f);
+        fwrite(gLogFormats[i].text, 1, textLen, f);
+        fwrite(&typeLen, 1, 1, f);
+        fwrite(gLogFormats[i].types, 1, typeLen, f);
+    }
+}
+
+bool LogInit(const char *path)
+{
+    memset(&gLog, 0, sizeof(gLog));
+    gLog.file = fopen(path, "wb");
+    if (!gLog.file)
+        return false;
+    LogWriteHeader(gLog.file);
+
+    LogThreadRing();
+    gLog.running = true;
+    if (pthread_create(&gLog.writer, NULL, LogWriterMain, NULL) != 0)
+    {
+        gLog.running = false;
+        fclose(gLog.file);
+        gLog.file = NULL;
+        return false;
+    }
+    return true;
+}
+
+void LogShutdown(void)
+{
+    if (!gLog.file)
+        return;
+    __atomic_store_n(&gLog.running, false, __ATOMIC_RELEASE);
+    pthread_join(gLog.writer, NULL);
+    LogDrainRings();
+    fclose(gLog.file);
+    gLog.file = NULL;
+}
+
+void LogWrite(LogFormat format, ...)
+{
+    if (!__atomic_load_n(&gLog.running, __ATOMIC_RELAXED) || format <= LOG_NONE || format >= LOG_FORMAT_COUNT)
+        return;
+
+    LogRing *ring = LogThreadRing();
+    if (!ring)
+    {
+        __atomic_fetch_add(&gLog.unregisteredDropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= LOG_RING_CAPACITY)
+    {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    LogRecord *record = &ring->records[head & (LOG_RING_CAPACITY - 1)];
+    record->timeNs = LogNowNs();
+    record->format = (uint16_t)format;
+    record->thread = (uint8_t)(ring - gLog.rings);
+    record->reserved = 0;
+
+    const char *types = gLogFormats[format].types;
+    int argCount = 0;
+    va_list args;
+    va_start(args, format);
+    for (; types[argCount] && argCount < LOG_MAX_ARGS; argCount++)
+    {
+        if (types[argCount] == 'f')
+            record->args[argCount].f = va_arg(args, double);
+        else
+            record->args[argCount].i = va_arg(args, int);
+    }
+    va_end(args);
+    record->argCount = (uint8_t)argCount;
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+uint64_t LogDroppedCount(void)
+{
+    uint64_t dropped = __atomic_load_n(&gLog.unregisteredDropped, __ATOMIC_RELAXED);
+    for (int i = 0; i < LOG_MAX_THREADS; i++)
+        dropped += __atomic_load_n(&gLog.rings[i].dropped, __ATOMIC_RELAXED);
+    return dropped;
+}
+
+static void LogPrintRecord(FILE *out, const LogRecord *record, const char *text, const char *types, uint64_t baseNs)
+{
+    fprintf(out, "[%12.6f] T%u ", (double)((int64_t)(record->timeNs - baseNs)) / 1e9, record->thread);
+    // The count comes from the file, so never trust it past the args array or
+    // the format's own type string.
+    int argCount = record->argCount;
+    if (argCount > LOG_MAX_ARGS)
+        argCount = LOG_MAX_ARGS;
+    if (argCount > (int)strlen(types))
+        argCount = (int)strlen(types);
+    int arg = 0;
+    for (const char *c = text; *c; c++)
+    {
+        if (c[0] == '%' && c[1] == '%')
+        {
+            fputc('%', out);
+            c++;
+        }
+        else if (c[0] == '%' && c[1] && arg < argCount)
+        {
+            if (types[arg] == 'f')
+                fprintf(out, "%.3f", record->args[arg].f);
+            else
+                fprintf(out, "%lld", (long long)record->args[arg].i);
+            arg++;
+            c++;
+        }
+        else
+        {
+            fputc(*c, out);
+        }
+    }
+    fputc('\n', out);
+}
+
+bool LogDecodeFile(const char *path, FILE *out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    char magic[4];
+    uint16_t version = 0;
+    uint16_t formatCount = 0;
+    uint64_t startNs = 0;
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, LOG_FILE_MAGIC, 4) != 0 ||
+        fread(&version, sizeof(version), 1, f) != 1 || version != LOG_FILE_VERSION ||
+        fread(&formatCount, sizeof(formatCount), 1, f) != 1 || formatCount > LOG_MAX_DECODE_FORMATS ||
+        fread(&startNs, sizeof(startNs), 1, f) != 1)
+    {
+        fclose(f);
+        return false;
+    }
+
+    // The file carries its own format table, so older logs decode with newer builds.
+    static char texts[LOG_MAX_DECODE_FORMATS][256];
+    static char types[LOG_MAX_DECODE_FORMATS][LOG_MAX_ARGS + 1];
+    for (int i = 0; i < formatCount; i++)
+    {
+        uint8_t textLen = 0;
+        uint8_t typeLen = 0;
+        if (fread(&textLen, 1, 1, f) != 1 || fread(texts[i], 1, textLen, f) != textLen ||
+            fread(&typeLen, 1, 1, f) != 1 || typeLen > LOG_MAX_ARGS || fread(types[i], 1, typeLen, f) != typeLen)
+        {
+            fclose(f);
+            return false;
+        }
+        texts[i][textLen] = '\0';
+        types[i][typeLen] = '\0';
+    }
+
+    // Records are grouped per thread in drain order; sort the text with the
+    // timestamp column if a strict cross-thread ordering is needed.
+    LogRecord record;
+    while (fread(&record, sizeof(record), 1, f) == 1)
+    {
+        if (record.format >= formatCount)
+            continue;
+        LogPrintRecord(out, &record, texts[record.format], types[record.format], startNs);
+    }
+    fclose(f);
+    return true;
+}
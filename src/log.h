@@ -0,0 +1,66 @@
+#ifndef U8_LOG_H
+#define U8_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "task.h"
+
+#define LOG_MAX_ARGS 4
+#define LOG_RING_CAPACITY 1024
+// One ring per thread that logs: every frame-graph worker, the game thread
+// among them, plus the hitch writer.
+#define LOG_HELPER_THREADS 1
+#define LOG_MAX_THREADS (TASK_MAX_WORKERS + LOG_HELPER_THREADS)
+
+// Every log site uses a fixed format ID; the text lives in the format table and is
+// only expanded by the offline decoder, so writing a record never touches stdio.
+typedef enum LogFormat
+{
+    LOG_NONE,
+    LOG_LAN_PEER_JOINED,
+    LOG_LAN_PEER_TIMEOUT,
+    LOG_LAN_BAD_PACKET,
+    LOG_LAN_EVENT,
+    LOG_LAN_MOVE_CORRECTED,
+    LOG_LAN_JOIN_SYNCED,
+    LOG_LAN_JOIN_LAYOUT_MISMATCH,
+    LOG_ZOMBIES_SPAWN,
+    LOG_ZOMBIES_WAVE,
+    LOG_ZOMBIES_PLAYER_HIT,
+    LOG_COMBAT_KILL,
+    LOG_COMBAT_FRAG,
+    LOG_PLAYER_DOWNED,
+    LOG_HITCH_DUMPED,
+    LOG_REGION_OVERFLOW,
+    LOG_REGION_REPORT,
+    LOG_CVAR_SET,
+    LOG_LAN_HOST_ELECTED,
+    LOG_FORMAT_COUNT
+} LogFormat;
+
+typedef union LogArg
+{
+    int64_t i;
+    double f;
+} LogArg;
+
+typedef struct LogRecord
+{
+    uint64_t timeNs;
+    uint16_t format;
+    uint8_t thread;
+    uint8_t argCount;
+    uint32_t reserved;
+    LogArg args[LOG_MAX_ARGS];
+} LogRecord;
+
+bool LogInit(const char *path);
+void LogShutdown(void);
+// Arguments follow the format's type string: 'i' takes an int, 'f' takes a double.
+void LogWrite(LogFormat format, ...);
+uint64_t LogDroppedCount(void);
+bool LogDecodeFile(const char *path, FILE *out);
+
+#endif
@@ -0,0 +1,272 @@
+#include "lowpoly.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rlgl.h"
+
+#define LOWPOLY_CELLS_PER_ROW (LOWPOLY_ATLAS_SIZE / LOWPOLY_ATLAS_CELL)
+
+static const char *gLowPolyNames[LOWPOLY_MODEL_COUNT] = {
+    [LOWPOLY_ZOMBIE] = "zombie",
+    [LOWPOLY_SPITTER] = "spitter",
+    [LOWPOLY_SPRINTER] = "sprinter",
+    [LOWPOLY_BOSS] = "boss",
+    [LOWPOLY_PEER] = "peer",
+    [LOWPOLY_BLOCK] = "block",
+    [LOWPOLY_PERK] = "perk",
+    [LOWPOLY_AMMO] = "ammo",
+    [LOWPOLY_MYSTERY] = "mystery",
+};
+
+// Corners of each box face as seen from outside: bottom-left, bottom-right,
+// top-right, top-left. Corner bits are x, y, z, matching the occlusion boxes.
+static const int gBoxFaces[6][4] = {
+    {4, 5, 7, 6}, {1, 0, 2, 3}, {5, 1, 3, 7}, {0, 4, 6, 2}, {6, 7, 3, 2}, {0, 1, 5, 4},
+};
+static const float gFaceUv[4][2] = {{0.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f}, {0.0f, 0.0f}};
+
+bool LowPolyInit(LowPolySet *set, MemRegion region)
+{
+    memset(set, 0, sizeof(*set));
+    set->vertices = (LowPolyVertex *)RegionAlloc(region, sizeof(LowPolyVertex) * LOWPOLY_MAX_VERTICES);
+    set->instances = (LowPolyInstance *)RegionAlloc(region, sizeof(LowPolyInstance) * LOWPOLY_MAX_INSTANCES);
+    return set->vertices && set->instances;
+}
+
+// Flat shading baked per triangle against a fixed overhead light.
+static void LowPolyShadeTriangle(LowPolyVertex *v)
+{
+    float ax = v[1].x - v[0].x, ay = v[1].y - v[0].y, az = v[1].z - v[0].z;
+    float bx = v[2].x - v[0].x, by = v[2].y - v[0].y, bz = v[2].z - v[0].z;
+    float nx = ay * bz - az * by;
+    float ny = az * bx - ax * bz;
+    float nz = ax * by - ay * bx;
+    float len = sqrtf(nx * nx + ny * ny + nz * nz);
+    float light = len > 0.0f ? (nx * 0.37f + ny * 0.86f + nz * 0.35f) / len : 1.0f;
+    uint8_t shade = (uint8_t)(170.0f + 85.0f * fmaxf(light, 0.0f));
+    v[0].shade = v[1].shade = v[2].shade = shade;
+}
+
+static void LowPolyAddBox(LowPolySet *set, LowPolyModelId id)
+{
+    if (set->vertexCount + 36 > LOWPOLY_MAX_VERTICES)
+        return;
+    // Half a texel of inset keeps point sampling inside the model's own cell.
+    const float texel = 1.0f / LOWPOLY_ATLAS_SIZE;
+    float u0 = (float)((id % LOWPOLY_CELLS_PER_ROW) * LOWPOLY_ATLAS_CELL) * texel + texel * 0.5f;
+    float v0 = (float)((id / LOWPOLY_CELLS_PER_ROW) * LOWPOLY_ATLAS_CELL) * texel + texel * 0.5f;
+    float extent = (float)LOWPOLY_ATLAS_CELL * texel - texel;
+
+    set->models[id].first = set->vertexCount;
+    for (int f = 0; f < 6; f++)
+    {
+        static const int order[6] = {0, 1, 2, 0, 2, 3};
+        LowPolyVertex *tri = &set->vertices[set->vertexCount];
+        for (int k = 0; k < 6; k++)
+        {
+            int corner = gBoxFaces[f][order[k]];
+            LowPolyVertex *v = &tri[k];
+            v->x = (corner & 1) ? 0.5f : -0.5f;
+            v->y = (corner & 2) ? 0.5f : -0.5f;
+            v->z = (corner & 4) ? 0.5f : -0.5f;
+            v->u = u0 + gFaceUv[order[k]][0] * extent;
+            v->v = v0 + gFaceUv[order[k]][1] * extent;
+        }
+        LowPolyShadeTriangle(&tri[0]);
+        LowPolyShadeTriangle(&tri[3]);
+        set->vertexCount += 6;
+    }
+    set->models[id].count = 36;
+}
+
+static LowPolyModelId LowPolyFindModel(const char *name)
+{
+    for (int i = 0; i < LOWPOLY_MODEL_COUNT; i++)
+    {
+        if (strcmp(gLowPolyNames[i], name) == 0)
+            return (LowPolyModelId)i;
+    }
+    return LOWPOLY_MODEL_COUNT;
+}
+
+static void LowPolyLoadModels(LowPolySet *set, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return;
+
+    LowPolyModelId current = LOWPOLY_MODEL_COUNT;
+    char word[16];
+    while (fscanf(f, "%15s", word) == 1)
+    {
+        if (strcmp(word, "model") == 0)
+        {
+            if (fscanf(f, "%15s", word) != 1)
+                break;
+            current = LowPolyFindModel(word);
+            if (current < LOWPOLY_MODEL_COUNT)
+            {
+                set->models[current].first = set->vertexCount;
+                set->models[current].count = 0;
+            }
+        }
+        else if (strcmp(word, "v") == 0)
+        {
+            LowPolyVertex v = {0};
+            if (fscanf(f, "%f %f %f %f %f", &v.x, &v.y, &v.z, &v.u, &v.v) != 5)
+                break;
+            if (current >= LOWPOLY_MODEL_COUNT)
+                continue;
+            if (set->vertexCount >= LOWPOLY_MAX_VERTICES)
+            {
+                set->dropped++;
+                continue;
+            }
+            set->vertices[set->vertexCount++] = v;
+            LowPolyModel *model = &set->models[current];
+            if (++model->count % 3 == 0)
+                LowPolyShadeTriangle(&set->vertices[model->first + model->count - 3]);
+        }
+        else
+        {
+            break;
+        }
+    }
+    fclose(f);
+
+    for (int i = 0; i < LOWPOLY_MODEL_COUNT; i++)
+        set->models[i].count -= set->models[i].count % 3;
+}
+
+static unsigned char LowPolyCellTexel(LowPolyModelId id, int x, int y)
+{
+    uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)(id + 1) * 83492791u;
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    int grain = (int)((h >> 24) & 31);
+    switch (id)
+    {
+    case LOWPOLY_ZOMBIE:
+    case LOWPOLY_SPITTER:
+    case LOWPOLY_SPRINTER:
+    case LOWPOLY_BOSS:
+        // Mottled skin with a dark band where the eyes sit.
+        return (unsigned char)((y >= 6 && y <= 9 && (x % 16) > 3 && (x % 16) < 12) ? 60 + grain : 190 + grain * 2);
+    case LOWPOLY_BLOCK:
+        return (unsigned char)((x < 2 || y < 2 || x > 29 || y > 29 || x == y || x == 31 - y) ? 120 + grain : 200 + grain);
+    case LOWPOLY_AMMO:
+        return (unsigned char)(((y / 4) & 1) ? 150 + grain : 220 + grain);
+    case LOWPOLY_MYSTERY:
+        return (unsigned char)((((x / 8) + (y / 8)) & 1) ? 140 + grain : 224 + grain);
+    default:
+        return (unsigned char)(((x / 4) & 1) ? 180 + grain : 224 + grain);
+    }
+}
+
+static Texture2D LowPolyBuildAtlas(void)
+{
+    Image atlas = GenImageColor(LOWPOLY_ATLAS_SIZE, LOWPOLY_ATLAS_SIZE, WHITE);
+    for (int id = 0; id < LOWPOLY_MODEL_COUNT; id++)
+    {
+        int ox = (id % LOWPOLY_CELLS_PER_ROW) * LOWPOLY_ATLAS_CELL;
+        int oy = (id / LOWPOLY_CELLS_PER_ROW) * LOWPOLY_ATLAS_CELL;
+        for (int y = 0; y < LOWPOLY_ATLAS_CELL; y++)
+        {
+            for (int x = 0; x < LOWPOLY_ATLAS_CELL; x++)
+            {
+                unsigned char g = LowPolyCellTexel((LowPolyModelId)id, x, y);
+                ImageDrawPixel(&atlas, ox + x, oy + y, (Color){g, g, g, 255});
+            }
+        }
+    }
+    Texture2D texture = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+    return texture;
+}
+
+void LowPolyLoadArena(LowPolySet *set, const char *modelPath, const char *atlasPath)
+{
+    LowPolyUnload(set);
+    set->vertexCount = 0;
+    set->dropped = 0;
+    memset(set->models, 0, sizeof(set->models));
+    if (!set->vertices)
+        return;
+
+    if (modelPath)
+        LowPolyLoadModels(set, modelPath);
+    for (int i = 0; i < LOWPOLY_MODEL_COUNT; i++)
+    {
+        if (set->models[i].count == 0)
+            LowPolyAddBox(set, (LowPolyModelId)i);
+    }
+
+    if (atlasPath && FileExists(atlasPath))
+    {
+        Image image = LoadImage(atlasPath);
+        if (image.data)
+        {
+            set->atlas = LoadTextureFromImage(image);
+            UnloadImage(image);
+        }
+    }
+    if (set->atlas.id == 0)
+        set->atlas = LowPolyBuildAtlas();
+}
+
+void LowPolyUnload(LowPolySet *set)
+{
+    if (set->atlas.id != 0)
+        UnloadTexture(set->atlas);
+    set->atlas = (Texture2D){0};
+}
+
+void LowPolyQueue(LowPolySet *set, LowPolyModelId model, Vector3 position, Vector3 scale, float yaw, Color tint)
+{
+    if (model < 0 || model >= LOWPOLY_MODEL_COUNT || !set->instances)
+        return;
+    if (set->instanceCount >= LOWPOLY_MAX_INSTANCES)
+    {
+        set->dropped++;
+        return;
+    }
+    set->instances[set->instanceCount++] = (LowPolyInstance){position, scale, yaw, tint, model};
+}
+
+void LowPolyFlush(LowPolySet *set)
+{
+    set->triangles = 0;
+    if (set->instanceCount == 0)
+        return;
+
+    rlSetTexture(set->atlas.id);
+    for (int i = 0; i < set->instanceCount; i++)
+    {
+        const LowPolyInstance *inst = &set->instances[i];
+        const LowPolyModel *model = &set->models[inst->model];
+        if (model->count == 0)
+            continue;
+        float c = cosf(inst->yaw);
+        float s = sinf(inst->yaw);
+        rlCheckRenderBatchLimit(model->count);
+        rlBegin(RL_TRIANGLES);
+        for (int k = model->first; k < model->first + model->count; k++)
+        {
+            const LowPolyVertex *v = &set->vertices[k];
+            float x = v->x * inst->scale.x;
+            float z = v->z * inst->scale.z;
+            rlColor4ub((unsigned char)(inst->tint.r * v->shade / 255),
+                       (unsigned char)(inst->tint.g * v->shade / 255),
+                       (unsigned char)(inst->tint.b * v->shade / 255),
+                       inst->tint.a);
+            rlTexCoord2f(v->u, v->v);
+            rlVertex3f(inst->position.x + x * c + z * s, inst->position.y + v->y * inst->scale.y, inst->position.z - x * s + z * c);
+        }
+        rlEnd();
+        set->triangles += model->count / 3;
+    }
+    rlSetTexture(0);
+    set->instanceCount = 0;
+}
@@ -0,0 +1,80 @@
+#ifndef U8_LOWPOLY_H
+#define U8_LOWPOLY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "raylib.h"
+#include "region.h"
+
+#define LOWPOLY_MAX_VERTICES 6144
+#define LOWPOLY_MAX_INSTANCES 256
+#define LOWPOLY_ATLAS_SIZE 128
+#define LOWPOLY_ATLAS_CELL 32
+
+typedef enum LowPolyModelId
+{
+    LOWPOLY_ZOMBIE,
+    LOWPOLY_SPITTER,
+    LOWPOLY_SPRINTER,
+    LOWPOLY_BOSS,
+    LOWPOLY_PEER,
+    LOWPOLY_BLOCK,
+    LOWPOLY_PERK,
+    LOWPOLY_AMMO,
+    LOWPOLY_MYSTERY,
+    LOWPOLY_MODEL_COUNT
+} LowPolyModelId;
+
+// Model space is the unit box around the origin; instances scale it to metres.
+// UVs address the whole atlas, and shade is the baked flat lighting of the face.
+typedef struct LowPolyVertex
+{
+    float x;
+    float y;
+    float z;
+    float u;
+    float v;
+    uint8_t shade;
+} LowPolyVertex;
+
+typedef struct LowPolyModel
+{
+    int first;
+    int count;
+} LowPolyModel;
+
+typedef struct LowPolyInstance
+{
+    Vector3 position;
+    Vector3 scale;
+    float yaw;
+    Color tint;
+    LowPolyModelId model;
+} LowPolyInstance;
+
+// Every model of an arena lives in one vertex pool and samples one atlas, so a
+// frame's instances go out as a single rlgl batch with one texture bind.
+typedef struct LowPolySet
+{
+    LowPolyVertex *vertices;
+    int vertexCount;
+    LowPolyModel models[LOWPOLY_MODEL_COUNT];
+    Texture2D atlas;
+    LowPolyInstance *instances;
+    int instanceCount;
+    int dropped;
+    int triangles;
+} LowPolySet;
+
+bool LowPolyInit(LowPolySet *set, MemRegion region);
+// Reads "model <name>" blocks of "v x y z u v" lines (three per triangle) and
+// an atlas image; anything missing falls back to built-in textured boxes that
+// use atlas cell N for model N.
+void LowPolyLoadArena(LowPolySet *set, const char *modelPath, const char *atlasPath);
+void LowPolyUnload(LowPolySet *set);
+void LowPolyQueue(LowPolySet *set, LowPolyModelId model, Vector3 position, Vector3 scale, float yaw, Color tint);
+// Submits and clears the queue; call inside BeginMode3D.
+void LowPolyFlush(LowPolySet *set);
+
+#endif
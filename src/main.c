@@ -1,21 +1,49 @@
 #include "raylib.h"
+#include "clocksync.h"
+#include "control.h"
+#include "cvar.h"
+#include "ecs.h"
+#include "election.h"
+#include "events.h"
+#include "hitch.h"
+#include "influence.h"
+#include "lancodec.h"
+#include "log.h"
+#include "lowpoly.h"
+#include "metrics.h"
+#include "occlusion.h"
+#include "particles.h"
+#include "predict.h"
+#include "profile.h"
+#include "region.h"
+#include "replication.h"
+#include "sampler.h"
+#include "task.h"
+#include "telemetry.h"
+#include "transfer.h"
+#include "vat.h"
 #include <arpa/inet.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <math.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <unistd.h>
 
 #define BASE_WIDTH 320
 #define BASE_HEIGHT 180
 #define PIXEL_SCALE 2
 
+#define MAX_ENEMIES 16
 #define MAX_DECALS 32
 #define MAX_DISSOLVES 16
 #define MAX_TRAILS 32
@@ -34,7 +62,48 @@
 #define LAN_PORT 27015
 #define MAX_NAME_LEN 16
 #define LAN_NAME_BYTES 12
-#define LAN_PACKET_SIZE 68
+#define LAN_ENEMY_MAGIC 0xE7
+#define LAN_ENEMY_HEADER_BYTES 6
+#define LAN_ENEMY_RECORD_BYTES 8
+#define LAN_ENEMY_BUDGET_BYTES 384
+// Receivers read into LAN_PACKET_SIZE buffers; anything longer arrives truncated.
+#define LAN_ENEMY_MAX_BYTES LAN_PACKET_SIZE
+// Sequence numbers further behind than this mean the sender restarted.
+#define LAN_ENEMY_REORDER_WINDOW 64
+#define LAN_ENEMY_SEND_INTERVAL 0.05f
+#define LAN_GHOST_VIEW_RANGE 14.0f
+#define LAN_MOVE_MAGIC 0xA6
+#define LAN_MOVE_ACK_MAGIC 0xA7
+#define LAN_MOVE_BYTES 10
+#define LAN_MOVE_ACK_BYTES 8
+#define LAN_MOVE_SEND_INTERVAL 0.05f
+#define LAN_MOVE_TELEPORT 0x01
+#define LAN_MOVE_FORCED 0x01
+// Fastest legal ground speed: speed perk on a diagonal.
+#define LAN_MOVE_MAX_SPEED (PLAYER_MOVE_SPEED * 1.35f * 1.415f)
+#define LAN_MOVE_SLACK 0.1f
+// Seconds of unclaimed host time a client may bank against late or bunched reports.
+#define LAN_MOVE_CREDIT_MAX 0.5f
+#define LAN_JOIN_REQUEST_MAGIC 0xB3
+#define LAN_JOIN_WAIT 0.6
+#define LAN_JOIN_REQUEST_INTERVAL 0.5
+#define LAN_TRANSFER_RATE 16384.0f
+#define LAN_TRANSFER_BURST (2.0f * (TRANSFER_HEADER_BYTES + TRANSFER_CHUNK_BYTES))
+#define LAN_TRANSFER_RESEND 0.2
+#define LAN_TRANSFER_TIMEOUT 5.0
+#define LAN_CLOCK_PING_MAGIC 0xC1
+#define LAN_CLOCK_PONG_MAGIC 0xC2
+#define LAN_CLOCK_PING_BYTES 9
+#define LAN_CLOCK_PONG_BYTES 25
+#define LAN_CLOCK_PING_INTERVAL 1.0f
+#define LAN_HOST_REPORT_MAGIC 0xC3
+#define LAN_HOST_REPORT_HEADER_BYTES 11
+#define LAN_HOST_REPORT_LINK_BYTES 6
+// Latency a fully loaded machine is worth when scoring host candidates.
+#define LAN_HOST_HEADROOM_MS 20.0f
+#define JOIN_SNAPSHOT_VERSION 2
+#define JOIN_SCORE_ENTRY_BYTES (LAN_NAME_BYTES + 5)
+#define LAN_PACKET_SIZE 512
 #define MAX_ARENAS 3
 
 typedef enum PropKind
@@ -101,7 +170,8 @@ typedef enum EnemyType
     ENEMY_BASIC,
     ENEMY_SPITTER,
     ENEMY_SPRINTER,
-    ENEMY_BOSS
+    ENEMY_BOSS,
+    ENEMY_TYPE_COUNT
 } EnemyType;
 
 typedef struct Enemy
@@ -122,11 +192,17 @@ typedef struct Enemy
 
 typedef struct ZombiesState
 {
-    Enemy enemies[16];
+    Enemy *enemies;
+    int enemyCapacity;
     int wave;
     float spawnCooldown;
     int activeCount;
+    int waveSpawned;
     float waveTimer;
+    double waveStartedAt;
+    bool waveClockStarted;
+    uint32_t rng;
+    float healthScale;
 } ZombiesState;
 
 typedef struct PlayerState
@@ -152,33 +228,33 @@ typedef struct KillfeedEntry
     Color color;
 } KillfeedEntry;
 
-typedef struct Decal
-{
-    Vector3 position;
-    float timer;
-    Color color;
-} Decal;
-
 typedef struct Flash
 {
     float timer;
     Color color;
 } Flash;
 
-typedef struct DissolveFX
+// Decals, corpse dissolves and spit trails share one entity store; each kind
+// is its own archetype so systems walk dense position/lifetime/tint columns.
+typedef struct FxStore
 {
-    Vector3 position;
-    float timer;
-    float height;
-    Color color;
-} DissolveFX;
-
-typedef struct TrailFX
+    EcsWorld world;
+    int decals;
+    int dissolves;
+    int trails;
+} FxStore;
+
+// Another client's zombie, shown as a ghost so everyone sees the whole horde.
+typedef struct RemoteEnemy
 {
     Vector3 position;
-    float timer;
-    Color color;
-} TrailFX;
+    Vector3 renderPos;
+    float health;
+    float charge;
+    EnemyType type;
+    bool active;
+    double lastHeard;
+} RemoteEnemy;
 
 typedef struct Peer
 {
@@ -198,15 +274,48 @@ typedef struct Peer
     int cash;
     int score;
     uint16_t joinAgeSeconds;
-    bool catchupSent;
     char name[MAX_NAME_LEN];
     int team;
     bool teamMode;
-    float respawnTimer;
+    bool respawning;
+    double respawnAt;
     uint8_t lastDamageId;
     uint8_t lastEventId;
+    LanCodecState codec;
+    ReplicationChannel replication;
+    RemoteEnemy ghosts[REPLICATION_MAX_ENTITIES];
+    Vector3 authPos;
+    uint16_t moveSeq;
+    bool hasAuth;
+    double moveHeardAt;
+    float moveCredit;
+    bool teleportGrant;
+    TransferSender joinTx;
+    bool joinRequested;
+    ClockSync clock;
+    uint32_t replicaSeq;
+    bool hasReplicaSeq;
+    ElectionNode report;
+    bool hasReport;
+    uint32_t reportedHost;
 } Peer;
 
+// Match state a late joiner adopts from the host; the LAN task fills it in and
+// the game thread applies it between frames.
+typedef struct JoinSnapshot
+{
+    GameMode mode;
+    MultiplayerVariant variant;
+    int arenaIndex;
+    uint32_t layoutHash;
+    int wave;
+    float waveTimer;
+    int teamScores[2];
+    int cashFloor;
+    size_t bytes;
+    double elapsed;
+} JoinSnapshot;
+
 typedef struct LanState
 {
     int socketFd;
@@ -220,6 +329,43 @@ typedef struct LanState
     struct sockaddr_in selfAddr;
     LanEvent incomingEvent;
     bool hasIncomingEvent;
+    LanCodecState codecTx;
+    uint64_t codecNs;
+    uint32_t codecPackets;
+    uint32_t codecRawBytes;
+    uint32_t codecWireBytes;
+    float enemyAccumulator;
+    uint32_t enemySeq;
+    uint16_t moveSeq;
+    Vector3 movePosition;
+    float moveElapsed;
+    float moveAccumulator;
+    bool moveReady;
+    bool moveTeleport;
+    bool hasMoveAck;
+    bool moveAckForced;
+    uint16_t moveAckSeq;
+    Vector3 moveAckPosition;
+    TransferReceiver joinRx;
+    JoinSnapshot joinState;
+    bool hasJoinState;
+    bool joinSynced;
+    double joinStartedAt;
+    double joinRequestAt;
+    uint8_t transferId;
+    float transferTokens;
+    float clockAccumulator;
+    // Loopback bots have no broadcast domain, so announcements also go to
+    // each listed address; soak bots set fanoutOnly and skip the broadcast.
+    struct sockaddr_in fanout[MAX_PEERS];
+    int fanoutCount;
+    bool fanoutOnly;
+    // Host election: a random id per session, the host everyone last agreed
+    // on (0 until the first report), and our smoothed spare frame budget.
+    uint32_t nodeId;
+    uint32_t electedId;
+    float headroom;
+    ElectionState election;
 } LanState;
 
 typedef enum MenuAction
@@ -282,7 +428,9 @@ static Sound MakeTone(float frequency, float duration, float volume)
 {
     const int sampleRate = 44100;
     int sampleCount = (int)(duration * sampleRate);
-    short *samples = (short *)MemAlloc(sampleCount * sizeof(short));
+    short *samples = (short *)RegionAlloc(MEM_REGION_AUDIO, sampleCount * sizeof(short));
+    if (!samples)
+        return (Sound){0};
     for (int i = 0; i < sampleCount; i++)
     {
         float t = (float)i / (float)sampleRate;
@@ -296,9 +444,8 @@ static Sound MakeTone(float frequency, float duration, float volume)
         .channels = 1,
         .data = samples};
 
-    Sound sound = LoadSoundFromWave(wave);
-    UnloadWave(wave);
-    return sound;
+    // LoadSoundFromWave copies the samples, and the staging buffer belongs to the audio region.
+    return LoadSoundFromWave(wave);
 }
 
 static bool gAudioEnabled = true;
@@ -439,24 +586,22 @@ static bool UnpackLanPayload(const uint8_t *in, size_t len, bool useChecksum, La
     return true;
 }
 
-static void UpdateCameraLean(Camera3D *camera, Vector2 *angles, float dt, float recoilOffset, float moveScale, bool allowMove)
+static MoveInput UpdateCameraLean(Camera3D *camera, Vector2 *angles, float dt, float recoilOffset, float moveScale, bool allowMove)
 {
     const float mouseScale = 0.0035f;
 
-    Vector3 forward = {
-        sinf(angles->x),
-        0.0f,
-        cosf(angles->x)};
-    Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, (Vector3){0, 1, 0}));
-
+    MoveInput input = {0};
+    input.yaw = angles->x;
+    input.speed = PLAYER_MOVE_SPEED * moveScale;
+    input.dt = dt;
     if (allowMove)
     {
-        float speed = PLAYER_MOVE_SPEED * moveScale;
-        if (IsKeyDown(KEY_W)) camera->position = Vector3Add(camera->position, Vector3Scale(forward, speed * dt));
-        if (IsKeyDown(KEY_S)) camera->position = Vector3Subtract(camera->position, Vector3Scale(forward, speed * dt));
-        if (IsKeyDown(KEY_A)) camera->position = Vector3Subtract(camera->position, Vector3Scale(right, speed * dt));
-        if (IsKeyDown(KEY_D)) camera->position = Vector3Add(camera->position, Vector3Scale(right, speed * dt));
+        if (IsKeyDown(KEY_W)) input.keys |= MOVE_KEY_FORWARD;
+        if (IsKeyDown(KEY_S)) input.keys |= MOVE_KEY_BACK;
+        if (IsKeyDown(KEY_A)) input.keys |= MOVE_KEY_LEFT;
+        if (IsKeyDown(KEY_D)) input.keys |= MOVE_KEY_RIGHT;
     }
+    camera->position = ApplyMoveInput(camera->position, &input);
 
     Vector2 mouseDelta = GetMouseDelta();
     angles->x += -mouseDelta.x * mouseScale;
@@ -472,6 +617,7 @@ static void UpdateCameraLean(Camera3D *camera, Vector2 *angles, float dt, float
 
     camera->target = Vector3Add(camera->position, dir);
     camera->position.y = PLAYER_HEIGHT;
+    return input;
 }
 
 static void DrawCrosshair(int screenWidth, int screenHeight)
@@ -634,6 +780,15 @@ static void SavePreset(const char *name, const PropSpot *spots, int count)
     fclose(f);
 }
 
+static const Weapon gWeapons[] = {
+    {.name = "Pistol", .damage = 18.0f, .fireRate = 3.5f, .recoil = 0.012f, .spread = 0.01f, .range = 40.0f, .color = ORANGE, .maxAmmo = 64},
+    {.name = "SMG", .damage = 12.0f, .fireRate = 9.0f, .recoil = 0.008f, .spread = 0.018f, .range = 35.0f, .color = SKYBLUE, .maxAmmo = 160},
+    {.name = "Rifle", .damage = 24.0f, .fireRate = 6.0f, .recoil = 0.02f, .spread = 0.012f, .range = 50.0f, .color = LIME, .maxAmmo = 120},
+    {.name = "Shotgun", .damage = 55.0f, .fireRate = 1.1f, .recoil = 0.06f, .spread = 0.04f, .range = 20.0f, .color = YELLOW, .maxAmmo = 48},
+    {.name = "LMG", .damage = 16.0f, .fireRate = 7.0f, .recoil = 0.03f, .spread = 0.02f, .range = 45.0f, .color = RED, .maxAmmo = 220},
+};
+
+
 static const ArenaPreset gArenaPresets[MAX_ARENAS] = {
     {.name = "Courtyard",
      .spots = {{{-2.0f, 0.0f, 2.0f}, PROP_PERK_QUICK},
@@ -682,6 +837,23 @@ static const ArenaPreset gArenaPresets[MAX_ARENAS] = {
                {{0.8f, 0.35f, -2.4f}, {0.7f, 0.6f, 0.7f}, {80, 80, 100, 255}}},
      .coverCount = 3}};
 
+// Fixed scenery shared by every arena; drawn before the preset's cover.
+static const CoverPiece gArenaBlocks[] = {
+    {{0.0f, 0.5f, 0.0f}, {0.5f, 1.0f, 0.5f}, GREEN},
+    {{2.0f, 0.35f, 1.5f}, {0.35f, 0.7f, 0.35f}, {90, 100, 160, 255}},
+    {{-1.5f, 0.25f, -1.0f}, {0.25f, 0.5f, 0.25f}, {120, 80, 90, 255}},
+    {{-4.0f, 0.4f, 1.5f}, {0.9f, 1.2f, 0.6f}, {80, 110, 160, 255}},
+    {{4.0f, 0.35f, -1.5f}, {0.8f, 1.0f, 0.8f}, {150, 120, 90, 255}},
+    {{0.0f, 0.25f, 3.5f}, {1.2f, 0.6f, 1.2f}, {60, 80, 110, 255}},
+};
+
+static Vector3 PropBoxSize(PropKind kind)
+{
+    if (kind == PROP_MYSTERY)
+        return (Vector3){0.45f, 0.8f, 0.45f};
+    return (Vector3){0.55f, 1.1f, 0.55f};
+}
+
 static int PropCost(PropKind kind)
 {
     switch (kind)
@@ -700,16 +872,70 @@ static int PropCost(PropKind kind)
     }
 }
 
-static void DrawRetroCube(Vector3 position, float width, float height, float length, Color color)
+// Scenery snaps to a 5 cm grid before it is queued into the atlas batch.
+static void QueueRetroModel(LowPolySet *models, LowPolyModelId model, Vector3 position, Vector3 size, Color color)
 {
-    Vector3 snapped = QuantizeVec3(position, 0.05f);
-    DrawCube(snapped, width, height, length, color);
-    DrawCubeWires(snapped, width, height, length, DARKGRAY);
+    LowPolyQueue(models, model, QuantizeVec3(position, 0.05f), size, 0.0f, color);
 }
 
-static bool InitLan(LanState *lan)
+// Animated counterpart for the zombie models, turned to face the viewer.
+static void QueueAnimatedModel(VatSet *vat, LowPolyModelId model, Vector3 position, Vector3 size, Vector3 viewer, Color color, VatClip clip, float time)
+{
+    float yaw = atan2f(viewer.x - position.x, viewer.z - position.z);
+    VatQueue(vat, model, QuantizeVec3(position, 0.05f), size, yaw, color, clip, time);
+}
+
+static LowPolyModelId PropModel(PropKind kind)
+{
+    switch (kind)
+    {
+    case PROP_WALL_AMMO:
+        return LOWPOLY_AMMO;
+    case PROP_MYSTERY:
+        return LOWPOLY_MYSTERY;
+    default:
+        return LOWPOLY_PERK;
+    }
+}
+
+static void LoadArenaModels(LowPolySet *models, const char *arenaName)
+{
+    char safe[32];
+    char modelPath[48];
+    char atlasPath[48];
+    SanitizePresetName(arenaName, safe, sizeof(safe));
+    snprintf(modelPath, sizeof(modelPath), "models_%s.txt", safe);
+    snprintf(atlasPath, sizeof(atlasPath), "atlas_%s.png", safe);
+    LowPolyLoadArena(models, modelPath, atlasPath);
+}
+
+// The LAN code reads time through this so the headless soak can run it without a window.
+static double (*gLanClock)(void) = GetTime;
+// Live-tunable knobs, registered at startup by RegisterCvars.
+typedef struct GameCvars
+{
+    int sendInterval;
+    int peerTimeout;
+    int peerSnap;
+    int peerSmoothing;
+    int maxFps;
+    int particles;
+    int trails;
+    int flashlight;
+    int dither;
+    int hostMargin;
+    int hostHold;
+    int hostMinHeadroom;
+    int enemyBudget;
+} GameCvars;
+static GameCvars gCvar;
+// StatsD ids for per-slot receive traffic; zero (a no-op) unless --statsd is given.
+static int gPeerMetrics[MAX_PEERS][2];
+
+static bool InitLanAt(LanState *lan, uint32_t bindAddr, uint16_t port)
 {
     memset(lan, 0, sizeof(*lan));
+    LanCodecInit();
     lan->socketFd = socket(AF_INET, SOCK_DGRAM, 0);
     if (lan->socketFd < 0)
         return false;
@@ -719,8 +945,8 @@ static bool InitLan(LanState *lan)
 
     struct sockaddr_in addr = {
         .sin_family = AF_INET,
-        .sin_port = htons(LAN_PORT),
-        .sin_addr.s_addr = htonl(INADDR_ANY)};
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(bindAddr)};
     if (bind(lan->socketFd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
     {
         close(lan->socketFd);
@@ -731,7 +957,7 @@ static bool InitLan(LanState *lan)
     lan->selfAddr = addr;
 
     char host[256];
-    if (gethostname(host, sizeof(host)) == 0)
+    if (bindAddr == INADDR_ANY && gethostname(host, sizeof(host)) == 0)
     {
         struct addrinfo hints = {0};
         hints.ai_family = AF_INET;
@@ -756,976 +982,4022 @@ static bool InitLan(LanState *lan)
     lan->enabled = true;
     lan->broadcastAccumulator = 0.0;
     lan->useChecksum = true;
-    lan->selfJoinTime = GetTime();
+    lan->selfJoinTime = gLanClock();
+    uint64_t seed = ProfileNowNs() ^ ((uint64_t)getpid() << 32) ^ ((uint64_t)ntohl(lan->selfAddr.sin_addr.s_addr) << 16) ^ port;
+    seed ^= seed >> 33;
+    seed *= 0xff51afd7ed558ccdull;
+    seed ^= seed >> 33;
+    lan->nodeId = (uint32_t)seed | 1u;
+    lan->headroom = 1.0f;
     lan->hasIncomingEvent = false;
     return true;
 }
 
-static void UpdateLan(LanState *lan,
-                      float dt,
-                      Vector3 playerPos,
-                      int weaponIndex,
-                      int ammo,
-                     PlayerState *player,
-                     bool quickfire,
-                     bool speed,
-                     bool revive,
-                      MultiplayerVariant multiVariant,
-                      int playerTeam,
-                      const char *playerName,
-                      double timeNow,
-                      int *pendingCashShare,
-                      int *pendingScoreShare,
-                      float *sharePipTimer,
-                      int *sharePipCash,
-                      int *sharePipScore,
-                      const DamageEvent *damageRay,
-                      bool allowDamageBursts,
-                      LanEvent *outEvent,
-                      uint8_t *eventCounter)
+static bool InitLan(LanState *lan)
 {
-    if (!lan->enabled)
+    return InitLanAt(lan, INADDR_ANY, LAN_PORT);
+}
+
+static uint32_t EnemyStateHash(const Enemy *e)
+{
+    uint32_t health = (uint32_t)Clamp(e->health, 0.0f, 255.0f);
+    uint32_t charging = e->attackCharge > 0.1f ? 1u : 0u;
+    uint32_t weakened = e->weakenTimer > 0.0f ? 1u : 0u;
+    return (uint32_t)e->type | (health << 8) | (charging << 16) | (weakened << 17);
+}
+
+// Clock readings travel as big-endian microseconds; match-time stamps on
+// snapshots are wrapping milliseconds.
+static void WriteClockTime(uint8_t *out, double seconds)
+{
+    uint64_t us = seconds > 0.0 ? (uint64_t)(seconds * 1e6) : 0;
+    for (int i = 0; i < 8; i++)
+        out[i] = (uint8_t)(us >> (56 - 8 * i));
+}
+
+static double ReadClockTime(const uint8_t *in)
+{
+    uint64_t us = 0;
+    for (int i = 0; i < 8; i++)
+        us = (us << 8) | in[i];
+    return (double)us / 1e6;
+}
+
+static uint32_t MatchStampMs(double matchTime)
+{
+    return (uint32_t)(uint64_t)(matchTime * 1000.0);
+}
+
+static void WriteEnemyRecord(uint8_t *out, int slot, const Enemy *e)
+{
+    int16_t x = QuantizePosition(e->position.x);
+    int16_t z = QuantizePosition(e->position.z);
+    int bits = (int)e->type & 0x0F;
+    if (e->active) bits |= 0x80;
+    if (e->weakenTimer > 0.0f) bits |= 0x20;
+    out[0] = (uint8_t)slot;
+    out[1] = (uint8_t)bits;
+    out[2] = (uint8_t)((x >> 8) & 0xFF);
+    out[3] = (uint8_t)(x & 0xFF);
+    out[4] = (uint8_t)((z >> 8) & 0xFF);
+    out[5] = (uint8_t)(z & 0xFF);
+    out[6] = (uint8_t)Clamp(e->health, 0.0f, 255.0f);
+    out[7] = (uint8_t)(Clamp(e->attackCharge / 0.5f, 0.0f, 1.0f) * 255.0f);
+}
+
+static void ReadEnemyRecord(Peer *peer, const uint8_t *record, double timeNow)
+{
+    int slot = record[0];
+    if (slot >= REPLICATION_MAX_ENTITIES)
+        return;
+    RemoteEnemy *g = &peer->ghosts[slot];
+    if (!(record[1] & 0x80))
+    {
+        g->active = false;
         return;
+    }
+    // The type picks the ghost's model, so an unknown one is dropped rather than drawn.
+    if ((record[1] & 0x0F) >= ENEMY_TYPE_COUNT)
+        return;
+    Vector3 pos = {DequantizePosition((int16_t)((record[2] << 8) | record[3])),
+                   0.0f,
+                   DequantizePosition((int16_t)((record[4] << 8) | record[5]))};
+    if (!g->active)
+        g->renderPos = pos;
+    g->active = true;
+    g->position = pos;
+    g->type = (EnemyType)(record[1] & 0x0F);
+    g->health = record[6];
+    g->charge = record[7] / 255.0f;
+    g->lastHeard = timeNow;
+}
 
-    struct sockaddr_in bcast = {
-        .sin_family = AF_INET,
-        .sin_port = htons(LAN_PORT),
-        .sin_addr.s_addr = htonl(INADDR_BROADCAST)};
+// Each peer gets its own unicast packet holding whichever local enemies have
+// built up the most priority for it, so the byte rate is fixed by the budget
+// rather than by the horde size.
+static void SendEnemyReplicas(LanState *lan, const ZombiesState *zombies, float dt)
+{
+    ReplicaInfo infos[REPLICATION_MAX_ENTITIES];
+    int count = zombies->enemyCapacity < REPLICATION_MAX_ENTITIES ? zombies->enemyCapacity : REPLICATION_MAX_ENTITIES;
+    for (int i = 0; i < count; i++)
+    {
+        const Enemy *e = &zombies->enemies[i];
+        infos[i].position = e->position;
+        infos[i].active = e->active;
+        infos[i].stateHash = EnemyStateHash(e);
+    }
 
-    lan->broadcastAccumulator += dt;
-    if (lan->broadcastAccumulator > 0.18f)
+    for (int p = 0; p < MAX_PEERS; p++)
     {
-        lan->broadcastAccumulator = 0.0;
-        LanPayload payload = {0};
-        payload.position[0] = QuantizePosition(playerPos.x);
-        payload.position[1] = QuantizePosition(playerPos.y);
-        payload.position[2] = QuantizePosition(playerPos.z);
-        payload.weaponIndex = (uint8_t)weaponIndex;
-        payload.ammo = (uint16_t)Clamp(ammo, 0, 60000);
-        payload.health = (uint8_t)Clamp((int)((player->health / PLAYER_MAX_HEALTH) * 255.0f), 0, 255);
-        payload.cash = (uint16_t)Clamp(player->cash, 0, 60000);
-        payload.score = (uint16_t)Clamp(player->score, 0, 60000);
-        payload.cashDelta = (int8_t)Clamp(*pendingCashShare, -120, 120);
-        payload.scoreDelta = (int8_t)Clamp(*pendingScoreShare, -120, 120);
-        payload.joinSeconds = (uint16_t)Clamp((int)(timeNow - lan->selfJoinTime), 0, 65000);
-        int flags = 0;
-        if (player->isDowned) flags |= 1 << 0;
-        if (quickfire) flags |= 1 << 1;
-        if (speed) flags |= 1 << 2;
-        if (revive) flags |= 1 << 3;
-        if (player->reviveProgress > 0.0f) flags |= 1 << 4;
-        if (playerTeam == 1) flags |= 1 << 5;
-        if (multiVariant == MULTI_TEAM) flags |= 1 << 6;
-        payload.flags = (uint8_t)flags;
-        strncpy(payload.name, playerName, LAN_NAME_BYTES - 1);
-        if (outEvent && outEvent->kind > 0 && eventCounter)
+        Peer *peer = &lan->peers[p];
+        if (!peer->active)
+            continue;
+        int picks[REPLICATION_MAX_ENTITIES];
+        int picked = ReplicationSelect(&peer->replication,
+                                       infos,
+                                       count,
+                                       peer->position,
+                                       LAN_GHOST_VIEW_RANGE,
+                                       dt,
+                                       LAN_ENEMY_RECORD_BYTES,
+                                       CvarInt(gCvar.enemyBudget) - LAN_ENEMY_HEADER_BYTES,
+                                       picks);
+        if (picked == 0)
+            continue;
+
+        uint8_t packet[LAN_ENEMY_MAX_BYTES];
+        size_t offset = 0;
+        packet[offset++] = LAN_ENEMY_MAGIC;
+        packet[offset++] = (uint8_t)picked;
+        uint32_t seq = ++lan->enemySeq;
+        packet[offset++] = (uint8_t)(seq >> 24);
+        packet[offset++] = (uint8_t)(seq >> 16);
+        packet[offset++] = (uint8_t)(seq >> 8);
+        packet[offset++] = (uint8_t)seq;
+        for (int k = 0; k < picked; k++)
         {
-            payload.eventKind = outEvent->kind;
-            payload.eventTeam = outEvent->team;
-            payload.eventId = (*eventCounter)++;
-            strncpy(payload.eventTarget, outEvent->target, LAN_NAME_BYTES - 1);
+            WriteEnemyRecord(&packet[offset], picks[k], &zombies->enemies[picks[k]]);
+            offset += LAN_ENEMY_RECORD_BYTES;
         }
-        if (damageRay && damageRay->ttl > 0.0f)
+        sendto(lan->socketFd, packet, offset, 0, (struct sockaddr *)&peer->addr, sizeof(peer->addr));
+        ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+        ProfileCount(PROFILE_COUNTER_BYTES_OUT, (uint32_t)offset);
+    }
+}
+
+static void ReceiveEnemyReplicas(Peer *peer, const uint8_t *in, size_t len, double timeNow)
+{
+    if (len < LAN_ENEMY_HEADER_BYTES)
+        return;
+    int count = in[1];
+    if (LAN_ENEMY_HEADER_BYTES + (size_t)count * LAN_ENEMY_RECORD_BYTES > len)
+        return;
+    // Unicast datagrams can arrive out of order; an older snapshot would pull ghosts backwards.
+    // The sequence is the sender's own counter, so host changes and clock syncs cannot move it.
+    uint32_t seq = ((uint32_t)in[2] << 24) | ((uint32_t)in[3] << 16) | ((uint32_t)in[4] << 8) | in[5];
+    int32_t ahead = (int32_t)(seq - peer->replicaSeq);
+    if (peer->hasReplicaSeq && ahead <= 0 && ahead > -LAN_ENEMY_REORDER_WINDOW)
+        return;
+    peer->replicaSeq = seq;
+    peer->hasReplicaSeq = true;
+    const uint8_t *record = in + LAN_ENEMY_HEADER_BYTES;
+    for (int k = 0; k < count; k++, record += LAN_ENEMY_RECORD_BYTES)
+        ReadEnemyRecord(peer, record, timeNow);
+}
+
+// Slot of the machine that is authoritative for movement, or -1 when this
+// machine hosts. That is the elected host while it is still around; otherwise
+// the longest-running machine (the lower address on equal ages, so every peer
+// agrees), which is also who runs the next election.
+static int LanHostSlot(const LanState *lan, double timeNow)
+{
+    if (lan->electedId != 0 && lan->electedId == lan->nodeId)
+        return -1;
+    for (int i = 0; i < MAX_PEERS && lan->electedId != 0; i++)
+    {
+        if (lan->peers[i].active && lan->peers[i].hasReport && lan->peers[i].report.id == lan->electedId)
+            return i;
+    }
+    int best = -1;
+    int bestAge = (int)(timeNow - lan->selfJoinTime);
+    uint32_t bestAddr = ntohl(lan->selfAddr.sin_addr.s_addr);
+    for (int i = 0; i < MAX_PEERS; i++)
+    {
+        const Peer *p = &lan->peers[i];
+        if (!p->active)
+            continue;
+        int age = p->joinAgeSeconds;
+        uint32_t addr = ntohl(p->addr.sin_addr.s_addr);
+        if (age > bestAge || (age == bestAge && addr < bestAddr))
         {
-            for (int i = 0; i < 3; i++)
-            {
-                float o = ((float *)&damageRay->origin)[i];
-                float d = ((float *)&damageRay->dir)[i];
-                payload.rayOrigin[i] = QuantizePosition(o);
-                payload.rayDir[i] = QuantizePosition(d);
-            }
-            payload.rayDamage = (uint8_t)Clamp((int)damageRay->damage, 0, 255);
-            payload.damageId = damageRay->id;
+            best = i;
+            bestAge = age;
+            bestAddr = addr;
         }
-        uint8_t buffer[LAN_PACKET_SIZE] = {0};
-        size_t packetSize = PackLanPayload(buffer, &payload, lan->useChecksum);
-        memcpy(lan->lastPacket, buffer, packetSize);
-        lan->lastPacketSize = packetSize;
-        sendto(lan->socketFd, buffer, packetSize, 0, (struct sockaddr *)&bcast, sizeof(bcast));
-        *pendingCashShare = 0;
-        *pendingScoreShare = 0;
-        if (outEvent)
-            outEvent->kind = 0;
     }
+    return best;
+}
 
-    struct sockaddr_in from;
-    socklen_t fromLen = sizeof(from);
-    uint8_t buffer[LAN_PACKET_SIZE] = {0};
-    int read = 0;
-    while ((read = recvfrom(lan->socketFd, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &fromLen)) > 0)
+// Shared match time is the host's clock; the host itself and anyone not yet
+// synced fall back to their local clock.
+static double LanMatchTime(const LanState *lan, double localNow)
+{
+    int host = LanHostSlot(lan, localNow);
+    if (host < 0)
+        return localNow;
+    return ClockSyncToRemote(&lan->peers[host].clock, localNow);
+}
+
+static void SendClockPings(LanState *lan)
+{
+    uint8_t ping[LAN_CLOCK_PING_BYTES];
+    ping[0] = LAN_CLOCK_PING_MAGIC;
+    for (int i = 0; i < MAX_PEERS; i++)
     {
-        LanPayload packet;
-        if (!UnpackLanPayload(buffer, read, lan->useChecksum, &packet))
+        const Peer *p = &lan->peers[i];
+        if (!p->active)
             continue;
+        WriteClockTime(&ping[1], gLanClock());
+        sendto(lan->socketFd, ping, sizeof(ping), 0, (struct sockaddr *)&p->addr, sizeof(p->addr));
+        ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+        ProfileCount(PROFILE_COUNTER_BYTES_OUT, sizeof(ping));
+    }
+}
 
-        bool assigned = false;
-        if (from.sin_addr.s_addr == lan->selfAddr.sin_addr.s_addr && from.sin_port == lan->selfAddr.sin_port)
+// Pongs echo the ping's send time next to our own receive and send times, read
+// as late as possible so frame-loop delay does not count as clock offset.
+static void AnswerClockPing(LanState *lan, const Peer *peer, const uint8_t *in, size_t len)
+{
+    if (len < LAN_CLOCK_PING_BYTES)
+        return;
+    double received = gLanClock();
+    uint8_t pong[LAN_CLOCK_PONG_BYTES];
+    pong[0] = LAN_CLOCK_PONG_MAGIC;
+    memcpy(&pong[1], &in[1], 8);
+    WriteClockTime(&pong[9], received);
+    WriteClockTime(&pong[17], gLanClock());
+    sendto(lan->socketFd, pong, sizeof(pong), 0, (struct sockaddr *)&peer->addr, sizeof(peer->addr));
+    ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+    ProfileCount(PROFILE_COUNTER_BYTES_OUT, sizeof(pong));
+}
+
+static void ReceiveClockPong(Peer *peer, const uint8_t *in, size_t len)
+{
+    if (len < LAN_CLOCK_PONG_BYTES)
+        return;
+    double arrived = gLanClock();
+    ClockSyncAddSample(&peer->clock, ReadClockTime(&in[1]), ReadClockTime(&in[9]), ReadClockTime(&in[17]), arrived);
+}
+
+static void WriteNodeId(uint8_t *out, uint32_t id)
+{
+    out[0] = (uint8_t)(id >> 24);
+    out[1] = (uint8_t)(id >> 16);
+    out[2] = (uint8_t)(id >> 8);
+    out[3] = (uint8_t)id;
+}
+
+static uint32_t ReadNodeId(const uint8_t *in)
+{
+    return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+}
+
+// Our row of the RTT matrix: every peer whose id we know and whose clock has settled.
+static void BuildHostReport(const LanState *lan, ElectionNode *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->id = lan->nodeId;
+    out->headroom = lan->headroom;
+    for (int i = 0; i < MAX_PEERS && out->linkCount < ELECTION_MAX_NODES; i++)
+    {
+        const Peer *p = &lan->peers[i];
+        if (!p->active || !p->hasReport || !p->clock.valid)
             continue;
+        out->linkIds[out->linkCount] = p->report.id;
+        out->linkRttMs[out->linkCount] = (float)(p->clock.rtt * 1000.0);
+        out->linkCount++;
+    }
+}
 
-        for (int i = 0; i < MAX_PEERS; i++)
+// Reports go out with the clock pings: id, who we think hosts, headroom and
+// our RTT row in tenths of a millisecond.
+static void SendHostReports(LanState *lan, double timeNow)
+{
+    ElectionNode self;
+    BuildHostReport(lan, &self);
+    int host = LanHostSlot(lan, timeNow);
+    uint32_t hostId = host < 0 ? lan->nodeId : (lan->peers[host].hasReport ? lan->peers[host].report.id : 0);
+    uint8_t packet[LAN_HOST_REPORT_HEADER_BYTES + LAN_HOST_REPORT_LINK_BYTES * ELECTION_MAX_NODES];
+    packet[0] = LAN_HOST_REPORT_MAGIC;
+    WriteNodeId(&packet[1], self.id);
+    WriteNodeId(&packet[5], hostId);
+    packet[9] = (uint8_t)Clamp(self.headroom * 255.0f + 0.5f, 0.0f, 255.0f);
+    packet[10] = (uint8_t)self.linkCount;
+    size_t len = LAN_HOST_REPORT_HEADER_BYTES;
+    for (int l = 0; l < self.linkCount; l++)
+    {
+        uint16_t tenths = (uint16_t)Clamp(self.linkRttMs[l] * 10.0f, 0.0f, 65535.0f);
+        WriteNodeId(&packet[len], self.linkIds[l]);
+        packet[len + 4] = (uint8_t)(tenths >> 8);
+        packet[len + 5] = (uint8_t)(tenths & 0xFF);
+        len += LAN_HOST_REPORT_LINK_BYTES;
+    }
+    for (int i = 0; i < MAX_PEERS; i++)
+    {
+        const Peer *p = &lan->peers[i];
+        if (!p->active)
+            continue;
+        sendto(lan->socketFd, packet, len, 0, (struct sockaddr *)&p->addr, sizeof(p->addr));
+        ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+        ProfileCount(PROFILE_COUNTER_BYTES_OUT, (uint32_t)len);
+    }
+}
+
+// Our host's word on who hosts next is final. Two machines that both believe
+// they host (a healed split, say) settle it in favour of the lower id.
+static void ReceiveHostReport(LanState *lan, int slot, const uint8_t *in, size_t len, double timeNow)
+{
+    if (len < LAN_HOST_REPORT_HEADER_BYTES)
+        return;
+    int links = in[10];
+    if (links > ELECTION_MAX_NODES || len < LAN_HOST_REPORT_HEADER_BYTES + (size_t)links * LAN_HOST_REPORT_LINK_BYTES)
+        return;
+    Peer *peer = &lan->peers[slot];
+    ElectionNode *report = &peer->report;
+    report->id = ReadNodeId(&in[1]);
+    report->headroom = (float)in[9] / 255.0f;
+    report->linkCount = links;
+    for (int l = 0; l < links; l++)
+    {
+        const uint8_t *link = &in[LAN_HOST_REPORT_HEADER_BYTES + l * LAN_HOST_REPORT_LINK_BYTES];
+        report->linkIds[l] = ReadNodeId(link);
+        report->linkRttMs[l] = (float)((link[4] << 8) | link[5]) / 10.0f;
+    }
+    peer->hasReport = report->id != 0;
+    peer->reportedHost = ReadNodeId(&in[5]);
+    if (!peer->hasReport || peer->reportedHost == 0 || peer->reportedHost == lan->electedId)
+        return;
+    int host = LanHostSlot(lan, timeNow);
+    bool rivalClaim = host < 0 && peer->reportedHost == report->id && report->id < lan->nodeId;
+    if (slot != host && !rivalClaim)
+        return;
+    lan->electedId = peer->reportedHost;
+    memset(&lan->election, 0, sizeof(lan->election));
+    LogWrite(LOG_LAN_HOST_ELECTED, LanHostSlot(lan, timeNow));
+}
+
+// Only the sitting host scores the candidates, so a handoff is one decision
+// that everyone else adopts from its next report.
+static void RunHostElection(LanState *lan, double timeNow, float dt)
+{
+    if (LanHostSlot(lan, timeNow) >= 0)
+    {
+        memset(&lan->election, 0, sizeof(lan->election));
+        return;
+    }
+    ElectionNode nodes[ELECTION_MAX_NODES];
+    int count = 0;
+    BuildHostReport(lan, &nodes[count++]);
+    for (int i = 0; i < MAX_PEERS && count < ELECTION_MAX_NODES; i++)
+    {
+        if (lan->peers[i].active && lan->peers[i].hasReport)
+            nodes[count++] = lan->peers[i].report;
+    }
+    ElectionConfig config = {
+        .minHeadroom = CvarFloat(gCvar.hostMinHeadroom),
+        .headroomMs = LAN_HOST_HEADROOM_MS,
+        .margin = CvarFloat(gCvar.hostMargin),
+        .holdSeconds = CvarFloat(gCvar.hostHold)};
+    uint32_t next = ElectionUpdate(&lan->election, nodes, count, lan->nodeId, dt, &config);
+    bool changed = next != lan->electedId;
+    lan->electedId = next;
+    if (changed && next != lan->nodeId)
+        LogWrite(LOG_LAN_HOST_ELECTED, LanHostSlot(lan, timeNow));
+}
+
+static void SendMoveReport(LanState *lan, const Peer *host)
+{
+    int16_t x = QuantizePosition(lan->movePosition.x);
+    int16_t z = QuantizePosition(lan->movePosition.z);
+    int elapsedMs = (int)Clamp(lan->moveElapsed * 1000.0f, 0.0f, 65535.0f);
+    uint8_t packet[LAN_MOVE_BYTES];
+    packet[0] = LAN_MOVE_MAGIC;
+    packet[1] = (uint8_t)(lan->moveSeq >> 8);
+    packet[2] = (uint8_t)(lan->moveSeq & 0xFF);
+    packet[3] = (uint8_t)((x >> 8) & 0xFF);
+    packet[4] = (uint8_t)(x & 0xFF);
+    packet[5] = (uint8_t)((z >> 8) & 0xFF);
+    packet[6] = (uint8_t)(z & 0xFF);
+    packet[7] = (uint8_t)(elapsedMs >> 8);
+    packet[8] = (uint8_t)(elapsedMs & 0xFF);
+    packet[9] = lan->moveTeleport ? LAN_MOVE_TELEPORT : 0;
+    sendto(lan->socketFd, packet, sizeof(packet), 0, (struct sockaddr *)&host->addr, sizeof(host->addr));
+    ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+    ProfileCount(PROFILE_COUNTER_BYTES_OUT, sizeof(packet));
+    lan->moveTeleport = false;
+}
+
+// Host side: accept the claimed position if it is reachable from the last
+// accepted one in the reported time, otherwise clamp it and tell the client.
+static void ReceiveMoveReport(LanState *lan, int slot, const uint8_t *in, size_t len, double timeNow)
+{
+    Peer *peer = &lan->peers[slot];
+    if (len < LAN_MOVE_BYTES)
+        return;
+    uint16_t seq = (uint16_t)((in[1] << 8) | in[2]);
+    if (peer->hasAuth && (int16_t)(seq - peer->moveSeq) <= 0)
+        return;
+    Vector3 claimed = {DequantizePosition((int16_t)((in[3] << 8) | in[4])),
+                       PLAYER_HEIGHT,
+                       DequantizePosition((int16_t)((in[5] << 8) | in[6]))};
+    float elapsed = (float)((in[7] << 8) | in[8]) / 1000.0f;
+    // The client's clock only counts for as much time as the host has seen pass.
+    if (peer->hasAuth)
+    {
+        peer->moveCredit = fminf(peer->moveCredit + (float)(timeNow - peer->moveHeardAt), LAN_MOVE_CREDIT_MAX);
+        elapsed = fminf(elapsed, peer->moveCredit);
+        peer->moveCredit -= elapsed;
+    }
+    else
+    {
+        peer->moveCredit = 0.0f;
+    }
+    // Teleports are the host's to grant: while it sees the peer dead, then
+    // once for the respawn, and once after a join request.
+    bool dead = peer->health <= 0.0f || peer->respawning;
+    if (dead)
+        peer->teleportGrant = true;
+    bool teleport = (in[9] & LAN_MOVE_TELEPORT) && peer->teleportGrant;
+    bool forced = false;
+    if (!peer->hasAuth || teleport)
+    {
+        peer->authPos = claimed;
+        if (teleport && !dead)
+            peer->teleportGrant = false;
+    }
+    else
+    {
+        Vector3 delta = Vector3Subtract(claimed, peer->authPos);
+        delta.y = 0.0f;
+        float dist = Vector3Length(delta);
+        float maxStep = LAN_MOVE_MAX_SPEED * elapsed + LAN_MOVE_SLACK;
+        if (dist > maxStep)
         {
-            Peer *p = &lan->peers[i];
-            if (p->active && p->addr.sin_addr.s_addr == from.sin_addr.s_addr && p->addr.sin_port == from.sin_port)
-            {
-                Vector3 target = {DequantizePosition(packet.position[0]),
-                                  DequantizePosition(packet.position[1]),
-                                  DequantizePosition(packet.position[2])};
-                p->position = target;
-                p->renderPos = Vector3Lerp(p->renderPos, target, Clamp(dt * 8.0f, 0.0f, 1.0f));
-                p->weaponIndex = packet.weaponIndex;
-                p->ammo = packet.ammo;
-                p->health = ((float)packet.health / 255.0f) * PLAYER_MAX_HEALTH;
-                p->isDowned = (packet.flags & (1 << 0)) != 0;
-                p->perkQuickfire = (packet.flags & (1 << 1)) != 0;
-                p->perkSpeed = (packet.flags & (1 << 2)) != 0;
-                p->perkRevive = (packet.flags & (1 << 3)) != 0;
-                p->isReviving = (packet.flags & (1 << 4)) != 0;
-                p->team = (packet.flags & (1 << 5)) != 0 ? 1 : 0;
-                p->teamMode = (packet.flags & (1 << 6)) != 0;
-                p->cash = packet.cash;
-                p->score = packet.score;
-                p->joinAgeSeconds = packet.joinSeconds;
-                if (packet.name[0])
-                    strncpy(p->name, packet.name, sizeof(p->name));
-                p->lastHeard = timeNow;
-                if (packet.eventKind > 0 && packet.eventId != p->lastEventId)
-                {
-                    const char *actorName = p->name[0] ? p->name : "Peer";
-                    memset(&lan->incomingEvent, 0, sizeof(lan->incomingEvent));
-                    lan->incomingEvent.kind = packet.eventKind;
-                    lan->incomingEvent.team = p->team;
-                    lan->incomingEvent.id = packet.eventId;
-                    strncpy(lan->incomingEvent.actor, actorName, LAN_NAME_BYTES - 1);
-                    strncpy(lan->incomingEvent.target, packet.eventTarget, LAN_NAME_BYTES - 1);
-                    lan->hasIncomingEvent = true;
-                    p->lastEventId = packet.eventId;
-                }
-                assigned = true;
-                player->cash = (int)Clamp((float)player->cash + (float)packet.cashDelta, 0.0f, 60000.0f);
-                player->score = (int)Clamp((float)player->score + (float)packet.scoreDelta, 0.0f, 60000.0f);
-                if ((packet.cashDelta != 0 || packet.scoreDelta != 0) && sharePipTimer && sharePipCash && sharePipScore)
-                {
-                    *sharePipTimer = 1.6f;
-                    *sharePipCash = packet.cashDelta;
-                    *sharePipScore = packet.scoreDelta;
-                }
-                if (allowDamageBursts && packet.rayDamage > 0 && packet.damageId != p->lastDamageId)
-                {
-                    Vector3 rayOrigin = {DequantizePosition(packet.rayOrigin[0]),
-                                         DequantizePosition(packet.rayOrigin[1]),
-                                         DequantizePosition(packet.rayOrigin[2])};
-                    Vector3 rayDir = {DequantizePosition(packet.rayDir[0]),
-                                      DequantizePosition(packet.rayDir[1]),
-                                      DequantizePosition(packet.rayDir[2])};
-                    float tHit = 50.0f;
-                    if (HitscanAgainstSphere(rayOrigin, Vector3Normalize(rayDir), playerPos, 0.35f, &tHit))
-                    {
-                        player->health -= packet.rayDamage;
-                        player->damageCooldown = 0.6f;
-                    }
-                    p->lastDamageId = packet.damageId;
-                }
+            peer->authPos = Vector3Add(peer->authPos, Vector3Scale(delta, maxStep / dist));
+            forced = true;
+            LogWrite(LOG_LAN_MOVE_CORRECTED, slot, (double)(dist - maxStep));
+        }
+        else
+        {
+            peer->authPos = claimed;
+        }
+    }
+    peer->hasAuth = true;
+    peer->moveSeq = seq;
+    peer->moveHeardAt = timeNow;
+
+    int16_t x = QuantizePosition(peer->authPos.x);
+    int16_t z = QuantizePosition(peer->authPos.z);
+    uint8_t ack[LAN_MOVE_ACK_BYTES];
+    ack[0] = LAN_MOVE_ACK_MAGIC;
+    ack[1] = in[1];
+    ack[2] = in[2];
+    ack[3] = (uint8_t)((x >> 8) & 0xFF);
+    ack[4] = (uint8_t)(x & 0xFF);
+    ack[5] = (uint8_t)((z >> 8) & 0xFF);
+    ack[6] = (uint8_t)(z & 0xFF);
+    ack[7] = forced ? LAN_MOVE_FORCED : 0;
+    sendto(lan->socketFd, ack, sizeof(ack), 0, (struct sockaddr *)&peer->addr, sizeof(peer->addr));
+    ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+    ProfileCount(PROFILE_COUNTER_BYTES_OUT, sizeof(ack));
+}
+
+// Client side: keep only the newest ack; the main thread reconciles after the frame graph.
+static void ReceiveMoveAck(LanState *lan, const uint8_t *in, size_t len)
+{
+    if (len < LAN_MOVE_ACK_BYTES)
+        return;
+    uint16_t seq = (uint16_t)((in[1] << 8) | in[2]);
+    if (lan->hasMoveAck && (int16_t)(seq - lan->moveAckSeq) <= 0)
+        return;
+    lan->moveAckSeq = seq;
+    lan->moveAckPosition = (Vector3){DequantizePosition((int16_t)((in[3] << 8) | in[4])),
+                                     PLAYER_HEIGHT,
+                                     DequantizePosition((int16_t)((in[5] << 8) | in[6]))};
+    lan->moveAckForced = (in[7] & LAN_MOVE_FORCED) != 0;
+    lan->hasMoveAck = true;
+}
+
+static uint32_t LayoutHash(const PropSpot *spots, int count)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < count; i++)
+    {
+        int16_t q[3] = {QuantizePosition(spots[i].position.x),
+                        QuantizePosition(spots[i].position.y),
+                        QuantizePosition(spots[i].position.z)};
+        uint8_t bytes[7] = {(uint8_t)spots[i].kind,
+                            (uint8_t)(q[0] >> 8), (uint8_t)q[0],
+                            (uint8_t)(q[1] >> 8), (uint8_t)q[1],
+                            (uint8_t)(q[2] >> 8), (uint8_t)q[2]};
+        for (int b = 0; b < 7; b++)
+        {
+            hash ^= bytes[b];
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+static size_t WriteScoreEntry(uint8_t *out, const char *name, int score, int cash, int team)
+{
+    size_t offset = 0;
+    memset(out, 0, LAN_NAME_BYTES);
+    for (int i = 0; i < LAN_NAME_BYTES - 1 && name[i]; i++)
+        out[i] = (uint8_t)name[i];
+    offset += LAN_NAME_BYTES;
+    uint16_t s = (uint16_t)Clamp(score, 0, 60000);
+    uint16_t c = (uint16_t)Clamp(cash, 0, 60000);
+    out[offset++] = (uint8_t)((s >> 8) & 0xFF);
+    out[offset++] = (uint8_t)(s & 0xFF);
+    out[offset++] = (uint8_t)((c >> 8) & 0xFF);
+    out[offset++] = (uint8_t)(c & 0xFF);
+    out[offset++] = (uint8_t)team;
+    return offset;
+}
+
+// Host side: everything a late joiner needs to line up with the match, in one
+// blob for the chunked transfer.
+static size_t BuildJoinSnapshot(uint8_t *out,
+                                const LanState *lan,
+                                int joinerSlot,
+                                GameMode mode,
+                                MultiplayerVariant variant,
+                                int arenaIndex,
+                                uint32_t layoutHash,
+                                const ZombiesState *zombies,
+                                const int teamScores[2],
+                                const PlayerState *player,
+                                const char *playerName,
+                                int playerTeam,
+                                double matchNow)
+{
+    size_t offset = 0;
+    uint32_t stamp = MatchStampMs(matchNow);
+    uint16_t waveTenths = (uint16_t)Clamp(zombies->waveTimer * 10.0f, 0.0f, 60000.0f);
+    out[offset++] = JOIN_SNAPSHOT_VERSION;
+    out[offset++] = (uint8_t)mode;
+    out[offset++] = (uint8_t)variant;
+    out[offset++] = (uint8_t)arenaIndex;
+    out[offset++] = (uint8_t)(layoutHash >> 24);
+    out[offset++] = (uint8_t)(layoutHash >> 16);
+    out[offset++] = (uint8_t)(layoutHash >> 8);
+    out[offset++] = (uint8_t)layoutHash;
+    out[offset++] = (uint8_t)((zombies->wave >> 8) & 0xFF);
+    out[offset++] = (uint8_t)(zombies->wave & 0xFF);
+    out[offset++] = (uint8_t)(waveTenths >> 8);
+    out[offset++] = (uint8_t)(waveTenths & 0xFF);
+    for (int t = 0; t < 2; t++)
+    {
+        uint16_t score = (uint16_t)Clamp(teamScores[t], 0, 60000);
+        out[offset++] = (uint8_t)(score >> 8);
+        out[offset++] = (uint8_t)(score & 0xFF);
+    }
+    out[offset++] = (uint8_t)(stamp >> 24);
+    out[offset++] = (uint8_t)(stamp >> 16);
+    out[offset++] = (uint8_t)(stamp >> 8);
+    out[offset++] = (uint8_t)stamp;
+
+    size_t countAt = offset++;
+    int entries = 1;
+    offset += WriteScoreEntry(&out[offset], playerName, player->score, player->cash, playerTeam);
+    for (int i = 0; i < MAX_PEERS; i++)
+    {
+        const Peer *p = &lan->peers[i];
+        if (!p->active || i == joinerSlot)
+            continue;
+        offset += WriteScoreEntry(&out[offset], p->name, p->score, p->cash, p->team);
+        entries++;
+    }
+    out[countAt] = (uint8_t)entries;
+
+    countAt = offset++;
+    int enemies = 0;
+    if (mode == MODE_ZOMBIES)
+    {
+        int count = zombies->enemyCapacity < REPLICATION_MAX_ENTITIES ? zombies->enemyCapacity : REPLICATION_MAX_ENTITIES;
+        for (int i = 0; i < count; i++)
+        {
+            if (!zombies->enemies[i].active)
+                continue;
+            WriteEnemyRecord(&out[offset], i, &zombies->enemies[i]);
+            offset += LAN_ENEMY_RECORD_BYTES;
+            enemies++;
+        }
+    }
+    out[countAt] = (uint8_t)enemies;
+    return offset;
+}
+
+// Joiner side: LAN-owned state (scoreboard, host ghosts) is applied here; the
+// rest is handed to the game thread through lan->joinState.
+static bool ReadJoinSnapshot(LanState *lan, int hostSlot, const uint8_t *in, size_t len, double timeNow, JoinSnapshot *out)
+{
+    const size_t headerBytes = 20;
+    if (len < headerBytes + 2 || in[0] != JOIN_SNAPSHOT_VERSION)
+        return false;
+    memset(out, 0, sizeof(*out));
+    out->mode = (GameMode)in[1];
+    out->variant = (MultiplayerVariant)in[2];
+    out->arenaIndex = in[3];
+    out->layoutHash = ((uint32_t)in[4] << 24) | ((uint32_t)in[5] << 16) | ((uint32_t)in[6] << 8) | in[7];
+    out->wave = (in[8] << 8) | in[9];
+    out->waveTimer = (float)((in[10] << 8) | in[11]) / 10.0f;
+    out->teamScores[0] = (in[12] << 8) | in[13];
+    out->teamScores[1] = (in[14] << 8) | in[15];
+    // Age the wave timer by however long the blob spent in flight, on the shared clock.
+    uint32_t stamp = ((uint32_t)in[16] << 24) | ((uint32_t)in[17] << 16) | ((uint32_t)in[18] << 8) | in[19];
+    uint32_t ageMs = MatchStampMs(LanMatchTime(lan, timeNow)) - stamp;
+    if (ageMs < 10000)
+        out->waveTimer += (float)ageMs / 1000.0f;
+
+    size_t offset = headerBytes;
+    int entries = in[offset++];
+    if (offset + (size_t)entries * JOIN_SCORE_ENTRY_BYTES + 1 > len)
+        return false;
+    out->cashFloor = entries > 0 ? 60000 : 0;
+    for (int e = 0; e < entries; e++, offset += JOIN_SCORE_ENTRY_BYTES)
+    {
+        const uint8_t *entry = &in[offset];
+        char name[LAN_NAME_BYTES + 1] = {0};
+        memcpy(name, entry, LAN_NAME_BYTES);
+        int score = (entry[LAN_NAME_BYTES] << 8) | entry[LAN_NAME_BYTES + 1];
+        int cash = (entry[LAN_NAME_BYTES + 2] << 8) | entry[LAN_NAME_BYTES + 3];
+        if (cash < out->cashFloor)
+            out->cashFloor = cash;
+        for (int i = 0; i < MAX_PEERS; i++)
+        {
+            Peer *p = &lan->peers[i];
+            if (p->active && strncmp(p->name, name, LAN_NAME_BYTES) == 0)
+            {
+                p->score = score;
+                p->cash = cash;
+                p->team = entry[LAN_NAME_BYTES + 4] ? 1 : 0;
+            }
+        }
+    }
+
+    int enemies = in[offset++];
+    if (offset + (size_t)enemies * LAN_ENEMY_RECORD_BYTES > len)
+        return false;
+    for (int e = 0; e < enemies; e++, offset += LAN_ENEMY_RECORD_BYTES)
+        ReadEnemyRecord(&lan->peers[hostSlot], &in[offset], timeNow);
+    out->bytes = len;
+    return true;
+}
+
+// Paces every outgoing join transfer from one token bucket so a joiner never
+// takes more than LAN_TRANSFER_RATE away from the regular traffic.
+static void PumpJoinTransfers(LanState *lan, float dt, double timeNow)
+{
+    lan->transferTokens += LAN_TRANSFER_RATE * dt;
+    if (lan->transferTokens > LAN_TRANSFER_BURST)
+        lan->transferTokens = LAN_TRANSFER_BURST;
+    for (int i = 0; i < MAX_PEERS; i++)
+    {
+        Peer *p = &lan->peers[i];
+        if (!p->active || !p->joinTx.active)
+            continue;
+        if (TransferDone(&p->joinTx) || timeNow - p->joinTx.startedAt > LAN_TRANSFER_TIMEOUT)
+        {
+            p->joinTx.active = false;
+            continue;
+        }
+        uint8_t chunk[TRANSFER_HEADER_BYTES + TRANSFER_CHUNK_BYTES];
+        while (lan->transferTokens >= (float)sizeof(chunk))
+        {
+            size_t size = TransferNextChunk(&p->joinTx, timeNow, LAN_TRANSFER_RESEND, chunk, sizeof(chunk));
+            if (size == 0)
+                break;
+            sendto(lan->socketFd, chunk, size, 0, (struct sockaddr *)&p->addr, sizeof(p->addr));
+            ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+            ProfileCount(PROFILE_COUNTER_BYTES_OUT, (uint32_t)size);
+            lan->transferTokens -= (float)size;
+        }
+    }
+}
+
+// Joiner side: after a short listen, either nobody older is here (we are the
+// host and already in sync) or we keep asking the host until its blob lands.
+static void RequestJoinState(LanState *lan, double timeNow)
+{
+    if (lan->joinSynced || timeNow - lan->joinStartedAt < LAN_JOIN_WAIT)
+        return;
+    int host = LanHostSlot(lan, timeNow);
+    if (host < 0)
+    {
+        lan->joinSynced = true;
+        return;
+    }
+    if (timeNow - lan->joinRequestAt < LAN_JOIN_REQUEST_INTERVAL)
+        return;
+    uint8_t request[2] = {LAN_JOIN_REQUEST_MAGIC, 0};
+    sendto(lan->socketFd, request, sizeof(request), 0, (struct sockaddr *)&lan->peers[host].addr, sizeof(lan->peers[host].addr));
+    ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+    ProfileCount(PROFILE_COUNTER_BYTES_OUT, sizeof(request));
+    lan->joinRequestAt = timeNow;
+}
+
+static void ReceiveJoinChunk(LanState *lan, int slot, const uint8_t *in, size_t len, double timeNow)
+{
+    if (slot != LanHostSlot(lan, timeNow))
+        return;
+    if (TransferReceive(&lan->joinRx, in, len))
+    {
+        JoinSnapshot snapshot;
+        if (ReadJoinSnapshot(lan, slot, lan->joinRx.data, lan->joinRx.size, timeNow, &snapshot))
+        {
+            snapshot.elapsed = timeNow - lan->joinStartedAt;
+            lan->joinState = snapshot;
+            lan->hasJoinState = true;
+        }
+        lan->joinSynced = true;
+    }
+    uint8_t ack[TRANSFER_ACK_BYTES];
+    size_t size = TransferWriteAck(&lan->joinRx, ack, sizeof(ack));
+    if (size == 0)
+        return;
+    const Peer *host = &lan->peers[slot];
+    sendto(lan->socketFd, ack, size, 0, (struct sockaddr *)&host->addr, sizeof(host->addr));
+    ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+    ProfileCount(PROFILE_COUNTER_BYTES_OUT, (uint32_t)size);
+}
+
+static void UpdateLan(LanState *lan,
+                      float dt,
+                      Vector3 playerPos,
+                      int weaponIndex,
+                      int ammo,
+                     PlayerState *player,
+                     bool quickfire,
+                     bool speed,
+                     bool revive,
+                      MultiplayerVariant multiVariant,
+                      int playerTeam,
+                      const char *playerName,
+                      double timeNow,
+                      int *pendingCashShare,
+                      int *pendingScoreShare,
+                      float *sharePipTimer,
+                      int *sharePipCash,
+                      int *sharePipScore,
+                      const DamageEvent *damageRay,
+                      bool allowDamageBursts,
+                      LanEvent *outEvent,
+                      uint8_t *eventCounter,
+                      const ZombiesState *zombies)
+{
+    if (!lan->enabled)
+        return;
+
+    struct sockaddr_in bcast = {
+        .sin_family = AF_INET,
+        .sin_port = htons(LAN_PORT),
+        .sin_addr.s_addr = htonl(INADDR_BROADCAST)};
+
+    lan->broadcastAccumulator += dt;
+    if (lan->broadcastAccumulator > CvarFloat(gCvar.sendInterval))
+    {
+        lan->broadcastAccumulator = 0.0;
+        LanPayload payload = {0};
+        payload.position[0] = QuantizePosition(playerPos.x);
+        payload.position[1] = QuantizePosition(playerPos.y);
+        payload.position[2] = QuantizePosition(playerPos.z);
+        payload.weaponIndex = (uint8_t)weaponIndex;
+        payload.ammo = (uint16_t)Clamp(ammo, 0, 60000);
+        payload.health = (uint8_t)Clamp((int)((player->health / PLAYER_MAX_HEALTH) * 255.0f), 0, 255);
+        payload.cash = (uint16_t)Clamp(player->cash, 0, 60000);
+        payload.score = (uint16_t)Clamp(player->score, 0, 60000);
+        payload.cashDelta = (int8_t)Clamp(*pendingCashShare, -120, 120);
+        payload.scoreDelta = (int8_t)Clamp(*pendingScoreShare, -120, 120);
+        payload.joinSeconds = (uint16_t)Clamp((int)(timeNow - lan->selfJoinTime), 0, 65000);
+        int flags = 0;
+        if (player->isDowned) flags |= 1 << 0;
+        if (quickfire) flags |= 1 << 1;
+        if (speed) flags |= 1 << 2;
+        if (revive) flags |= 1 << 3;
+        if (player->reviveProgress > 0.0f) flags |= 1 << 4;
+        if (playerTeam == 1) flags |= 1 << 5;
+        if (multiVariant == MULTI_TEAM) flags |= 1 << 6;
+        payload.flags = (uint8_t)flags;
+        strncpy(payload.name, playerName, LAN_NAME_BYTES - 1);
+        if (outEvent && outEvent->kind > 0 && eventCounter)
+        {
+            payload.eventKind = outEvent->kind;
+            payload.eventTeam = outEvent->team;
+            payload.eventId = (*eventCounter)++;
+            strncpy(payload.eventTarget, outEvent->target, LAN_NAME_BYTES - 1);
+        }
+        if (damageRay && damageRay->ttl > 0.0f)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                float o = ((float *)&damageRay->origin)[i];
+                float d = ((float *)&damageRay->dir)[i];
+                payload.rayOrigin[i] = QuantizePosition(o);
+                payload.rayDir[i] = QuantizePosition(d);
+            }
+            payload.rayDamage = (uint8_t)Clamp((int)damageRay->damage, 0, 255);
+            payload.damageId = damageRay->id;
+        }
+        uint8_t raw[LAN_PACKET_SIZE] = {0};
+        size_t rawSize = PackLanPayload(raw, &payload, lan->useChecksum);
+        uint8_t buffer[LAN_PACKET_SIZE] = {0};
+        bool keyframe = false;
+        uint64_t codecStart = ProfileNowNs();
+        size_t packetSize = LanCodecEncode(&lan->codecTx, raw, buffer, sizeof(buffer), &keyframe);
+        uint64_t codecNs = ProfileNowNs() - codecStart;
+        ProfileCount(PROFILE_COUNTER_CODEC_NS, (uint32_t)codecNs);
+        lan->codecNs += codecNs;
+        lan->codecPackets++;
+        lan->codecRawBytes += (uint32_t)rawSize;
+        lan->codecWireBytes += (uint32_t)packetSize;
+        // Late joiners can only start from a keyframe, so that is what gets resent to them.
+        if (keyframe)
+        {
+            memcpy(lan->lastPacket, buffer, packetSize);
+            lan->lastPacketSize = packetSize;
+        }
+        for (int i = 0; i < lan->fanoutCount; i++)
+        {
+            sendto(lan->socketFd, buffer, packetSize, 0, (struct sockaddr *)&lan->fanout[i], sizeof(lan->fanout[i]));
+            ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+            ProfileCount(PROFILE_COUNTER_BYTES_OUT, (uint32_t)packetSize);
+        }
+        if (!lan->fanoutOnly)
+        {
+            sendto(lan->socketFd, buffer, packetSize, 0, (struct sockaddr *)&bcast, sizeof(bcast));
+            ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+            ProfileCount(PROFILE_COUNTER_BYTES_OUT, (uint32_t)packetSize);
+        }
+        *pendingCashShare = 0;
+        *pendingScoreShare = 0;
+        if (outEvent)
+            outEvent->kind = 0;
+    }
+
+    lan->enemyAccumulator += dt;
+    if (lan->enemyAccumulator >= LAN_ENEMY_SEND_INTERVAL)
+    {
+        if (zombies)
+            SendEnemyReplicas(lan, zombies, lan->enemyAccumulator);
+        lan->enemyAccumulator = 0.0f;
+    }
+
+    lan->moveAccumulator += dt;
+    if (lan->moveAccumulator >= LAN_MOVE_SEND_INTERVAL)
+    {
+        int host = LanHostSlot(lan, timeNow);
+        if (host >= 0 && lan->moveReady)
+            SendMoveReport(lan, &lan->peers[host]);
+        lan->moveElapsed = 0.0f;
+        lan->moveAccumulator = 0.0f;
+    }
+
+    lan->clockAccumulator += dt;
+    if (lan->clockAccumulator >= LAN_CLOCK_PING_INTERVAL)
+    {
+        SendClockPings(lan);
+        RunHostElection(lan, timeNow, lan->clockAccumulator);
+        SendHostReports(lan, timeNow);
+        lan->clockAccumulator = 0.0f;
+    }
+
+    RequestJoinState(lan, timeNow);
+    PumpJoinTransfers(lan, dt, timeNow);
+
+    struct sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    uint8_t buffer[LAN_PACKET_SIZE] = {0};
+    int read = 0;
+    while ((read = recvfrom(lan->socketFd, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &fromLen)) > 0)
+    {
+        ProfileCount(PROFILE_COUNTER_PACKETS_IN, 1);
+        ProfileCount(PROFILE_COUNTER_BYTES_IN, (uint32_t)read);
+        int known = -1;
+        for (int i = 0; i < MAX_PEERS; i++)
+        {
+            const Peer *p = &lan->peers[i];
+            if (p->active && p->addr.sin_addr.s_addr == from.sin_addr.s_addr && p->addr.sin_port == from.sin_port)
+            {
+                known = i;
                 break;
             }
         }
-        if (!assigned)
+        if (known >= 0)
+        {
+            MetricsAdd(gPeerMetrics[known][0], 1);
+            MetricsAdd(gPeerMetrics[known][1], read);
+        }
+        if (buffer[0] == LAN_ENEMY_MAGIC)
+        {
+            if (known >= 0)
+                ReceiveEnemyReplicas(&lan->peers[known], buffer, (size_t)read, timeNow);
+            continue;
+        }
+        if (buffer[0] == LAN_MOVE_MAGIC)
+        {
+            if (known >= 0)
+                ReceiveMoveReport(lan, known, buffer, (size_t)read, timeNow);
+            continue;
+        }
+        if (buffer[0] == LAN_CLOCK_PING_MAGIC)
+        {
+            if (known >= 0)
+                AnswerClockPing(lan, &lan->peers[known], buffer, (size_t)read);
+            continue;
+        }
+        if (buffer[0] == LAN_CLOCK_PONG_MAGIC)
+        {
+            if (known >= 0)
+                ReceiveClockPong(&lan->peers[known], buffer, (size_t)read);
+            continue;
+        }
+        if (buffer[0] == LAN_HOST_REPORT_MAGIC)
+        {
+            if (known >= 0)
+                ReceiveHostReport(lan, known, buffer, (size_t)read, timeNow);
+            continue;
+        }
+        if (buffer[0] == LAN_JOIN_REQUEST_MAGIC)
+        {
+            // Requests are repeated until the blob lands; only a finished or idle transfer restarts.
+            if (known >= 0 && LanHostSlot(lan, timeNow) < 0 && !lan->peers[known].joinTx.active)
+            {
+                lan->peers[known].joinRequested = true;
+                lan->peers[known].teleportGrant = true;
+            }
+            continue;
+        }
+        if (buffer[0] == TRANSFER_CHUNK_MAGIC)
+        {
+            if (known >= 0)
+                ReceiveJoinChunk(lan, known, buffer, (size_t)read, timeNow);
+            continue;
+        }
+        if (buffer[0] == TRANSFER_ACK_MAGIC)
+        {
+            if (known >= 0)
+                TransferAck(&lan->peers[known].joinTx, buffer, (size_t)read);
+            continue;
+        }
+        if (buffer[0] == LAN_MOVE_ACK_MAGIC)
+        {
+            if (known >= 0 && known == LanHostSlot(lan, timeNow))
+                ReceiveMoveAck(lan, buffer, (size_t)read);
+            continue;
+        }
+        LanCodecState joinCodec = {0};
+        LanCodecState *codec = known >= 0 ? &lan->peers[known].codec : &joinCodec;
+        uint8_t raw[LAN_RAW_PAYLOAD_BYTES];
+        uint64_t codecStart = ProfileNowNs();
+        bool decoded = LanCodecDecode(codec, buffer, (size_t)read, raw);
+        ProfileCount(PROFILE_COUNTER_CODEC_NS, (uint32_t)(ProfileNowNs() - codecStart));
+        // Deltas from a sender whose keyframe we missed are skipped until the next one.
+        if (!decoded && read > 0 && buffer[0] == LAN_CODEC_MAGIC)
+            continue;
+        LanPayload packet;
+        if (!decoded || !UnpackLanPayload(raw, LAN_RAW_PAYLOAD_BYTES, lan->useChecksum, &packet))
+        {
+            LogWrite(LOG_LAN_BAD_PACKET, read);
+            continue;
+        }
+
+        bool assigned = false;
+        if (from.sin_addr.s_addr == lan->selfAddr.sin_addr.s_addr && from.sin_port == lan->selfAddr.sin_port)
+            continue;
+
+        for (int i = 0; i < MAX_PEERS; i++)
+        {
+            Peer *p = &lan->peers[i];
+            if (p->active && p->addr.sin_addr.s_addr == from.sin_addr.s_addr && p->addr.sin_port == from.sin_port)
+            {
+                Vector3 target = {DequantizePosition(packet.position[0]),
+                                  DequantizePosition(packet.position[1]),
+                                  DequantizePosition(packet.position[2])};
+                p->position = target;
+                p->renderPos = Vector3Lerp(p->renderPos, target, Clamp(dt * CvarFloat(gCvar.peerSnap), 0.0f, 1.0f));
+                p->weaponIndex = packet.weaponIndex;
+                p->ammo = packet.ammo;
+                p->health = ((float)packet.health / 255.0f) * PLAYER_MAX_HEALTH;
+                p->isDowned = (packet.flags & (1 << 0)) != 0;
+                p->perkQuickfire = (packet.flags & (1 << 1)) != 0;
+                p->perkSpeed = (packet.flags & (1 << 2)) != 0;
+                p->perkRevive = (packet.flags & (1 << 3)) != 0;
+                p->isReviving = (packet.flags & (1 << 4)) != 0;
+                p->team = (packet.flags & (1 << 5)) != 0 ? 1 : 0;
+                p->teamMode = (packet.flags & (1 << 6)) != 0;
+                p->cash = packet.cash;
+                p->score = packet.score;
+                p->joinAgeSeconds = packet.joinSeconds;
+                if (packet.name[0])
+                    strncpy(p->name, packet.name, sizeof(p->name));
+                p->lastHeard = timeNow;
+                if (packet.eventKind > 0 && packet.eventId != p->lastEventId)
+                {
+                    const char *actorName = p->name[0] ? p->name : "Peer";
+                    memset(&lan->incomingEvent, 0, sizeof(lan->incomingEvent));
+                    lan->incomingEvent.kind = packet.eventKind;
+                    lan->incomingEvent.team = p->team;
+                    lan->incomingEvent.id = packet.eventId;
+                    strncpy(lan->incomingEvent.actor, actorName, LAN_NAME_BYTES - 1);
+                    strncpy(lan->incomingEvent.target, packet.eventTarget, LAN_NAME_BYTES - 1);
+                    lan->hasIncomingEvent = true;
+                    p->lastEventId = packet.eventId;
+                    LogWrite(LOG_LAN_EVENT, packet.eventKind, packet.eventId, i);
+                }
+                assigned = true;
+                player->cash = (int)Clamp((float)player->cash + (float)packet.cashDelta, 0.0f, 60000.0f);
+                player->score = (int)Clamp((float)player->score + (float)packet.scoreDelta, 0.0f, 60000.0f);
+                if ((packet.cashDelta != 0 || packet.scoreDelta != 0) && sharePipTimer && sharePipCash && sharePipScore)
+                {
+                    *sharePipTimer = 1.6f;
+                    *sharePipCash = packet.cashDelta;
+                    *sharePipScore = packet.scoreDelta;
+                }
+                if (allowDamageBursts && packet.rayDamage > 0 && packet.damageId != p->lastDamageId)
+                {
+                    Vector3 rayOrigin = {DequantizePosition(packet.rayOrigin[0]),
+                                         DequantizePosition(packet.rayOrigin[1]),
+                                         DequantizePosition(packet.rayOrigin[2])};
+                    Vector3 rayDir = {DequantizePosition(packet.rayDir[0]),
+                                      DequantizePosition(packet.rayDir[1]),
+                                      DequantizePosition(packet.rayDir[2])};
+                    float tHit = 50.0f;
+                    if (HitscanAgainstSphere(rayOrigin, Vector3Normalize(rayDir), playerPos, 0.35f, &tHit))
+                    {
+                        player->health -= packet.rayDamage;
+                        player->damageCooldown = 0.6f;
+                    }
+                    p->lastDamageId = packet.damageId;
+                }
+                break;
+            }
+        }
+        if (!assigned)
+        {
+            for (int i = 0; i < MAX_PEERS; i++)
+            {
+                Peer *p = &lan->peers[i];
+                if (!p->active)
+                {
+                    p->active = true;
+                    p->addr = from;
+                    p->codec = joinCodec;
+                    ReplicationReset(&p->replication);
+                    memset(p->ghosts, 0, sizeof(p->ghosts));
+                    p->hasAuth = false;
+                    p->teleportGrant = false;
+                    p->joinTx.active = false;
+                    p->joinRequested = false;
+                    p->hasReplicaSeq = false;
+                    p->hasReport = false;
+                    p->reportedHost = 0;
+                    ClockSyncReset(&p->clock);
+                    LanCodecRequestKeyframe(&lan->codecTx);
+                    p->position = (Vector3){DequantizePosition(packet.position[0]),
+                                            DequantizePosition(packet.position[1]),
+                                            DequantizePosition(packet.position[2])};
+                    p->renderPos = p->position;
+                    p->weaponIndex = packet.weaponIndex;
+                    p->ammo = packet.ammo;
+                    p->health = ((float)packet.health / 255.0f) * PLAYER_MAX_HEALTH;
+                    p->isDowned = (packet.flags & (1 << 0)) != 0;
+                    p->perkQuickfire = (packet.flags & (1 << 1)) != 0;
+                    p->perkSpeed = (packet.flags & (1 << 2)) != 0;
+                    p->perkRevive = (packet.flags & (1 << 3)) != 0;
+                    p->isReviving = (packet.flags & (1 << 4)) != 0;
+                    p->team = (packet.flags & (1 << 5)) != 0 ? 1 : 0;
+                    p->teamMode = (packet.flags & (1 << 6)) != 0;
+                    p->cash = packet.cash;
+                    p->score = packet.score;
+                    p->joinAgeSeconds = packet.joinSeconds;
+                    if (packet.name[0])
+                        strncpy(p->name, packet.name, sizeof(p->name));
+                    unsigned int addr = ntohl(from.sin_addr.s_addr);
+                    unsigned int octet = addr & 0xFF;
+                    if (p->name[0] == '\0')
+                        snprintf(p->name, sizeof(p->name), "P-%02u", octet);
+                    p->lastHeard = timeNow;
+                    LogWrite(LOG_LAN_PEER_JOINED, i, (int)octet);
+                    if (packet.eventKind > 0)
+                        p->lastEventId = packet.eventId;
+                    if (lan->lastPacketSize > 0)
+                    {
+                        sendto(lan->socketFd,
+                               lan->lastPacket,
+                               lan->lastPacketSize,
+                               0,
+                               (struct sockaddr *)&from,
+                               sizeof(from));
+                        ProfileCount(PROFILE_COUNTER_PACKETS_OUT, 1);
+                        ProfileCount(PROFILE_COUNTER_BYTES_OUT, (uint32_t)lan->lastPacketSize);
+                    }
+                    player->cash = (int)Clamp((float)player->cash + (float)packet.cashDelta, 0.0f, 60000.0f);
+                    player->score = (int)Clamp((float)player->score + (float)packet.scoreDelta, 0.0f, 60000.0f);
+                    if ((packet.cashDelta != 0 || packet.scoreDelta != 0) && sharePipTimer && sharePipCash && sharePipScore)
+                    {
+                        *sharePipTimer = 1.6f;
+                        *sharePipCash = packet.cashDelta;
+                        *sharePipScore = packet.scoreDelta;
+                    }
+                    if (allowDamageBursts && packet.rayDamage > 0 && packet.damageId != p->lastDamageId)
+                    {
+                        Vector3 rayOrigin = {DequantizePosition(packet.rayOrigin[0]),
+                                             DequantizePosition(packet.rayOrigin[1]),
+                                             DequantizePosition(packet.rayOrigin[2])};
+                        Vector3 rayDir = {DequantizePosition(packet.rayDir[0]),
+                                          DequantizePosition(packet.rayDir[1]),
+                                          DequantizePosition(packet.rayDir[2])};
+                        float tHit = 50.0f;
+                        if (HitscanAgainstSphere(rayOrigin, Vector3Normalize(rayDir), playerPos, 0.35f, &tHit))
+                        {
+                            player->health -= packet.rayDamage;
+                            player->damageCooldown = 0.6f;
+                        }
+                        p->lastDamageId = packet.damageId;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < MAX_PEERS; i++)
+    {
+        Peer *p = &lan->peers[i];
+        if (p->active && timeNow - p->lastHeard > CvarFloat(gCvar.peerTimeout))
+        {
+            p->active = false;
+            LogWrite(LOG_LAN_PEER_TIMEOUT, i, timeNow - p->lastHeard);
+        }
+        if (p->active)
+        {
+            p->renderPos = Vector3Lerp(p->renderPos, p->position, Clamp(dt * CvarFloat(gCvar.peerSmoothing), 0.0f, 1.0f));
+            for (int g = 0; g < REPLICATION_MAX_ENTITIES; g++)
+            {
+                RemoteEnemy *ghost = &p->ghosts[g];
+                if (!ghost->active)
+                    continue;
+                if (timeNow - ghost->lastHeard > 1.5)
+                    ghost->active = false;
+                else
+                    ghost->renderPos = Vector3Lerp(ghost->renderPos, ghost->position, Clamp(dt * 10.0f, 0.0f, 1.0f));
+            }
+        }
+    }
+}
+
+static bool HitscanAgainstSphere(Vector3 origin, Vector3 dir, Vector3 center, float radius, float *tHit)
+{
+    Vector3 oc = Vector3Subtract(origin, center);
+    float b = Vector3DotProduct(oc, dir);
+    float c = Vector3DotProduct(oc, oc) - radius * radius;
+    float discriminant = b * b - c;
+    if (discriminant < 0.0f)
+        return false;
+
+    float t = -b - sqrtf(discriminant);
+    if (t < 0.0f)
+        t = -b + sqrtf(discriminant);
+    if (t < 0.0f)
+        return false;
+
+    if (tHit)
+        *tHit = t;
+    return true;
+}
+
+static EcsHandle SpawnFx(FxStore *fx, int archetype, Vector3 pos, float timer, Color color)
+{
+    EcsHandle h = EcsSpawn(&fx->world, archetype);
+    if (!EcsAlive(&fx->world, h) && archetype >= 0 && fx->world.archetypes[archetype].count > 0)
+    {
+        // Full: the newest effect wins over whichever has the least time left.
+        const EcsArchetype *a = &fx->world.archetypes[archetype];
+        const float *lifetimes = (const float *)a->columns[ECS_LIFETIME];
+        int oldest = 0;
+        for (int row = 1; row < a->count; row++)
+        {
+            if (lifetimes[row] < lifetimes[oldest])
+                oldest = row;
+        }
+        EcsDestroyRow(&fx->world, archetype, oldest);
+        h = EcsSpawn(&fx->world, archetype);
+    }
+    if (!EcsAlive(&fx->world, h))
+        return h;
+    *(Vector3 *)EcsGet(&fx->world, h, ECS_POSITION) = pos;
+    *(float *)EcsGet(&fx->world, h, ECS_LIFETIME) = timer;
+    *(Color *)EcsGet(&fx->world, h, ECS_TINT) = color;
+    return h;
+}
+
+static void PushDissolve(FxStore *fx, Vector3 pos, EnemyType type)
+{
+    EcsHandle h = SpawnFx(fx, fx->dissolves, pos, 1.35f, (Color){180, 200, 200, 200});
+    float *height = (float *)EcsGet(&fx->world, h, ECS_EXTENT);
+    if (height)
+        *height = (type == ENEMY_BOSS) ? 1.4f : (type == ENEMY_SPITTER ? 0.8f : 1.0f);
+}
+
+static int FireWeapon(const Weapon *weapon,
+                      Vector3 origin,
+                      Vector3 dir,
+                      ZombiesState *zombies,
+                      FxStore *fx,
+                      EventBus *events)
+{
+    int hits = 0;
+    for (int i = 0; i < zombies->enemyCapacity; i++)
+    {
+        Enemy *e = &zombies->enemies[i];
+        if (!e->active)
+            continue;
+
+        float t = weapon->range;
+        if (HitscanAgainstSphere(origin, dir, e->position, e->radius, &t))
+        {
+            float damage = weapon->damage;
+            if (e->weakenTimer > 0.0f)
+                damage *= 1.35f;
+            e->health -= damage;
+            GameEvent *hit = EventBusPush(events, GAME_EVENT_ENEMY_HIT);
+            if (hit)
+            {
+                hit->subject = (int)e->type;
+                hit->damage = damage;
+                hit->origin = origin;
+                hit->dir = dir;
+                hit->point = Vector3Add(origin, Vector3Scale(dir, t));
+            }
+            if (e->health <= 0)
+            {
+                e->active = false;
+                zombies->activeCount--;
+                int reward = 40;
+                if (e->type == ENEMY_BOSS)
+                    reward = 220;
+                else if (e->type == ENEMY_SPRINTER)
+                    reward = 70;
+                else if (e->type == ENEMY_SPITTER)
+                    reward = 90;
+                GameEvent *kill = EventBusPush(events, GAME_EVENT_ENEMY_KILLED);
+                if (kill)
+                {
+                    kill->subject = (int)e->type;
+                    kill->amount = reward;
+                    kill->bonus = e->weakenedByPlayer ? reward / 3 : 0;
+                    kill->point = e->position;
+                }
+                LogWrite(LOG_COMBAT_KILL, (int)e->type, reward);
+                if (fx)
+                    PushDissolve(fx, e->position, e->type);
+            }
+            hits++;
+
+            if (fx)
+                SpawnFx(fx, fx->decals, Vector3Add(origin, Vector3Scale(dir, t)), 1.5f, (Color){200, 90, 90, 255});
+        }
+    }
+    return hits;
+}
+
+static int FireAtPeers(const Weapon *weapon,
+                       Vector3 origin,
+                       Vector3 dir,
+                       LanState *lan,
+                       bool teamMode,
+                       int playerTeam,
+                       double matchNow,
+                       EventBus *events)
+{
+    int hits = 0;
+    for (int i = 0; i < MAX_PEERS; i++)
+    {
+        Peer *p = &lan->peers[i];
+        if (!p->active)
+            continue;
+        if (teamMode && p->team == playerTeam)
+            continue;
+        float t = weapon->range;
+        if (HitscanAgainstSphere(origin, dir, p->renderPos, 0.35f, &t))
+        {
+            hits++;
+            p->health -= weapon->damage;
+            GameEvent *hit = EventBusPush(events, GAME_EVENT_PEER_HIT);
+            if (hit)
+            {
+                hit->subject = i;
+                hit->team = playerTeam;
+                hit->damage = weapon->damage;
+                hit->origin = origin;
+                hit->dir = dir;
+                hit->point = Vector3Add(origin, Vector3Scale(dir, t));
+            }
+            if (p->health <= 0.0f)
+            {
+                p->respawning = true;
+                p->respawnAt = matchNow + 1.5;
+                p->health = 0.0f;
+                p->teleportGrant = true;
+                GameEvent *frag = EventBusPush(events, GAME_EVENT_PEER_FRAGGED);
+                if (frag)
+                {
+                    frag->subject = i;
+                    frag->team = playerTeam;
+                    snprintf(frag->target, sizeof(frag->target), "%.*s", LAN_NAME_BYTES, p->name[0] ? p->name : "Peer");
+                }
+            }
+        }
+    }
+    return hits;
+}
+
+static int MeleeAssist(Vector3 origin,
+                       Vector3 dir,
+                       ZombiesState *zombies,
+                       int *cashAssist,
+                       float *assistFlash)
+{
+    int tagged = 0;
+    for (int i = 0; i < zombies->enemyCapacity; i++)
+    {
+        Enemy *e = &zombies->enemies[i];
+        if (!e->active)
+            continue;
+        float t = 1.6f;
+        if (HitscanAgainstSphere(origin, dir, e->position, e->radius, &t))
+        {
+            e->health -= 6.0f;
+            e->weakenTimer = 4.0f;
+            e->weakenedByPlayer = true;
+            tagged++;
+            if (cashAssist)
+                *cashAssist += 6;
+        }
+    }
+    if (tagged > 0 && assistFlash)
+        *assistFlash = 1.2f;
+    return tagged;
+}
+
+// Each simulation owns its generator, so headless balance runs are
+// deterministic per seed and never share state across threads.
+static int ZombiesRandom(ZombiesState *zombies, int min, int max)
+{
+    uint32_t x = zombies->rng ? zombies->rng : 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    zombies->rng = x;
+    return min + (int)(x % (uint32_t)(max - min + 1));
+}
+
+static void SpawnEnemy(ZombiesState *zombies, Vector3 position, EnemyType type)
+{
+    for (int i = 0; i < zombies->enemyCapacity; i++)
+    {
+        if (!zombies->enemies[i].active)
+        {
+            zombies->enemies[i].position = position;
+            zombies->enemies[i].type = type;
+            zombies->enemies[i].radius = (type == ENEMY_BOSS) ? 0.6f : (type == ENEMY_SPITTER ? 0.4f : 0.35f);
+            float baseHealth = 0.0f;
+            switch (type)
+            {
+            case ENEMY_BOSS:
+                baseHealth = 180.0f;
+                break;
+            case ENEMY_SPITTER:
+                baseHealth = 50.0f;
+                break;
+            case ENEMY_SPRINTER:
+                baseHealth = 22.0f;
+                break;
+            default:
+                baseHealth = 30.0f;
+                break;
+            }
+            zombies->enemies[i].health = baseHealth + zombies->wave * (type == ENEMY_BOSS ? 15.0f : 6.0f) * zombies->healthScale;
+            zombies->enemies[i].active = true;
+            zombies->enemies[i].wobblePhase = ZombiesRandom(zombies, 0, 628) / 100.0f;
+            zombies->enemies[i].attackCharge = 0.0f;
+            zombies->enemies[i].attackCooldown = 0.0f;
+            zombies->enemies[i].weakenTimer = 0.0f;
+            zombies->enemies[i].weakenedByPlayer = false;
+            zombies->enemies[i].navTarget = -1;
+            zombies->enemies[i].navCooldown = 0.0f;
+            zombies->activeCount++;
+            zombies->waveSpawned++;
+            LogWrite(LOG_ZOMBIES_SPAWN, (int)type, zombies->wave, zombies->activeCount);
+            break;
+        }
+    }
+}
+
+static void PushTrail(FxStore *fx, Vector3 pos, Color color)
+{
+    if (fx->world.archetypes[fx->trails].count < CvarInt(gCvar.trails))
+        SpawnFx(fx, fx->trails, pos, 0.8f, color);
+}
+
+static int ChooseNavTarget(const Vector3 *navPoints, const float *navWeights, int navCount, Vector3 playerPos, int jitter)
+{
+    if (navCount <= 0)
+        return -1;
+    int best = 0;
+    float bestDist = Vector3Distance(navPoints[0], playerPos);
+    if (navWeights)
+        bestDist /= fmaxf(navWeights[0], 0.01f);
+    for (int i = 1; i < navCount; i++)
+    {
+        float d = Vector3Distance(navPoints[i], playerPos);
+        if (navWeights)
+            d /= fmaxf(navWeights[i], 0.01f);
+        if (d < bestDist)
+        {
+            bestDist = d;
+            best = i;
+        }
+    }
+    if (navCount > 1 && jitter > 65)
+        best = (best + 1) % navCount;
+    return best;
+}
+
+static Vector3 SelectSafeSpawn(const ArenaPreset *preset)
+{
+    if (!preset)
+        return (Vector3){0};
+    if (preset->navCount > 0)
+    {
+        float best = -1000.0f;
+        int bestIndex = 0;
+        for (int i = 0; i < preset->navCount; i++)
+        {
+            float w = (preset->navWeights[i] > 0.01f) ? preset->navWeights[i] : 0.01f;
+            if (w > best)
+            {
+                best = w;
+                bestIndex = i;
+            }
+        }
+        Vector3 pos = preset->navPoints[bestIndex];
+        pos.y = PLAYER_HEIGHT;
+        return pos;
+    }
+    return preset->playerSpawn;
+}
+
+// How strongly each enemy type shies away from threat, recent deaths and
+// crowding; bosses ignore the maps and walk straight in.
+static const float gEnemyInfluenceWeights[][INFLUENCE_LAYER_COUNT] = {
+    [ENEMY_BASIC] = {0.8f, 0.6f, 0.4f},
+    [ENEMY_SPITTER] = {1.0f, 0.6f, 0.6f},
+    [ENEMY_SPRINTER] = {1.4f, 0.8f, 0.3f},
+    [ENEMY_BOSS] = {0.0f, 0.0f, 0.0f},
+};
+
+static void UpdateZombies(ZombiesState *zombies,
+                          float dt,
+                          double matchNow,
+                          Vector3 playerPos,
+                          PlayerState *player,
+                          FxStore *fx,
+                          const Vector3 *navPoints,
+                          const float *navWeights,
+                          int navCount,
+                          const InfluenceMap *influence,
+                          EventBus *events)
+{
+    const float spawnDelay = 2.0f;
+    zombies->spawnCooldown -= dt;
+    // The wave clock runs on match time so every peer's boss window lines up.
+    if (!zombies->waveClockStarted)
+    {
+        zombies->waveStartedAt = matchNow;
+        zombies->waveClockStarted = true;
+    }
+    zombies->waveTimer = fmaxf((float)(matchNow - zombies->waveStartedAt), 0.0f);
+
+    if (zombies->spawnCooldown <= 0.0f && zombies->activeCount < 6)
+    {
+        float angle = ZombiesRandom(zombies, 0, 628) / 100.0f;
+        float dist = 6.0f + zombies->wave * 0.2f;
+        Vector3 pos = {cosf(angle) * dist, 0.0f, sinf(angle) * dist};
+        bool boss = (zombies->wave % 5 == 0) && (zombies->waveTimer < 1.0f);
+        EnemyType type = boss ? ENEMY_BOSS : ENEMY_BASIC;
+        if (!boss)
+        {
+            int roll = ZombiesRandom(zombies, 0, 100);
+            if (zombies->wave > 2 && roll > 65)
+                type = ENEMY_SPRINTER;
+            else if (zombies->wave > 3 && roll > 40)
+                type = ENEMY_SPITTER;
+        }
+        SpawnEnemy(zombies, pos, type);
+        zombies->spawnCooldown = spawnDelay;
+    }
+
+    for (int i = 0; i < zombies->enemyCapacity; i++)
+    {
+        Enemy *e = &zombies->enemies[i];
+        if (!e->active)
+            continue;
+
+        Vector3 toPlayer = Vector3Subtract(playerPos, e->position);
+        toPlayer.y = 0.0f;
+        float dist = Vector3Length(toPlayer);
+        Vector3 toTarget = toPlayer;
+        if (navPoints && navCount > 0)
+        {
+            e->navCooldown -= dt;
+            if (e->navTarget < 0 || e->navTarget >= navCount || e->navCooldown <= 0.0f)
+            {
+                e->navTarget = ChooseNavTarget(navPoints, navWeights, navCount, playerPos, ZombiesRandom(zombies, 0, 100));
+                e->navCooldown = 2.0f + (float)ZombiesRandom(zombies, 0, 60) / 60.0f;
+            }
+            if (e->navTarget >= 0 && e->navTarget < navCount)
+            {
+                Vector3 navGoal = navPoints[e->navTarget];
+                navGoal.y = 0.0f;
+                if (Vector3Distance(e->position, navGoal) < 0.55f)
+                    e->navCooldown = 0.0f;
+                if (Vector3Distance(navGoal, playerPos) > 0.4f)
+                    toTarget = Vector3Subtract(navGoal, e->position);
+            }
+        }
+        if (e->weakenTimer > 0.0f)
+        {
+            e->weakenTimer -= dt;
+            if (e->weakenTimer < 0.0f)
+                e->weakenTimer = 0.0f;
+        }
+        float weakenScale = e->weakenTimer > 0.0f ? 0.78f : 1.0f;
+        float moveDist = Vector3Length(toTarget);
+        if (moveDist > 0.001f)
+        {
+            float speed = 2.2f;
+            if (e->type == ENEMY_BOSS)
+                speed = 1.6f;
+            else if (e->type == ENEMY_SPRINTER)
+                speed = 3.8f;
+            else if (e->type == ENEMY_SPITTER)
+                speed = 1.9f;
+            Vector3 dir = Vector3Normalize(toTarget);
+            // Out of striking range, zombies bend their approach around the aim line and kill zones.
+            if (influence && dist > 3.0f && e->type != ENEMY_BOSS)
+                dir = InfluenceSteer(influence, e->position, dir, 1.5f, gEnemyInfluenceWeights[e->type]);
+            Vector3 step = Vector3Scale(dir, speed * weakenScale * dt);
+            if (Vector3Length(step) > moveDist)
+                step = Vector3Scale(dir, moveDist);
+            e->position = Vector3Add(e->position, step);
+        }
+
+        e->wobblePhase += dt * ((e->type == ENEMY_BOSS) ? 2.0f : 2.8f);
+
+        if (e->attackCooldown > 0.0f)
+            e->attackCooldown -= dt;
+
+        const float attackRange = 1.05f;
+        const float windupTime = 0.35f;
+        if (e->type == ENEMY_SPITTER)
+        {
+            const float spitRange = 7.5f;
+            const float spitWind = 0.5f;
+            if (dist < spitRange)
+            {
+                e->attackCharge += dt;
+                if (e->attackCharge >= spitWind && e->attackCooldown <= 0.0f)
+                {
+                    player->health -= 8.0f;
+                    player->damageCooldown = 0.8f;
+                    LogWrite(LOG_ZOMBIES_PLAYER_HIT, (int)e->type, 8.0, (double)player->health);
+                    GameEvent *hurt = EventBusPush(events, GAME_EVENT_PLAYER_HURT);
+                    if (hurt)
+                    {
+                        hurt->subject = (int)e->type;
+                        hurt->damage = 8.0f;
+                        hurt->point = Vector3Add(e->position, Vector3Scale(Vector3Normalize(toPlayer), 1.4f));
+                        hurt->point.y = 0.5f;
+                    }
+                    e->attackCharge = 0.0f;
+                    e->attackCooldown = 2.0f;
+                    if (fx)
+                    {
+                        Vector3 dir = Vector3Normalize(toPlayer);
+                        for (int t = 1; t <= 4; t++)
+                        {
+                            Vector3 pos = Vector3Add(e->position, Vector3Scale(dir, (float)t * 0.35f));
+                            pos.y = 0.5f;
+                            PushTrail(fx, pos, (Color){140, 200, 255, 200});
+                        }
+                    }
+                }
+            }
+            else
+            {
+                e->attackCharge = 0.0f;
+            }
+        }
+        else
+        {
+            if (dist < attackRange)
+            {
+                e->attackCharge += dt;
+                if (e->attackCharge >= windupTime && e->attackCooldown <= 0.0f && player->damageCooldown <= 0.0f)
+                {
+                    float dmg = (e->type == ENEMY_BOSS) ? 25.0f : (e->type == ENEMY_SPRINTER ? 10.0f : 12.0f);
+                    if (e->weakenTimer > 0.0f)
+                        dmg *= 0.65f;
+                    player->health -= dmg;
+                    player->damageCooldown = 1.0f;
+                    LogWrite(LOG_ZOMBIES_PLAYER_HIT, (int)e->type, (double)dmg, (double)player->health);
+                    GameEvent *hurt = EventBusPush(events, GAME_EVENT_PLAYER_HURT);
+                    if (hurt)
+                    {
+                        hurt->subject = (int)e->type;
+                        hurt->damage = dmg;
+                    }
+                    e->attackCharge = 0.0f;
+                    e->attackCooldown = 1.35f;
+                }
+            }
+            else
+            {
+                e->attackCharge = 0.0f;
+            }
+        }
+    }
+
+    // A wave only clears once it has put something on the field.
+    if (zombies->activeCount == 0 && zombies->waveSpawned > 0)
+    {
+        zombies->wave++;
+        zombies->waveSpawned = 0;
+        zombies->spawnCooldown = 0.5f;
+        zombies->waveTimer = 0.0f;
+        zombies->waveStartedAt = matchNow;
+        LogWrite(LOG_ZOMBIES_WAVE, zombies->wave);
+    }
+}
+
+typedef struct OccluderCandidate
+{
+    Vector3 center;
+    Vector3 size;
+    float score;
+} OccluderCandidate;
+
+static void AddOccluderCandidate(OccluderCandidate *list, int *count, Vector3 eye, Vector3 center, Vector3 size)
+{
+    Vector3 toCenter = Vector3Subtract(center, eye);
+    float distSq = Vector3DotProduct(toCenter, toCenter);
+    list[*count].center = center;
+    list[*count].size = size;
+    list[*count].score = size.y * fmaxf(size.x, size.z) / fmaxf(distSq, 0.25f);
+    (*count)++;
+}
+
+// Rasterizes the scenery that hides the most screen for its distance; the
+// positions are snapped the same way QueueRetroModel snaps them.
+static void BuildOccluders(OcclusionBuffer *occlusion, const Camera3D *camera, const ArenaPreset *arena, const PropSpot *props, int propCount)
+{
+    OccluderCandidate candidates[sizeof(gArenaBlocks) / sizeof(gArenaBlocks[0]) + 8 + MAX_PROP_SPOTS];
+    int count = 0;
+    Vector3 eye = camera->position;
+    for (size_t i = 0; i < sizeof(gArenaBlocks) / sizeof(gArenaBlocks[0]); i++)
+        AddOccluderCandidate(candidates, &count, eye, QuantizeVec3(gArenaBlocks[i].position, 0.05f), gArenaBlocks[i].size);
+    for (int i = 0; i < arena->coverCount; i++)
+        AddOccluderCandidate(candidates, &count, eye, QuantizeVec3(arena->cover[i].position, 0.05f), arena->cover[i].size);
+    for (int i = 0; i < propCount; i++)
+        AddOccluderCandidate(candidates, &count, eye, QuantizeVec3(props[i].position, 0.1f), PropBoxSize(props[i].kind));
+
+    OcclusionBegin(occlusion, camera, (float)BASE_WIDTH / (float)BASE_HEIGHT);
+    for (int n = 0; n < count && n < OCCLUSION_MAX_OCCLUDERS; n++)
+    {
+        int best = n;
+        for (int i = n + 1; i < count; i++)
+        {
+            if (candidates[i].score > candidates[best].score)
+                best = i;
+        }
+        OccluderCandidate pick = candidates[best];
+        candidates[best] = candidates[n];
+        candidates[n] = pick;
+        OcclusionRasterBox(occlusion, pick.center, pick.size);
+    }
+    OcclusionFinish(occlusion);
+}
+
+static void DrawRemoteEnemies(const LanState *lan, OcclusionBuffer *occlusion, Vector3 viewer, VatSet *vat)
+{
+    for (int p = 0; p < MAX_PEERS; p++)
+    {
+        if (!lan->peers[p].active)
+            continue;
+        for (int i = 0; i < REPLICATION_MAX_ENTITIES; i++)
+        {
+            const RemoteEnemy *g = &lan->peers[p].ghosts[i];
+            if (!g->active)
+                continue;
+            float h = (g->type == ENEMY_BOSS) ? 1.7f : (g->type == ENEMY_SPITTER ? 1.0f : 1.2f);
+            float size = (g->type == ENEMY_BOSS) ? 1.0f : (g->type == ENEMY_SPITTER ? 0.6f : 0.7f);
+            if (!OcclusionTestBox(occlusion, g->renderPos, (Vector3){size, h, size}))
+                continue;
+            Color tint = {(unsigned char)(120 + g->charge * 100), 170, 150, 110};
+            // Ghosts carry no walk phase, so derive one from where they stand.
+            VatClip clip = g->charge > 0.05f ? VAT_CLIP_ATTACK : VAT_CLIP_WALK;
+            float time = clip == VAT_CLIP_ATTACK ? g->charge : (g->renderPos.x + g->renderPos.z) * 0.8f;
+            QueueAnimatedModel(vat, (LowPolyModelId)(LOWPOLY_ZOMBIE + g->type), g->renderPos, (Vector3){size, h, size}, viewer, tint, clip, time);
+        }
+    }
+}
+
+static void DrawZombies(const ZombiesState *zombies, OcclusionBuffer *occlusion, Vector3 viewer, VatSet *vat)
+{
+    for (int i = 0; i < zombies->enemyCapacity; i++)
+    {
+        if (!zombies->enemies[i].active)
+            continue;
+        float h = (zombies->enemies[i].type == ENEMY_BOSS) ? 1.7f : (zombies->enemies[i].type == ENEMY_SPITTER ? 1.0f : 1.2f);
+        float size = (zombies->enemies[i].type == ENEMY_BOSS) ? 1.0f : (zombies->enemies[i].type == ENEMY_SPITTER ? 0.6f : 0.7f);
+        float wobble = sinf(zombies->enemies[i].wobblePhase) * 0.15f;
+        Vector3 pos = zombies->enemies[i].position;
+        pos.y += wobble;
+        Vector3 boundsCenter = pos;
+        Vector3 bounds = {size, h, size};
+        if (zombies->enemies[i].attackCharge > 0.1f)
+        {
+            // Grow the bounds over the telegraph sphere drawn above the head.
+            float reach = 0.2f + 0.35f + Clamp(zombies->enemies[i].attackCharge / 0.5f, 0.0f, 1.0f) * 0.3f;
+            boundsCenter.y += reach * 0.5f;
+            bounds.y += reach;
+            bounds.x = bounds.z = fmaxf(size, reach * 2.0f);
+        }
+        if (!OcclusionTestBox(occlusion, boundsCenter, bounds))
+            continue;
+        Color baseTint = {120, 200, 120, 255};
+        if (zombies->enemies[i].type == ENEMY_BOSS)
+            baseTint = (Color){190, 120, 40, 255};
+        else if (zombies->enemies[i].type == ENEMY_SPITTER)
+            baseTint = (Color){160, 180, 220, 255};
+        else if (zombies->enemies[i].type == ENEMY_SPRINTER)
+            baseTint = (Color){200, 120, 180, 255};
+        if (zombies->enemies[i].weakenTimer > 0.0f)
+        {
+            baseTint = (Color){(unsigned char)Clamp(baseTint.r + 20, 0, 255),
+                               (unsigned char)Clamp(baseTint.g + 35, 0, 255),
+                               (unsigned char)Clamp(baseTint.b + 35, 0, 255),
+                               255};
+        }
+        float charge = Clamp(zombies->enemies[i].attackCharge / 0.5f, 0.0f, 1.0f);
+        Color tint = ColorAlpha(RED, charge);
+        tint = (Color){
+            (unsigned char)Clamp(baseTint.r + (int)tint.r, 0, 255),
+            (unsigned char)Clamp(baseTint.g - (int)(charge * 80), 0, 255),
+            (unsigned char)Clamp(baseTint.b - (int)(charge * 60), 0, 255),
+            255};
+        VatClip clip = zombies->enemies[i].attackCharge > 0.05f ? VAT_CLIP_ATTACK : VAT_CLIP_WALK;
+        float time = clip == VAT_CLIP_ATTACK ? charge : zombies->enemies[i].wobblePhase / (2.0f * PI);
+        QueueAnimatedModel(vat, (LowPolyModelId)(LOWPOLY_ZOMBIE + zombies->enemies[i].type), pos, (Vector3){size, h, size}, viewer, tint, clip, time);
+        if (zombies->enemies[i].attackCharge > 0.1f)
+        {
+            float telegraphSize = 0.35f + charge * 0.3f;
+            DrawSphere(Vector3Add(pos, (Vector3){0, h * 0.5f + 0.2f, 0}), telegraphSize, ColorAlpha(RED, 120));
+        }
+    }
+}
+
+static bool InitFxStore(FxStore *fx)
+{
+    const uint32_t base = ECS_MASK(ECS_POSITION) | ECS_MASK(ECS_LIFETIME) | ECS_MASK(ECS_TINT);
+    if (!EcsWorldInit(&fx->world, MEM_REGION_FX, MAX_DECALS + MAX_DISSOLVES + MAX_TRAILS))
+        return false;
+    fx->decals = EcsAddArchetype(&fx->world, base | ECS_MASK(ECS_TAG_DECAL), MAX_DECALS);
+    fx->dissolves = EcsAddArchetype(&fx->world, base | ECS_MASK(ECS_EXTENT) | ECS_MASK(ECS_TAG_DISSOLVE), MAX_DISSOLVES);
+    fx->trails = EcsAddArchetype(&fx->world, base | ECS_MASK(ECS_TAG_TRAIL), MAX_TRAILS);
+    return fx->decals >= 0 && fx->dissolves >= 0 && fx->trails >= 0;
+}
+
+static void AgeLifetimes(EcsWorld *world, const EcsView *view, void *user)
+{
+    (void)world;
+    float dt = *(const float *)user;
+    float *life = ECS_COLUMN(view, float, ECS_LIFETIME);
+    for (int i = 0; i < view->count; i++)
+        life[i] -= dt;
+}
+
+// Aging only writes columns, so FX tasks can run beside spawns into other
+// archetypes. Expired rows are removed later on the game thread.
+static void AgeFx(FxStore *fx, EcsComponent tag, float dt)
+{
+    EcsEach(&fx->world, ECS_MASK(ECS_LIFETIME) | ECS_MASK(tag), AgeLifetimes, &dt);
+}
+
+static void ReapExpired(EcsWorld *world, const EcsView *view, void *user)
+{
+    (void)user;
+    const float *life = ECS_COLUMN(view, const float, ECS_LIFETIME);
+    for (int i = view->count - 1; i >= 0; i--)
+    {
+        if (life[i] <= 0.0f)
+            EcsDestroyRow(world, view->archetype, i);
+    }
+}
+
+static void ReapFx(FxStore *fx)
+{
+    EcsEach(&fx->world, ECS_MASK(ECS_LIFETIME), ReapExpired, NULL);
+}
+
+static void DrawDecalRows(EcsWorld *world, const EcsView *view, void *user)
+{
+    (void)world;
+    (void)user;
+    const Vector3 *pos = ECS_COLUMN(view, const Vector3, ECS_POSITION);
+    const float *life = ECS_COLUMN(view, const float, ECS_LIFETIME);
+    const Color *color = ECS_COLUMN(view, const Color, ECS_TINT);
+    for (int i = 0; i < view->count; i++)
+    {
+        float alpha = Clamp(life[i], 0.0f, 1.0f);
+        Color faded = color[i];
+        faded.a = (unsigned char)(alpha * 255);
+        DrawSphere(pos[i], 0.08f, faded);
+    }
+}
+
+static void DrawDissolveRows(EcsWorld *world, const EcsView *view, void *user)
+{
+    (void)world;
+    VatSet *vat = (VatSet *)user;
+    const Vector3 *pos = ECS_COLUMN(view, const Vector3, ECS_POSITION);
+    const float *life = ECS_COLUMN(view, const float, ECS_LIFETIME);
+    const Color *color = ECS_COLUMN(view, const Color, ECS_TINT);
+    const float *height = ECS_COLUMN(view, const float, ECS_EXTENT);
+    for (int i = 0; i < view->count; i++)
+    {
+        float alpha = Clamp(life[i], 0.0f, 1.0f);
+        Color tint = color[i];
+        tint.a = (unsigned char)(alpha * 200);
+        // The dissolve height still encodes the enemy type it was pushed for.
+        LowPolyModelId model = height[i] > 1.2f ? LOWPOLY_BOSS : (height[i] < 0.9f ? LOWPOLY_SPITTER : LOWPOLY_ZOMBIE);
+        float size = model == LOWPOLY_BOSS ? 1.0f : (model == LOWPOLY_SPITTER ? 0.6f : 0.7f);
+        float h = model == LOWPOLY_BOSS ? 1.7f : (model == LOWPOLY_SPITTER ? 1.0f : 1.2f);
+        VatQueue(vat, model, QuantizeVec3(pos[i], 0.05f), (Vector3){size, h, size}, 0.0f, tint, VAT_CLIP_DEATH, 1.0f - alpha);
+    }
+}
+
+static void DrawTrailRows(EcsWorld *world, const EcsView *view, void *user)
+{
+    (void)world;
+    (void)user;
+    const Vector3 *pos = ECS_COLUMN(view, const Vector3, ECS_POSITION);
+    const float *life = ECS_COLUMN(view, const float, ECS_LIFETIME);
+    const Color *color = ECS_COLUMN(view, const Color, ECS_TINT);
+    for (int i = 0; i < view->count; i++)
+    {
+        float alpha = Clamp(life[i], 0.0f, 1.0f);
+        Color tint = color[i];
+        tint.a = (unsigned char)(alpha * 220);
+        DrawSphere(pos[i], 0.08f + (1.0f - alpha) * 0.08f, tint);
+    }
+}
+
+static void DrawFx(FxStore *fx, VatSet *vat)
+{
+    const uint32_t base = ECS_MASK(ECS_POSITION) | ECS_MASK(ECS_LIFETIME) | ECS_MASK(ECS_TINT);
+    EcsEach(&fx->world, base | ECS_MASK(ECS_TAG_DECAL), DrawDecalRows, NULL);
+    EcsEach(&fx->world, base | ECS_MASK(ECS_EXTENT) | ECS_MASK(ECS_TAG_DISSOLVE), DrawDissolveRows, vat);
+    EcsEach(&fx->world, base | ECS_MASK(ECS_TAG_TRAIL), DrawTrailRows, NULL);
+}
+
+static void ResetZombies(ZombiesState *zombies)
+{
+    Enemy *enemies = zombies->enemies;
+    int enemyCapacity = zombies->enemyCapacity;
+    uint32_t rng = zombies->rng;
+    float healthScale = zombies->healthScale > 0.0f ? zombies->healthScale : 1.0f;
+    memset(zombies, 0, sizeof(*zombies));
+    memset(enemies, 0, sizeof(Enemy) * enemyCapacity);
+    zombies->enemies = enemies;
+    zombies->enemyCapacity = enemyCapacity;
+    zombies->rng = rng;
+    zombies->healthScale = healthScale;
+    zombies->wave = 1;
+    zombies->spawnCooldown = 0.25f;
+    zombies->waveTimer = 0.0f;
+}
+
+static void ResetPlayer(PlayerState *player)
+{
+    player->health = PLAYER_MAX_HEALTH;
+    player->isDowned = false;
+    player->reviveProgress = 0.0f;
+    player->damageCooldown = 0.0f;
+    player->score = 0;
+    player->cash = 500;
+}
+
+static void DrawMenuButton(Rectangle rect, const char *label, bool selected)
+{
+    Color outline = selected ? SKYBLUE : DARKGRAY;
+    Color fill = selected ? (Color){20, 26, 42, 180} : (Color){14, 16, 24, 140};
+    DrawRectangleRec(rect, fill);
+    DrawRectangleLinesEx(rect, 2, outline);
+    Vector2 textSize = MeasureTextEx(GetFontDefault(), label, 12, 1);
+    DrawText(label,
+             (int)(rect.x + (rect.width - textSize.x) * 0.5f),
+             (int)(rect.y + (rect.height - textSize.y) * 0.5f),
+             12,
+             selected ? WHITE : LIGHTGRAY);
+}
+
+static void DrawCooldownBar(int x, int y, float t)
+{
+    int w = 38;
+    int h = 6;
+    DrawRectangleLines(x, y, w, h, DARKGRAY);
+    float fill = Clamp(1.0f - t, 0.0f, 1.0f);
+    DrawRectangle(x + 1, y + 1, (int)((w - 2) * fill), h - 2, fill >= 1.0f ? LIME : SKYBLUE);
+}
+
+static void PushKillfeed(KillfeedEntry *feed, int count, const char *text, Color color)
+{
+    if (count <= 0)
+        return;
+    for (int i = count - 1; i > 0; i--)
+        feed[i] = feed[i - 1];
+    strncpy(feed[0].text, text, sizeof(feed[0].text) - 1);
+    feed[0].text[sizeof(feed[0].text) - 1] = '\0';
+    feed[0].timer = 3.0f;
+    feed[0].color = color;
+}
+
+static void DrawInfo(float dt,
+                     GameMode mode,
+                     const Weapon *weapon,
+                     const ZombiesState *zombies,
+                     const PlayerState *player,
+                     int ammo,
+                     bool quickfire,
+                     bool speed,
+                     bool revive,
+                     const LanState *lan,
+                     const char *playerName,
+                     bool nameLocked,
+                     bool audioOn,
+                     bool flashlightOn,
+                     bool ditherOn,
+                     float fireCooldown,
+                     float mysteryCooldown,
+                     float damageCooldown,
+                     const char *arenaName,
+                     float sharePipTimer,
+                     int sharePipCash,
+                     int sharePipScore,
+                     float assistFlash,
+                     MultiplayerVariant mpVariant,
+                     int playerTeam,
+                     int frags,
+                     int deaths,
+                     const int teamScores[2],
+                     const HitMarker *hitMarker,
+                     const KillfeedEntry *killfeed,
+                     int killfeedCount)
+{
+    DrawText("U8 Prototype", 8, 8, 10, LIGHTGRAY);
+    DrawText(TextFormat("Frame: %d FPS", GetFPS()), 8, 20, 10, LIGHTGRAY);
+    DrawText(TextFormat("dt: %.3f", dt), 8, 32, 10, LIGHTGRAY);
+    DrawText(TextFormat("Name: %s%s", playerName, nameLocked ? "" : " (edit Enter)"), 8, 44, 10, LIGHTGRAY);
+    DrawText(TextFormat("Audio: %s (M)", audioOn ? "on" : "muted"), 8, 56, 10, LIGHTGRAY);
+    DrawText(TextFormat("Flashlight: %s (F)", flashlightOn ? "on" : "off"), 8, 68, 10, LIGHTGRAY);
+    DrawText(TextFormat("Dither: %s (V)", ditherOn ? "on" : "off"), 8, 80, 10, LIGHTGRAY);
+    if (lan->codecPackets > 0)
+        DrawText(TextFormat("Checksum: %s (C)  codec %u->%uB %.1fus",
+                            lan->useChecksum ? "on" : "off",
+                            lan->codecRawBytes / lan->codecPackets,
+                            lan->codecWireBytes / lan->codecPackets,
+                            (double)lan->codecNs / lan->codecPackets / 1000.0),
+                 8, 92, 10, LIGHTGRAY);
+    else
+        DrawText(TextFormat("Checksum: %s (C)", lan->useChecksum ? "on" : "off"), 8, 92, 10, LIGHTGRAY);
+
+    const char *modeName = (mode == MODE_ZOMBIES) ? "Zombies" : (mpVariant == MULTI_TEAM ? "Multiplayer (Teams)" : "Multiplayer (FFA)");
+    DrawText(TextFormat("Mode: %s", modeName), 8, 106, 10, LIGHTGRAY);
+    DrawText(TextFormat("Arena: %s  (< > swap, P save)", arenaName), 8, 118, 10, LIGHTGRAY);
+    DrawText(TextFormat("Score: %d   Cash: %d", player->score, player->cash), 8, 130, 10, LIGHTGRAY);
+    DrawText(TextFormat("Weapon: %s [%d]", weapon->name, ammo), 8, 142, 10, weapon->color);
+    DrawText(TextFormat("Health: %.0f", player->health), 8, 154, 10, player->health > 35 ? LIGHTGRAY : RED);
+    if (player->isDowned)
+        DrawText("Down! Hold E near a peer to revive", 8, 166, 10, RED);
+
+    if (mode == MODE_MULTIPLAYER)
+    {
+        DrawText(TextFormat("Frags: %d  Deaths: %d", frags, deaths), 8, 178, 10, LIGHTGRAY);
+        if (mpVariant == MULTI_TEAM)
+        {
+            const char *teamName = playerTeam == 0 ? "Blue" : "Gold";
+            DrawText(TextFormat("Team: %s | Score %d - %d  (H swap)", teamName, teamScores[0], teamScores[1]), 8, 190, 10, SKYBLUE);
+        }
+    }
+
+    if (sharePipTimer > 0.0f)
+    {
+        int y = (mode == MODE_MULTIPLAYER) ? 204 : 178;
+        DrawText(TextFormat("Shared %+d | %+d", sharePipCash, sharePipScore), 8, y, 10, SKYBLUE);
+    }
+    if (assistFlash > 0.0f)
+    {
+        int y = (mode == MODE_MULTIPLAYER) ? 216 : 190;
+        DrawText("Melee weaken active", 8, y, 10, ORANGE);
+    }
+
+    int perkY = player->isDowned ? 202 : (mode == MODE_MULTIPLAYER ? 232 : 178);
+    if (quickfire)
+    {
+        DrawText("Perk: Quickfire", 8, perkY, 10, ORANGE);
+        perkY += 12;
+    }
+    if (speed)
+    {
+        DrawText("Perk: Sprint", 8, perkY, 10, SKYBLUE);
+        perkY += 12;
+    }
+    if (revive)
+    {
+        DrawText("Perk: Revive", 8, perkY, 10, LIME);
+        perkY += 12;
+    }
+
+    if (mode == MODE_ZOMBIES)
+    {
+        DrawText(TextFormat("Wave %d", zombies->wave), 8, perkY + 6, 10, LIGHTGRAY);
+        DrawText(TextFormat("Active: %d", zombies->activeCount), 8, perkY + 18, 10, LIGHTGRAY);
+        DrawText("E: perk (blue), wall ammo (red), box (gold)", 8, perkY + 32, 9, LIGHTGRAY);
+        DrawText("Speed perk: teal, Revive: lime", 8, perkY + 44, 9, LIGHTGRAY);
+        DrawText("Cooldowns:", 8, perkY + 58, 9, LIGHTGRAY);
+        DrawText("Fire", 8, perkY + 70, 8, LIGHTGRAY);
+        DrawCooldownBar(32, perkY + 70, fireCooldown);
+        DrawText("Mystery", 8, perkY + 82, 8, LIGHTGRAY);
+        DrawCooldownBar(48, perkY + 82, mysteryCooldown / 5.0f);
+        DrawText("Damage", 8, perkY + 94, 8, LIGHTGRAY);
+        DrawCooldownBar(44, perkY + 94, damageCooldown);
+    }
+
+    if (hitMarker && hitMarker->timer > 0.0f)
+    {
+        float alpha = Clamp(hitMarker->timer / 0.3f, 0.0f, 1.0f);
+        Color tint = hitMarker->isKill ? RED : WHITE;
+        tint.a = (unsigned char)(alpha * 200);
+        int cx = BASE_WIDTH / 2;
+        int cy = BASE_HEIGHT / 2;
+        DrawLine(cx - 4, cy - 4, cx + 4, cy + 4, tint);
+        DrawLine(cx - 4, cy + 4, cx + 4, cy - 4, tint);
+    }
+
+    if (killfeed && killfeedCount > 0)
+    {
+        int y = 12;
+        for (int i = 0; i < killfeedCount; i++)
+        {
+            if (killfeed[i].timer <= 0.0f)
+                continue;
+            Color tint = killfeed[i].color;
+            DrawText(killfeed[i].text, BASE_WIDTH - 132, y, 9, tint);
+            y += 12;
+        }
+    }
+
+    DrawText("Peers:", 8, BASE_HEIGHT - 48, 9, LIGHTGRAY);
+    int hostSlot = LanHostSlot(lan, GetTime());
+    int peerLine = BASE_HEIGHT - 36;
+        for (int i = 0; i < MAX_PEERS; i++)
+        {
+            if (!lan->peers[i].active)
+                continue;
+            const char *name = lan->peers[i].name[0] ? lan->peers[i].name : "Peer";
+            const char *status = lan->peers[i].isDowned ? "DOWN" : (lan->peers[i].isReviving ? "REV" : "OK");
+            const char *teamTag = (mode == MODE_MULTIPLAYER && lan->peers[i].teamMode) ? (lan->peers[i].team == 0 ? "B" : "G") : "-";
+            DrawText(TextFormat("%s: %s H%.0f $%d S%d W%d A%d T%s",
+                               name,
+                               status,
+                               lan->peers[i].health,
+                               lan->peers[i].cash,
+                               lan->peers[i].score,
+                               lan->peers[i].weaponIndex + 1,
+                               lan->peers[i].ammo,
+                               teamTag),
+                     8,
+                     peerLine,
+                     9,
+                 LIGHTGRAY);
+        peerLine += 10;
+        DrawText(TextFormat("perks: %s%s%s  rtt %.0fms%s",
+                            lan->peers[i].perkQuickfire ? "Q" : "-",
+                            lan->peers[i].perkSpeed ? "S" : "-",
+                            lan->peers[i].perkRevive ? "R" : "-",
+                            lan->peers[i].clock.rtt * 1000.0,
+                            i == hostSlot ? "  host" : ""),
+                 12,
+                 peerLine,
+                 8,
+                 DARKGRAY);
+        peerLine += 10;
+    }
+}
+
+// Everything the frame graph tasks read or write. Pointers are bound once at
+// startup; the per-frame values are refreshed right before the graph runs.
+typedef struct FrameContext
+{
+    float dt;
+    double now;
+    double matchNow;
+    bool isZombies;
+    bool allowDamageBursts;
+    int currentAmmo;
+    const Camera3D *camera;
+    LanState *lan;
+    PlayerState *player;
+    ZombiesState *zombies;
+    const int *arenaIndex;
+    const int *weaponIndex;
+    const bool *quickfirePerk;
+    const bool *speedPerk;
+    const bool *revivePerk;
+    const MultiplayerVariant *mpVariant;
+    const int *playerTeam;
+    const char *playerName;
+    int *pendingCashShare;
+    int *pendingScoreShare;
+    float *sharePipTimer;
+    int *sharePipCash;
+    int *sharePipScore;
+    const DamageEvent *pendingRay;
+    LanEvent *pendingEvent;
+    uint8_t *eventCounter;
+    FxStore *fx;
+    ParticleSystem *particles;
+    InfluenceMap *influence;
+    const Weapon *weapons;
+    int weaponCount;
+    Vector2 *peerLabels;
+    bool *peerLabelVisible;
+    char (*peerLabelText)[48];
+    EventBus *events;
+} FrameContext;
+
+static void FrameTaskLan(void *data)
+{
+    FrameContext *f = (FrameContext *)data;
+    uint64_t zone = ProfileZoneBegin();
+    UpdateLan(f->lan,
+              f->dt,
+              f->camera->position,
+              *f->weaponIndex,
+              f->currentAmmo,
+              f->player,
+              *f->quickfirePerk,
+              *f->speedPerk,
+              *f->revivePerk,
+              *f->mpVariant,
+              *f->playerTeam,
+              f->playerName,
+              f->now,
+              f->pendingCashShare,
+              f->pendingScoreShare,
+              f->sharePipTimer,
+              f->sharePipCash,
+              f->sharePipScore,
+              f->pendingRay,
+              f->allowDamageBursts,
+              f->pendingEvent,
+              f->eventCounter,
+              f->isZombies ? f->zombies : NULL);
+    ProfileZoneEnd(PROFILE_ZONE_LAN, zone);
+}
+
+static void FrameTaskZombies(void *data)
+{
+    FrameContext *f = (FrameContext *)data;
+    if (!f->isZombies)
+        return;
+    const ArenaPreset *arena = &gArenaPresets[*f->arenaIndex];
+    uint64_t zone = ProfileZoneBegin();
+    UpdateZombies(f->zombies,
+                  f->dt,
+                  f->matchNow,
+                  (Vector3){f->camera->position.x, 0.0f, f->camera->position.z},
+                  f->player,
+                  f->fx,
+                  arena->navPoints,
+                  arena->navWeights,
+                  arena->navCount,
+                  f->influence,
+                  f->events);
+    ProfileZoneEnd(PROFILE_ZONE_ZOMBIES, zone);
+}
+
+static void RebuildInfluence(InfluenceMap *map, const ZombiesState *zombies, Vector3 eye, Vector3 target, float dt)
+{
+    InfluenceClearSource(map, INFLUENCE_THREAT);
+    InfluenceClearSource(map, INFLUENCE_DENSITY);
+
+    Vector3 aim = Vector3Subtract(target, eye);
+    aim.y = 0.0f;
+    aim = Vector3Normalize(aim);
+    for (int t = 1; t <= 8; t++)
+    {
+        Vector3 p = Vector3Add(eye, Vector3Scale(aim, (float)t));
+        InfluenceStamp(map, INFLUENCE_THREAT, p, 1.0f - (float)t / 10.0f, 0.8f + 0.2f * (float)t);
+    }
+
+    for (int i = 0; i < zombies->enemyCapacity; i++)
+    {
+        if (zombies->enemies[i].active)
+            InfluenceStamp(map, INFLUENCE_DENSITY, zombies->enemies[i].position, 0.5f, 1.5f);
+    }
+    InfluenceUpdate(map, dt);
+}
+
+// Runs after the zombies have moved; they read last tick's maps while this
+// one is being rebuilt.
+static void FrameTaskInfluence(void *data)
+{
+    FrameContext *f = (FrameContext *)data;
+    if (!f->isZombies)
+        return;
+    RebuildInfluence(f->influence, f->zombies, f->camera->position, f->camera->target, f->dt);
+}
+
+static void FrameTaskFx(void *data)
+{
+    FrameContext *f = (FrameContext *)data;
+    if (!f->isZombies)
+        return;
+    AgeFx(f->fx, ECS_TAG_DECAL, f->dt);
+    AgeFx(f->fx, ECS_TAG_DISSOLVE, f->dt);
+}
+
+static void FrameTaskParticles(void *data)
+{
+    FrameContext *f = (FrameContext *)data;
+    ParticlesUpdate(f->particles, f->dt);
+}
+
+static void FrameTaskTrails(void *data)
+{
+    FrameContext *f = (FrameContext *)data;
+    if (f->isZombies)
+        AgeFx(f->fx, ECS_TAG_TRAIL, f->dt);
+}
+
+static void FrameTaskPeerLabels(void *data)
+{
+    FrameContext *f = (FrameContext *)data;
+    // Labels are the first thing to go when scratch runs out.
+    if (!f->peerLabelText)
+        return;
+    for (int i = 0; i < MAX_PEERS; i++)
+    {
+        const Peer *peer = &f->lan->peers[i];
+        if (!peer->active)
+            continue;
+        Vector3 head = peer->renderPos;
+        head.y += 0.9f;
+        Vector2 screenPos = GetWorldToScreen(head, *f->camera);
+        if (screenPos.x < 0 || screenPos.x > BASE_WIDTH || screenPos.y < 0 || screenPos.y > BASE_HEIGHT)
+            continue;
+        f->peerLabels[i] = screenPos;
+        f->peerLabelVisible[i] = true;
+        int wi = peer->weaponIndex;
+        const char *wName = (wi >= 0 && wi < f->weaponCount) ? f->weapons[wi].name : "W?";
+        const char *name = peer->name[0] ? peer->name : "Peer";
+        const char *status = peer->isDowned ? "!" : (peer->isReviving ? "R" : "");
+        snprintf(f->peerLabelText[i],
+                 sizeof(f->peerLabelText[i]),
+                 "%s [%s %d|H%.0f%s $%d]",
+                 name,
+                 wName,
+                 peer->ammo,
+                 peer->health,
+                 status,
+                 peer->cash);
+    }
+}
+
+typedef struct AudioSink
+{
+    Sound hit;
+    Sound kill;
+    Sound feed;
+    Sound perk;
+    Sound box;
+    Sound revive;
+    Sound down;
+} AudioSink;
+
+typedef struct HudSink
+{
+    HitMarker *hitMarker;
+    KillfeedEntry *killfeed;
+    int killfeedCount;
+    float *sharePipTimer;
+    int *sharePipCash;
+    int *sharePipScore;
+} HudSink;
+
+typedef struct NetSink
+{
+    int *pendingCashShare;
+    int *pendingScoreShare;
+    DamageEvent *pendingRay;
+    uint8_t *damageCounter;
+    LanEvent *pendingEvent;
+} NetSink;
+
+typedef struct StatsSink
+{
+    PlayerState *player;
+    const MultiplayerVariant *mpVariant;
+    int *fragCount;
+    int *deathCount;
+    int *teamScores;
+} StatsSink;
+
+// A burst of pellets or a multi-kill still plays each cue once per tick.
+static void AudioConsumeEvents(const GameEvent *events, int count, void *user)
+{
+    const AudioSink *a = (const AudioSink *)user;
+    bool hit = false;
+    bool kill = false;
+    bool feed = false;
+    for (int i = 0; i < count; i++)
+    {
+        switch (events[i].kind)
+        {
+        case GAME_EVENT_ENEMY_HIT:
+        case GAME_EVENT_PEER_HIT:
+            hit = true;
+            break;
+        case GAME_EVENT_ENEMY_KILLED:
+            kill = true;
+            break;
+        case GAME_EVENT_PEER_FRAGGED:
+            kill = true;
+            feed = true;
+            break;
+        case GAME_EVENT_PLAYER_FRAGGED:
+        case GAME_EVENT_LAN_FEED:
+            feed = true;
+            break;
+        case GAME_EVENT_PERK_PURCHASED:
+            PlaySoundSafe(a->perk);
+            break;
+        case GAME_EVENT_BOX_ROLLED:
+            PlaySoundSafe(a->box);
+            break;
+        case GAME_EVENT_PLAYER_REVIVED:
+            PlaySoundSafe(a->revive);
+            break;
+        case GAME_EVENT_PLAYER_DOWNED:
+            PlaySoundSafe(a->down);
+            break;
+        default:
+            break;
+        }
+    }
+    if (hit)
+        PlaySoundSafe(a->hit);
+    if (hit && kill)
+        PlaySoundSafe(a->kill);
+    if (feed)
+        PlaySoundSafe(a->feed);
+}
+
+static void HudConsumeEvents(const GameEvent *events, int count, void *user)
+{
+    HudSink *h = (HudSink *)user;
+    bool hit = false;
+    bool kill = false;
+    int assistShare = 0;
+    char buf[64];
+    for (int i = 0; i < count; i++)
+    {
+        const GameEvent *e = &events[i];
+        switch (e->kind)
         {
-            for (int i = 0; i < MAX_PEERS; i++)
+        case GAME_EVENT_ENEMY_HIT:
+        case GAME_EVENT_PEER_HIT:
+            hit = true;
+            break;
+        case GAME_EVENT_ENEMY_KILLED:
+            kill = true;
+            assistShare += e->bonus;
+            break;
+        case GAME_EVENT_PEER_FRAGGED:
+            kill = true;
+            snprintf(buf, sizeof(buf), "Fragged %s", e->target);
+            PushKillfeed(h->killfeed, h->killfeedCount, buf, ORANGE);
+            break;
+        case GAME_EVENT_PLAYER_FRAGGED:
+            PushKillfeed(h->killfeed, h->killfeedCount, "You were fragged", RED);
+            break;
+        case GAME_EVENT_LAN_FEED:
+            if (e->subject == 1)
             {
-                Peer *p = &lan->peers[i];
-                if (!p->active)
-                {
-                    p->active = true;
-                    p->addr = from;
-                    p->position = (Vector3){DequantizePosition(packet.position[0]),
-                                            DequantizePosition(packet.position[1]),
-                                            DequantizePosition(packet.position[2])};
-                    p->renderPos = p->position;
-                    p->weaponIndex = packet.weaponIndex;
-                    p->ammo = packet.ammo;
-                    p->health = ((float)packet.health / 255.0f) * PLAYER_MAX_HEALTH;
-                    p->isDowned = (packet.flags & (1 << 0)) != 0;
-                    p->perkQuickfire = (packet.flags & (1 << 1)) != 0;
-                    p->perkSpeed = (packet.flags & (1 << 2)) != 0;
-                    p->perkRevive = (packet.flags & (1 << 3)) != 0;
-                    p->isReviving = (packet.flags & (1 << 4)) != 0;
-                    p->team = (packet.flags & (1 << 5)) != 0 ? 1 : 0;
-                    p->teamMode = (packet.flags & (1 << 6)) != 0;
-                    p->cash = packet.cash;
-                    p->score = packet.score;
-                    p->joinAgeSeconds = packet.joinSeconds;
-                    if (packet.name[0])
-                        strncpy(p->name, packet.name, sizeof(p->name));
-                    unsigned int addr = ntohl(from.sin_addr.s_addr);
-                    unsigned int octet = addr & 0xFF;
-                    if (p->name[0] == '\0')
-                        snprintf(p->name, sizeof(p->name), "P-%02u", octet);
-                    p->lastHeard = timeNow;
-                    p->catchupSent = false;
-                    if (packet.eventKind > 0)
-                        p->lastEventId = packet.eventId;
-                    if (lan->lastPacketSize > 0)
-                        sendto(lan->socketFd,
-                               lan->lastPacket,
-                               lan->lastPacketSize,
-                               0,
-                               (struct sockaddr *)&from,
-                               sizeof(from));
-                    player->cash = (int)Clamp((float)player->cash + (float)packet.cashDelta, 0.0f, 60000.0f);
-                    player->score = (int)Clamp((float)player->score + (float)packet.scoreDelta, 0.0f, 60000.0f);
-                    if ((packet.cashDelta != 0 || packet.scoreDelta != 0) && sharePipTimer && sharePipCash && sharePipScore)
-                    {
-                        *sharePipTimer = 1.6f;
-                        *sharePipCash = packet.cashDelta;
-                        *sharePipScore = packet.scoreDelta;
-                    }
-                    if (allowDamageBursts && packet.rayDamage > 0 && packet.damageId != p->lastDamageId)
-                    {
-                        Vector3 rayOrigin = {DequantizePosition(packet.rayOrigin[0]),
-                                             DequantizePosition(packet.rayOrigin[1]),
-                                             DequantizePosition(packet.rayOrigin[2])};
-                        Vector3 rayDir = {DequantizePosition(packet.rayDir[0]),
-                                          DequantizePosition(packet.rayDir[1]),
-                                          DequantizePosition(packet.rayDir[2])};
-                        float tHit = 50.0f;
-                        if (HitscanAgainstSphere(rayOrigin, Vector3Normalize(rayDir), playerPos, 0.35f, &tHit))
-                        {
-                            player->health -= packet.rayDamage;
-                            player->damageCooldown = 0.6f;
-                        }
-                        p->lastDamageId = packet.damageId;
-                    }
-                    break;
-                }
+                snprintf(buf, sizeof(buf), "%s fragged %s", e->actor, e->target);
+                PushKillfeed(h->killfeed, h->killfeedCount, buf, ORANGE);
+            }
+            else if (e->subject == 2)
+            {
+                snprintf(buf, sizeof(buf), "%s assisted %s", e->actor, e->target);
+                PushKillfeed(h->killfeed, h->killfeedCount, buf, SKYBLUE);
             }
+            break;
+        case GAME_EVENT_MELEE_ASSIST:
+            *h->sharePipTimer = 1.2f;
+            *h->sharePipCash = e->amount;
+            *h->sharePipScore = e->amount;
+            break;
+        default:
+            break;
         }
     }
+    if (hit)
+    {
+        h->hitMarker->timer = 0.3f;
+        h->hitMarker->isKill = kill;
+    }
+    if (assistShare > 0)
+    {
+        *h->sharePipTimer = 1.4f;
+        *h->sharePipCash = assistShare / 2;
+        *h->sharePipScore = assistShare / 2;
+    }
+}
 
-    for (int i = 0; i < MAX_PEERS; i++)
+static void NetConsumeEvents(const GameEvent *events, int count, void *user)
+{
+    NetSink *n = (NetSink *)user;
+    const GameEvent *ray = NULL;
+    bool fragged = false;
+    int kills = 0;
+    int cashEarned = 0;
+    int assistShare = 0;
+    for (int i = 0; i < count; i++)
     {
-        Peer *p = &lan->peers[i];
-        if (p->active && timeNow - p->lastHeard > 3.0)
-            p->active = false;
-        if (p->active)
+        const GameEvent *e = &events[i];
+        switch (e->kind)
         {
-            p->renderPos = Vector3Lerp(p->renderPos, p->position, Clamp(dt * 6.0f, 0.0f, 1.0f));
-            if (!p->catchupSent && p->joinAgeSeconds < 8)
-            {
-                *pendingCashShare = Clamp(*pendingCashShare + 20, -120, 120);
-                *pendingScoreShare = Clamp(*pendingScoreShare + 20, -120, 120);
-                p->catchupSent = true;
-            }
+        case GAME_EVENT_PEER_HIT:
+            if (!ray)
+                ray = e;
+            break;
+        case GAME_EVENT_PEER_FRAGGED:
+            fragged = true;
+            n->pendingEvent->kind = 1;
+            n->pendingEvent->team = (uint8_t)e->team;
+            strncpy(n->pendingEvent->target, e->target, LAN_NAME_BYTES - 1);
+            break;
+        case GAME_EVENT_ENEMY_KILLED:
+            kills++;
+            cashEarned += e->amount;
+            assistShare += e->bonus;
+            break;
+        case GAME_EVENT_PLAYER_REVIVED:
+            *n->pendingCashShare += 25;
+            *n->pendingScoreShare += 30;
+            break;
+        case GAME_EVENT_PEER_REVIVED:
+            *n->pendingCashShare += 40;
+            *n->pendingScoreShare += 60;
+            break;
+        case GAME_EVENT_MELEE_ASSIST:
+            *n->pendingCashShare += e->amount;
+            break;
+        default:
+            break;
         }
     }
+    // One damage ray per shot is enough for peers to replay the hit.
+    if (ray)
+    {
+        n->pendingRay->origin = ray->origin;
+        n->pendingRay->dir = ray->dir;
+        n->pendingRay->damage = ray->damage;
+        n->pendingRay->ttl = 0.3f;
+        n->pendingRay->id = (*n->damageCounter)++;
+        if (!fragged && n->pendingEvent->kind == 0)
+        {
+            n->pendingEvent->kind = 2;
+            n->pendingEvent->team = (uint8_t)ray->team;
+            strncpy(n->pendingEvent->target, "assist", LAN_NAME_BYTES - 1);
+        }
+    }
+    *n->pendingCashShare += cashEarned / 4 + assistShare / 4;
+    *n->pendingScoreShare += kills * 40;
 }
 
-static bool HitscanAgainstSphere(Vector3 origin, Vector3 dir, Vector3 center, float radius, float *tHit)
+static void StatsConsumeEvents(const GameEvent *events, int count, void *user)
 {
-    Vector3 oc = Vector3Subtract(origin, center);
-    float b = Vector3DotProduct(oc, dir);
-    float c = Vector3DotProduct(oc, oc) - radius * radius;
-    float discriminant = b * b - c;
-    if (discriminant < 0.0f)
-        return false;
+    StatsSink *st = (StatsSink *)user;
+    bool teamMode = *st->mpVariant == MULTI_TEAM;
+    for (int i = 0; i < count; i++)
+    {
+        const GameEvent *e = &events[i];
+        switch (e->kind)
+        {
+        case GAME_EVENT_ENEMY_KILLED:
+            st->player->score += 120;
+            st->player->cash += e->amount;
+            break;
+        case GAME_EVENT_PEER_FRAGGED:
+            (*st->fragCount)++;
+            st->player->score += 100;
+            LogWrite(LOG_COMBAT_FRAG, e->subject);
+            if (teamMode && e->team >= 0 && e->team < 2)
+                st->teamScores[e->team]++;
+            break;
+        case GAME_EVENT_LAN_FEED:
+            if (e->subject == 1 && teamMode && e->team >= 0 && e->team < 2)
+                st->teamScores[e->team]++;
+            break;
+        case GAME_EVENT_PLAYER_FRAGGED:
+            (*st->deathCount)++;
+            break;
+        case GAME_EVENT_PLAYER_DOWNED:
+            (*st->deathCount)++;
+            LogWrite(LOG_PLAYER_DOWNED, e->subject);
+            break;
+        default:
+            break;
+        }
+    }
+}
 
-    float t = -b - sqrtf(discriminant);
-    if (t < 0.0f)
-        t = -b + sqrtf(discriminant);
-    if (t < 0.0f)
-        return false;
+static void InfluenceConsumeEvents(const GameEvent *events, int count, void *user)
+{
+    InfluenceMap *map = (InfluenceMap *)user;
+    for (int i = 0; i < count; i++)
+    {
+        if (events[i].kind == GAME_EVENT_ENEMY_KILLED)
+            InfluenceStamp(map, INFLUENCE_DEATHS, events[i].point, 1.0f, 2.0f);
+    }
+}
 
-    if (tHit)
-        *tHit = t;
-    return true;
+static void ParticleConsumeEvents(const GameEvent *events, int count, void *user)
+{
+    ParticleSystem *ps = (ParticleSystem *)user;
+    const Vector3 up = {0.0f, 1.0f, 0.0f};
+    for (int i = 0; i < count; i++)
+    {
+        const GameEvent *e = &events[i];
+        switch (e->kind)
+        {
+        case GAME_EVENT_ENEMY_HIT:
+        case GAME_EVENT_PEER_HIT:
+            ParticlesEmit(ps, PARTICLE_HIT_SPURT, e->point, Vector3Scale(e->dir, -1.0f));
+            break;
+        case GAME_EVENT_ENEMY_KILLED:
+            ParticlesEmit(ps, PARTICLE_DISSOLVE_DUST, e->point, up);
+            break;
+        case GAME_EVENT_PLAYER_HURT:
+            if (e->subject == ENEMY_SPITTER)
+                ParticlesEmit(ps, PARTICLE_SPIT_SPLASH, e->point, up);
+            break;
+        default:
+            break;
+        }
+    }
 }
 
-static void PushDissolve(DissolveFX *fx, int *idx, Vector3 pos, EnemyType type)
+static void DrawTaskGraphOverlay(const TaskGraph *graph, int x, int y)
 {
-    fx[*idx].position = pos;
-    fx[*idx].timer = 1.35f;
-    fx[*idx].height = (type == ENEMY_BOSS) ? 1.4f : (type == ENEMY_SPITTER ? 0.8f : 1.0f);
-    fx[*idx].color = (Color){180, 200, 200, 200};
-    *idx = (*idx + 1) % MAX_DISSOLVES;
+    float wallMs = (float)(graph->runEndNs - graph->runStartNs) / 1e6f;
+    DrawRectangle(x - 2, y - 2, 150, 12 + graph->count * 9, (Color){8, 10, 16, 190});
+    DrawText(TextFormat("graph %dw wall %.2f crit %.2f", TaskSchedulerWorkerCount(), wallMs, graph->criticalMs), x, y, 8, LIGHTGRAY);
+    y += 10;
+    const int barWidth = 48;
+    for (int i = 0; i < graph->count; i++)
+    {
+        const TaskNode *node = &graph->tasks[i];
+        float startMs = (float)(node->startNs - graph->runStartNs) / 1e6f;
+        float durMs = (float)(node->endNs - node->startNs) / 1e6f;
+        Color tint = node->critical ? ORANGE : LIGHTGRAY;
+        DrawText(TextFormat("%-11s w%d %.2f", node->name, node->worker, durMs), x, y, 8, tint);
+        if (wallMs > 0.0f)
+        {
+            int bx = x + 96 + (int)(startMs / wallMs * barWidth);
+            int bw = (int)(durMs / wallMs * barWidth);
+            DrawRectangle(bx, y + 2, bw > 1 ? bw : 1, 5, tint);
+        }
+        y += 9;
+    }
 }
 
-static int FireWeapon(const Weapon *weapon,
-                      Vector3 origin,
-                      Vector3 dir,
-                      ZombiesState *zombies,
-                      Decal *decals,
-                      int *decalIndex,
-                      DissolveFX *dissolves,
-                      int *dissolveIndex,
-                      int *kills,
-                      int *cashEarned,
-                      int *assistShare)
+// Per-zone CPU counters for the last frame: IPC and misses with a PMU,
+// otherwise the raw software counts.
+static void DrawPmuOverlay(const ProfileFrame *frame, int x, int y)
 {
-    int hits = 0;
-    for (int i = 0; i < (int)(sizeof(zombies->enemies) / sizeof(zombies->enemies[0])); i++)
+    ProfilePmuMode mode = ProfilePmuActive();
+    DrawRectangle(x - 2, y - 2, 150, 12 + PROFILE_ZONE_COUNT * 9, (Color){8, 10, 16, 190});
+    if (mode == PROFILE_PMU_HARDWARE)
+        DrawText("pmu      ipc  cache-m  branch-m", x, y, 8, LIGHTGRAY);
+    else
+        DrawText(TextFormat("pmu %s", mode == PROFILE_PMU_SOFTWARE ? "sw: clk faults cs mig" : "rusage: flt maj vcs ics"), x, y, 8, LIGHTGRAY);
+    y += 10;
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++)
     {
-        Enemy *e = &zombies->enemies[i];
-        if (!e->active)
+        const uint64_t *c = frame->pmu[z];
+        if (mode == PROFILE_PMU_HARDWARE)
+        {
+            float ipc = c[0] > 0 ? (float)c[1] / (float)c[0] : 0.0f;
+            DrawText(TextFormat("%-8s %4.2f %7llu %8llu", ProfileZoneName((ProfileZone)z), ipc, (unsigned long long)c[2], (unsigned long long)c[3]),
+                     x, y, 8, LIGHTGRAY);
+        }
+        else
+        {
+            DrawText(TextFormat("%-8s %llu %llu %llu %llu", ProfileZoneName((ProfileZone)z), (unsigned long long)c[0], (unsigned long long)c[1],
+                                (unsigned long long)c[2], (unsigned long long)c[3]),
+                     x, y, 8, LIGHTGRAY);
+        }
+        y += 9;
+    }
+}
+
+#define CONSOLE_LINES 12
+#define CONSOLE_LINE_BYTES 72
+
+// Backquote console over the cvar registry; while it is open it owns the keyboard.
+typedef struct CvarConsole
+{
+    bool open;
+    char input[CONSOLE_LINE_BYTES];
+    int inputLen;
+    char lines[CONSOLE_LINES][CONSOLE_LINE_BYTES];
+    int lineCount;
+} CvarConsole;
+
+static void ConsolePrint(CvarConsole *console, const char *text)
+{
+    if (console->lineCount == CONSOLE_LINES)
+    {
+        memmove(console->lines[0], console->lines[1], sizeof(console->lines[0]) * (CONSOLE_LINES - 1));
+        console->lineCount--;
+    }
+    snprintf(console->lines[console->lineCount++], CONSOLE_LINE_BYTES, "%s", text);
+}
+
+static void ConsoleSubmit(CvarConsole *console)
+{
+    char reply[CONSOLE_LINE_BYTES];
+    ConsolePrint(console, TextFormat("> %s", console->input));
+    if (strcmp(console->input, "list") == 0)
+    {
+        for (int i = 0; i < CvarCount(); i++)
+        {
+            CvarFormat(i, reply, sizeof(reply));
+            ConsolePrint(console, reply);
+        }
+    }
+    else if (console->inputLen > 0)
+    {
+        CvarCommand(console->input, reply, sizeof(reply));
+        ConsolePrint(console, reply);
+    }
+    console->input[0] = '\0';
+    console->inputLen = 0;
+}
+
+static void UpdateCvarConsole(CvarConsole *console)
+{
+    int key = GetCharPressed();
+    while (key > 0)
+    {
+        if (key != '`' && key >= 32 && key <= 125 && console->inputLen < CONSOLE_LINE_BYTES - 1)
+        {
+            console->input[console->inputLen++] = (char)key;
+            console->input[console->inputLen] = '\0';
+        }
+        key = GetCharPressed();
+    }
+    if (IsKeyPressed(KEY_BACKSPACE) && console->inputLen > 0)
+        console->input[--console->inputLen] = '\0';
+    if (IsKeyPressed(KEY_ENTER))
+        ConsoleSubmit(console);
+}
+
+static void DrawCvarConsole(const CvarConsole *console)
+{
+    int height = 14 + CONSOLE_LINES * 9;
+    DrawRectangle(0, 0, BASE_WIDTH, height, (Color){8, 10, 16, 220});
+    for (int i = 0; i < console->lineCount; i++)
+        DrawText(console->lines[i], 4, 2 + i * 9, 8, LIGHTGRAY);
+    DrawText(TextFormat("] %s_", console->input), 4, height - 11, 8, WHITE);
+}
+
+#define BALANCE_DT (1.0f / 60.0f)
+#define BALANCE_MAX_WAVES 40
+#define BALANCE_MAX_SECONDS 1200.0f
+#define BALANCE_MAX_THREADS 64
+#define BALANCE_AIM_ERROR 0.03f
+#define BALANCE_KITE_RANGE 3.0f
+#define BALANCE_ARENA_RADIUS 11.0f
+#define BALANCE_WEAPON_COUNT ((int)(sizeof(gWeapons) / sizeof(gWeapons[0])))
+
+typedef struct BalanceConfig
+{
+    int sims;
+    uint32_t seed;
+    float healthScale;
+    float damageScale;
+    const char *outPath;
+} BalanceConfig;
+
+typedef struct BalanceResult
+{
+    int weapon;
+    int arena;
+    int waveReached;
+    float seconds;
+    int cashAtWave[BALANCE_MAX_WAVES + 1];
+    float waveSeconds[BALANCE_MAX_WAVES + 1];
+    float ttkSum[BALANCE_MAX_WAVES + 1];
+    int ttkCount[BALANCE_MAX_WAVES + 1];
+} BalanceResult;
+
+typedef struct BalanceJob
+{
+    const BalanceConfig *config;
+    BalanceResult *results;
+    int next;
+} BalanceJob;
+
+// Each worker reuses one influence map for all of its runs.
+typedef struct BalanceWorker
+{
+    BalanceJob *job;
+    InfluenceMap influence;
+} BalanceWorker;
+
+static void BalanceEconomyConsumer(const GameEvent *events, int count, void *user)
+{
+    PlayerState *player = user;
+    for (int i = 0; i < count; i++)
+    {
+        if (events[i].kind != GAME_EVENT_ENEMY_KILLED)
             continue;
+        player->cash += events[i].amount;
+        player->score += events[i].amount;
+    }
+}
 
-        float t = weapon->range;
-        if (HitscanAgainstSphere(origin, dir, e->position, e->radius, &t))
+static float BalanceJitter(ZombiesState *zombies, float spread)
+{
+    return ((float)ZombiesRandom(zombies, -100, 100) / 100.0f) * spread;
+}
+
+// One headless Zombies run: a scripted bot kites and shoots the nearest enemy
+// until it dies, the wave cap or the time cap. Everything lives on this stack
+// and draws from the run's own seed, so results do not depend on the thread;
+// the worker's influence map is reset first.
+static void RunBalanceSim(const BalanceConfig *config, int index, InfluenceMap *influence, BalanceResult *out)
+{
+    Enemy enemies[MAX_ENEMIES];
+    float spawnedAt[MAX_ENEMIES] = {0};
+    bool wasActive[MAX_ENEMIES] = {0};
+    ZombiesState zombies = {0};
+    zombies.enemies = enemies;
+    zombies.enemyCapacity = MAX_ENEMIES;
+    zombies.rng = (config->seed ^ ((uint32_t)index * 2654435761u)) | 1u;
+    zombies.healthScale = config->healthScale;
+    ResetZombies(&zombies);
+
+    PlayerState player;
+    ResetPlayer(&player);
+    EventBus bus;
+    EventBusInit(&bus);
+    EventBusSubscribe(&bus, "balance", BalanceEconomyConsumer, &player);
+    EventBusSubscribe(&bus, "influence", InfluenceConsumeEvents, influence);
+    InfluenceReset(influence);
+
+    memset(out, 0, sizeof(*out));
+    out->weapon = index % BALANCE_WEAPON_COUNT;
+    out->arena = (index / BALANCE_WEAPON_COUNT) % MAX_ARENAS;
+    const ArenaPreset *arena = &gArenaPresets[out->arena];
+    Weapon weapon = gWeapons[out->weapon];
+    weapon.damage *= config->damageScale;
+    int ammo = weapon.maxAmmo;
+    bool quickfire = false;
+    float fireCooldown = 0.0f;
+    Vector3 pos = SelectSafeSpawn(arena);
+    pos.y = PLAYER_HEIGHT;
+    Vector3 aimAt = {0.0f, PLAYER_HEIGHT, 0.0f};
+
+    float t = 0.0f;
+    float waveStart = 0.0f;
+    int lastWave = 0;
+    while (t < BALANCE_MAX_SECONDS && player.health > 0.0f)
+    {
+        if (zombies.wave != lastWave)
+        {
+            if (zombies.wave > BALANCE_MAX_WAVES)
+                break;
+            if (lastWave > 0)
+                out->waveSeconds[lastWave] = t - waveStart;
+            waveStart = t;
+            lastWave = zombies.wave;
+            out->waveReached = lastWave;
+            out->cashAtWave[lastWave] = player.cash;
+        }
+
+        Enemy *target = NULL;
+        float targetDist = 0.0f;
+        for (int i = 0; i < MAX_ENEMIES; i++)
+        {
+            Enemy *e = &enemies[i];
+            if (!e->active)
+                continue;
+            float d = Vector3Distance((Vector3){pos.x, 0.0f, pos.z}, (Vector3){e->position.x, 0.0f, e->position.z});
+            if (!target || d < targetDist)
+            {
+                target = e;
+                targetDist = d;
+            }
+        }
+
+        if (target && targetDist < BALANCE_KITE_RANGE && targetDist > 0.001f)
+        {
+            Vector3 away = {pos.x - target->position.x, 0.0f, pos.z - target->position.z};
+            away = Vector3Scale(Vector3Normalize(away), PLAYER_MOVE_SPEED * BALANCE_DT);
+            pos = Vector3Add(pos, away);
+            float r = Vector3Length((Vector3){pos.x, 0.0f, pos.z});
+            if (r > BALANCE_ARENA_RADIUS)
+            {
+                pos.x *= BALANCE_ARENA_RADIUS / r;
+                pos.z *= BALANCE_ARENA_RADIUS / r;
+            }
+        }
+
+        if (ammo == 0 && player.cash >= COST_WALL_AMMO)
+        {
+            player.cash -= COST_WALL_AMMO;
+            ammo = weapon.maxAmmo;
+        }
+        else if (!quickfire && player.cash >= COST_PERK + COST_WALL_AMMO)
+        {
+            player.cash -= COST_PERK;
+            quickfire = true;
+        }
+
+        UpdateZombies(&zombies,
+                      BALANCE_DT,
+                      t,
+                      (Vector3){pos.x, 0.0f, pos.z},
+                      &player,
+                      NULL,
+                      arena->navPoints,
+                      arena->navWeights,
+                      arena->navCount,
+                      influence,
+                      &bus);
+        if (player.damageCooldown > 0.0f)
+            player.damageCooldown -= BALANCE_DT;
+
+        fireCooldown -= BALANCE_DT;
+        if (target && target->active && fireCooldown <= 0.0f && ammo > 0)
         {
-            float damage = weapon->damage;
-            if (e->weakenTimer > 0.0f)
-                damage *= 1.35f;
-            e->health -= damage;
-            if (e->health <= 0)
+            float spread = weapon.spread + BALANCE_AIM_ERROR;
+            Vector3 dir = Vector3Normalize(Vector3Subtract(target->position, pos));
+            dir = Vector3Normalize(Vector3Add(dir,
+                                              (Vector3){BalanceJitter(&zombies, spread),
+                                                        BalanceJitter(&zombies, spread),
+                                                        BalanceJitter(&zombies, spread)}));
+            fireCooldown = 1.0f / (quickfire ? weapon.fireRate * 1.25f : weapon.fireRate);
+            FireWeapon(&weapon, pos, dir, &zombies, NULL, &bus);
+            ammo--;
+        }
+        EventBusDispatch(&bus);
+        // The bot looks at its target the way a player would, so enemies see the same threat cone.
+        if (target && target->active)
+            aimAt = target->position;
+        RebuildInfluence(influence, &zombies, pos, aimAt, BALANCE_DT);
+
+        // Time to kill runs from the moment a slot goes live until it drops out.
+        for (int i = 0; i < MAX_ENEMIES; i++)
+        {
+            if (enemies[i].active && !wasActive[i])
+                spawnedAt[i] = t;
+            else if (!enemies[i].active && wasActive[i])
             {
-                e->active = false;
-                zombies->activeCount--;
-                if (kills)
-                    (*kills)++;
-                if (cashEarned)
-                {
-                    int reward = 40;
-                    if (e->type == ENEMY_BOSS)
-                        reward = 220;
-                    else if (e->type == ENEMY_SPRINTER)
-                        reward = 70;
-                    else if (e->type == ENEMY_SPITTER)
-                        reward = 90;
-                    *cashEarned += reward;
-                    if (assistShare && e->weakenedByPlayer)
-                        *assistShare += reward / 3;
-                }
-                if (dissolves && dissolveIndex)
-                    PushDissolve(dissolves, dissolveIndex, e->position, e->type);
+                out->ttkSum[lastWave] += t - spawnedAt[i];
+                out->ttkCount[lastWave]++;
             }
-            hits++;
-
-            decals[*decalIndex].position = Vector3Add(origin, Vector3Scale(dir, t));
-            decals[*decalIndex].color = (Color){200, 90, 90, 255};
-            decals[*decalIndex].timer = 1.5f;
-            *decalIndex = (*decalIndex + 1) % MAX_DECALS;
+            wasActive[i] = enemies[i].active;
         }
+        t += BALANCE_DT;
     }
-    return hits;
+    out->seconds = t;
 }
 
-static int FireAtPeers(const Weapon *weapon,
-                       Vector3 origin,
-                       Vector3 dir,
-                       LanState *lan,
-                       bool teamMode,
-                       int playerTeam,
-                       int *fraggedIndex)
+static void *BalanceWorkerMain(void *arg)
 {
-    int hits = 0;
-    for (int i = 0; i < MAX_PEERS; i++)
+    BalanceWorker *worker = arg;
+    BalanceJob *job = worker->job;
+    for (;;)
     {
-        Peer *p = &lan->peers[i];
-        if (!p->active)
-            continue;
-        if (teamMode && p->team == playerTeam)
-            continue;
-        float t = weapon->range;
-        if (HitscanAgainstSphere(origin, dir, p->renderPos, 0.35f, &t))
-        {
-            hits++;
-            p->health -= weapon->damage;
-            if (p->health <= 0.0f)
-            {
-                p->respawnTimer = 1.5f;
-                p->health = 0.0f;
-                if (fraggedIndex)
-                    *fraggedIndex = i;
-            }
-        }
+        int index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (index >= job->config->sims)
+            break;
+        RunBalanceSim(job->config, index, &worker->influence, &job->results[index]);
     }
-    return hits;
+    return NULL;
 }
 
-static int MeleeAssist(Vector3 origin,
-                       Vector3 dir,
-                       ZombiesState *zombies,
-                       int *cashAssist,
-                       float *assistFlash)
+static bool WriteBalanceReport(const BalanceConfig *config, const BalanceResult *results)
 {
-    int tagged = 0;
-    for (int i = 0; i < (int)(sizeof(zombies->enemies) / sizeof(zombies->enemies[0])); i++)
+    FILE *f = fopen(config->outPath, "w");
+    if (!f)
+        return false;
+    fprintf(f, "weapon,wave,sims,reached,reach_rate,mean_cash,mean_wave_seconds,mean_ttk_s\n");
+    for (int w = 0; w < BALANCE_WEAPON_COUNT; w++)
     {
-        Enemy *e = &zombies->enemies[i];
-        if (!e->active)
+        int sims = 0;
+        for (int i = w; i < config->sims; i += BALANCE_WEAPON_COUNT)
+            sims++;
+        if (sims == 0)
             continue;
-        float t = 1.6f;
-        if (HitscanAgainstSphere(origin, dir, e->position, e->radius, &t))
+        for (int wave = 1; wave <= BALANCE_MAX_WAVES; wave++)
         {
-            e->health -= 6.0f;
-            e->weakenTimer = 4.0f;
-            e->weakenedByPlayer = true;
-            tagged++;
-            if (cashAssist)
-                *cashAssist += 6;
+            int reached = 0;
+            int cleared = 0;
+            int kills = 0;
+            double cash = 0.0;
+            double waveSeconds = 0.0;
+            double ttk = 0.0;
+            for (int i = w; i < config->sims; i += BALANCE_WEAPON_COUNT)
+            {
+                const BalanceResult *r = &results[i];
+                if (r->waveReached < wave)
+                    continue;
+                reached++;
+                cash += r->cashAtWave[wave];
+                if (r->waveSeconds[wave] > 0.0f)
+                {
+                    cleared++;
+                    waveSeconds += r->waveSeconds[wave];
+                }
+                ttk += r->ttkSum[wave];
+                kills += r->ttkCount[wave];
+            }
+            if (reached == 0)
+                break;
+            fprintf(f,
+                    "%s,%d,%d,%d,%.4f,%.1f,%.2f,%.3f\n",
+                    gWeapons[w].name,
+                    wave,
+                    sims,
+                    reached,
+                    (double)reached / sims,
+                    cash / reached,
+                    cleared > 0 ? waveSeconds / cleared : 0.0,
+                    kills > 0 ? ttk / kills : 0.0);
         }
     }
-    if (tagged > 0 && assistFlash)
-        *assistFlash = 1.2f;
-    return tagged;
+    fclose(f);
+    return true;
 }
 
-static void SpawnEnemy(ZombiesState *zombies, Vector3 position, EnemyType type)
+static int RunBalance(const BalanceConfig *config)
 {
-    for (int i = 0; i < (int)(sizeof(zombies->enemies) / sizeof(zombies->enemies[0])); i++)
+    if (config->sims <= 0)
+        return 1;
+    BalanceResult *results = calloc((size_t)config->sims, sizeof(BalanceResult));
+    if (!results)
+        return 1;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threadCount = (int)Clamp((float)cores, 1.0f, (float)BALANCE_MAX_THREADS);
+    if (threadCount > config->sims)
+        threadCount = config->sims;
+
+    // The runs have no memory regions; their maps share one heap block instead.
+    float *influenceStorage = calloc((size_t)threadCount * INFLUENCE_STORAGE_FLOATS, sizeof(float));
+    if (!influenceStorage)
     {
-        if (!zombies->enemies[i].active)
-        {
-            zombies->enemies[i].position = position;
-            zombies->enemies[i].type = type;
-            zombies->enemies[i].radius = (type == ENEMY_BOSS) ? 0.6f : (type == ENEMY_SPITTER ? 0.4f : 0.35f);
-            float baseHealth = 0.0f;
-            switch (type)
-            {
-            case ENEMY_BOSS:
-                baseHealth = 180.0f;
-                break;
-            case ENEMY_SPITTER:
-                baseHealth = 50.0f;
-                break;
-            case ENEMY_SPRINTER:
-                baseHealth = 22.0f;
-                break;
-            default:
-                baseHealth = 30.0f;
-                break;
-            }
-            zombies->enemies[i].health = baseHealth + zombies->wave * (type == ENEMY_BOSS ? 15.0f : 6.0f);
-            zombies->enemies[i].active = true;
-            zombies->enemies[i].wobblePhase = GetRandomValue(0, 628) / 100.0f;
-            zombies->enemies[i].attackCharge = 0.0f;
-            zombies->enemies[i].attackCooldown = 0.0f;
-            zombies->enemies[i].weakenTimer = 0.0f;
-            zombies->enemies[i].weakenedByPlayer = false;
-            zombies->enemies[i].navTarget = -1;
-            zombies->enemies[i].navCooldown = 0.0f;
-            zombies->activeCount++;
+        free(results);
+        return 1;
+    }
+
+    BalanceJob job = {.config = config, .results = results, .next = 0};
+    BalanceWorker workers[BALANCE_MAX_THREADS];
+    for (int i = 0; i < threadCount; i++)
+    {
+        workers[i].job = &job;
+        InfluenceInitStorage(&workers[i].influence, influenceStorage + (size_t)i * INFLUENCE_STORAGE_FLOATS);
+    }
+    pthread_t threads[BALANCE_MAX_THREADS];
+    int started = 0;
+    uint64_t start = ProfileNowNs();
+    for (; started < threadCount; started++)
+    {
+        if (pthread_create(&threads[started], NULL, BalanceWorkerMain, &workers[started]) != 0)
             break;
+    }
+    // With no worker at all the caller's thread does the whole batch.
+    if (started == 0)
+        BalanceWorkerMain(&workers[0]);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    double seconds = (double)(ProfileNowNs() - start) / 1e9;
+
+    bool ok = WriteBalanceReport(config, results);
+    printf("balance: %d sims on %d threads in %.1f s -> %s\n",
+           config->sims, started > 0 ? started : 1, seconds, ok ? config->outPath : "(write failed)");
+    for (int w = 0; w < BALANCE_WEAPON_COUNT; w++)
+    {
+        int sims = 0;
+        double waves = 0.0;
+        for (int i = w; i < config->sims; i += BALANCE_WEAPON_COUNT)
+        {
+            sims++;
+            waves += results[i].waveReached;
         }
+        if (sims > 0)
+            printf("  %-8s mean wave %.2f over %d sims\n", gWeapons[w].name, waves / sims, sims);
     }
+    free(influenceStorage);
+    free(results);
+    return ok ? 0 : 1;
 }
 
-static void PushTrail(TrailFX *fx, int *idx, Vector3 pos, Color color)
+#define SOAK_DT (1.0f / 60.0f)
+#define SOAK_MAX_BOTS MAX_PEERS
+#define SOAK_BASE_PORT (LAN_PORT + 1)
+#define SOAK_JOIN_STAGGER 1.5
+#define SOAK_REJOIN_SECONDS 300.0
+#define SOAK_OFFLINE_SECONDS 4.0
+#define SOAK_ORBIT_RADIUS 5.0f
+#define SOAK_ORBIT_SPEED 0.4f
+#define SOAK_BASELINE_SAMPLE 1
+
+typedef struct SoakConfig
+{
+    double hours;
+    float sampleSeconds;
+    float driftPercent;
+    int bots;
+    const char *outPath;
+    const char *lanModelPath;
+} SoakConfig;
+
+// Bot 0 hosts a Zombies match and shoots back; the rest orbit the arena as
+// clients, so replication, move reports, clock pings and joins all stay busy.
+// The last bot drops out and rejoins on a timer to keep the join path warm.
+typedef struct SoakBot
+{
+    LanState lan;
+    Enemy enemies[MAX_ENEMIES];
+    ZombiesState zombies;
+    PlayerState player;
+    EventBus bus;
+    char name[MAX_NAME_LEN];
+    uint16_t port;
+    bool online;
+    double joinAt;
+    double leaveAt;
+    float orbit;
+    float fireCooldown;
+    int pendingCash;
+    int pendingScore;
+} SoakBot;
+
+typedef struct SoakSample
+{
+    double minutes;
+    long rssKb;
+    uint32_t allocations;
+    uint32_t overflows;
+    size_t used[MEM_REGION_COUNT];
+    float tickP50;
+    float tickP99;
+    float frameP50;
+    float frameP99;
+    uint32_t counters[PROFILE_COUNTER_COUNT];
+    uint64_t logDropped;
+    int peers;
+    int ghosts;
+    uint32_t replicaSent;
+    uint32_t replicaDeferred;
+    int enemies;
+    int wave;
+    int matches;
+} SoakSample;
+
+static uint64_t gSoakEpochNs;
+
+static double SoakClock(void)
 {
-    fx[*idx].position = pos;
-    fx[*idx].timer = 0.8f;
-    fx[*idx].color = color;
-    *idx = (*idx + 1) % MAX_TRAILS;
+    return (double)(ProfileNowNs() - gSoakEpochNs) / 1e9;
 }
 
-static int ChooseNavTarget(const Vector3 *navPoints, const float *navWeights, int navCount, Vector3 playerPos)
+static long SoakResidentKb(void)
 {
-    if (navCount <= 0)
-        return -1;
-    int best = 0;
-    float bestDist = Vector3Distance(navPoints[0], playerPos);
-    if (navWeights)
-        bestDist /= fmaxf(navWeights[0], 0.01f);
-    for (int i = 1; i < navCount; i++)
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+    long pages = 0;
+    long resident = 0;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+    fclose(f);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static int CompareFloats(const void *a, const void *b)
+{
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts the window in place; it is discarded after the sample anyway.
+static float SoakPercentile(float *values, int count, float p)
+{
+    if (count == 0)
+        return 0.0f;
+    qsort(values, (size_t)count, sizeof(float), CompareFloats);
+    int index = (int)(p * (float)(count - 1) + 0.5f);
+    return values[index];
+}
+
+static bool SoakBotJoin(SoakBot *bots, int count, int index)
+{
+    SoakBot *bot = &bots[index];
+    if (!InitLanAt(&bot->lan, INADDR_LOOPBACK, bot->port))
+        return false;
+    for (int i = 0; i < count; i++)
     {
-        float d = Vector3Distance(navPoints[i], playerPos);
-        if (navWeights)
-            d /= fmaxf(navWeights[i], 0.01f);
-        if (d < bestDist)
-        {
-            bestDist = d;
-            best = i;
-        }
+        if (i == index)
+            continue;
+        bot->lan.fanout[bot->lan.fanoutCount++] = (struct sockaddr_in){
+            .sin_family = AF_INET,
+            .sin_port = htons(bots[i].port),
+            .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
     }
-    int jitter = GetRandomValue(0, 100);
-    if (navCount > 1 && jitter > 65)
-        best = (best + 1) % navCount;
-    return best;
+    bot->lan.fanoutOnly = true;
+    bot->lan.joinStartedAt = bot->lan.selfJoinTime;
+    bot->online = true;
+    return true;
 }
 
-static Vector3 SelectSafeSpawn(const ArenaPreset *preset)
+static void SoakBotLeave(SoakBot *bot)
 {
-    if (!preset)
-        return (Vector3){0};
-    if (preset->navCount > 0)
+    if (bot->lan.socketFd >= 0)
+        close(bot->lan.socketFd);
+    bot->lan.socketFd = -1;
+    bot->lan.enabled = false;
+    bot->online = false;
+}
+
+static void SoakTickHost(SoakBot *bot, Vector3 pos, double matchNow, int *matches)
+{
+    const ArenaPreset *arena = &gArenaPresets[0];
+    UpdateZombies(&bot->zombies,
+                  SOAK_DT,
+                  matchNow,
+                  (Vector3){pos.x, 0.0f, pos.z},
+                  &bot->player,
+                  NULL,
+                  arena->navPoints,
+                  arena->navWeights,
+                  arena->navCount,
+                  NULL,
+                  &bot->bus);
+    if (bot->player.damageCooldown > 0.0f)
+        bot->player.damageCooldown -= SOAK_DT;
+
+    bot->fireCooldown -= SOAK_DT;
+    Enemy *target = NULL;
+    float targetDist = 0.0f;
+    for (int i = 0; i < MAX_ENEMIES; i++)
     {
-        float best = -1000.0f;
-        int bestIndex = 0;
-        for (int i = 0; i < preset->navCount; i++)
+        Enemy *e = &bot->enemies[i];
+        if (!e->active)
+            continue;
+        float d = Vector3Distance(pos, e->position);
+        if (!target || d < targetDist)
         {
-            float w = (preset->navWeights[i] > 0.01f) ? preset->navWeights[i] : 0.01f;
-            if (w > best)
-            {
-                best = w;
-                bestIndex = i;
-            }
+            target = e;
+            targetDist = d;
         }
-        Vector3 pos = preset->navPoints[bestIndex];
-        pos.y = PLAYER_HEIGHT;
-        return pos;
     }
-    return preset->playerSpawn;
+    if (target && bot->fireCooldown <= 0.0f)
+    {
+        Vector3 dir = Vector3Normalize(Vector3Subtract(target->position, pos));
+        dir = Vector3Normalize(Vector3Add(dir, (Vector3){BalanceJitter(&bot->zombies, BALANCE_AIM_ERROR), 0.0f, 0.0f}));
+        FireWeapon(&gWeapons[0], pos, dir, &bot->zombies, NULL, &bot->bus);
+        bot->fireCooldown = 1.0f / gWeapons[0].fireRate;
+    }
+    EventBusDispatch(&bot->bus);
+
+    // A lost match starts over at once so the waves keep cycling for the whole soak.
+    if (bot->player.health <= 0.0f)
+    {
+        ResetPlayer(&bot->player);
+        ResetZombies(&bot->zombies);
+        (*matches)++;
+    }
 }
 
-static void UpdateZombies(ZombiesState *zombies,
-                          float dt,
-                          Vector3 playerPos,
-                          PlayerState *player,
-                          TrailFX *trails,
-                          int *trailIndex,
-                          const Vector3 *navPoints,
-                          const float *navWeights,
-                          int navCount)
+// lanZone is where the bot's network tick is charged: lan for the soak, control for bots the control socket starts.
+static void SoakTickBot(SoakBot *bot, bool host, double now, ProfileZone lanZone, int *matches)
 {
-    const float spawnDelay = 2.0f;
-    zombies->spawnCooldown -= dt;
-    zombies->waveTimer += dt;
+    bot->orbit += SOAK_ORBIT_SPEED * SOAK_DT;
+    Vector3 pos = {cosf(bot->orbit) * SOAK_ORBIT_RADIUS, PLAYER_HEIGHT, sinf(bot->orbit) * SOAK_ORBIT_RADIUS};
 
-    if (zombies->spawnCooldown <= 0.0f && zombies->activeCount < 6)
+    if (host)
     {
-        float angle = GetRandomValue(0, 628) / 100.0f;
-        float dist = 6.0f + zombies->wave * 0.2f;
-        Vector3 pos = {cosf(angle) * dist, 0.0f, sinf(angle) * dist};
-        bool boss = (zombies->wave % 5 == 0) && (zombies->waveTimer < 1.0f);
-        EnemyType type = boss ? ENEMY_BOSS : ENEMY_BASIC;
-        if (!boss)
-        {
-            int roll = GetRandomValue(0, 100);
-            if (zombies->wave > 2 && roll > 65)
-                type = ENEMY_SPRINTER;
-            else if (zombies->wave > 3 && roll > 40)
-                type = ENEMY_SPITTER;
-        }
-        SpawnEnemy(zombies, pos, type);
-        zombies->spawnCooldown = spawnDelay;
+        uint64_t zone = ProfileZoneBegin();
+        SoakTickHost(bot, pos, LanMatchTime(&bot->lan, now), matches);
+        ProfileZoneEnd(PROFILE_ZONE_ZOMBIES, zone);
     }
 
-    for (int i = 0; i < (int)(sizeof(zombies->enemies) / sizeof(zombies->enemies[0])); i++)
+    LanState *lan = &bot->lan;
+    lan->movePosition = pos;
+    lan->moveSeq++;
+    lan->moveElapsed += SOAK_DT;
+    lan->moveReady = true;
+    uint64_t zone = ProfileZoneBegin();
+    UpdateLan(lan,
+              SOAK_DT,
+              pos,
+              0,
+              gWeapons[0].maxAmmo,
+              &bot->player,
+              false,
+              false,
+              false,
+              MULTI_FFA,
+              0,
+              bot->name,
+              now,
+              &bot->pendingCash,
+              &bot->pendingScore,
+              NULL,
+              NULL,
+              NULL,
+              NULL,
+              false,
+              NULL,
+              NULL,
+              host ? &bot->zombies : NULL);
+    ProfileZoneEnd(lanZone, zone);
+
+    for (int i = 0; i < MAX_PEERS && host; i++)
     {
-        Enemy *e = &zombies->enemies[i];
-        if (!e->active)
+        Peer *p = &lan->peers[i];
+        if (!p->active || !p->joinRequested)
             continue;
+        uint8_t *blob = (uint8_t *)RegionAlloc(MEM_REGION_SCRATCH, TRANSFER_MAX_BYTES);
+        if (!blob)
+            break;
+        int teamScores[2] = {0};
+        size_t blobSize = BuildJoinSnapshot(blob, lan, i, MODE_ZOMBIES, MULTI_FFA, 0, LayoutHash(NULL, 0), &bot->zombies,
+                                            teamScores, &bot->player, bot->name, 0, LanMatchTime(lan, now));
+        TransferBegin(&p->joinTx, ++lan->transferId, blob, blobSize, now);
+        p->joinRequested = false;
+    }
+    lan->hasMoveAck = false;
+    lan->hasJoinState = false;
+    lan->hasIncomingEvent = false;
+}
 
-        Vector3 toPlayer = Vector3Subtract(playerPos, e->position);
-        toPlayer.y = 0.0f;
-        float dist = Vector3Length(toPlayer);
-        Vector3 toTarget = toPlayer;
-        if (navPoints && navCount > 0)
+static void SoakTakeSample(SoakSample *out, const SoakBot *bots, int count, double seconds, float *tickMs, float *frameMs, int ticks,
+                           const uint32_t counters[PROFILE_COUNTER_COUNT], int matches)
+{
+    memset(out, 0, sizeof(*out));
+    out->minutes = seconds / 60.0;
+    out->rssKb = SoakResidentKb();
+    for (int r = 0; r < MEM_REGION_COUNT; r++)
+    {
+        RegionStats stats = RegionGetStats((MemRegion)r);
+        out->allocations += stats.allocations;
+        out->overflows += stats.overflows;
+        out->used[r] = stats.used;
+    }
+    out->tickP50 = SoakPercentile(tickMs, ticks, 0.5f);
+    out->tickP99 = SoakPercentile(tickMs, ticks, 0.99f);
+    out->frameP50 = SoakPercentile(frameMs, ticks, 0.5f);
+    out->frameP99 = SoakPercentile(frameMs, ticks, 0.99f);
+    memcpy(out->counters, counters, sizeof(out->counters));
+    out->logDropped = LogDroppedCount();
+    for (int b = 0; b < count; b++)
+    {
+        if (!bots[b].online)
+            continue;
+        for (int i = 0; i < MAX_PEERS; i++)
         {
-            e->navCooldown -= dt;
-            if (e->navTarget < 0 || e->navTarget >= navCount || e->navCooldown <= 0.0f)
-            {
-                e->navTarget = ChooseNavTarget(navPoints, navWeights, navCount, playerPos);
-                e->navCooldown = 2.0f + (float)GetRandomValue(0, 60) / 60.0f;
-            }
-            if (e->navTarget >= 0 && e->navTarget < navCount)
+            if (!bots[b].lan.peers[i].active)
+                continue;
+            out->peers++;
+            for (int g = 0; g < REPLICATION_MAX_ENTITIES; g++)
+                out->ghosts += bots[b].lan.peers[i].ghosts[g].active ? 1 : 0;
+            if (b == 0)
             {
-                Vector3 navGoal = navPoints[e->navTarget];
-                navGoal.y = 0.0f;
-                if (Vector3Distance(e->position, navGoal) < 0.55f)
-                    e->navCooldown = 0.0f;
-                if (Vector3Distance(navGoal, playerPos) > 0.4f)
-                    toTarget = Vector3Subtract(navGoal, e->position);
+                out->replicaSent += bots[b].lan.peers[i].replication.recordsSent;
+                out->replicaDeferred += bots[b].lan.peers[i].replication.recordsDeferred;
             }
         }
-        if (e->weakenTimer > 0.0f)
-        {
-            e->weakenTimer -= dt;
-            if (e->weakenTimer < 0.0f)
-                e->weakenTimer = 0.0f;
-        }
-        float weakenScale = e->weakenTimer > 0.0f ? 0.78f : 1.0f;
-        float moveDist = Vector3Length(toTarget);
-        if (moveDist > 0.001f)
-        {
-            float speed = 2.2f;
-            if (e->type == ENEMY_BOSS)
-                speed = 1.6f;
-            else if (e->type == ENEMY_SPRINTER)
-                speed = 3.8f;
-            else if (e->type == ENEMY_SPITTER)
-                speed = 1.9f;
-            Vector3 dir = Vector3Normalize(toTarget);
-            Vector3 step = Vector3Scale(dir, speed * weakenScale * dt);
-            if (Vector3Length(step) > moveDist)
-                step = Vector3Scale(dir, moveDist);
-            e->position = Vector3Add(e->position, step);
-        }
+    }
+    for (int i = 0; i < MAX_ENEMIES; i++)
+        out->enemies += bots[0].enemies[i].active ? 1 : 0;
+    out->wave = bots[0].zombies.wave;
+    out->matches = matches;
+}
+
+static void WriteSoakHeader(FILE *f)
+{
+    fprintf(f, "minute,rss_kb,region_allocs,region_overflows");
+    for (int r = 0; r < MEM_REGION_COUNT; r++)
+        fprintf(f, ",%s_used", RegionGetStats((MemRegion)r).name);
+    fprintf(f, ",tick_p50_ms,tick_p99_ms,frame_p50_ms,frame_p99_ms");
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+        fprintf(f, ",%s", ProfileCounterName((ProfileCounter)c));
+    fprintf(f, ",log_dropped,peers,ghosts,replica_sent,replica_deferred,enemies,wave,matches,drift\n");
+}
 
-        e->wobblePhase += dt * ((e->type == ENEMY_BOSS) ? 2.0f : 2.8f);
+static void WriteSoakRow(FILE *f, const SoakSample *s, const char *drift)
+{
+    fprintf(f, "%.2f,%ld,%u,%u", s->minutes, s->rssKb, s->allocations, s->overflows);
+    for (int r = 0; r < MEM_REGION_COUNT; r++)
+        fprintf(f, ",%zu", s->used[r]);
+    fprintf(f, ",%.3f,%.3f,%.3f,%.3f", s->tickP50, s->tickP99, s->frameP50, s->frameP99);
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+        fprintf(f, ",%u", s->counters[c]);
+    fprintf(f, ",%llu,%d,%d,%u,%u,%d,%d,%d,%s\n", (unsigned long long)s->logDropped, s->peers, s->ghosts, s->replicaSent,
+            s->replicaDeferred, s->enemies, s->wave, s->matches, drift ? drift : "");
+    fflush(f);
+}
 
-        if (e->attackCooldown > 0.0f)
-            e->attackCooldown -= dt;
+// Compares a sample against the baseline minute. Growth checks carry an
+// absolute slack so a quiet baseline does not turn scheduler noise into a
+// failure; long-lived regions and overflow counts must not move at all.
+static const char *SoakDrift(const SoakSample *base, const SoakSample *s, float limit)
+{
+    // With more live enemies than the packet budget holds, the host must be
+    // deferring records; run with a small net.enemy_budget to exercise it.
+    int fit = (CvarInt(gCvar.enemyBudget) - LAN_ENEMY_HEADER_BYTES) / LAN_ENEMY_RECORD_BYTES;
+    if (s->peers > 0 && s->enemies > fit && s->replicaDeferred == 0)
+        return "replica_budget";
+    if (s->rssKb > (long)((float)base->rssKb * (1.0f + limit)) + 1024)
+        return "rss_kb";
+    for (int r = 0; r < MEM_REGION_COUNT; r++)
+    {
+        if (r != MEM_REGION_SCRATCH && s->used[r] > base->used[r])
+            return RegionGetStats((MemRegion)r).name;
+    }
+    if (s->overflows > base->overflows)
+        return "overflows";
+    if (s->tickP99 > base->tickP99 * (1.0f + limit) + 1.0f)
+        return "tick_p99_ms";
+    if (s->frameP99 > base->frameP99 * (1.0f + limit) + 2.0f)
+        return "frame_p99_ms";
+    if ((float)s->counters[PROFILE_COUNTER_PACKETS_IN] < (float)base->counters[PROFILE_COUNTER_PACKETS_IN] * (1.0f - limit))
+        return "packets_in";
+    if (s->logDropped > base->logDropped)
+        return "log_dropped";
+    return NULL;
+}
 
-        const float attackRange = 1.05f;
-        const float windupTime = 0.35f;
-        if (e->type == ENEMY_SPITTER)
+static int RunSoak(const SoakConfig *config)
+{
+    int botCount = (int)Clamp((float)config->bots, 2.0f, (float)SOAK_MAX_BOTS);
+    int samplesPerWindow = (int)(config->sampleSeconds / SOAK_DT) + 2;
+    if (config->hours <= 0.0 || config->sampleSeconds <= 0.0f || !RegionInit())
+        return 1;
+    SoakBot *bots = calloc((size_t)botCount, sizeof(SoakBot));
+    float *tickMs = calloc((size_t)samplesPerWindow, sizeof(float));
+    float *frameMs = calloc((size_t)samplesPerWindow, sizeof(float));
+    FILE *csv = fopen(config->outPath, "w");
+    if (!bots || !tickMs || !frameMs || !csv)
+    {
+        free(bots);
+        free(tickMs);
+        free(frameMs);
+        if (csv)
+            fclose(csv);
+        return 1;
+    }
+    WriteSoakHeader(csv);
+
+    gSoakEpochNs = ProfileNowNs();
+    gLanClock = SoakClock;
+    for (int i = 0; i < botCount; i++)
+    {
+        SoakBot *bot = &bots[i];
+        bot->lan.socketFd = -1;
+        bot->port = (uint16_t)(SOAK_BASE_PORT + i);
+        bot->joinAt = (double)i * SOAK_JOIN_STAGGER;
+        bot->leaveAt = i == botCount - 1 ? SOAK_REJOIN_SECONDS : 0.0;
+        bot->orbit = (float)i * (2.0f * PI / (float)botCount);
+        snprintf(bot->name, sizeof(bot->name), "Soak%d", i);
+        ResetPlayer(&bot->player);
+        EventBusInit(&bot->bus);
+    }
+    bots[0].zombies.enemies = bots[0].enemies;
+    bots[0].zombies.enemyCapacity = MAX_ENEMIES;
+    bots[0].zombies.rng = 0x50A4u;
+    ResetZombies(&bots[0].zombies);
+    EventBusSubscribe(&bots[0].bus, "soak", BalanceEconomyConsumer, &bots[0].player);
+
+    double endAt = config->hours * 3600.0;
+    double nextSample = config->sampleSeconds;
+    uint32_t counters[PROFILE_COUNTER_COUNT] = {0};
+    SoakSample baseline = {0};
+    int samples = 0;
+    int ticks = 0;
+    int matches = 0;
+    const char *failed = NULL;
+    uint64_t deadline = ProfileNowNs();
+    printf("soak: %d bots on 127.0.0.1:%d-%d for %.2f h, sampling every %.0f s -> %s\n",
+           botCount, SOAK_BASE_PORT, SOAK_BASE_PORT + botCount - 1, config->hours, config->sampleSeconds, config->outPath);
+
+    for (double now = SoakClock(); now < endAt && !failed; now = SoakClock())
+    {
+        ProfileBeginFrame();
+        RegionResetScratch();
+        uint64_t tickStart = ProfileNowNs();
+        for (int i = 0; i < botCount; i++)
         {
-            const float spitRange = 7.5f;
-            const float spitWind = 0.5f;
-            if (dist < spitRange)
+            SoakBot *bot = &bots[i];
+            if (!bot->online && now >= bot->joinAt && !SoakBotJoin(bots, botCount, i))
             {
-                e->attackCharge += dt;
-                if (e->attackCharge >= spitWind && e->attackCooldown <= 0.0f)
-                {
-                    player->health -= 8.0f;
-                    player->damageCooldown = 0.8f;
-                    e->attackCharge = 0.0f;
-                    e->attackCooldown = 2.0f;
-                    if (trails && trailIndex)
-                    {
-                        Vector3 dir = Vector3Normalize(toPlayer);
-                        for (int t = 1; t <= 4; t++)
-                        {
-                            Vector3 pos = Vector3Add(e->position, Vector3Scale(dir, (float)t * 0.35f));
-                            pos.y = 0.5f;
-                            PushTrail(trails, trailIndex, pos, (Color){140, 200, 255, 200});
-                        }
-                    }
-                }
+                failed = "bind";
+                break;
             }
-            else
+            if (bot->online && bot->leaveAt > 0.0 && now >= bot->leaveAt)
             {
-                e->attackCharge = 0.0f;
+                SoakBotLeave(bot);
+                bot->joinAt = now + SOAK_OFFLINE_SECONDS;
+                bot->leaveAt = bot->joinAt + SOAK_REJOIN_SECONDS;
             }
+            if (bot->online)
+                SoakTickBot(bot, i == 0, now, PROFILE_ZONE_LAN, &matches);
         }
-        else
+        float workMs = (float)(ProfileNowNs() - tickStart) / 1e6f;
+        ProfileFrame frame;
+        ProfileEndFrame(&frame);
+        for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+            counters[c] += frame.counters[c];
+        if (ticks < samplesPerWindow)
         {
-            if (dist < attackRange)
-            {
-                e->attackCharge += dt;
-                if (e->attackCharge >= windupTime && e->attackCooldown <= 0.0f && player->damageCooldown <= 0.0f)
-                {
-                    float dmg = (e->type == ENEMY_BOSS) ? 25.0f : (e->type == ENEMY_SPRINTER ? 10.0f : 12.0f);
-                    if (e->weakenTimer > 0.0f)
-                        dmg *= 0.65f;
-                    player->health -= dmg;
-                    player->damageCooldown = 1.0f;
-                    e->attackCharge = 0.0f;
-                    e->attackCooldown = 1.35f;
-                }
-            }
-            else
-            {
-                e->attackCharge = 0.0f;
-            }
+            tickMs[ticks] = workMs;
+            frameMs[ticks] = frame.frameMs;
+            ticks++;
+        }
+
+        if (now >= nextSample)
+        {
+            SoakSample sample;
+            SoakTakeSample(&sample, bots, botCount, now, tickMs, frameMs, ticks, counters, matches);
+            if (samples == SOAK_BASELINE_SAMPLE)
+                baseline = sample;
+            const char *drift = samples > SOAK_BASELINE_SAMPLE ? SoakDrift(&baseline, &sample, config->driftPercent / 100.0f) : NULL;
+            WriteSoakRow(csv, &sample, drift);
+            if (drift)
+                failed = drift;
+            samples++;
+            ticks = 0;
+            memset(counters, 0, sizeof(counters));
+            nextSample += config->sampleSeconds;
+        }
+
+        // Fixed 60 Hz pacing; after a stall the schedule restarts rather than bursting to catch up.
+        deadline += (uint64_t)(SOAK_DT * 1e9f);
+        uint64_t after = ProfileNowNs();
+        if (after < deadline)
+            ProfileSleepUntilNs(deadline);
+        else if (after - deadline > 1000000000ull)
+        {
+            deadline = after;
         }
     }
 
-    if (zombies->activeCount == 0)
+    for (int i = 0; i < botCount; i++)
     {
-        zombies->wave++;
-        zombies->spawnCooldown = 0.5f;
-        zombies->waveTimer = 0.0f;
+        if (bots[i].online)
+            SoakBotLeave(&bots[i]);
     }
+    fclose(csv);
+    free(bots);
+    free(tickMs);
+    free(frameMs);
+    gLanClock = GetTime;
+    RegionShutdown();
+    if (failed)
+        printf("soak: FAILED on %s after %d samples\n", failed, samples);
+    else
+        printf("soak: passed, %d samples, %d matches\n", samples, matches);
+    return failed ? 2 : 0;
 }
 
-static void DrawZombies(const ZombiesState *zombies)
+typedef struct GameMetrics
 {
-    for (int i = 0; i < (int)(sizeof(zombies->enemies) / sizeof(zombies->enemies[0])); i++)
+    int frameMs;
+    int tickMs;
+    int counters[PROFILE_COUNTER_COUNT];
+    int hitches;
+    int enemies;
+    int peers;
+    int logDropped;
+    int poolUsed[MEM_REGION_COUNT];
+    int poolOverflows;
+} GameMetrics;
+
+static void RegisterGameMetrics(GameMetrics *m)
+{
+    char name[METRICS_NAME_BYTES];
+    m->frameMs = MetricsRegister(METRIC_HISTOGRAM, "frame_ms");
+    m->tickMs = MetricsRegister(METRIC_HISTOGRAM, "tick_ms");
+    static const ProfileCounter exported[] = {PROFILE_COUNTER_PACKETS_IN, PROFILE_COUNTER_PACKETS_OUT, PROFILE_COUNTER_BYTES_IN,
+                                              PROFILE_COUNTER_BYTES_OUT};
+    for (size_t i = 0; i < sizeof(exported) / sizeof(exported[0]); i++)
     {
-        if (!zombies->enemies[i].active)
-            continue;
-        float wobble = sinf(zombies->enemies[i].wobblePhase) * 0.15f;
-        Color baseTint = {120, 200, 120, 255};
-        if (zombies->enemies[i].type == ENEMY_BOSS)
-            baseTint = (Color){190, 120, 40, 255};
-        else if (zombies->enemies[i].type == ENEMY_SPITTER)
-            baseTint = (Color){160, 180, 220, 255};
-        else if (zombies->enemies[i].type == ENEMY_SPRINTER)
-            baseTint = (Color){200, 120, 180, 255};
-        if (zombies->enemies[i].weakenTimer > 0.0f)
-        {
-            baseTint = (Color){(unsigned char)Clamp(baseTint.r + 20, 0, 255),
-                               (unsigned char)Clamp(baseTint.g + 35, 0, 255),
-                               (unsigned char)Clamp(baseTint.b + 35, 0, 255),
-                               255};
-        }
-        float charge = Clamp(zombies->enemies[i].attackCharge / 0.5f, 0.0f, 1.0f);
-        Color tint = ColorAlpha(RED, charge);
-        tint = (Color){
-            (unsigned char)Clamp(baseTint.r + (int)tint.r, 0, 255),
-            (unsigned char)Clamp(baseTint.g - (int)(charge * 80), 0, 255),
-            (unsigned char)Clamp(baseTint.b - (int)(charge * 60), 0, 255),
-            255};
-        float h = (zombies->enemies[i].type == ENEMY_BOSS) ? 1.7f : (zombies->enemies[i].type == ENEMY_SPITTER ? 1.0f : 1.2f);
-        float size = (zombies->enemies[i].type == ENEMY_BOSS) ? 1.0f : (zombies->enemies[i].type == ENEMY_SPITTER ? 0.6f : 0.7f);
-        Vector3 pos = zombies->enemies[i].position;
-        pos.y += wobble;
-        DrawRetroCube(pos, size, h, size, tint);
-        if (zombies->enemies[i].attackCharge > 0.1f)
-        {
-            float telegraphSize = 0.35f + charge * 0.3f;
-            DrawSphere(Vector3Add(pos, (Vector3){0, h * 0.5f + 0.2f, 0}), telegraphSize, ColorAlpha(RED, 120));
-        }
+        snprintf(name, sizeof(name), "lan.%s", ProfileCounterName(exported[i]));
+        m->counters[exported[i]] = MetricsRegister(METRIC_COUNTER, name);
+    }
+    m->hitches = MetricsRegister(METRIC_COUNTER, "hitches");
+    m->enemies = MetricsRegister(METRIC_GAUGE, "active_enemies");
+    m->peers = MetricsRegister(METRIC_GAUGE, "lan.peers");
+    m->logDropped = MetricsRegister(METRIC_GAUGE, "log_dropped");
+    for (int r = 0; r < MEM_REGION_COUNT; r++)
+    {
+        snprintf(name, sizeof(name), "pool.%s_used", RegionGetStats((MemRegion)r).name);
+        m->poolUsed[r] = MetricsRegister(METRIC_GAUGE, name);
+    }
+    m->poolOverflows = MetricsRegister(METRIC_GAUGE, "pool.overflows");
+    for (int i = 0; i < MAX_PEERS; i++)
+    {
+        snprintf(name, sizeof(name), "lan.peer%d.packets_in", i);
+        gPeerMetrics[i][0] = MetricsRegister(METRIC_COUNTER, name);
+        snprintf(name, sizeof(name), "lan.peer%d.bytes_in", i);
+        gPeerMetrics[i][1] = MetricsRegister(METRIC_COUNTER, name);
     }
 }
 
-static void DrawDecals(Decal *decals, float dt)
+static void UpdateGameMetrics(const GameMetrics *m, const ProfileFrame *frame, const LanState *lan, bool hitch)
 {
-    for (int i = 0; i < MAX_DECALS; i++)
+    MetricsObserve(m->frameMs, frame->frameMs);
+    MetricsObserve(m->tickMs, frame->zoneMs[PROFILE_ZONE_LAN] + frame->zoneMs[PROFILE_ZONE_ZOMBIES] +
+                                  frame->zoneMs[PROFILE_ZONE_COMBAT]);
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++)
+        MetricsAdd(m->counters[c], frame->counters[c]);
+    MetricsAdd(m->hitches, hitch ? 1 : 0);
+    MetricsSet(m->enemies, frame->activeEnemies);
+    int peers = 0;
+    for (int i = 0; i < MAX_PEERS; i++)
+        peers += lan->peers[i].active ? 1 : 0;
+    MetricsSet(m->peers, peers);
+    MetricsSet(m->logDropped, LogDroppedCount());
+    uint32_t overflows = 0;
+    for (int r = 0; r < MEM_REGION_COUNT; r++)
     {
-        if (decals[i].timer <= 0.0f)
-            continue;
-        decals[i].timer -= dt;
-        float alpha = Clamp(decals[i].timer, 0.0f, 1.0f);
-        Color faded = decals[i].color;
-        faded.a = (unsigned char)(alpha * 255);
-        DrawSphere(decals[i].position, 0.08f, faded);
+        RegionStats stats = RegionGetStats((MemRegion)r);
+        MetricsSet(m->poolUsed[r], (double)stats.used);
+        overflows += stats.overflows;
     }
+    MetricsSet(m->poolOverflows, overflows);
 }
 
-static void UpdateDissolves(DissolveFX *fx, float dt)
+static void PublishTelemetry(const ProfileFrame *frame, const LanState *lan, GameMode mode, MultiplayerVariant variant,
+                             const ZombiesState *zombies, const int teamScores[2], const PlayerState *player, const char *name,
+                             int team, Vector3 position, uint32_t hitches)
 {
-    for (int i = 0; i < MAX_DISSOLVES; i++)
+    TelemetrySnapshot t;
+    memset(&t, 0, sizeof(t));
+    double now = GetTime();
+    int hostSlot = LanHostSlot(lan, now);
+    t.tick = frame->index;
+    t.matchTime = LanMatchTime(lan, now);
+    t.mode = (uint32_t)mode;
+    t.variant = (uint32_t)variant;
+    t.wave = mode == MODE_ZOMBIES ? zombies->wave : 0;
+    t.activeEnemies = frame->activeEnemies;
+    t.teamScores[0] = teamScores[0];
+    t.teamScores[1] = teamScores[1];
+
+    TelemetryPlayer *self = &t.players[t.playerCount++];
+    snprintf(self->name, sizeof(self->name), "%s", name);
+    self->position[0] = position.x;
+    self->position[1] = position.y;
+    self->position[2] = position.z;
+    self->health = player->health;
+    self->score = player->score;
+    self->cash = player->cash;
+    self->team = (uint8_t)team;
+    self->flags = TELEMETRY_PLAYER_SELF | (lan->enabled && hostSlot < 0 ? TELEMETRY_PLAYER_HOST : 0) |
+                  (player->isDowned ? TELEMETRY_PLAYER_DOWNED : 0);
+    for (int i = 0; i < MAX_PEERS && t.playerCount < TELEMETRY_MAX_PLAYERS; i++)
     {
-        if (fx[i].timer <= 0.0f)
+        const Peer *p = &lan->peers[i];
+        if (!p->active)
             continue;
-        fx[i].timer -= dt;
-        float alpha = Clamp(fx[i].timer, 0.0f, 1.0f);
-        Color tint = fx[i].color;
-        tint.a = (unsigned char)(alpha * 200);
-        float scale = 0.4f + (1.0f - alpha) * 0.4f;
-        DrawRetroCube(Vector3Add(fx[i].position, (Vector3){0, (1.0f - alpha) * 0.2f, 0}),
-                      scale,
-                      fx[i].height * alpha,
-                      scale,
-                      tint);
+        TelemetryPlayer *out = &t.players[t.playerCount++];
+        snprintf(out->name, sizeof(out->name), "%s", p->name);
+        out->position[0] = p->position.x;
+        out->position[1] = p->position.y;
+        out->position[2] = p->position.z;
+        out->health = p->health;
+        out->score = p->score;
+        out->cash = p->cash;
+        out->rttMs = p->clock.valid ? (float)(p->clock.rtt * 1000.0) : 0.0f;
+        out->team = (uint8_t)p->team;
+        out->flags = (i == hostSlot ? TELEMETRY_PLAYER_HOST : 0) | (p->isDowned ? TELEMETRY_PLAYER_DOWNED : 0);
     }
+
+    t.frameMs = frame->frameMs;
+    for (int z = 0; z < PROFILE_ZONE_COUNT && z < TELEMETRY_ZONES; z++)
+        t.zoneMs[z] = frame->zoneMs[z];
+    t.headroom = lan->headroom;
+    t.hitches = hitches;
+    t.packetsIn = frame->counters[PROFILE_COUNTER_PACKETS_IN];
+    t.packetsOut = frame->counters[PROFILE_COUNTER_PACKETS_OUT];
+    t.bytesIn = frame->counters[PROFILE_COUNTER_BYTES_IN];
+    t.bytesOut = frame->counters[PROFILE_COUNTER_BYTES_OUT];
+    TelemetryPublish(&t);
 }
 
-static void UpdateTrails(TrailFX *fx, float dt)
+// Match changes asked for by the menu or the control socket. Both only fill
+// this in; the game applies it at the top of the next frame.
+typedef struct MatchRequest
 {
-    for (int i = 0; i < MAX_TRAILS; i++)
-    {
-        if (fx[i].timer <= 0.0f)
-            continue;
-        fx[i].timer -= dt;
-        float alpha = Clamp(fx[i].timer, 0.0f, 1.0f);
-        Color tint = fx[i].color;
-        tint.a = (unsigned char)(alpha * 220);
-        DrawSphere(fx[i].position, 0.08f + (1.0f - alpha) * 0.08f, tint);
-    }
+    int arena;
+    int mode;
+    int variant;
+    bool start;
+    bool menu;
+    bool quit;
+} MatchRequest;
+
+static void ClearMatchRequest(MatchRequest *request)
+{
+    *request = (MatchRequest){.arena = -1, .mode = -1, .variant = -1};
 }
 
-static void ResetZombies(ZombiesState *zombies)
+// Loopback clients for benchmark runs: soak bots orbiting the arena that
+// reach the game on 127.0.0.1 and are reached through its fanout list.
+typedef struct ControlBots
 {
-    memset(zombies, 0, sizeof(*zombies));
-    zombies->wave = 1;
-    zombies->spawnCooldown = 0.25f;
-    zombies->waveTimer = 0.0f;
+    SoakBot *bots;
+    int count;
+} ControlBots;
+
+static void StopControlBots(ControlBots *control, LanState *lan)
+{
+    for (int i = 0; i < control->count; i++)
+        SoakBotLeave(&control->bots[i]);
+    free(control->bots);
+    control->bots = NULL;
+    control->count = 0;
+    lan->fanoutCount = 0;
 }
 
-static void ResetPlayer(PlayerState *player)
+static int StartControlBots(ControlBots *control, LanState *lan, int count)
 {
-    player->health = PLAYER_MAX_HEALTH;
-    player->isDowned = false;
-    player->reviveProgress = 0.0f;
-    player->damageCooldown = 0.0f;
-    player->score = 0;
-    player->cash = 500;
+    StopControlBots(control, lan);
+    if (count <= 0 || !lan->enabled)
+        return 0;
+    control->bots = calloc((size_t)count, sizeof(SoakBot));
+    if (!control->bots)
+        return 0;
+    control->count = count;
+    for (int i = 0; i < count; i++)
+    {
+        SoakBot *bot = &control->bots[i];
+        bot->lan.socketFd = -1;
+        bot->port = (uint16_t)(SOAK_BASE_PORT + i);
+        bot->orbit = (float)i * (2.0f * PI / (float)count);
+        snprintf(bot->name, sizeof(bot->name), "Bot%d", i);
+        ResetPlayer(&bot->player);
+        EventBusInit(&bot->bus);
+    }
+    struct sockaddr_in game = {.sin_family = AF_INET, .sin_port = htons(LAN_PORT), .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    int started = 0;
+    for (int i = 0; i < count; i++)
+    {
+        SoakBot *bot = &control->bots[i];
+        if (!SoakBotJoin(control->bots, count, i))
+            continue;
+        bot->lan.fanout[bot->lan.fanoutCount++] = game;
+        // No spare budget on record, so the election never hands a bot the match.
+        bot->lan.headroom = 0.0f;
+        lan->fanout[lan->fanoutCount++] = (struct sockaddr_in){
+            .sin_family = AF_INET,
+            .sin_port = htons(bot->port),
+            .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+        started++;
+    }
+    return started;
 }
 
-static void DrawMenuButton(Rectangle rect, const char *label, bool selected)
+static void TickControlBots(ControlBots *control, double now)
 {
-    Color outline = selected ? SKYBLUE : DARKGRAY;
-    Color fill = selected ? (Color){20, 26, 42, 180} : (Color){14, 16, 24, 140};
-    DrawRectangleRec(rect, fill);
-    DrawRectangleLinesEx(rect, 2, outline);
-    Vector2 textSize = MeasureTextEx(GetFontDefault(), label, 12, 1);
-    DrawText(label,
-             (int)(rect.x + (rect.width - textSize.x) * 0.5f),
-             (int)(rect.y + (rect.height - textSize.y) * 0.5f),
-             12,
-             selected ? WHITE : LIGHTGRAY);
+    int matches = 0;
+    for (int i = 0; i < control->count; i++)
+    {
+        if (control->bots[i].online)
+            SoakTickBot(&control->bots[i], false, now, PROFILE_ZONE_CONTROL, &matches);
+    }
 }
 
-static void DrawCooldownBar(int x, int y, float t)
+static int CountOnlineBots(const ControlBots *control)
 {
-    int w = 38;
-    int h = 6;
-    DrawRectangleLines(x, y, w, h, DARKGRAY);
-    float fill = Clamp(1.0f - t, 0.0f, 1.0f);
-    DrawRectangle(x + 1, y + 1, (int)((w - 2) * fill), h - 2, fill >= 1.0f ? LIME : SKYBLUE);
+    int online = 0;
+    for (int i = 0; i < control->count; i++)
+        online += control->bots[i].online ? 1 : 0;
+    return online;
 }
 
-static void PushKillfeed(KillfeedEntry *feed, int count, const char *text, Color color)
+// What the control socket acts on directly rather than through a MatchRequest.
+typedef struct ControlSession
 {
-    if (count <= 0)
+    ControlBots bots;
+    LanState *lan;
+    // Client waiting for a folded profile to finish writing, or -1, and the
+    // connection it was; if that client leaves, the reply is dropped.
+    int traceClient;
+    unsigned traceSerial;
+    char tracePath[128];
+} ControlSession;
+
+static void FinishControlTrace(ControlSession *session)
+{
+    bool ok;
+    if (session->traceClient < 0 || !SamplerWriteDone(false, &ok))
         return;
-    for (int i = count - 1; i > 0; i--)
-        feed[i] = feed[i - 1];
-    strncpy(feed[0].text, text, sizeof(feed[0].text) - 1);
-    feed[0].text[sizeof(feed[0].text) - 1] = '\0';
-    feed[0].timer = 3.0f;
-    feed[0].color = color;
+    char reply[CONTROL_REPLY_BYTES];
+    if (ok)
+        snprintf(reply, sizeof(reply), "ok trace %u samples %u dropped %s", SamplerSampleCount(), SamplerDroppedCount(),
+                 session->tracePath);
+    else
+        snprintf(reply, sizeof(reply), "err could not write %s", session->tracePath);
+    if (ControlSerial(session->traceClient) == session->traceSerial)
+        ControlReply(session->traceClient, reply);
+    session->traceClient = -1;
 }
 
-static void PushKillfeedSfx(KillfeedEntry *feed, int count, const char *text, Color color, Sound sound)
+static int FindArena(const char *text)
 {
-    PushKillfeed(feed, count, text, color);
-    PlaySoundSafe(sound);
+    for (int i = 0; i < MAX_ARENAS; i++)
+    {
+        if (strcmp(gArenaPresets[i].name, text) == 0)
+            return i;
+    }
+    char *end = NULL;
+    long index = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || index < 0 || index >= MAX_ARENAS)
+        return -1;
+    return (int)index;
 }
 
-static void DrawInfo(float dt,
-                     GameMode mode,
-                     const Weapon *weapon,
-                     const ZombiesState *zombies,
-                     const PlayerState *player,
-                     int ammo,
-                     bool quickfire,
-                     bool speed,
-                     bool revive,
-                     const LanState *lan,
-                     const char *playerName,
-                     bool nameLocked,
-                     bool audioOn,
-                     bool flashlightOn,
-                     bool ditherOn,
-                     float fireCooldown,
-                     float mysteryCooldown,
-                     float damageCooldown,
-                     const char *arenaName,
-                     float sharePipTimer,
-                     int sharePipCash,
-                     int sharePipScore,
-                     float assistFlash,
-                     MultiplayerVariant mpVariant,
-                     int playerTeam,
-                     int frags,
-                     int deaths,
-                     const int teamScores[2],
-                     const HitMarker *hitMarker,
-                     const KillfeedEntry *killfeed,
-                     int killfeedCount)
+// Every command gets exactly one reply line, "ok ..." or "err ...". Match
+// changes only land in the request, so a reply of ok means "queued"; bots
+// start before the reply. Returns false when the reply comes later, which
+// only trace stop does, once FinishControlTrace sees the profile written.
+static bool RunControlCommand(ControlSession *session, int client, char *line, MatchRequest *request, char *reply, size_t cap)
 {
-    DrawText("U8 Prototype", 8, 8, 10, LIGHTGRAY);
-    DrawText(TextFormat("Frame: %d FPS", GetFPS()), 8, 20, 10, LIGHTGRAY);
-    DrawText(TextFormat("dt: %.3f", dt), 8, 32, 10, LIGHTGRAY);
-    DrawText(TextFormat("Name: %s%s", playerName, nameLocked ? "" : " (edit Enter)"), 8, 44, 10, LIGHTGRAY);
-    DrawText(TextFormat("Audio: %s (M)", audioOn ? "on" : "muted"), 8, 56, 10, LIGHTGRAY);
-    DrawText(TextFormat("Flashlight: %s (F)", flashlightOn ? "on" : "off"), 8, 68, 10, LIGHTGRAY);
-    DrawText(TextFormat("Dither: %s (V)", ditherOn ? "on" : "off"), 8, 80, 10, LIGHTGRAY);
-    DrawText(TextFormat("Checksum: %s (C)", lan->useChecksum ? "on" : "off"), 8, 92, 10, LIGHTGRAY);
-
-    const char *modeName = (mode == MODE_ZOMBIES) ? "Zombies" : (mpVariant == MULTI_TEAM ? "Multiplayer (Teams)" : "Multiplayer (FFA)");
-    DrawText(TextFormat("Mode: %s", modeName), 8, 106, 10, LIGHTGRAY);
-    DrawText(TextFormat("Arena: %s  (< > swap, P save)", arenaName), 8, 118, 10, LIGHTGRAY);
-    DrawText(TextFormat("Score: %d   Cash: %d", player->score, player->cash), 8, 130, 10, LIGHTGRAY);
-    DrawText(TextFormat("Weapon: %s [%d]", weapon->name, ammo), 8, 142, 10, weapon->color);
-    DrawText(TextFormat("Health: %.0f", player->health), 8, 154, 10, player->health > 35 ? LIGHTGRAY : RED);
-    if (player->isDowned)
-        DrawText("Down! Hold E near a peer to revive", 8, 166, 10, RED);
+    const char *arg = "";
+    char *space = strchr(line, ' ');
+    if (space)
+    {
+        *space = '\0';
+        arg = space + 1;
+        while (*arg == ' ')
+            arg++;
+    }
 
-    if (mode == MODE_MULTIPLAYER)
+    if (strcmp(line, "arena") == 0)
     {
-        DrawText(TextFormat("Frags: %d  Deaths: %d", frags, deaths), 8, 178, 10, LIGHTGRAY);
-        if (mpVariant == MULTI_TEAM)
+        int arena = FindArena(arg);
+        if (arena < 0)
         {
-            const char *teamName = playerTeam == 0 ? "Blue" : "Gold";
-            DrawText(TextFormat("Team: %s | Score %d - %d  (H swap)", teamName, teamScores[0], teamScores[1]), 8, 190, 10, SKYBLUE);
+            snprintf(reply, cap, "err unknown arena '%s'", arg);
+            return true;
         }
+        request->arena = arena;
+        snprintf(reply, cap, "ok arena %d %s", arena, gArenaPresets[arena].name);
     }
-
-    if (sharePipTimer > 0.0f)
+    else if (strcmp(line, "mode") == 0)
     {
-        int y = (mode == MODE_MULTIPLAYER) ? 204 : 178;
-        DrawText(TextFormat("Shared %+d | %+d", sharePipCash, sharePipScore), 8, y, 10, SKYBLUE);
+        if (strcmp(arg, "zombies") == 0)
+        {
+            request->mode = MODE_ZOMBIES;
+        }
+        else if (strcmp(arg, "ffa") == 0 || strcmp(arg, "team") == 0)
+        {
+            request->mode = MODE_MULTIPLAYER;
+            request->variant = arg[0] == 't' ? MULTI_TEAM : MULTI_FFA;
+        }
+        else
+        {
+            snprintf(reply, cap, "err mode is zombies, ffa or team");
+            return true;
+        }
+        snprintf(reply, cap, "ok mode %s", arg);
     }
-    if (assistFlash > 0.0f)
+    else if (strcmp(line, "bots") == 0)
     {
-        int y = (mode == MODE_MULTIPLAYER) ? 216 : 190;
-        DrawText("Melee weaken active", 8, y, 10, ORANGE);
+        int bots = atoi(arg);
+        if (bots < 0 || bots > SOAK_MAX_BOTS)
+        {
+            snprintf(reply, cap, "err bots is 0-%d", SOAK_MAX_BOTS);
+            return true;
+        }
+        int started = StartControlBots(&session->bots, session->lan, bots);
+        if (started < bots)
+            snprintf(reply, cap, "err started=%d of %d", started, bots);
+        else
+            snprintf(reply, cap, "ok started=%d", started);
     }
-
-    int perkY = player->isDowned ? 202 : (mode == MODE_MULTIPLAYER ? 232 : 178);
-    if (quickfire)
+    else if (strcmp(line, "start") == 0 || strcmp(line, "menu") == 0 || strcmp(line, "quit") == 0)
     {
-        DrawText("Perk: Quickfire", 8, perkY, 10, ORANGE);
-        perkY += 12;
+        request->start |= line[0] == 's';
+        request->menu |= line[0] == 'm';
+        request->quit |= line[0] == 'q';
+        snprintf(reply, cap, "ok %s", line);
+    }
+    else if (strcmp(line, "trace") == 0)
+    {
+        char what[8] = "";
+        char path[128] = "profile.folded";
+        int hz = 1000;
+        sscanf(arg, "%7s", what);
+        if (strcmp(what, "start") == 0)
+        {
+            sscanf(arg, "%*s %d", &hz);
+            if (SamplerStart(hz))
+                snprintf(reply, cap, "ok trace %d Hz", hz);
+            else
+                snprintf(reply, cap, "err sampler is busy or %d Hz is invalid", hz);
+        }
+        else if (strcmp(what, "stop") == 0)
+        {
+            sscanf(arg, "%*s %127s", path);
+            if (session->traceClient >= 0)
+            {
+                snprintf(reply, cap, "err the last trace is still being written");
+                return true;
+            }
+            SamplerStop();
+            if (!SamplerWriteFoldedAsync(path))
+            {
+                snprintf(reply, cap, "err could not write %s", path);
+                return true;
+            }
+            session->traceClient = client;
+            session->traceSerial = ControlSerial(client);
+            snprintf(session->tracePath, sizeof(session->tracePath), "%s", path);
+            return false;
+        }
+        else
+        {
+            snprintf(reply, cap, "err trace start [hz] | trace stop [path]");
+        }
     }
-    if (speed)
+    else if (strcmp(line, "cvar") == 0)
     {
-        DrawText("Perk: Sprint", 8, perkY, 10, SKYBLUE);
-        perkY += 12;
+        char text[CONTROL_REPLY_BYTES - 8];
+        bool ok = CvarCommand(arg, text, sizeof(text));
+        snprintf(reply, cap, "%s %s", ok ? "ok" : "err", text);
     }
-    if (revive)
+    else
     {
-        DrawText("Perk: Revive", 8, perkY, 10, LIME);
-        perkY += 12;
+        snprintf(reply, cap, "err commands: arena mode bots start menu trace cvar stats quit");
     }
+    return true;
+}
 
-    if (mode == MODE_ZOMBIES)
+static void FormatControlStats(char *out, size_t cap, const ProfileFrame *frame, const LanState *lan, bool inMenu, GameMode mode,
+                               MultiplayerVariant variant, int arena, const ZombiesState *zombies, int frags, int deaths,
+                               const int teamScores[2], int bots)
+{
+    int peers = 0;
+    for (int i = 0; i < MAX_PEERS; i++)
+        peers += lan->peers[i].active ? 1 : 0;
+    int length = snprintf(out, cap, "ok frame=%llu frame_ms=%.2f", (unsigned long long)frame->index, frame->frameMs);
+    for (int z = 0; z < PROFILE_ZONE_COUNT && length > 0 && (size_t)length < cap; z++)
+        length += snprintf(out + length, cap - (size_t)length, " %s_ms=%.2f", ProfileZoneName((ProfileZone)z), frame->zoneMs[z]);
+    for (int c = 0; c < PROFILE_COUNTER_COUNT && length > 0 && (size_t)length < cap; c++)
+        length += snprintf(out + length, cap - (size_t)length, " %s=%u", ProfileCounterName((ProfileCounter)c), frame->counters[c]);
+    if (length > 0 && (size_t)length < cap)
+        snprintf(out + length, cap - (size_t)length,
+                 " state=%s mode=%s variant=%s arena=%d wave=%d enemies=%d frags=%d deaths=%d team_scores=%d:%d peers=%d bots=%d"
+                 " headroom=%.2f",
+                 inMenu ? "menu" : "match", mode == MODE_ZOMBIES ? "zombies" : "multiplayer", variant == MULTI_TEAM ? "team" : "ffa",
+                 arena, mode == MODE_ZOMBIES ? zombies->wave : 0, frame->activeEnemies, frags, deaths, teamScores[0],
+                 teamScores[1], peers, bots, lan->headroom);
+}
+
+// A startup allocation that does not fit its region is a budget mistake, not
+// something to limp along with: report every region's use and quit.
+static int AbortStartup(const char *what)
+{
+    printf("region: no room for %s\n", what);
+    for (int r = 0; r < MEM_REGION_COUNT; r++)
     {
-        DrawText(TextFormat("Wave %d", zombies->wave), 8, perkY + 6, 10, LIGHTGRAY);
-        DrawText(TextFormat("Active: %d", zombies->activeCount), 8, perkY + 18, 10, LIGHTGRAY);
-        DrawText("E: perk (blue), wall ammo (red), box (gold)", 8, perkY + 32, 9, LIGHTGRAY);
-        DrawText("Speed perk: teal, Revive: lime", 8, perkY + 44, 9, LIGHTGRAY);
-        DrawText("Cooldowns:", 8, perkY + 58, 9, LIGHTGRAY);
-        DrawText("Fire", 8, perkY + 70, 8, LIGHTGRAY);
-        DrawCooldownBar(32, perkY + 70, fireCooldown);
-        DrawText("Mystery", 8, perkY + 82, 8, LIGHTGRAY);
-        DrawCooldownBar(48, perkY + 82, mysteryCooldown / 5.0f);
-        DrawText("Damage", 8, perkY + 94, 8, LIGHTGRAY);
-        DrawCooldownBar(44, perkY + 94, damageCooldown);
+        RegionStats stats = RegionGetStats((MemRegion)r);
+        printf("  %-8s %zu of %zu bytes used, %u overflows\n", stats.name, stats.highWater, stats.budget, stats.overflows);
     }
+    RegionLogReport();
+    CloseWindow();
+    TaskSchedulerShutdown();
+    RegionShutdown();
+    LogShutdown();
+    return 1;
+}
 
-    if (hitMarker && hitMarker->timer > 0.0f)
+static void RegisterCvars(void)
+{
+    gCvar.sendInterval = CvarRegister(CVAR_FLOAT, "net.send_interval", 0.18f, 0.02f, 1.0f, "seconds between state broadcasts");
+    gCvar.peerTimeout = CvarRegister(CVAR_FLOAT, "net.peer_timeout", 3.0f, 0.5f, 30.0f, "seconds of silence before a peer is dropped");
+    gCvar.peerSnap = CvarRegister(CVAR_FLOAT, "net.peer_snap", 8.0f, 0.0f, 60.0f, "blend rate toward a freshly received peer position");
+    gCvar.peerSmoothing = CvarRegister(CVAR_FLOAT, "net.peer_smoothing", 6.0f, 0.0f, 60.0f, "blend rate of peer models between packets");
+    gCvar.maxFps = CvarRegister(CVAR_INT, "r.max_fps", 60.0f, 0.0f, 500.0f, "frame and simulation rate cap, 0 for none");
+    gCvar.particles = CvarRegister(CVAR_INT, "fx.particles", PARTICLE_BUDGET, 0.0f, PARTICLE_BUDGET, "live particle budget");
+    gCvar.trails = CvarRegister(CVAR_INT, "fx.trails", MAX_TRAILS, 0.0f, MAX_TRAILS, "live spit trail budget");
+    gCvar.flashlight = CvarRegister(CVAR_BOOL, "r.flashlight", 1.0f, 0.0f, 1.0f, "flashlight mask (F)");
+    gCvar.dither = CvarRegister(CVAR_BOOL, "r.dither", 0.0f, 0.0f, 1.0f, "ordered dither mask (V)");
+    gCvar.hostMargin = CvarRegister(CVAR_FLOAT, "net.host_margin", 0.25f, 0.0f, 0.9f, "fraction a challenger must beat the host's score by");
+    gCvar.hostHold = CvarRegister(CVAR_FLOAT, "net.host_hold", 5.0f, 1.0f, 120.0f, "seconds a challenger must stay ahead before hosting moves");
+    gCvar.hostMinHeadroom = CvarRegister(CVAR_FLOAT, "net.host_min_headroom", 0.2f, 0.0f, 1.0f, "spare frame budget below which a machine avoids hosting");
+    gCvar.enemyBudget = CvarRegister(CVAR_INT, "net.enemy_budget", LAN_ENEMY_BUDGET_BYTES, LAN_ENEMY_HEADER_BYTES + LAN_ENEMY_RECORD_BYTES,
+                                     LAN_ENEMY_MAX_BYTES, "bytes per enemy replication packet");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2 && strcmp(argv[1], "--decode-log") == 0)
+        return LogDecodeFile(argv[2], stdout) ? 0 : 1;
+    // u8.cfg first, then --cvar overrides, so every mode below starts from the same values.
+    RegisterCvars();
+    CvarLoadFile("u8.cfg");
+    for (int i = 1; i + 1 < argc; i++)
     {
-        float alpha = Clamp(hitMarker->timer / 0.3f, 0.0f, 1.0f);
-        Color tint = hitMarker->isKill ? RED : WHITE;
-        tint.a = (unsigned char)(alpha * 200);
-        int cx = BASE_WIDTH / 2;
-        int cy = BASE_HEIGHT / 2;
-        DrawLine(cx - 4, cy - 4, cx + 4, cy + 4, tint);
-        DrawLine(cx - 4, cy + 4, cx + 4, cy - 4, tint);
+        if (strcmp(argv[i], "--cvar") == 0)
+        {
+            char reply[96];
+            CvarCommand(argv[++i], reply, sizeof(reply));
+            printf("cvar: %s\n", reply);
+        }
     }
-
-    if (killfeed && killfeedCount > 0)
+    CvarApplyPending();
+    if (argc > 2 && strcmp(argv[1], "--balance") == 0)
     {
-        int y = 12;
-        for (int i = 0; i < killfeedCount; i++)
+        BalanceConfig config = {.sims = atoi(argv[2]), .seed = 1, .healthScale = 1.0f, .damageScale = 1.0f, .outPath = "balance.csv"};
+        for (int i = 3; i + 1 < argc; i += 2)
         {
-            if (killfeed[i].timer <= 0.0f)
-                continue;
-            Color tint = killfeed[i].color;
-            DrawText(killfeed[i].text, BASE_WIDTH - 132, y, 9, tint);
-            y += 12;
+            if (strcmp(argv[i], "--out") == 0)
+                config.outPath = argv[i + 1];
+            else if (strcmp(argv[i], "--seed") == 0)
+                config.seed = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+            else if (strcmp(argv[i], "--health-scale") == 0)
+                config.healthScale = (float)atof(argv[i + 1]);
+            else if (strcmp(argv[i], "--damage-scale") == 0)
+                config.damageScale = (float)atof(argv[i + 1]);
         }
+        return RunBalance(&config);
     }
-
-    DrawText("Peers:", 8, BASE_HEIGHT - 48, 9, LIGHTGRAY);
-    int peerLine = BASE_HEIGHT - 36;
-        for (int i = 0; i < MAX_PEERS; i++)
+    if (argc > 2 && strcmp(argv[1], "--soak") == 0)
+    {
+        SoakConfig config = {.hours = atof(argv[2]), .sampleSeconds = 60.0f, .driftPercent = 25.0f, .bots = 4, .outPath = "soak.csv"};
+        for (int i = 3; i + 1 < argc; i += 2)
         {
-            if (!lan->peers[i].active)
-                continue;
-            const char *name = lan->peers[i].name[0] ? lan->peers[i].name : "Peer";
-            const char *status = lan->peers[i].isDowned ? "DOWN" : (lan->peers[i].isReviving ? "REV" : "OK");
-            const char *teamTag = (mode == MODE_MULTIPLAYER && lan->peers[i].teamMode) ? (lan->peers[i].team == 0 ? "B" : "G") : "-";
-            DrawText(TextFormat("%s: %s H%.0f $%d S%d W%d A%d T%s",
-                               name,
-                               status,
-                               lan->peers[i].health,
-                               lan->peers[i].cash,
-                               lan->peers[i].score,
-                               lan->peers[i].weaponIndex + 1,
-                               lan->peers[i].ammo,
-                               teamTag),
-                     8,
-                     peerLine,
-                     9,
-                 LIGHTGRAY);
-        peerLine += 10;
-        DrawText(TextFormat("perks: %s%s%s", lan->peers[i].perkQuickfire ? "Q" : "-", lan->peers[i].perkSpeed ? "S" : "-", lan->peers[i].perkRevive ? "R" : "-"), 12, peerLine, 8, DARKGRAY);
-        peerLine += 10;
+            if (strcmp(argv[i], "--out") == 0)
+                config.outPath = argv[i + 1];
+            else if (strcmp(argv[i], "--bots") == 0)
+                config.bots = atoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--sample") == 0)
+                config.sampleSeconds = (float)atof(argv[i + 1]);
+            else if (strcmp(argv[i], "--drift") == 0)
+                config.driftPercent = (float)atof(argv[i + 1]);
+            else if (strcmp(argv[i], "--train-lan-models") == 0)
+                config.lanModelPath = argv[i + 1];
+        }
+        LogInit("u8_log.bin");
+        // The soak drives every LAN packet kind for hours, which makes it a
+        // convenient source of traffic for the codec priors.
+        if (config.lanModelPath)
+            LanCodecTrainBegin();
+        int status = RunSoak(&config);
+        if (config.lanModelPath && !LanCodecWritePriors(config.lanModelPath))
+            printf("soak: could not write %s\n", config.lanModelPath);
+        LogShutdown();
+        return status;
     }
-}
 
-int main(int argc, char **argv)
-{
+    LogInit("u8_log.bin");
+    if (!RegionInit())
+        return 1;
+
     SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_MSAA_4X_HINT | FLAG_VSYNC_HINT);
     InitWindow(BASE_WIDTH * PIXEL_SCALE, BASE_HEIGHT * PIXEL_SCALE, "U8 FPS Prototype");
     InitAudioDevice();
-    SetTargetFPS(60);
+    SetTargetFPS(CvarInt(gCvar.maxFps));
     DisableCursor();
 
     Camera3D camera = {
@@ -1739,13 +5011,8 @@ int main(int argc, char **argv)
     camera.position = SelectSafeSpawn(&gArenaPresets[0]);
     camera.target = Vector3Add(camera.position, (Vector3){0.0f, 0.0f, -1.0f});
 
-    Weapon weapons[] = {
-        {.name = "Pistol", .damage = 18.0f, .fireRate = 3.5f, .recoil = 0.012f, .spread = 0.01f, .range = 40.0f, .color = ORANGE, .maxAmmo = 64},
-        {.name = "SMG", .damage = 12.0f, .fireRate = 9.0f, .recoil = 0.008f, .spread = 0.018f, .range = 35.0f, .color = SKYBLUE, .maxAmmo = 160},
-        {.name = "Rifle", .damage = 24.0f, .fireRate = 6.0f, .recoil = 0.02f, .spread = 0.012f, .range = 50.0f, .color = LIME, .maxAmmo = 120},
-        {.name = "Shotgun", .damage = 55.0f, .fireRate = 1.1f, .recoil = 0.06f, .spread = 0.04f, .range = 20.0f, .color = YELLOW, .maxAmmo = 48},
-        {.name = "LMG", .damage = 16.0f, .fireRate = 7.0f, .recoil = 0.03f, .spread = 0.02f, .range = 45.0f, .color = RED, .maxAmmo = 220},
-    };
+    Weapon weapons[sizeof(gWeapons) / sizeof(gWeapons[0])];
+    memcpy(weapons, gWeapons, sizeof(weapons));
 
     int weaponIndex = 0;
     float fireCooldown = 0.0f;
@@ -1754,17 +5021,71 @@ int main(int argc, char **argv)
     GameMode mode = MODE_MULTIPLAYER;
     MultiplayerVariant mpVariant = MULTI_FFA;
     int playerTeam = 0;
-    if (argc > 1 && strcmp(argv[1], "--zombies") == 0)
-    {
-        mode = MODE_ZOMBIES;
-    }
-    else if (argc > 1 && strcmp(argv[1], "--team") == 0)
+    float hitchFactor = 2.0f;
+    int workerCount = 0;
+    const char *lanModelPath = NULL;
+    int profileHz = 0;
+    const char *statsdAddress = NULL;
+    bool telemetryOn = false;
+    const char *controlPath = NULL;
+    for (int i = 1; i < argc; i++)
     {
-        mode = MODE_MULTIPLAYER;
-        mpVariant = MULTI_TEAM;
+        if (strcmp(argv[i], "--zombies") == 0)
+        {
+            mode = MODE_ZOMBIES;
+        }
+        else if (strcmp(argv[i], "--team") == 0)
+        {
+            mode = MODE_MULTIPLAYER;
+            mpVariant = MULTI_TEAM;
+        }
+        else if (strcmp(argv[i], "--hitch-factor") == 0 && i + 1 < argc)
+        {
+            hitchFactor = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+        {
+            workerCount = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--train-lan-models") == 0 && i + 1 < argc)
+        {
+            lanModelPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--pmu") == 0)
+        {
+            static const char *pmuModes[] = {"off", "hardware", "software", "rusage"};
+            printf("pmu: %s counters\n", pmuModes[ProfileEnablePmu()]);
+        }
+        else if (strcmp(argv[i], "--profile-hz") == 0 && i + 1 < argc)
+        {
+            profileHz = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--statsd") == 0 && i + 1 < argc)
+        {
+            statsdAddress = argv[++i];
+        }
+        else if (strcmp(argv[i], "--telemetry") == 0)
+        {
+            telemetryOn = true;
+        }
+        else if (strcmp(argv[i], "--control") == 0 && i + 1 < argc)
+        {
+            controlPath = argv[++i];
+        }
     }
-
-    ZombiesState zombies;
+    if (lanModelPath)
+        LanCodecTrainBegin();
+
+    static HitchRecorder hitches;
+    HitchInit(&hitches, 1000.0f / 60.0f, hitchFactor);
+    TaskSchedulerInit(workerCount);
+
+    ZombiesState zombies = {0};
+    zombies.enemies = (Enemy *)RegionAlloc(MEM_REGION_SIM, sizeof(Enemy) * MAX_ENEMIES);
+    if (!zombies.enemies)
+        return AbortStartup("enemies");
+    zombies.enemyCapacity = MAX_ENEMIES;
+    zombies.rng = (uint32_t)GetRandomValue(1, 0x7FFFFFFF);
     ResetZombies(&zombies);
 
     PlayerState player;
@@ -1779,19 +5100,34 @@ int main(int argc, char **argv)
     bool nameLocked = false;
     bool inMenu = true;
 
-    LanState lan;
-    InitLan(&lan);
+    LanState *lan = (LanState *)RegionAlloc(MEM_REGION_NETWORK, sizeof(LanState));
+    if (!lan)
+        return AbortStartup("LAN state");
+    InitLan(lan);
 
     RenderTexture2D renderTarget = LoadRenderTexture(BASE_WIDTH, BASE_HEIGHT);
     Image flashImg = GenImageColor(1, 1, WHITE);
     Texture2D flashTex = LoadTextureFromImage(flashImg);
     UnloadImage(flashImg);
-    Decal decals[MAX_DECALS] = {0};
-    int decalIndex = 0;
-    DissolveFX dissolves[MAX_DISSOLVES] = {0};
-    int dissolveIndex = 0;
-    TrailFX trails[MAX_TRAILS] = {0};
-    int trailIndex = 0;
+    static FxStore fx;
+    InitFxStore(&fx);
+    static ParticleSystem particles;
+    if (!ParticlesInit(&particles, MEM_REGION_FX, PARTICLE_BUDGET))
+        return AbortStartup("particles");
+    ParticlesSetLimit(&particles, CvarInt(gCvar.particles));
+    static InfluenceMap influence;
+    if (!InfluenceInit(&influence, MEM_REGION_SIM))
+        return AbortStartup("influence maps");
+    static OcclusionBuffer occlusion;
+    if (!OcclusionInit(&occlusion, MEM_REGION_RENDER))
+        return AbortStartup("the occlusion buffer");
+    static LowPolySet lowPoly;
+    if (!LowPolyInit(&lowPoly, MEM_REGION_RENDER))
+        return AbortStartup("low-poly models");
+    static VatSet vat;
+    if (!VatInit(&vat, MEM_REGION_RENDER))
+        return AbortStartup("vertex animation");
+    int modelArena = -1;
     Flash flash = {0};
     HitMarker hitMarker = {0};
     KillfeedEntry killfeed[5] = {0};
@@ -1819,8 +5155,6 @@ int main(int argc, char **argv)
     bool speedPerk = false;
     bool revivePerk = false;
     bool wallBuyed = false;
-    bool flashlightOn = true;
-    bool ditherOn = false;
     float mysteryCooldown = 0.0f;
     float mysteryRollTimer = 0.0f;
     int mysteryRollsLeft = 0;
@@ -1840,9 +5174,172 @@ int main(int argc, char **argv)
     float sharePipTimer = 0.0f;
     int sharePipCash = 0;
     int sharePipScore = 0;
-
+    bool showTaskGraph = false;
+    static ProfileFrame lastProfileFrame;
+
+    static FrameContext frameCtx;
+    frameCtx.camera = &camera;
+    frameCtx.lan = lan;
+    frameCtx.player = &player;
+    frameCtx.zombies = &zombies;
+    frameCtx.arenaIndex = &arenaIndex;
+    frameCtx.weaponIndex = &weaponIndex;
+    frameCtx.quickfirePerk = &quickfirePerk;
+    frameCtx.speedPerk = &speedPerk;
+    frameCtx.revivePerk = &revivePerk;
+    frameCtx.mpVariant = &mpVariant;
+    frameCtx.playerTeam = &playerTeam;
+    frameCtx.playerName = playerName;
+    frameCtx.pendingCashShare = &pendingCashShare;
+    frameCtx.pendingScoreShare = &pendingScoreShare;
+    frameCtx.sharePipTimer = &sharePipTimer;
+    frameCtx.sharePipCash = &sharePipCash;
+    frameCtx.sharePipScore = &sharePipScore;
+    frameCtx.pendingRay = &pendingRay;
+    frameCtx.pendingEvent = &pendingEvent;
+    frameCtx.eventCounter = &eventCounter;
+    frameCtx.fx = &fx;
+    frameCtx.particles = &particles;
+    frameCtx.influence = &influence;
+    frameCtx.weapons = weapons;
+    frameCtx.weaponCount = (int)(sizeof(weapons) / sizeof(weapons[0]));
+
+    static EventBus events;
+    EventBusInit(&events);
+    static PredictionBuffer prediction;
+    PredictReset(&prediction);
+    frameCtx.events = &events;
+    AudioSink audioSink = {hitSound, killSound, feedSound, perkSound, boxSound, reviveSound, downSound};
+    HudSink hudSink = {&hitMarker, killfeed, killfeedCount, &sharePipTimer, &sharePipCash, &sharePipScore};
+    NetSink netSink = {&pendingCashShare, &pendingScoreShare, &pendingRay, &damageCounter, &pendingEvent};
+    StatsSink statsSink = {&player, &mpVariant, &fragCount, &deathCount, teamScores};
+    EventBusSubscribe(&events, "audio", AudioConsumeEvents, &audioSink);
+    EventBusSubscribe(&events, "hud", HudConsumeEvents, &hudSink);
+    EventBusSubscribe(&events, "net", NetConsumeEvents, &netSink);
+    EventBusSubscribe(&events, "stats", StatsConsumeEvents, &statsSink);
+    EventBusSubscribe(&events, "particles", ParticleConsumeEvents, &particles);
+    EventBusSubscribe(&events, "influence", InfluenceConsumeEvents, &influence);
+
+    // LAN, FX aging and particles start together; zombies wait on LAN because both touch
+    // the player, trails wait on zombies (spitters push them), and the peer
+    // label model only needs fresh peer state.
+    static TaskGraph frameGraph;
+    TaskGraphInit(&frameGraph);
+    int lanTask = TaskGraphAdd(&frameGraph, "lan", FrameTaskLan, &frameCtx);
+    TaskGraphAdd(&frameGraph, "fx", FrameTaskFx, &frameCtx);
+    TaskGraphAdd(&frameGraph, "particles", FrameTaskParticles, &frameCtx);
+    int zombiesTask = TaskGraphAdd(&frameGraph, "zombies", FrameTaskZombies, &frameCtx);
+    TaskGraphDepend(&frameGraph, zombiesTask, lanTask);
+    int trailsTask = TaskGraphAdd(&frameGraph, "trails", FrameTaskTrails, &frameCtx);
+    TaskGraphDepend(&frameGraph, trailsTask, zombiesTask);
+    int influenceTask = TaskGraphAdd(&frameGraph, "influence", FrameTaskInfluence, &frameCtx);
+    TaskGraphDepend(&frameGraph, influenceTask, zombiesTask);
+    int labelsTask = TaskGraphAdd(&frameGraph, "peer_labels", FrameTaskPeerLabels, &frameCtx);
+    TaskGraphDepend(&frameGraph, labelsTask, lanTask);
+
+    if (profileHz > 0 && !SamplerStart(profileHz))
+        printf("profiler: could not arm the SIGPROF timer\n");
+    static GameMetrics gameMetrics;
+    static CvarConsole console;
+    uint32_t telemetryHitches = 0;
+    if (telemetryOn && !TelemetryOpen(TELEMETRY_SHM_NAME))
+    {
+        printf("telemetry: could not create %s\n", TELEMETRY_SHM_NAME);
+        telemetryOn = false;
+    }
+    static ControlSession control = {.traceClient = -1};
+    control.lan = lan;
+    MatchRequest request;
+    ClearMatchRequest(&request);
+    if (controlPath && !ControlOpen(controlPath))
+    {
+        if (errno == EADDRINUSE)
+            printf("control: %s is already in use\n", controlPath);
+        else
+            printf("control: could not listen on %s\n", controlPath);
+    }
+    if (statsdAddress)
+    {
+        RegisterGameMetrics(&gameMetrics);
+        CvarExportMetrics();
+        if (!MetricsStart(statsdAddress, 5.0f))
+            printf("statsd: could not resolve %s\n", statsdAddress);
+    }
     while (!WindowShouldClose())
     {
+        uint64_t controlZone = ProfileZoneBegin();
+        char controlLine[CONTROL_LINE_BYTES];
+        int controlClient;
+        for (int n = 0; n < CONTROL_COMMANDS_PER_FRAME && (controlClient = ControlPoll(controlLine, sizeof(controlLine))) >= 0; n++)
+        {
+            char reply[CONTROL_REPLY_BYTES];
+            bool ready = true;
+            if (strcmp(controlLine, "stats") == 0)
+                FormatControlStats(reply, sizeof(reply), &lastProfileFrame, lan, inMenu, mode, mpVariant, arenaIndex, &zombies,
+                                   fragCount, deathCount, teamScores, CountOnlineBots(&control.bots));
+            else
+                ready = RunControlCommand(&control, controlClient, controlLine, &request, reply, sizeof(reply));
+            if (ready)
+                ControlReply(controlClient, reply);
+        }
+        FinishControlTrace(&control);
+        ProfileZoneEnd(PROFILE_ZONE_CONTROL, controlZone);
+        if (request.quit)
+            break;
+        if (CvarApplyPending() > 0)
+        {
+            SetTargetFPS(CvarInt(gCvar.maxFps));
+            ParticlesSetLimit(&particles, CvarInt(gCvar.particles));
+        }
+        if (request.mode >= 0 && request.mode != (int)mode)
+        {
+            mode = (GameMode)request.mode;
+            ResetPlayer(&player);
+            ResetZombies(&zombies);
+            fragCount = 0;
+            deathCount = 0;
+            teamScores[0] = teamScores[1] = 0;
+        }
+        if (request.variant >= 0 && request.variant != (int)mpVariant)
+        {
+            mpVariant = (MultiplayerVariant)request.variant;
+            fragCount = 0;
+            deathCount = 0;
+            teamScores[0] = teamScores[1] = 0;
+        }
+        if (request.arena >= 0)
+        {
+            arenaIndex = request.arena;
+            propSpotCount = gArenaPresets[arenaIndex].spotCount;
+            memcpy(propSpots, gArenaPresets[arenaIndex].spots, sizeof(PropSpot) * propSpotCount);
+            LoadPresetOverride(gArenaPresets[arenaIndex].name, propSpots, &propSpotCount);
+            camera.position = SelectSafeSpawn(&gArenaPresets[arenaIndex]);
+        }
+        if (request.start)
+        {
+            inMenu = false;
+            nameLocked = true;
+            ResetPlayer(&player);
+            ResetZombies(&zombies);
+            fragCount = 0;
+            deathCount = 0;
+            teamScores[0] = teamScores[1] = 0;
+            InfluenceReset(&influence);
+            lan->joinSynced = false;
+            lan->joinStartedAt = GetTime();
+            lan->joinRequestAt = 0.0;
+            TransferReset(&lan->joinRx);
+            for (int i = 0; i < (int)(sizeof(weaponAmmo) / sizeof(weaponAmmo[0])); i++)
+                weaponAmmo[i] = weapons[i].maxAmmo;
+            camera.position = SelectSafeSpawn(&gArenaPresets[arenaIndex]);
+            camera.target = Vector3Add(camera.position, (Vector3){0.0f, 0.0f, -1.0f});
+        }
+        if (request.menu)
+            inMenu = true;
+        ClearMatchRequest(&request);
+        ProfileBeginFrame();
+        RegionResetScratch();
+        TickControlBots(&control.bots, GetTime());
         float dt = GetFrameTime();
         if (player.damageCooldown > 0.0f)
             player.damageCooldown -= dt;
@@ -1858,60 +5355,74 @@ int main(int argc, char **argv)
             if (killfeed[i].timer > 0.0f)
                 killfeed[i].timer -= dt;
 
+        double respawnNow = LanMatchTime(lan, GetTime());
         for (int i = 0; i < MAX_PEERS; i++)
         {
-            if (!lan.peers[i].active)
+            if (!lan->peers[i].active)
                 continue;
-            if (!lan.peers[i].teamMode && lan.peers[i].addr.sin_addr.s_addr != 0)
+            if (!lan->peers[i].teamMode && lan->peers[i].addr.sin_addr.s_addr != 0)
             {
-                unsigned int addr = ntohl(lan.peers[i].addr.sin_addr.s_addr);
-                lan.peers[i].team = (addr & 0xFFu) % 2;
+                unsigned int addr = ntohl(lan->peers[i].addr.sin_addr.s_addr);
+                lan->peers[i].team = (addr & 0xFFu) % 2;
             }
-            if (lan.peers[i].respawnTimer > 0.0f)
+            // A host change can pull match time backwards; never hold a peer longer than the delay.
+            if (lan->peers[i].respawning &&
+                (respawnNow >= lan->peers[i].respawnAt || lan->peers[i].respawnAt - respawnNow > 1.5))
             {
-                lan.peers[i].respawnTimer -= dt;
-                if (lan.peers[i].respawnTimer <= 0.0f)
-                {
-                    lan.peers[i].respawnTimer = 0.0f;
-                    lan.peers[i].health = PLAYER_MAX_HEALTH;
-                    lan.peers[i].renderPos = SelectSafeSpawn(&gArenaPresets[arenaIndex]);
-                }
+                lan->peers[i].respawning = false;
+                lan->peers[i].health = PLAYER_MAX_HEALTH;
+                lan->peers[i].renderPos = SelectSafeSpawn(&gArenaPresets[arenaIndex]);
             }
         }
 
-        int key = GetCharPressed();
-        while (key > 0)
-        {
-            if (!nameLocked && playerNameLen < MAX_NAME_LEN - 1 && key >= 32 && key <= 125)
-            {
-                playerName[playerNameLen++] = (char)key;
-                playerName[playerNameLen] = '\0';
-            }
-            key = GetCharPressed();
-        }
-        if (!nameLocked && IsKeyPressed(KEY_BACKSPACE) && playerNameLen > 0)
-        {
-            playerName[--playerNameLen] = '\0';
-        }
-        if (IsKeyPressed(KEY_ENTER))
-        {
-            nameLocked = !nameLocked;
-        }
-        if (IsKeyPressed(KEY_M))
-        {
-            gAudioEnabled = !gAudioEnabled;
-        }
-        if (IsKeyPressed(KEY_C))
+        if (IsKeyPressed(KEY_GRAVE))
         {
-            lan.useChecksum = !lan.useChecksum;
+            console.open = !console.open;
         }
-        if (IsKeyPressed(KEY_F))
+        if (console.open)
         {
-            flashlightOn = !flashlightOn;
+            UpdateCvarConsole(&console);
         }
-        if (IsKeyPressed(KEY_V))
+        else
         {
-            ditherOn = !ditherOn;
+            int key = GetCharPressed();
+            while (key > 0)
+            {
+                if (!nameLocked && playerNameLen < MAX_NAME_LEN - 1 && key >= 32 && key <= 125)
+                {
+                    playerName[playerNameLen++] = (char)key;
+                    playerName[playerNameLen] = '\0';
+                }
+                key = GetCharPressed();
+            }
+            if (!nameLocked && IsKeyPressed(KEY_BACKSPACE) && playerNameLen > 0)
+            {
+                playerName[--playerNameLen] = '\0';
+            }
+            if (IsKeyPressed(KEY_ENTER))
+            {
+                nameLocked = !nameLocked;
+            }
+            if (IsKeyPressed(KEY_M))
+            {
+                gAudioEnabled = !gAudioEnabled;
+            }
+            if (IsKeyPressed(KEY_C))
+            {
+                lan->useChecksum = !lan->useChecksum;
+            }
+            if (IsKeyPressed(KEY_F))
+            {
+                CvarSet(gCvar.flashlight, CvarBool(gCvar.flashlight) ? "off" : "on");
+            }
+            if (IsKeyPressed(KEY_V))
+            {
+                CvarSet(gCvar.dither, CvarBool(gCvar.dither) ? "off" : "on");
+            }
+            if (IsKeyPressed(KEY_F3))
+            {
+                showTaskGraph = !showTaskGraph;
+            }
         }
 
         if (inMenu)
@@ -1952,7 +5463,7 @@ int main(int argc, char **argv)
             buttons[buttonCount].rect = (Rectangle){x, y, w, h};
             snprintf(buttons[buttonCount].label,
                      sizeof(buttons[buttonCount].label),
-                     "Checksum: %s", lan.useChecksum ? "enabled" : "off");
+                     "Checksum: %s", lan->useChecksum ? "enabled" : "off");
             buttonCount++;
             y += h + 6.0f;
 
@@ -2010,7 +5521,7 @@ int main(int argc, char **argv)
             buttons[buttonCount].rect = (Rectangle){x, y, w, h};
             snprintf(buttons[buttonCount].label,
                      sizeof(buttons[buttonCount].label),
-                     "Flashlight: %s", flashlightOn ? "on" : "off");
+                     "Flashlight: %s", CvarBool(gCvar.flashlight) ? "on" : "off");
             buttonCount++;
             y += h + 6.0f;
 
@@ -2018,7 +5529,7 @@ int main(int argc, char **argv)
             buttons[buttonCount].rect = (Rectangle){x, y, w, h};
             snprintf(buttons[buttonCount].label,
                      sizeof(buttons[buttonCount].label),
-                     "Dither: %s", ditherOn ? "on" : "off");
+                     "Dither: %s", CvarBool(gCvar.dither) ? "on" : "off");
             buttonCount++;
             y += h + 10.0f;
 
@@ -2047,9 +5558,9 @@ int main(int argc, char **argv)
                 menuSelection = (menuSelection - 1 + buttonCount) % buttonCount;
             }
 
-            bool left = IsKeyPressed(KEY_LEFT);
-            bool right = IsKeyPressed(KEY_RIGHT);
-            bool activate = IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE);
+            bool left = !console.open && IsKeyPressed(KEY_LEFT);
+            bool right = !console.open && IsKeyPressed(KEY_RIGHT);
+            bool activate = !console.open && (IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE));
 
             switch (buttons[menuSelection].action)
             {
@@ -2063,27 +5574,15 @@ int main(int argc, char **argv)
                 break;
             case MENU_ACTION_CHECKSUM:
                 if (activate || left || right)
-                    lan.useChecksum = !lan.useChecksum;
+                    lan->useChecksum = !lan->useChecksum;
                 break;
             case MENU_ACTION_MODE:
                 if (activate || left || right)
-                {
-                    mode = (mode == MODE_MULTIPLAYER) ? MODE_ZOMBIES : MODE_MULTIPLAYER;
-                    ResetPlayer(&player);
-                    ResetZombies(&zombies);
-                    fragCount = 0;
-                    deathCount = 0;
-                    teamScores[0] = teamScores[1] = 0;
-                }
+                    request.mode = (mode == MODE_MULTIPLAYER) ? MODE_ZOMBIES : MODE_MULTIPLAYER;
                 break;
             case MENU_ACTION_VARIANT:
                 if (mode == MODE_MULTIPLAYER && (activate || left || right))
-                {
-                    mpVariant = (mpVariant == MULTI_FFA) ? MULTI_TEAM : MULTI_FFA;
-                    fragCount = 0;
-                    deathCount = 0;
-                    teamScores[0] = teamScores[1] = 0;
-                }
+                    request.variant = (mpVariant == MULTI_FFA) ? MULTI_TEAM : MULTI_FFA;
                 break;
             case MENU_ACTION_TEAM:
                 if (mpVariant == MULTI_TEAM && (activate || left || right))
@@ -2091,20 +5590,9 @@ int main(int argc, char **argv)
                 break;
             case MENU_ACTION_ARENA:
                 if (left)
-                {
-                    arenaIndex = (arenaIndex - 1 + MAX_ARENAS) % MAX_ARENAS;
-                }
+                    request.arena = (arenaIndex - 1 + MAX_ARENAS) % MAX_ARENAS;
                 else if (right || activate)
-                {
-                    arenaIndex = (arenaIndex + 1) % MAX_ARENAS;
-                }
-                if (left || right || activate)
-                {
-                    propSpotCount = gArenaPresets[arenaIndex].spotCount;
-                    memcpy(propSpots, gArenaPresets[arenaIndex].spots, sizeof(PropSpot) * propSpotCount);
-                    LoadPresetOverride(gArenaPresets[arenaIndex].name, propSpots, &propSpotCount);
-                    camera.position = SelectSafeSpawn(&gArenaPresets[arenaIndex]);
-                }
+                    request.arena = (arenaIndex + 1) % MAX_ARENAS;
                 break;
             case MENU_ACTION_SAVE:
                 if (activate)
@@ -2112,27 +5600,15 @@ int main(int argc, char **argv)
                 break;
             case MENU_ACTION_FLASHLIGHT:
                 if (activate || left || right)
-                    flashlightOn = !flashlightOn;
+                    CvarSet(gCvar.flashlight, CvarBool(gCvar.flashlight) ? "off" : "on");
                 break;
             case MENU_ACTION_DITHER:
                 if (activate || left || right)
-                    ditherOn = !ditherOn;
+                    CvarSet(gCvar.dither, CvarBool(gCvar.dither) ? "off" : "on");
                 break;
             case MENU_ACTION_SPAWN:
                 if (activate)
-                {
-                    inMenu = false;
-                    nameLocked = true;
-                    ResetPlayer(&player);
-                    ResetZombies(&zombies);
-                    fragCount = 0;
-                    deathCount = 0;
-                    teamScores[0] = teamScores[1] = 0;
-                    for (int i = 0; i < (int)(sizeof(weaponAmmo) / sizeof(weaponAmmo[0])); i++)
-                        weaponAmmo[i] = weapons[i].maxAmmo;
-                    camera.position = SelectSafeSpawn(&gArenaPresets[arenaIndex]);
-                    camera.target = Vector3Add(camera.position, (Vector3){0.0f, 0.0f, -1.0f});
-                }
+                    request.start = true;
                 break;
             }
 
@@ -2151,12 +5627,13 @@ int main(int argc, char **argv)
             DrawText("Zombies: E uses perks/box/wall, hold E near peers to revive.", 32, 274, 10, LIGHTGRAY);
             DrawText("Multiplayer: frag for score; in teams use the Team button to swap.", 32, 288, 10, LIGHTGRAY);
             EndDrawing();
+            ProfileEndFrame(NULL);
             continue;
         }
 
         Vector2 peerLabels[MAX_PEERS] = {0};
         bool peerLabelVisible[MAX_PEERS] = {0};
-        char peerLabelText[MAX_PEERS][48] = {0};
+        char (*peerLabelText)[48] = (char (*)[48])RegionAlloc(MEM_REGION_SCRATCH, sizeof(char[MAX_PEERS][48]));
 
         if (mode == MODE_MULTIPLAYER && playerRespawnTimer > 0.0f)
         {
@@ -2179,7 +5656,7 @@ int main(int argc, char **argv)
             }
         }
 
-        bool canAct = !player.isDowned && playerRespawnTimer <= 0.0f;
+        bool canAct = !player.isDowned && playerRespawnTimer <= 0.0f && !console.open;
         float moveScale = 1.0f;
         if (speedPerk)
             moveScale += 0.35f;
@@ -2190,7 +5667,21 @@ int main(int argc, char **argv)
         bool wasDown = player.isDowned;
         bool isZombies = (mode == MODE_ZOMBIES);
 
-        UpdateCameraLean(&camera, &viewAngles, dt, recoilKick, moveScale, canAct);
+        Vector3 correctionStep = PredictCorrectionStep(&prediction, dt);
+        camera.position = Vector3Add(camera.position, correctionStep);
+        // Respawns, arena swaps and the respawn drift move the camera outside the input stream.
+        Vector3 lastPredicted;
+        if (PredictLatest(&prediction, &lastPredicted) &&
+            Vector3Distance(Vector3Add(camera.position, prediction.correction), lastPredicted) > 0.01f)
+        {
+            PredictReset(&prediction);
+            lan->moveTeleport = true;
+        }
+        MoveInput moveInput = UpdateCameraLean(&camera, &viewAngles, dt, recoilKick, moveScale, canAct);
+        lan->movePosition = Vector3Add(camera.position, prediction.correction);
+        lan->moveSeq = PredictRecord(&prediction, &moveInput, lan->movePosition);
+        lan->moveElapsed += dt;
+        lan->moveReady = true;
         recoilKick = Lerp(recoilKick, 0.0f, dt * 8.0f);
         if (flash.timer > 0.0f)
             flash.timer -= dt;
@@ -2208,51 +5699,93 @@ int main(int argc, char **argv)
         }
 
         double now = GetTime();
-        int currentAmmo = weaponAmmo[weaponIndex];
-        UpdateLan(&lan,
-                  dt,
-                  camera.position,
-                  weaponIndex,
-                  currentAmmo,
-                  &player,
-                  quickfirePerk,
-                  speedPerk,
-                  revivePerk,
-                  mpVariant,
-                  playerTeam,
-                  playerName,
-                  now,
-                  &pendingCashShare,
-                  &pendingScoreShare,
-                  &sharePipTimer,
-                  &sharePipCash,
-                  &sharePipScore,
-                  &pendingRay,
-                  mode == MODE_MULTIPLAYER,
-                  &pendingEvent,
-                  &eventCounter);
-
-        if (lan.hasIncomingEvent)
-        {
-            LanEvent evt = lan.incomingEvent;
-            lan.hasIncomingEvent = false;
-            char actor[LAN_NAME_BYTES + 4] = {0};
-            char target[LAN_NAME_BYTES + 4] = {0};
-            strncpy(actor, evt.actor[0] ? evt.actor : "Peer", sizeof(actor) - 1);
-            strncpy(target, evt.target[0] ? evt.target : "opponent", sizeof(target) - 1);
-            if (evt.kind == 1)
+        frameCtx.dt = dt;
+        frameCtx.now = now;
+        frameCtx.matchNow = LanMatchTime(lan, now);
+        frameCtx.isZombies = isZombies;
+        frameCtx.allowDamageBursts = mode == MODE_MULTIPLAYER;
+        frameCtx.currentAmmo = weaponAmmo[weaponIndex];
+        frameCtx.peerLabels = peerLabels;
+        frameCtx.peerLabelVisible = peerLabelVisible;
+        frameCtx.peerLabelText = peerLabelText;
+        TaskGraphRun(&frameGraph);
+        ReapFx(&fx);
+        if (lan->hasMoveAck)
+        {
+            lan->hasMoveAck = false;
+            PredictReconcile(&prediction, lan->moveAckSeq, lan->moveAckPosition, lan->moveAckForced);
+        }
+        for (int i = 0; i < MAX_PEERS; i++)
+        {
+            Peer *p = &lan->peers[i];
+            if (!p->active || !p->joinRequested)
+                continue;
+            uint8_t *blob = (uint8_t *)RegionAlloc(MEM_REGION_SCRATCH, TRANSFER_MAX_BYTES);
+            if (!blob)
+                break;
+            size_t blobSize = BuildJoinSnapshot(blob,
+                                                lan,
+                                                i,
+                                                mode,
+                                                mpVariant,
+                                                arenaIndex,
+                                                LayoutHash(propSpots, propSpotCount),
+                                                &zombies,
+                                                teamScores,
+                                                &player,
+                                                playerName,
+                                                playerTeam,
+                                                frameCtx.matchNow);
+            TransferBegin(&p->joinTx, ++lan->transferId, blob, blobSize, now);
+            p->joinRequested = false;
+        }
+        if (lan->hasJoinState)
+        {
+            JoinSnapshot join = lan->joinState;
+            lan->hasJoinState = false;
+            if (join.mode == mode)
             {
-                char buf[64];
-                snprintf(buf, sizeof(buf), "%s fragged %s", actor, target);
-                PushKillfeedSfx(killfeed, killfeedCount, buf, ORANGE, feedSound);
-                if (mpVariant == MULTI_TEAM && evt.team >= 0 && evt.team < 2)
-                    teamScores[evt.team]++;
+                if (join.arenaIndex != arenaIndex && join.arenaIndex < MAX_ARENAS)
+                {
+                    arenaIndex = join.arenaIndex;
+                    propSpotCount = gArenaPresets[arenaIndex].spotCount;
+                    memcpy(propSpots, gArenaPresets[arenaIndex].spots, sizeof(PropSpot) * propSpotCount);
+                    LoadPresetOverride(gArenaPresets[arenaIndex].name, propSpots, &propSpotCount);
+                    camera.position = SelectSafeSpawn(&gArenaPresets[arenaIndex]);
+                    camera.target = Vector3Add(camera.position, (Vector3){0.0f, 0.0f, -1.0f});
+                }
+                if (LayoutHash(propSpots, propSpotCount) != join.layoutHash)
+                    LogWrite(LOG_LAN_JOIN_LAYOUT_MISMATCH, arenaIndex);
+                if (mode == MODE_ZOMBIES && join.wave > zombies.wave)
+                {
+                    zombies.wave = join.wave;
+                    zombies.waveTimer = join.waveTimer;
+                    zombies.waveStartedAt = frameCtx.matchNow - join.waveTimer;
+                    zombies.waveClockStarted = true;
+                }
+                // Late joiners start from the poorest player's cash rather than zero.
+                if (mode == MODE_ZOMBIES && player.cash < join.cashFloor)
+                    player.cash = join.cashFloor;
+                if (mode == MODE_MULTIPLAYER && join.variant == mpVariant)
+                {
+                    teamScores[0] = join.teamScores[0];
+                    teamScores[1] = join.teamScores[1];
+                }
             }
-            else if (evt.kind == 2)
+            LogWrite(LOG_LAN_JOIN_SYNCED, join.wave, (int)join.bytes, join.elapsed * 1000.0);
+        }
+
+        if (lan->hasIncomingEvent)
+        {
+            LanEvent evt = lan->incomingEvent;
+            lan->hasIncomingEvent = false;
+            GameEvent *feed = EventBusPush(&events, GAME_EVENT_LAN_FEED);
+            if (feed)
             {
-                char buf[64];
-                snprintf(buf, sizeof(buf), "%s assisted %s", actor, target);
-                PushKillfeedSfx(killfeed, killfeedCount, buf, SKYBLUE, feedSound);
+                feed->subject = evt.kind;
+                feed->team = evt.team;
+                snprintf(feed->actor, sizeof(feed->actor), "%.*s", LAN_NAME_BYTES, evt.actor[0] ? evt.actor : "Peer");
+                snprintf(feed->target, sizeof(feed->target), "%.*s", LAN_NAME_BYTES, evt.target[0] ? evt.target : "opponent");
             }
         }
 
@@ -2260,29 +5793,20 @@ int main(int argc, char **argv)
         {
             playerRespawnTimer = 2.5f;
             player.health = 0.0f;
-            deathCount++;
-            PushKillfeedSfx(killfeed, killfeedCount, "You were fragged", RED, feedSound);
+            EventBusPush(&events, GAME_EVENT_PLAYER_FRAGGED);
         }
 
         if (isZombies)
         {
-            UpdateZombies(&zombies,
-                          dt,
-                          (Vector3){camera.position.x, 0.0f, camera.position.z},
-                          &player,
-                          trails,
-                          &trailIndex,
-                          gArenaPresets[arenaIndex].navPoints,
-                          gArenaPresets[arenaIndex].navWeights,
-                          gArenaPresets[arenaIndex].navCount);
             if (player.health <= 0.0f)
             {
                 player.isDowned = true;
                 player.health = 0.0f;
                 if (!wasDown)
                 {
-                    PlaySoundSafe(downSound);
-                    deathCount++;
+                    GameEvent *down = EventBusPush(&events, GAME_EVENT_PLAYER_DOWNED);
+                    if (down)
+                        down->subject = zombies.wave;
                 }
             }
 
@@ -2292,9 +5816,9 @@ int main(int argc, char **argv)
                 bool peerNearby = false;
                 for (int i = 0; i < MAX_PEERS; i++)
                 {
-                    if (!lan.peers[i].active)
+                    if (!lan->peers[i].active)
                         continue;
-                    if (Vector3Distance(playerFoot, lan.peers[i].renderPos) < 1.6f)
+                    if (Vector3Distance(playerFoot, lan->peers[i].renderPos) < 1.6f)
                     {
                         peerNearby = true;
                         break;
@@ -2310,9 +5834,7 @@ int main(int argc, char **argv)
                         player.health = PLAYER_MAX_HEALTH * 0.6f;
                         player.reviveProgress = 0.0f;
                         player.damageCooldown = 1.0f;
-                        PlaySoundSafe(reviveSound);
-                        pendingCashShare += 25;
-                        pendingScoreShare += 30;
+                        EventBusPush(&events, GAME_EVENT_PLAYER_REVIVED);
                     }
                 }
                 else
@@ -2327,24 +5849,25 @@ int main(int argc, char **argv)
 
             for (int i = 0; i < MAX_PEERS; i++)
             {
-                if (!lan.peers[i].active)
+                if (!lan->peers[i].active)
                     continue;
-                if (!lan.peers[i].isDowned)
+                if (!lan->peers[i].isDowned)
                 {
                     if (peerReviveTimers[i] < 0.0f)
                         peerReviveTimers[i] = 0.0f;
                     continue;
                 }
 
-                float dist = Vector3Distance(playerFoot, lan.peers[i].renderPos);
+                float dist = Vector3Distance(playerFoot, lan->peers[i].renderPos);
                 if (dist < 1.6f && IsKeyDown(KEY_E) && canAct)
                 {
                     float assistSpeed = revivePerk ? 1.5f : 1.0f;
                     peerReviveTimers[i] += dt * assistSpeed;
                     if (peerReviveTimers[i] >= 1.0f)
                     {
-                        pendingCashShare += 40;
-                        pendingScoreShare += 60;
+                        GameEvent *revived = EventBusPush(&events, GAME_EVENT_PEER_REVIVED);
+                        if (revived)
+                            revived->subject = i;
                         peerReviveTimers[i] = -2.0f;
                     }
                 }
@@ -2381,10 +5904,12 @@ int main(int argc, char **argv)
                 if (tagged > 0)
                 {
                     meleeCooldown = 0.45f;
-                    pendingCashShare += assistCash;
-                    sharePipTimer = 1.2f;
-                    sharePipCash = assistCash;
-                    sharePipScore = assistCash;
+                    GameEvent *assist = EventBusPush(&events, GAME_EVENT_MELEE_ASSIST);
+                    if (assist)
+                    {
+                        assist->subject = tagged;
+                        assist->amount = assistCash;
+                    }
                 }
             }
 
@@ -2398,28 +5923,25 @@ int main(int argc, char **argv)
                     int cost = PropCost(propSpots[i].kind);
                     if (player.cash < cost)
                         continue;
+                    GameEventKind purchase = GAME_EVENT_PERK_PURCHASED;
                     switch (propSpots[i].kind)
                     {
                     case PROP_PERK_QUICK:
                         quickfirePerk = true;
                         player.cash -= cost;
-                        PlaySoundSafe(perkSound);
                         break;
                     case PROP_PERK_SPEED:
                         speedPerk = true;
                         player.cash -= cost;
-                        PlaySoundSafe(perkSound);
                         break;
                     case PROP_PERK_REVIVE:
                         revivePerk = true;
                         player.cash -= cost;
-                        PlaySoundSafe(perkSound);
                         break;
                     case PROP_WALL_AMMO:
                         wallBuyed = true;
                         player.cash -= cost;
                         weaponAmmo[weaponIndex] = weapons[weaponIndex].maxAmmo;
-                        PlaySoundSafe(perkSound);
                         break;
                     case PROP_MYSTERY:
                         if (mysteryCooldown <= 0.0f && mysteryRollsLeft == 0)
@@ -2427,10 +5949,23 @@ int main(int argc, char **argv)
                             player.cash -= cost;
                             mysteryRollsLeft = 3;
                             mysteryRollTimer = 0.2f;
-                            PlaySoundSafe(boxSound);
+                            purchase = GAME_EVENT_BOX_ROLLED;
+                        }
+                        else
+                        {
+                            purchase = GAME_EVENT_NONE;
                         }
                         break;
                     }
+                    if (purchase != GAME_EVENT_NONE)
+                    {
+                        GameEvent *bought = EventBusPush(&events, purchase);
+                        if (bought)
+                        {
+                            bought->subject = (int)propSpots[i].kind;
+                            bought->amount = cost;
+                        }
+                    }
                 }
             }
         }
@@ -2452,6 +5987,7 @@ int main(int argc, char **argv)
             current.damage *= 1.15f;
         }
 
+        uint64_t combatZone = ProfileZoneBegin();
         if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && fireCooldown <= 0.0f && canAct)
         {
             if (weaponAmmo[weaponIndex] > 0)
@@ -2467,80 +6003,20 @@ int main(int argc, char **argv)
                 recoilKick += current.recoil;
                 flash.timer = MAX_FLASH_TIME;
                 flash.color = current.color;
-                int kills = 0;
-                int cashEarned = 0;
-                int assistShare = 0;
-                int peerFragged = -1;
-                int hits = 0;
                 if (isZombies)
                 {
-                    hits = FireWeapon(&current,
-                                      camera.position,
-                                      dir,
-                                      &zombies,
-                                      decals,
-                                      &decalIndex,
-                                      dissolves,
-                                      &dissolveIndex,
-                                      &kills,
-                                      &cashEarned,
-                                      &assistShare);
+                    FireWeapon(&current,
+                               camera.position,
+                               dir,
+                               &zombies,
+                               &fx,
+                               &events);
                 }
                 else
                 {
-                    hits = FireAtPeers(&current, camera.position, dir, &lan, mpVariant == MULTI_TEAM, playerTeam, &peerFragged);
-                }
-                if (hits > 0)
-                {
-                    if (!isZombies)
-                    {
-                        pendingRay.origin = camera.position;
-                        pendingRay.dir = dir;
-                        pendingRay.damage = current.damage;
-                        pendingRay.ttl = 0.3f;
-                        pendingRay.id = damageCounter++;
-                    }
-                    PlaySoundSafe(hitSound);
-                    hitMarker.timer = 0.3f;
-                    hitMarker.isKill = (!isZombies && peerFragged >= 0) || (isZombies && kills > 0);
-                    if (hitMarker.isKill)
-                        PlaySoundSafe(killSound);
+                    FireAtPeers(&current, camera.position, dir, lan, mpVariant == MULTI_TEAM, playerTeam, frameCtx.matchNow, &events);
                 }
                 weaponAmmo[weaponIndex]--;
-                if (isZombies)
-                {
-                    player.score += kills * 120;
-                    player.cash += cashEarned;
-                    pendingCashShare += cashEarned / 4;
-                    pendingCashShare += assistShare / 4;
-                    if (assistShare > 0)
-                    {
-                        sharePipTimer = 1.4f;
-                        sharePipCash = assistShare / 2;
-                        sharePipScore = assistShare / 2;
-                    }
-                    pendingScoreShare += kills * 40;
-                }
-                else if (peerFragged >= 0)
-                {
-                    fragCount++;
-                    if (mpVariant == MULTI_TEAM)
-                        teamScores[playerTeam]++;
-                    player.score += 100;
-                    const char *fragName = lan.peers[peerFragged].name[0] ? lan.peers[peerFragged].name : "Peer";
-                    char buf[48];
-                    snprintf(buf, sizeof(buf), "Fragged %s", fragName);
-                    PushKillfeedSfx(killfeed, killfeedCount, buf, ORANGE, feedSound);
-                    pendingEvent.kind = 1;
-                    pendingEvent.team = playerTeam;
-                    strncpy(pendingEvent.target, fragName, LAN_NAME_BYTES - 1);
-                }
-                else if (hits > 0 && !isZombies && pendingEvent.kind == 0)
-                {
-                    pendingEvent.kind = 2;
-                    pendingEvent.team = playerTeam;
-                    strncpy(pendingEvent.target, "assist", LAN_NAME_BYTES - 1);
-                }
             }
             else
             {
@@ -2548,67 +6024,70 @@ int main(int argc, char **argv)
             }
         }
 
+        EventBusDispatch(&events);
+        ProfileZoneEnd(PROFILE_ZONE_COMBAT, combatZone);
+
+        // The arena can change from the menu or from a join snapshot earlier in
+        // the frame; swap models here so loading never lands in the render pass.
+        if (modelArena != arenaIndex)
+        {
+            LoadArenaModels(&lowPoly, gArenaPresets[arenaIndex].name);
+            VatBake(&vat, &lowPoly);
+            modelArena = arenaIndex;
+        }
+
+        uint64_t renderZone = ProfileZoneBegin();
         BeginTextureMode(renderTarget);
         ClearBackground((Color){15, 20, 30, 255});
         BeginMode3D(camera);
 
+        BuildOccluders(&occlusion, &camera, &gArenaPresets[arenaIndex], propSpots, propSpotCount);
         DrawPlane((Vector3){0, 0, 0}, (Vector2){20, 20}, (Color){25, 30, 40, 255});
-        DrawRetroCube((Vector3){0, 0.5f, 0}, 0.5f, 1.0f, 0.5f, GREEN);
-        DrawRetroCube((Vector3){2.0f, 0.35f, 1.5f}, 0.35f, 0.7f, 0.35f, (Color){90, 100, 160, 255});
-        DrawRetroCube((Vector3){-1.5f, 0.25f, -1.0f}, 0.25f, 0.5f, 0.25f, (Color){120, 80, 90, 255});
-        DrawRetroCube((Vector3){-4.0f, 0.4f, 1.5f}, 0.9f, 1.2f, 0.6f, (Color){80, 110, 160, 255});
-        DrawRetroCube((Vector3){4.0f, 0.35f, -1.5f}, 0.8f, 1.0f, 0.8f, (Color){150, 120, 90, 255});
-        DrawRetroCube((Vector3){0.0f, 0.25f, 3.5f}, 1.2f, 0.6f, 1.2f, (Color){60, 80, 110, 255});
+        for (size_t i = 0; i < sizeof(gArenaBlocks) / sizeof(gArenaBlocks[0]); i++)
+        {
+            CoverPiece b = gArenaBlocks[i];
+            QueueRetroModel(&lowPoly, LOWPOLY_BLOCK, b.position, b.size, b.color);
+        }
         for (int i = 0; i < gArenaPresets[arenaIndex].coverCount; i++)
         {
             CoverPiece c = gArenaPresets[arenaIndex].cover[i];
-            DrawRetroCube(c.position, c.size.x, c.size.y, c.size.z, c.color);
+            QueueRetroModel(&lowPoly, LOWPOLY_BLOCK, c.position, c.size, c.color);
         }
         for (int i = 0; i < propSpotCount; i++)
         {
             Vector3 snapped = propSpots[i].position;
             snapped = QuantizeVec3(snapped, 0.1f);
-            float h = (propSpots[i].kind == PROP_MYSTERY) ? 0.8f : 1.1f;
-            float s = (propSpots[i].kind == PROP_MYSTERY) ? 0.45f : 0.55f;
-            DrawRetroCube(snapped, s, h, s, PropColor(propSpots[i].kind));
+            Vector3 box = PropBoxSize(propSpots[i].kind);
+            if (!OcclusionTestBox(&occlusion, snapped, box))
+                continue;
+            QueueRetroModel(&lowPoly, PropModel(propSpots[i].kind), snapped, box, PropColor(propSpots[i].kind));
         }
 
         if (isZombies)
         {
-            DrawZombies(&zombies);
-            DrawDecals(decals, dt);
-            UpdateDissolves(dissolves, dt);
-            UpdateTrails(trails, dt);
+            DrawZombies(&zombies, &occlusion, camera.position, &vat);
+            DrawRemoteEnemies(lan, &occlusion, camera.position, &vat);
         }
-        DrawMuzzleFlash(&flash, &camera, flashTex);
         for (int i = 0; i < MAX_PEERS; i++)
         {
-            if (!lan.peers[i].active)
+            if (!lan->peers[i].active)
                 continue;
-            DrawRetroCube(lan.peers[i].renderPos, 0.25f, 0.6f, 0.25f, (Color){160, 160, 255, 255});
-            Vector3 head = lan.peers[i].renderPos;
-            head.y += 0.9f;
-            Vector2 screenPos = GetWorldToScreen(head, camera);
-            if (screenPos.x >= 0 && screenPos.x <= BASE_WIDTH && screenPos.y >= 0 && screenPos.y <= BASE_HEIGHT)
-            {
-                peerLabels[i] = screenPos;
-                peerLabelVisible[i] = true;
-                int wi = lan.peers[i].weaponIndex;
-                const char *wName = (wi >= 0 && wi < (int)(sizeof(weapons) / sizeof(weapons[0]))) ? weapons[wi].name : "W?";
-                const char *name = lan.peers[i].name[0] ? lan.peers[i].name : "Peer";
-                const char *status = lan.peers[i].isDowned ? "!" : (lan.peers[i].isReviving ? "R" : "");
-                snprintf(peerLabelText[i],
-                         sizeof(peerLabelText[i]),
-                         "%s [%s %d|H%.0f%s $%d]",
-                         name,
-                         wName,
-                         lan.peers[i].ammo,
-                         lan.peers[i].health,
-                         status,
-                         lan.peers[i].cash);
-            }
+            if (!OcclusionTestBox(&occlusion, lan->peers[i].renderPos, (Vector3){0.25f, 0.6f, 0.25f}))
+                continue;
+            QueueRetroModel(&lowPoly, LOWPOLY_PEER, lan->peers[i].renderPos, (Vector3){0.25f, 0.6f, 0.25f}, (Color){160, 160, 255, 255});
         }
+        LowPolyFlush(&lowPoly);
+        VatFlush(&vat, &lowPoly);
+        if (isZombies)
+        {
+            DrawFx(&fx, &vat);
+            VatFlush(&vat, &lowPoly);
+        }
+        ParticlesDraw(&particles, camera, flashTex);
+        DrawMuzzleFlash(&flash, &camera, flashTex);
         EndMode3D();
+        ProfileCount(PROFILE_COUNTER_OCCLUSION_TESTED, (uint32_t)occlusion.tested);
+        ProfileCount(PROFILE_COUNTER_OCCLUSION_CULLED, (uint32_t)occlusion.culled);
 
         DrawCrosshair(BASE_WIDTH, BASE_HEIGHT);
         for (int i = 0; i < MAX_PEERS; i++)
@@ -2626,12 +6105,12 @@ int main(int argc, char **argv)
                  quickfirePerk,
                  speedPerk,
                  revivePerk,
-                 &lan,
+                 lan,
                  playerName,
                  nameLocked,
                  gAudioEnabled,
-                 flashlightOn,
-                 ditherOn,
+                 CvarBool(gCvar.flashlight),
+                 CvarBool(gCvar.dither),
                  fireCooldown,
                  mysteryCooldown,
                  player.damageCooldown,
@@ -2648,8 +6127,23 @@ int main(int argc, char **argv)
                  &hitMarker,
                  killfeed,
                  killfeedCount);
+        if (showTaskGraph)
+        {
+            DrawTaskGraphOverlay(&frameGraph, BASE_WIDTH - 152, BASE_HEIGHT - 64);
+            DrawText(TextFormat("occl %d boxes, culled %d/%d, %d tris", occlusion.occluders, occlusion.culled, occlusion.tested, lowPoly.triangles + vat.triangles),
+                     BASE_WIDTH - 152,
+                     BASE_HEIGHT - 76,
+                     8,
+                     LIGHTGRAY);
+            if (ProfilePmuActive() != PROFILE_PMU_OFF)
+                DrawPmuOverlay(&lastProfileFrame, BASE_WIDTH - 152, BASE_HEIGHT - 136);
+        }
+        if (console.open)
+            DrawCvarConsole(&console);
         EndTextureMode();
+        ProfileZoneEnd(PROFILE_ZONE_RENDER, renderZone);
 
+        uint64_t presentZone = ProfileZoneBegin();
         BeginDrawing();
         ClearBackground(BLACK);
         Rectangle dest = {0, 0, BASE_WIDTH * PIXEL_SCALE, BASE_HEIGHT * PIXEL_SCALE};
@@ -2665,15 +6159,52 @@ int main(int argc, char **argv)
             unsigned char alpha = (unsigned char)Clamp((int)((0.55f - healthPct) * 255), 0, 140);
             DrawRectangle(0, 0, (int)dest.width, (int)dest.height, (Color){60, 0, 0, alpha});
         }
-        if (flashlightOn)
+        if (CvarBool(gCvar.flashlight))
             DrawFlashlightMask((int)dest.width, (int)dest.height);
-        if (ditherOn)
+        if (CvarBool(gCvar.dither))
             DrawDitherMask((int)dest.width, (int)dest.height);
         EndDrawing();
+        ProfileZoneEnd(PROFILE_ZONE_PRESENT, presentZone);
+
+        ProfileFrame profileFrame;
+        ProfileEndFrame(&profileFrame);
+        profileFrame.activeEnemies = isZombies ? zombies.activeCount : 0;
+        bool hitch = HitchRecordFrame(&hitches, &profileFrame);
+        // Spare frame budget for host election; present is left out since it includes the vsync wait.
+        float busyMs = profileFrame.zoneMs[PROFILE_ZONE_LAN] + profileFrame.zoneMs[PROFILE_ZONE_ZOMBIES] +
+                       profileFrame.zoneMs[PROFILE_ZONE_COMBAT] + profileFrame.zoneMs[PROFILE_ZONE_RENDER] +
+                       profileFrame.zoneMs[PROFILE_ZONE_CONTROL];
+        float budgetMs = 1000.0f / (float)(CvarInt(gCvar.maxFps) > 0 ? CvarInt(gCvar.maxFps) : 60);
+        lan->headroom = Lerp(lan->headroom, Clamp(1.0f - busyMs / budgetMs, 0.0f, 1.0f), 0.02f);
+        if (statsdAddress)
+            UpdateGameMetrics(&gameMetrics, &profileFrame, lan, hitch);
+        if (telemetryOn)
+        {
+            telemetryHitches += hitch ? 1 : 0;
+            PublishTelemetry(&profileFrame, lan, mode, mpVariant, &zombies, teamScores, &player, playerName, playerTeam,
+                             camera.position, telemetryHitches);
+        }
+        lastProfileFrame = profileFrame;
+    }
+    MetricsStop();
+    TelemetryClose();
+    // A trace still being written gets its reply before the socket closes.
+    bool traceWritten;
+    SamplerWriteDone(true, &traceWritten);
+    FinishControlTrace(&control);
+    ControlClose();
+    StopControlBots(&control.bots, lan);
+    if (profileHz > 0)
+    {
+        SamplerStop();
+        if (SamplerWriteFolded("profile.folded"))
+            printf("profiler: %u samples (%u dropped) -> profile.folded\n", SamplerSampleCount(), SamplerDroppedCount());
     }
 
     EnableCursor();
     UnloadTexture(flashTex);
+    VatUnload(&vat);
+    LowPolyUnload(&lowPoly);
     UnloadRenderTexture(renderTarget);
     UnloadSound(hitSound);
     UnloadSound(perkSound);
@@ -2681,8 +6212,15 @@ int main(int argc, char **argv)
     UnloadSound(reviveSound);
     UnloadSound(downSound);
     CloseAudioDevice();
-    if (lan.enabled)
-        close(lan.socketFd);
+    if (lan->enabled)
+        close(lan->socketFd);
     CloseWindow();
+    TaskSchedulerShutdown();
+    HitchShutdown(&hitches);
+    if (lanModelPath)
+        LanCodecWritePriors(lanModelPath);
+    RegionLogReport();
+    RegionShutdown();
+    LogShutdown();
     return 0;
 }
@@ -0,0 +1,287 @@
+#define _POSIX_C_SOURCE 200809L
+#include "metrics.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define METRICS_PACKET_BYTES 1400
+#define METRICS_POLL_NS 100000000L
+
+// Histogram samples are double-buffered: writers fill the active half while
+// the flusher drains the other. A writer announces itself on a half before
+// touching it, so after flipping the flusher only waits out the few writers
+// that were already mid-store. The announce/check on one side and the
+// flip/wait on the other are seq_cst, so at least one side sees the other:
+// either the writer sees the flip and retries, or the flusher sees it waiting.
+typedef struct MetricsHistogram
+{
+    float samples[2][METRICS_HISTOGRAM_SAMPLES];
+    uint32_t count[2];
+    uint32_t writers[2];
+} MetricsHistogram;
+
+typedef struct Metric
+{
+    char name[METRICS_NAME_BYTES];
+    MetricKind kind;
+    int64_t counter;
+    double gauge;
+    bool gaugeSet;
+    int histogram;
+} Metric;
+
+typedef struct MetricsState
+{
+    Metric metrics[METRICS_MAX + 1];
+    int count;
+    MetricsHistogram histograms[METRICS_MAX_HISTOGRAMS];
+    int histogramCount;
+    uint32_t active;
+    int socketFd;
+    struct sockaddr_storage target;
+    socklen_t targetLen;
+    char prefix[64];
+    int64_t intervalNs;
+    bool running;
+    pthread_t thread;
+} MetricsState;
+
+static MetricsState gMetrics = {.socketFd = -1};
+
+static Metric *MetricsGet(int id, MetricKind kind)
+{
+    if (id <= 0 || id > __atomic_load_n(&gMetrics.count, __ATOMIC_ACQUIRE))
+        return NULL;
+    Metric *m = &gMetrics.metrics[id];
+    return m->kind == kind ? m : NULL;
+}
+
+int MetricsRegister(MetricKind kind, const char *name)
+{
+    int id = gMetrics.count + 1;
+    if (id > METRICS_MAX || (kind == METRIC_HISTOGRAM && gMetrics.histogramCount >= METRICS_MAX_HISTOGRAMS))
+        return 0;
+    Metric *m = &gMetrics.metrics[id];
+    memset(m, 0, sizeof(*m));
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    m->kind = kind;
+    m->histogram = kind == METRIC_HISTOGRAM ? gMetrics.histogramCount++ : -1;
+    __atomic_store_n(&gMetrics.count, id, __ATOMIC_RELEASE);
+    return id;
+}
+
+void MetricsAdd(int id, int64_t amount)
+{
+    Metric *m = MetricsGet(id, METRIC_COUNTER);
+    if (m)
+        __atomic_fetch_add(&m->counter, amount, __ATOMIC_RELAXED);
+}
+
+void MetricsSet(int id, double value)
+{
+    Metric *m = MetricsGet(id, METRIC_GAUGE);
+    if (!m)
+        return;
+    __atomic_store(&m->gauge, &value, __ATOMIC_RELAXED);
+    __atomic_store_n(&m->gaugeSet, true, __ATOMIC_RELEASE);
+}
+
+void MetricsObserve(int id, float value)
+{
+    Metric *m = MetricsGet(id, METRIC_HISTOGRAM);
+    if (!m)
+        return;
+    MetricsHistogram *h = &gMetrics.histograms[m->histogram];
+    for (;;)
+    {
+        uint32_t half = __atomic_load_n(&gMetrics.active, __ATOMIC_ACQUIRE);
+        __atomic_fetch_add(&h->writers[half], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&gMetrics.active, __ATOMIC_SEQ_CST) == half)
+        {
+            uint32_t slot = __atomic_fetch_add(&h->count[half], 1, __ATOMIC_RELAXED);
+            if (slot < METRICS_HISTOGRAM_SAMPLES)
+                h->samples[half][slot] = value;
+            __atomic_fetch_sub(&h->writers[half], 1, __ATOMIC_RELEASE);
+            return;
+        }
+        // The flusher flipped halves in between; announce on the new one instead.
+        __atomic_fetch_sub(&h->writers[half], 1, __ATOMIC_RELEASE);
+    }
+}
+
+typedef struct MetricsPacket
+{
+    char data[METRICS_PACKET_BYTES];
+    size_t used;
+} MetricsPacket;
+
+static void MetricsSendPacket(MetricsPacket *packet)
+{
+    if (packet->used == 0)
+        return;
+    sendto(gMetrics.socketFd, packet->data, packet->used, 0, (struct sockaddr *)&gMetrics.target, gMetrics.targetLen);
+    packet->used = 0;
+}
+
+static void MetricsLine(MetricsPacket *packet, const char *name, const char *suffix, double value, const char *type)
+{
+    char line[160];
+    int n = snprintf(line, sizeof(line), "%s%s%s:%.6g|%s", gMetrics.prefix, name, suffix, value, type);
+    if (n <= 0 || (size_t)n >= sizeof(line))
+        return;
+    if (packet->used + (size_t)n + 1 > sizeof(packet->data))
+        MetricsSendPacket(packet);
+    if (packet->used > 0)
+        packet->data[packet->used++] = '\n';
+    memcpy(packet->data + packet->used, line, (size_t)n);
+    packet->used += (size_t)n;
+}
+
+static int MetricsCompareFloats(const void *a, const void *b)
+{
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static void MetricsFlushHistogram(MetricsPacket *packet, const Metric *m, uint32_t half)
+{
+    static float sorted[METRICS_HISTOGRAM_SAMPLES];
+    MetricsHistogram *h = &gMetrics.histograms[m->histogram];
+    struct timespec pause = {0, 1000};
+    while (__atomic_load_n(&h->writers[half], __ATOMIC_SEQ_CST) != 0)
+        nanosleep(&pause, NULL);
+    uint32_t seen = __atomic_load_n(&h->count[half], __ATOMIC_ACQUIRE);
+    uint32_t n = seen < METRICS_HISTOGRAM_SAMPLES ? seen : METRICS_HISTOGRAM_SAMPLES;
+    memcpy(sorted, h->samples[half], sizeof(float) * n);
+    __atomic_store_n(&h->count[half], 0, __ATOMIC_RELEASE);
+    MetricsLine(packet, m->name, ".count", (double)seen, "c");
+    if (n == 0)
+        return;
+    qsort(sorted, n, sizeof(float), MetricsCompareFloats);
+    MetricsLine(packet, m->name, ".p50", sorted[(n - 1) / 2], "g");
+    MetricsLine(packet, m->name, ".p95", sorted[(uint32_t)((float)(n - 1) * 0.95f)], "g");
+    MetricsLine(packet, m->name, ".p99", sorted[(uint32_t)((float)(n - 1) * 0.99f)], "g");
+    MetricsLine(packet, m->name, ".max", sorted[n - 1], "g");
+}
+
+static void MetricsFlush(void)
+{
+    MetricsPacket packet = {.used = 0};
+    uint32_t half = __atomic_load_n(&gMetrics.active, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&gMetrics.active, half ^ 1u, __ATOMIC_SEQ_CST);
+    int count = __atomic_load_n(&gMetrics.count, __ATOMIC_ACQUIRE);
+    for (int id = 1; id <= count; id++)
+    {
+        Metric *m = &gMetrics.metrics[id];
+        switch (m->kind)
+        {
+        case METRIC_COUNTER:
+            MetricsLine(&packet, m->name, "", (double)__atomic_exchange_n(&m->counter, 0, __ATOMIC_RELAXED), "c");
+            break;
+        case METRIC_GAUGE:
+            if (__atomic_load_n(&m->gaugeSet, __ATOMIC_ACQUIRE))
+            {
+                double value;
+                __atomic_load(&m->gauge, &value, __ATOMIC_RELAXED);
+                MetricsLine(&packet, m->name, "", value, "g");
+            }
+            break;
+        case METRIC_HISTOGRAM:
+            MetricsFlushHistogram(&packet, m, half);
+            break;
+        }
+    }
+    MetricsSendPacket(&packet);
+}
+
+static void *MetricsThreadMain(void *arg)
+{
+    (void)arg;
+    struct timespec poll = {0, METRICS_POLL_NS};
+    int64_t waited = 0;
+    while (__atomic_load_n(&gMetrics.running, __ATOMIC_ACQUIRE))
+    {
+        nanosleep(&poll, NULL);
+        waited += METRICS_POLL_NS;
+        if (waited < gMetrics.intervalNs)
+            continue;
+        waited = 0;
+        MetricsFlush();
+    }
+    MetricsFlush();
+    return NULL;
+}
+
+static bool MetricsResolve(const char *address)
+{
+    char host[128];
+    const char *colon = strrchr(address, ':');
+    size_t hostLen = colon ? (size_t)(colon - address) : strlen(address);
+    if (hostLen == 0 || hostLen >= sizeof(host))
+        return false;
+    memcpy(host, address, hostLen);
+    host[hostLen] = '\0';
+    char port[8];
+    snprintf(port, sizeof(port), "%d", colon ? atoi(colon + 1) : METRICS_DEFAULT_PORT);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo *info = NULL;
+    if (getaddrinfo(host, port, &hints, &info) != 0 || !info)
+        return false;
+    gMetrics.socketFd = socket(info->ai_family, SOCK_DGRAM, 0);
+    if (gMetrics.socketFd >= 0)
+    {
+        memcpy(&gMetrics.target, info->ai_addr, info->ai_addrlen);
+        gMetrics.targetLen = info->ai_addrlen;
+        fcntl(gMetrics.socketFd, F_SETFL, O_NONBLOCK);
+    }
+    freeaddrinfo(info);
+    return gMetrics.socketFd >= 0;
+}
+
+bool MetricsStart(const char *address, float intervalSeconds)
+{
+    if (gMetrics.running || !MetricsResolve(address))
+        return false;
+    char host[48] = "local";
+    gethostname(host, sizeof(host) - 1);
+    for (char *c = host; *c; c++)
+    {
+        if (!isalnum((unsigned char)*c) && *c != '-')
+            *c = '_';
+    }
+    snprintf(gMetrics.prefix, sizeof(gMetrics.prefix), "u8.%s.", host);
+    gMetrics.intervalNs = (int64_t)((intervalSeconds > 0.1f ? intervalSeconds : 0.1f) * 1e9f);
+    __atomic_store_n(&gMetrics.running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&gMetrics.thread, NULL, MetricsThreadMain, NULL) != 0)
+    {
+        __atomic_store_n(&gMetrics.running, false, __ATOMIC_RELEASE);
+        close(gMetrics.socketFd);
+        gMetrics.socketFd = -1;
+        return false;
+    }
+    return true;
+}
+
+void MetricsStop(void)
+{
+    if (!__atomic_load_n(&gMetrics.running, __ATOMIC_ACQUIRE))
+        return;
+    __atomic_store_n(&gMetrics.running, false, __ATOMIC_RELEASE);
+    pthread_join(gMetrics.thread, NULL);
+    close(gMetrics.socketFd);
+    gMetrics.socketFd = -1;
+}
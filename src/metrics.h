@@ -0,0 +1,34 @@
+#ifndef U8_METRICS_H
+#define U8_METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define METRICS_MAX 96
+#define METRICS_MAX_HISTOGRAMS 8
+#define METRICS_HISTOGRAM_SAMPLES 1024
+#define METRICS_NAME_BYTES 40
+#define METRICS_DEFAULT_PORT 8125
+
+typedef enum MetricKind
+{
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+} MetricKind;
+
+// In-process aggregation with a StatsD exporter. Updates are lock-free atomics
+// from any thread; a background thread flushes every interval as UDP lines
+// prefixed "u8.<host>.". Counters go out as |c and reset, gauges as |g, and
+// histograms as p50/p95/p99/max gauges plus a count over the interval.
+bool MetricsStart(const char *address, float intervalSeconds);
+void MetricsStop(void);
+// Ids start at 1; 0 is never returned for a live metric, so a zeroed id is a
+// safe no-op. Register from one thread, before or after starting.
+int MetricsRegister(MetricKind kind, const char *name);
+void MetricsAdd(int id, int64_t amount);
+void MetricsSet(int id, double value);
+// Histograms keep the first METRICS_HISTOGRAM_SAMPLES values of each interval.
+void MetricsObserve(int id, float value);
+
+#endif
@@ -0,0 +1,263 @@
+#include "occlusion.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "raymath.h"
+
+#define OCCLUSION_LANES 4
+#define OCCLUSION_NEAR 0.05f
+#define OCCLUSION_DEPTH_BIAS 1.0001f
+
+typedef struct OcclusionVertex
+{
+    float x;
+    float y;
+    float w;
+} OcclusionVertex;
+
+static const int gBoxTriangles[12][3] = {
+    {0, 1, 3}, {0, 3, 2}, {4, 6, 7}, {4, 7, 5}, {0, 4, 5}, {0, 5, 1},
+    {2, 3, 7}, {2, 7, 6}, {0, 2, 6}, {0, 6, 4}, {1, 5, 7}, {1, 7, 3},
+};
+
+bool OcclusionInit(OcclusionBuffer *buffer, MemRegion region)
+{
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->depth = (float *)RegionAlloc(region, sizeof(float) * OCCLUSION_WIDTH * OCCLUSION_HEIGHT);
+    return buffer->depth != NULL;
+}
+
+void OcclusionBegin(OcclusionBuffer *buffer, const Camera3D *camera, float aspect)
+{
+    buffer->occluders = 0;
+    buffer->tested = 0;
+    buffer->culled = 0;
+    if (!buffer->depth)
+        return;
+    memset(buffer->depth, 0, sizeof(float) * OCCLUSION_WIDTH * OCCLUSION_HEIGHT);
+    memset(buffer->tiles, 0, sizeof(buffer->tiles));
+    buffer->eye = camera->position;
+    buffer->forward = Vector3Normalize(Vector3Subtract(camera->target, camera->position));
+    buffer->right = Vector3Normalize(Vector3CrossProduct(buffer->forward, camera->up));
+    buffer->up = Vector3CrossProduct(buffer->right, buffer->forward);
+    buffer->scaleY = 1.0f / tanf(camera->fovy * DEG2RAD * 0.5f);
+    buffer->scaleX = buffer->scaleY / aspect;
+}
+
+// Projects the eight corners to pixel space; false when any is behind the near plane.
+static bool OcclusionProjectBox(const OcclusionBuffer *buffer, Vector3 center, Vector3 size, OcclusionVertex out[8])
+{
+    for (int i = 0; i < 8; i++)
+    {
+        Vector3 corner = {center.x + ((i & 1) ? 0.5f : -0.5f) * size.x,
+                          center.y + ((i & 2) ? 0.5f : -0.5f) * size.y,
+                          center.z + ((i & 4) ? 0.5f : -0.5f) * size.z};
+        Vector3 v = Vector3Subtract(corner, buffer->eye);
+        float z = Vector3DotProduct(v, buffer->forward);
+        if (z < OCCLUSION_NEAR)
+            return false;
+        float w = 1.0f / z;
+        out[i].x = (Vector3DotProduct(v, buffer->right) * w * buffer->scaleX * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+        out[i].y = (0.5f - Vector3DotProduct(v, buffer->up) * w * buffer->scaleY * 0.5f) * OCCLUSION_HEIGHT;
+        out[i].w = w;
+    }
+    return true;
+}
+
+#if defined(__GNUC__)
+typedef float OcclusionLane __attribute__((vector_size(16)));
+typedef int32_t OcclusionMask __attribute__((vector_size(16)));
+
+static OcclusionLane OcclusionSelect(OcclusionMask mask, OcclusionLane a, OcclusionLane b)
+{
+    return (OcclusionLane)(((OcclusionMask)a & mask) | ((OcclusionMask)b & ~mask));
+}
+
+// e* and w are the edge functions and depth at pixel x0; a* and wStep are their per-pixel steps.
+static void OcclusionRasterSpan(float *row, int x0, int x1, float e0, float e1, float e2, float a0, float a1, float a2, float w, float wStep)
+{
+    const OcclusionLane zero = {0.0f, 0.0f, 0.0f, 0.0f};
+    const OcclusionLane lane = {0.0f, 1.0f, 2.0f, 3.0f};
+    OcclusionLane l0 = e0 + lane * a0;
+    OcclusionLane l1 = e1 + lane * a1;
+    OcclusionLane l2 = e2 + lane * a2;
+    OcclusionLane lw = w + lane * wStep;
+    const OcclusionLane s0 = zero + a0 * OCCLUSION_LANES;
+    const OcclusionLane s1 = zero + a1 * OCCLUSION_LANES;
+    const OcclusionLane s2 = zero + a2 * OCCLUSION_LANES;
+    const OcclusionLane sw = zero + wStep * OCCLUSION_LANES;
+    for (int x = x0; x <= x1; x += OCCLUSION_LANES)
+    {
+        OcclusionLane *cell = (OcclusionLane *)&row[x];
+        OcclusionMask inside = (l0 >= zero) & (l1 >= zero) & (l2 >= zero) & (lw > *cell);
+        *cell = OcclusionSelect(inside, lw, *cell);
+        l0 += s0;
+        l1 += s1;
+        l2 += s2;
+        lw += sw;
+    }
+}
+#else
+static void OcclusionRasterSpan(float *row, int x0, int x1, float e0, float e1, float e2, float a0, float a1, float a2, float w, float wStep)
+{
+    for (int x = x0; x <= x1; x++)
+    {
+        if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f && w > row[x])
+            row[x] = w;
+        e0 += a0;
+        e1 += a1;
+        e2 += a2;
+        w += wStep;
+    }
+}
+#endif
+
+static void OcclusionRasterTriangle(float *depth, OcclusionVertex v0, OcclusionVertex v1, OcclusionVertex v2)
+{
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (fabsf(area) < 1e-6f)
+        return;
+    if (area < 0.0f)
+    {
+        OcclusionVertex t = v1;
+        v1 = v2;
+        v2 = t;
+        area = -area;
+    }
+
+    int minX = (int)floorf(fminf(v0.x, fminf(v1.x, v2.x)));
+    int maxX = (int)ceilf(fmaxf(v0.x, fmaxf(v1.x, v2.x)));
+    int minY = (int)floorf(fminf(v0.y, fminf(v1.y, v2.y)));
+    int maxY = (int)ceilf(fmaxf(v0.y, fmaxf(v1.y, v2.y)));
+    if (minX < 0)
+        minX = 0;
+    if (minY < 0)
+        minY = 0;
+    if (maxX > OCCLUSION_WIDTH - 1)
+        maxX = OCCLUSION_WIDTH - 1;
+    if (maxY > OCCLUSION_HEIGHT - 1)
+        maxY = OCCLUSION_HEIGHT - 1;
+    if (minX > maxX || minY > maxY)
+        return;
+    // Spans start on a lane boundary; lanes left of the triangle fail the edge test.
+    minX &= ~(OCCLUSION_LANES - 1);
+
+    // Edge function e_i(x, y) = a_i * x + b_i * y + c_i, positive inside.
+    float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v1.y * v2.x;
+    float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v2.y * v0.x;
+    float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v0.y * v1.x;
+    float inv = 1.0f / area;
+    float wA = (a0 * v0.w + a1 * v1.w + a2 * v2.w) * inv;
+    float wB = (b0 * v0.w + b1 * v1.w + b2 * v2.w) * inv;
+    float wC = (c0 * v0.w + c1 * v1.w + c2 * v2.w) * inv;
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        float px = (float)minX + 0.5f;
+        float py = (float)y + 0.5f;
+        OcclusionRasterSpan(&depth[y * OCCLUSION_WIDTH],
+                            minX,
+                            maxX,
+                            a0 * px + b0 * py + c0,
+                            a1 * px + b1 * py + c1,
+                            a2 * px + b2 * py + c2,
+                            a0,
+                            a1,
+                            a2,
+                            wA * px + wB * py + wC,
+                            wA);
+    }
+}
+
+void OcclusionRasterBox(OcclusionBuffer *buffer, Vector3 center, Vector3 size)
+{
+    OcclusionVertex v[8];
+    if (!buffer->depth || !OcclusionProjectBox(buffer, center, size, v))
+        return;
+    for (int t = 0; t < 12; t++)
+        OcclusionRasterTriangle(buffer->depth, v[gBoxTriangles[t][0]], v[gBoxTriangles[t][1]], v[gBoxTriangles[t][2]]);
+    buffer->occluders++;
+}
+
+void OcclusionFinish(OcclusionBuffer *buffer)
+{
+    if (!buffer->depth)
+        return;
+    for (int ty = 0; ty < OCCLUSION_TILES_Y; ty++)
+    {
+        for (int tx = 0; tx < OCCLUSION_TILES_X; tx++)
+        {
+            float farthest = INFINITY;
+            for (int y = ty * OCCLUSION_TILE; y < (ty + 1) * OCCLUSION_TILE && y < OCCLUSION_HEIGHT; y++)
+            {
+                for (int x = tx * OCCLUSION_TILE; x < (tx + 1) * OCCLUSION_TILE && x < OCCLUSION_WIDTH; x++)
+                    farthest = fminf(farthest, buffer->depth[y * OCCLUSION_WIDTH + x]);
+            }
+            buffer->tiles[ty * OCCLUSION_TILES_X + tx] = farthest;
+        }
+    }
+}
+
+static bool OcclusionRectVisible(const OcclusionBuffer *buffer, int x0, int y0, int x1, int y1, float nearest)
+{
+    for (int ty = y0 / OCCLUSION_TILE; ty <= y1 / OCCLUSION_TILE; ty++)
+    {
+        for (int tx = x0 / OCCLUSION_TILE; tx <= x1 / OCCLUSION_TILE; tx++)
+        {
+            if (buffer->tiles[ty * OCCLUSION_TILES_X + tx] > nearest)
+                continue;
+            // The tile has something at or behind the box; look at the covered pixels only.
+            int ya = ty * OCCLUSION_TILE > y0 ? ty * OCCLUSION_TILE : y0;
+            int yb = (ty + 1) * OCCLUSION_TILE - 1 < y1 ? (ty + 1) * OCCLUSION_TILE - 1 : y1;
+            int xa = tx * OCCLUSION_TILE > x0 ? tx * OCCLUSION_TILE : x0;
+            int xb = (tx + 1) * OCCLUSION_TILE - 1 < x1 ? (tx + 1) * OCCLUSION_TILE - 1 : x1;
+            for (int y = ya; y <= yb; y++)
+            {
+                for (int x = xa; x <= xb; x++)
+                {
+                    if (buffer->depth[y * OCCLUSION_WIDTH + x] <= nearest)
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool OcclusionTestBox(OcclusionBuffer *buffer, Vector3 center, Vector3 size)
+{
+    buffer->tested++;
+    OcclusionVertex v[8];
+    if (!buffer->depth || !OcclusionProjectBox(buffer, center, size, v))
+        return true;
+
+    float minX = v[0].x, maxX = v[0].x, minY = v[0].y, maxY = v[0].y, nearest = v[0].w;
+    for (int i = 1; i < 8; i++)
+    {
+        minX = fminf(minX, v[i].x);
+        maxX = fmaxf(maxX, v[i].x);
+        minY = fminf(minY, v[i].y);
+        maxY = fmaxf(maxY, v[i].y);
+        nearest = fmaxf(nearest, v[i].w);
+    }
+    int x0 = (int)floorf(minX);
+    int x1 = (int)ceilf(maxX);
+    int y0 = (int)floorf(minY);
+    int y1 = (int)ceilf(maxY);
+    if (x1 < 0 || y1 < 0 || x0 > OCCLUSION_WIDTH - 1 || y0 > OCCLUSION_HEIGHT - 1)
+    {
+        buffer->culled++;
+        return false;
+    }
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > OCCLUSION_WIDTH - 1 ? OCCLUSION_WIDTH - 1 : x1;
+    y1 = y1 > OCCLUSION_HEIGHT - 1 ? OCCLUSION_HEIGHT - 1 : y1;
+
+    if (OcclusionRectVisible(buffer, x0, y0, x1, y1, nearest * OCCLUSION_DEPTH_BIAS))
+        return true;
+    buffer->culled++;
+    return false;
+}
@@ -0,0 +1,45 @@
+#ifndef U8_OCCLUSION_H
+#define U8_OCCLUSION_H
+
+#include <stdbool.h>
+
+#include "raylib.h"
+#include "region.h"
+
+#define OCCLUSION_WIDTH 80
+#define OCCLUSION_HEIGHT 45
+#define OCCLUSION_TILE 8
+#define OCCLUSION_TILES_X ((OCCLUSION_WIDTH + OCCLUSION_TILE - 1) / OCCLUSION_TILE)
+#define OCCLUSION_TILES_Y ((OCCLUSION_HEIGHT + OCCLUSION_TILE - 1) / OCCLUSION_TILE)
+#define OCCLUSION_MAX_OCCLUDERS 8
+
+// A small software depth buffer holding inverse view depth (bigger is nearer),
+// which interpolates linearly in screen space. The tile level keeps the
+// farthest value under each 8x8 block, so a box whose nearest point lies
+// behind every tile it touches is rejected without a per-pixel walk.
+typedef struct OcclusionBuffer
+{
+    float *depth;
+    float tiles[OCCLUSION_TILES_Y * OCCLUSION_TILES_X];
+    Vector3 eye;
+    Vector3 right;
+    Vector3 up;
+    Vector3 forward;
+    float scaleX;
+    float scaleY;
+    int occluders;
+    int tested;
+    int culled;
+} OcclusionBuffer;
+
+bool OcclusionInit(OcclusionBuffer *buffer, MemRegion region);
+// Clears the buffer and takes the view from a perspective camera.
+void OcclusionBegin(OcclusionBuffer *buffer, const Camera3D *camera, float aspect);
+// Boxes that cross the near plane are skipped rather than clipped.
+void OcclusionRasterBox(OcclusionBuffer *buffer, Vector3 center, Vector3 size);
+// Rebuilds the tile level; call once after the last occluder.
+void OcclusionFinish(OcclusionBuffer *buffer);
+// False only when the whole box is off screen or behind rasterized occluders.
+bool OcclusionTestBox(OcclusionBuffer *buffer, Vector3 center, Vector3 size);
+
+#endif
@@ -0,0 +1,303 @@
+#include "particles.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "raymath.h"
+#include "rlgl.h"
+
+#define PARTICLE_LANES 4
+#define PARTICLE_GRAVITY 9.8f
+#define PARTICLE_GROUND 0.02f
+#define PARTICLE_BOUNCE 0.35f
+#define PARTICLE_FRICTION 0.7f
+#define PARTICLE_DRAW_CHUNK 256
+
+typedef struct ParticleEmitterDesc
+{
+    int count;
+    float speed;
+    float spread;
+    float upBias;
+    float life;
+    float size;
+    float drag;
+    Color color;
+} ParticleEmitterDesc;
+
+static const ParticleEmitterDesc gParticleEmitters[PARTICLE_EMITTER_COUNT] = {
+    [PARTICLE_HIT_SPURT] = {10, 2.6f, 0.6f, 1.2f, 0.55f, 0.05f, 1.5f, {170, 30, 30, 255}},
+    [PARTICLE_DISSOLVE_DUST] = {24, 0.7f, 1.0f, 0.9f, 1.2f, 0.08f, 3.0f, {170, 190, 190, 200}},
+    [PARTICLE_SPIT_SPLASH] = {14, 1.8f, 0.9f, 1.5f, 0.7f, 0.06f, 2.0f, {140, 200, 255, 220}},
+};
+
+static float ParticleRandom(ParticleSystem *ps)
+{
+    ps->rng ^= ps->rng << 13;
+    ps->rng ^= ps->rng >> 17;
+    ps->rng ^= ps->rng << 5;
+    return (float)(ps->rng & 0xffff) / 65535.0f * 2.0f - 1.0f;
+}
+
+bool ParticlesInit(ParticleSystem *ps, MemRegion region, int capacity)
+{
+    memset(ps, 0, sizeof(*ps));
+    capacity = (capacity + PARTICLE_LANES - 1) & ~(PARTICLE_LANES - 1);
+    float **columns[] = {&ps->px, &ps->py, &ps->pz, &ps->vx, &ps->vy, &ps->vz, &ps->drag, &ps->life, &ps->maxLife, &ps->size};
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++)
+    {
+        *columns[i] = (float *)RegionAlloc(region, sizeof(float) * (size_t)capacity);
+        if (!*columns[i])
+            return false;
+    }
+    ps->color = (Color *)RegionAlloc(region, sizeof(Color) * (size_t)capacity);
+    if (!ps->color)
+        return false;
+    ps->capacity = capacity;
+    ps->limit = capacity;
+    ps->rng = 0x9e3779b9u;
+    return true;
+}
+
+int ParticlesEmit(ParticleSystem *ps, ParticleEmitter emitter, Vector3 origin, Vector3 dir)
+{
+    if (emitter < 0 || emitter >= PARTICLE_EMITTER_COUNT || ps->capacity == 0)
+        return 0;
+    const ParticleEmitterDesc *desc = &gParticleEmitters[emitter];
+    if (ps->count >= ps->limit)
+    {
+        ps->culled += (uint32_t)desc->count;
+        return 0;
+    }
+
+    int want = desc->count;
+    int soft = ps->limit * 3 / 4;
+    if (ps->count > soft)
+    {
+        want = want * (ps->limit - ps->count) / (ps->limit - soft);
+        if (want < 1)
+            want = 1;
+    }
+    if (want > ps->limit - ps->count)
+        want = ps->limit - ps->count;
+    ps->culled += (uint32_t)(desc->count - want);
+
+    for (int n = 0; n < want; n++)
+    {
+        int i = ps->count++;
+        float speed = desc->speed * (0.6f + 0.4f * fabsf(ParticleRandom(ps)));
+        Vector3 v = {dir.x + ParticleRandom(ps) * desc->spread,
+                     dir.y + ParticleRandom(ps) * desc->spread + desc->upBias,
+                     dir.z + ParticleRandom(ps) * desc->spread};
+        v = Vector3Scale(Vector3Normalize(v), speed);
+        ps->px[i] = origin.x;
+        ps->py[i] = origin.y;
+        ps->pz[i] = origin.z;
+        ps->vx[i] = v.x;
+        ps->vy[i] = v.y;
+        ps->vz[i] = v.z;
+        ps->drag[i] = desc->drag;
+        ps->life[i] = desc->life * (0.75f + 0.25f * ParticleRandom(ps));
+        ps->maxLife[i] = ps->life[i];
+        ps->size[i] = desc->size;
+        ps->color[i] = desc->color;
+    }
+    ps->emitted += (uint32_t)want;
+    return want;
+}
+
+#if defined(__GNUC__)
+typedef float ParticleLane __attribute__((vector_size(16)));
+typedef int32_t ParticleMask __attribute__((vector_size(16)));
+
+static ParticleLane ParticleSelect(ParticleMask mask, ParticleLane a, ParticleLane b)
+{
+    return (ParticleLane)(((ParticleMask)a & mask) | ((ParticleMask)b & ~mask));
+}
+
+static void ParticlesIntegrate(ParticleSystem *ps, float dt)
+{
+    const ParticleLane zero = {0.0f, 0.0f, 0.0f, 0.0f};
+    const ParticleLane one = zero + 1.0f;
+    const ParticleLane step = zero + dt;
+    const ParticleLane fall = zero + PARTICLE_GRAVITY * dt;
+    const ParticleLane ground = zero + PARTICLE_GROUND;
+    const ParticleLane bounce = zero - PARTICLE_BOUNCE;
+    const ParticleLane friction = zero + PARTICLE_FRICTION;
+    for (int i = 0; i < ps->count; i += PARTICLE_LANES)
+    {
+        ParticleLane *px = (ParticleLane *)&ps->px[i];
+        ParticleLane *py = (ParticleLane *)&ps->py[i];
+        ParticleLane *pz = (ParticleLane *)&ps->pz[i];
+        ParticleLane *vx = (ParticleLane *)&ps->vx[i];
+        ParticleLane *vy = (ParticleLane *)&ps->vy[i];
+        ParticleLane *vz = (ParticleLane *)&ps->vz[i];
+        ParticleLane damp = one - *(ParticleLane *)&ps->drag[i] * step;
+        damp = ParticleSelect(damp > zero, damp, zero);
+
+        ParticleLane x = *vx * damp;
+        ParticleLane y = *vy * damp - fall;
+        ParticleLane z = *vz * damp;
+        *px += x * step;
+        *py += y * step;
+        *pz += z * step;
+
+        ParticleMask below = *py < ground;
+        *py = ParticleSelect(below, ground, *py);
+        *vy = ParticleSelect(below, y * bounce, y);
+        *vx = ParticleSelect(below, x * friction, x);
+        *vz = ParticleSelect(below, z * friction, z);
+        *(ParticleLane *)&ps->life[i] -= step;
+    }
+}
+#else
+static void ParticlesIntegrate(ParticleSystem *ps, float dt)
+{
+    for (int i = 0; i < ps->count; i++)
+    {
+        float damp = 1.0f - ps->drag[i] * dt;
+        if (damp < 0.0f)
+            damp = 0.0f;
+        ps->vx[i] *= damp;
+        ps->vy[i] = ps->vy[i] * damp - PARTICLE_GRAVITY * dt;
+        ps->vz[i] *= damp;
+        ps->px[i] += ps->vx[i] * dt;
+        ps->py[i] += ps->vy[i] * dt;
+        ps->pz[i] += ps->vz[i] * dt;
+        if (ps->py[i] < PARTICLE_GROUND)
+        {
+            ps->py[i] = PARTICLE_GROUND;
+            ps->vy[i] *= -PARTICLE_BOUNCE;
+            ps->vx[i] *= PARTICLE_FRICTION;
+            ps->vz[i] *= PARTICLE_FRICTION;
+        }
+        ps->life[i] -= dt;
+    }
+}
+#endif
+
+// The packing shuffle is a single instruction with SSSE3 or NEON. Plain SSE2
+// has no variable shuffle, GCC splits it into scalar moves, and the scalar
+// loop below is then the faster of the two.
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__SSSE3__) || defined(__ARM_NEON))
+// Lane indices that pack the live lanes of a 4-bit mask to the front, in order.
+static const ParticleMask gParticlePack[16] = {
+    {0, 0, 0, 0}, {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0},
+    {2, 0, 0, 0}, {0, 2, 0, 0}, {1, 2, 0, 0}, {0, 1, 2, 0},
+    {3, 0, 0, 0}, {0, 3, 0, 0}, {1, 3, 0, 0}, {0, 1, 3, 0},
+    {2, 3, 0, 0}, {0, 2, 3, 0}, {1, 2, 3, 0}, {0, 1, 2, 3},
+};
+
+// Order-preserving stream compaction, four lanes at a time: each block's live
+// mask picks a shuffle that packs its survivors, and the whole lane is stored
+// at the write cursor. The cursor never passes the block being read and the
+// columns are padded to the lane width, so the spare lanes it writes land on
+// slots that have already been read or are past the live range.
+static void ParticlesCompact(ParticleSystem *ps)
+{
+    float *columns[] = {ps->px, ps->py, ps->pz, ps->vx, ps->vy, ps->vz, ps->drag, ps->life, ps->maxLife, ps->size};
+    const ParticleLane zero = {0.0f, 0.0f, 0.0f, 0.0f};
+    const ParticleMask lanes = {0, 1, 2, 3};
+    int live = 0;
+    for (int i = 0; i < ps->count; i += PARTICLE_LANES)
+    {
+        ParticleMask alive = (*(ParticleLane *)&ps->life[i] > zero) & ((lanes + i) < ps->count);
+        int bits = (alive[0] & 1) | (alive[1] & 2) | (alive[2] & 4) | (alive[3] & 8);
+        if (bits == 0)
+            continue;
+        if (bits == 15 && live == i)
+        {
+            live += PARTICLE_LANES;
+            continue;
+        }
+        ParticleMask pack = gParticlePack[bits];
+        for (size_t c = 0; c < sizeof(columns) / sizeof(columns[0]); c++)
+        {
+            ParticleLane v = __builtin_shuffle(*(ParticleLane *)&columns[c][i], pack);
+            memcpy(&columns[c][live], &v, sizeof(v));
+        }
+        ParticleMask color;
+        memcpy(&color, &ps->color[i], sizeof(color));
+        color = __builtin_shuffle(color, pack);
+        memcpy(&ps->color[live], &color, sizeof(color));
+        live += __builtin_popcount((unsigned)bits);
+    }
+    ps->count = live;
+}
+#else
+// Order-preserving compaction keeps the live range dense for the next step.
+static void ParticlesCompact(ParticleSystem *ps)
+{
+    int live = 0;
+    for (int i = 0; i < ps->count; i++)
+    {
+        if (ps->life[i] <= 0.0f)
+            continue;
+        if (live != i)
+        {
+            ps->px[live] = ps->px[i];
+            ps->py[live] = ps->py[i];
+            ps->pz[live] = ps->pz[i];
+            ps->vx[live] = ps->vx[i];
+            ps->vy[live] = ps->vy[i];
+            ps->vz[live] = ps->vz[i];
+            ps->drag[live] = ps->drag[i];
+            ps->life[live] = ps->life[i];
+            ps->maxLife[live] = ps->maxLife[i];
+            ps->size[live] = ps->size[i];
+            ps->color[live] = ps->color[i];
+        }
+        live++;
+    }
+    ps->count = live;
+}
+#endif
+
+void ParticlesSetLimit(ParticleSystem *ps, int limit)
+{
+    ps->limit = limit < 0 ? 0 : (limit > ps->capacity ? ps->capacity : limit);
+}
+
+void ParticlesUpdate(ParticleSystem *ps, float dt)
+{
+    if (ps->count == 0)
+        return;
+    ParticlesIntegrate(ps, dt);
+    ParticlesCompact(ps);
+}
+
+void ParticlesDraw(const ParticleSystem *ps, Camera3D camera, Texture2D texture)
+{
+    if (ps->count == 0)
+        return;
+    Vector3 forward = Vector3Normalize(Vector3Subtract(camera.target, camera.position));
+    Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, camera.up));
+    Vector3 up = Vector3CrossProduct(right, forward);
+
+    rlSetTexture(texture.id);
+    for (int start = 0; start < ps->count; start += PARTICLE_DRAW_CHUNK)
+    {
+        int end = start + PARTICLE_DRAW_CHUNK < ps->count ? start + PARTICLE_DRAW_CHUNK : ps->count;
+        rlCheckRenderBatchLimit((end - start) * 4);
+        rlBegin(RL_QUADS);
+        for (int i = start; i < end; i++)
+        {
+            float fade = ps->maxLife[i] > 0.0f ? Clamp(ps->life[i] / ps->maxLife[i], 0.0f, 1.0f) : 0.0f;
+            Color c = ps->color[i];
+            rlColor4ub(c.r, c.g, c.b, (unsigned char)(c.a * fade));
+            Vector3 r = Vector3Scale(right, ps->size[i]);
+            Vector3 u = Vector3Scale(up, ps->size[i]);
+            Vector3 p = {ps->px[i], ps->py[i], ps->pz[i]};
+            rlTexCoord2f(0.0f, 0.0f);
+            rlVertex3f(p.x - r.x + u.x, p.y - r.y + u.y, p.z - r.z + u.z);
+            rlTexCoord2f(0.0f, 1.0f);
+            rlVertex3f(p.x - r.x - u.x, p.y - r.y - u.y, p.z - r.z - u.z);
+            rlTexCoord2f(1.0f, 1.0f);
+            rlVertex3f(p.x + r.x - u.x, p.y + r.y - u.y, p.z + r.z - u.z);
+            rlTexCoord2f(1.0f, 0.0f);
+            rlVertex3f(p.x + r.x + u.x, p.y + r.y + u.y, p.z + r.z + u.z);
+        }
+        rlEnd();
+    }
+    rlSetTexture(0);
+}
@@ -0,0 +1,53 @@
+#ifndef U8_PARTICLES_H
+#define U8_PARTICLES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "raylib.h"
+#include "region.h"
+
+#define PARTICLE_BUDGET 1024
+
+typedef enum ParticleEmitter
+{
+    PARTICLE_HIT_SPURT,
+    PARTICLE_DISSOLVE_DUST,
+    PARTICLE_SPIT_SPLASH,
+    PARTICLE_EMITTER_COUNT
+} ParticleEmitter;
+
+// Structure-of-arrays storage; every column is 16-byte aligned and padded to a
+// multiple of four so the integrator can step four particles per lane.
+typedef struct ParticleSystem
+{
+    float *px;
+    float *py;
+    float *pz;
+    float *vx;
+    float *vy;
+    float *vz;
+    float *drag;
+    float *life;
+    float *maxLife;
+    float *size;
+    Color *color;
+    int count;
+    int capacity;
+    int limit;
+    uint32_t rng;
+    uint32_t emitted;
+    uint32_t culled;
+} ParticleSystem;
+
+bool ParticlesInit(ParticleSystem *ps, MemRegion region, int capacity);
+// Emits one burst along dir. Past three quarters of the budget bursts thin out
+// instead of failing outright; returns how many particles were spawned.
+int ParticlesEmit(ParticleSystem *ps, ParticleEmitter emitter, Vector3 origin, Vector3 dir);
+// Lowers the live budget below the allocated capacity; particles already past it fade out normally.
+void ParticlesSetLimit(ParticleSystem *ps, int limit);
+void ParticlesUpdate(ParticleSystem *ps, float dt);
+// Camera-facing quads through one rlgl batch and a single texture bind; call inside BeginMode3D.
+void ParticlesDraw(const ParticleSystem *ps, Camera3D camera, Texture2D texture);
+
+#endif
@@ -0,0 +1,122 @@
+#include "predict.h"
+
+#include <math.h>
+#include <string.h>
+
+#define PREDICT_SMOOTH_RATE 12.0f
+#define PREDICT_SNAP_DISTANCE 2.0f
+
+Vector3 ApplyMoveInput(Vector3 position, const MoveInput *input)
+{
+    float fx = sinf(input->yaw);
+    float fz = cosf(input->yaw);
+    // right = forward x up, normalised (forward is already unit length on the ground plane)
+    float rx = -fz;
+    float rz = fx;
+    float step = input->speed * input->dt;
+    if (input->keys & MOVE_KEY_FORWARD)
+    {
+        position.x += fx * step;
+        position.z += fz * step;
+    }
+    if (input->keys & MOVE_KEY_BACK)
+    {
+        position.x -= fx * step;
+        position.z -= fz * step;
+    }
+    if (input->keys & MOVE_KEY_LEFT)
+    {
+        position.x -= rx * step;
+        position.z -= rz * step;
+    }
+    if (input->keys & MOVE_KEY_RIGHT)
+    {
+        position.x += rx * step;
+        position.z += rz * step;
+    }
+    return position;
+}
+
+void PredictReset(PredictionBuffer *buf)
+{
+    uint16_t nextSeq = buf->nextSeq;
+    memset(buf, 0, sizeof(*buf));
+    buf->nextSeq = nextSeq;
+    buf->ackSeq = (uint16_t)(nextSeq - 1);
+}
+
+uint16_t PredictRecord(PredictionBuffer *buf, MoveInput *input, Vector3 predicted)
+{
+    input->seq = buf->nextSeq++;
+    // A full ring means the authority has gone quiet; the oldest input is dropped.
+    if (buf->count == PREDICT_HISTORY)
+    {
+        buf->count--;
+        buf->ackSeq++;
+    }
+    int slot = input->seq % PREDICT_HISTORY;
+    buf->inputs[slot] = *input;
+    buf->predicted[slot] = predicted;
+    buf->count++;
+    return input->seq;
+}
+
+bool PredictLatest(const PredictionBuffer *buf, Vector3 *predicted)
+{
+    if (buf->count == 0)
+        return false;
+    *predicted = buf->predicted[(uint16_t)(buf->nextSeq - 1) % PREDICT_HISTORY];
+    return true;
+}
+
+bool PredictReconcile(PredictionBuffer *buf, uint16_t ackSeq, Vector3 authority, bool forced)
+{
+    int16_t ahead = (int16_t)(ackSeq - buf->ackSeq);
+    int16_t pending = (int16_t)(buf->nextSeq - ackSeq);
+    if (ahead <= 0 || pending <= 0 || buf->count == 0)
+        return false;
+
+    buf->count -= ahead;
+    if (buf->count < 0)
+        buf->count = 0;
+    buf->ackSeq = ackSeq;
+
+    Vector3 mine = buf->predicted[ackSeq % PREDICT_HISTORY];
+    float dx = mine.x - authority.x;
+    float dz = mine.z - authority.z;
+    if (!forced && dx * dx + dz * dz <= PREDICT_TOLERANCE * PREDICT_TOLERANCE)
+        return false;
+
+    // Rewind to the authority's answer and replay everything it has not seen yet.
+    Vector3 before = buf->predicted[(uint16_t)(buf->nextSeq - 1) % PREDICT_HISTORY];
+    Vector3 position = authority;
+    position.y = mine.y;
+    for (uint16_t seq = (uint16_t)(ackSeq + 1); seq != buf->nextSeq; seq++)
+    {
+        int slot = seq % PREDICT_HISTORY;
+        position = ApplyMoveInput(position, &buf->inputs[slot]);
+        buf->predicted[slot] = position;
+    }
+    buf->correction.x += position.x - before.x;
+    buf->correction.z += position.z - before.z;
+    buf->corrections++;
+    return true;
+}
+
+Vector3 PredictCorrectionStep(PredictionBuffer *buf, float dt)
+{
+    Vector3 step = buf->correction;
+    float dist = sqrtf(step.x * step.x + step.z * step.z);
+    if (dist < PREDICT_SNAP_DISTANCE)
+    {
+        float t = dt * PREDICT_SMOOTH_RATE;
+        if (t > 1.0f)
+            t = 1.0f;
+        step.x *= t;
+        step.z *= t;
+    }
+    buf->correction.x -= step.x;
+    buf->correction.z -= step.z;
+    step.y = 0.0f;
+    return step;
+}
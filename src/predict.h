@@ -0,0 +1,55 @@
+#ifndef U8_PREDICT_H
+#define U8_PREDICT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "raylib.h"
+
+#define PREDICT_HISTORY 64
+#define PREDICT_TOLERANCE 0.05f
+
+typedef enum MoveKey
+{
+    MOVE_KEY_FORWARD = 1 << 0,
+    MOVE_KEY_BACK = 1 << 1,
+    MOVE_KEY_LEFT = 1 << 2,
+    MOVE_KEY_RIGHT = 1 << 3
+} MoveKey;
+
+typedef struct MoveInput
+{
+    uint16_t seq;
+    uint8_t keys;
+    float yaw;
+    float speed;
+    float dt;
+} MoveInput;
+
+// Inputs the authority has not confirmed yet, each with the position the
+// client predicted after applying it.
+typedef struct PredictionBuffer
+{
+    MoveInput inputs[PREDICT_HISTORY];
+    Vector3 predicted[PREDICT_HISTORY];
+    uint16_t nextSeq;
+    uint16_t ackSeq;
+    int count;
+    // Error left over from reconciliation, bled into the camera over a few frames.
+    Vector3 correction;
+    uint32_t corrections;
+} PredictionBuffer;
+
+// The one movement step shared by local play, prediction replay and host validation.
+Vector3 ApplyMoveInput(Vector3 position, const MoveInput *input);
+
+void PredictReset(PredictionBuffer *buf);
+uint16_t PredictRecord(PredictionBuffer *buf, MoveInput *input, Vector3 predicted);
+bool PredictLatest(const PredictionBuffer *buf, Vector3 *predicted);
+// Drops inputs up to ackSeq; if the authority disagrees it rewinds to its
+// position and replays the newer inputs. Returns true when a correction was queued.
+bool PredictReconcile(PredictionBuffer *buf, uint16_t ackSeq, Vector3 authority, bool forced);
+// Portion of the pending correction to apply this frame.
+Vector3 PredictCorrectionStep(PredictionBuffer *buf, float dt);
+
+#endif
@@ -0,0 +1,326 @@
+#define _GNU_SOURCE
+#include "profile.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "task.h"
+
+#define PROFILE_PMU_DEPTH 8
+// Threads whose zone stacks another thread can see; zones are opened by the
+// frame graph's threads, so one per worker.
+#define PROFILE_ZONE_THREADS TASK_MAX_WORKERS
+
+typedef struct ProfileState
+{
+    uint64_t zoneNs[PROFILE_ZONE_COUNT];
+    uint32_t counters[PROFILE_COUNTER_COUNT];
+    uint64_t pmu[PROFILE_ZONE_COUNT][PROFILE_PMU_COUNT];
+    uint64_t lastFrameEndNs;
+    uint64_t frameIndex;
+    ProfilePmuMode pmuMode;
+} ProfileState;
+
+static ProfileState gProfile;
+
+// Start times of every registered thread's open zones. A zone closed on
+// another thread has its entry zeroed there, and the opening thread pops it.
+static uint64_t gZoneStarts[PROFILE_ZONE_THREADS][PROFILE_PMU_DEPTH];
+static uint32_t gZoneThreadCount;
+
+// Each thread reads its own counter group; the stack holds the readings taken
+// when its open zones began, keyed by their start times.
+static __thread bool tPmuOpened;
+static __thread int tPmuFd = -1;
+static __thread int tPmuSlot[PROFILE_PMU_COUNT];
+static __thread uint64_t tPmuStart[PROFILE_PMU_DEPTH][PROFILE_PMU_COUNT];
+static __thread uint64_t tZoneStartsLocal[PROFILE_PMU_DEPTH];
+static __thread uint64_t *tZoneStartNs;
+static __thread int tPmuDepth;
+
+static const struct
+{
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} gPmuEvents[][PROFILE_PMU_COUNT] = {
+    [PROFILE_PMU_HARDWARE] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache_misses"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch_misses"},
+    },
+    [PROFILE_PMU_SOFTWARE] = {
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, "task_clock_ns"},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, "page_faults"},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "ctx_switches"},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS, "cpu_migrations"},
+    },
+    [PROFILE_PMU_RUSAGE] = {
+        {0, 0, "minor_faults"},
+        {0, 0, "major_faults"},
+        {0, 0, "vol_switches"},
+        {0, 0, "invol_switches"},
+    },
+};
+
+static const char *gZoneNames[PROFILE_ZONE_COUNT] = {
+    [PROFILE_ZONE_LAN] = "lan",
+    [PROFILE_ZONE_ZOMBIES] = "zombies",
+    [PROFILE_ZONE_COMBAT] = "combat",
+    [PROFILE_ZONE_RENDER] = "render",
+    [PROFILE_ZONE_PRESENT] = "present",
+    [PROFILE_ZONE_CONTROL] = "control",
+};
+
+static const char *gCounterNames[PROFILE_COUNTER_COUNT] = {
+    [PROFILE_COUNTER_PACKETS_IN] = "packets_in",
+    [PROFILE_COUNTER_PACKETS_OUT] = "packets_out",
+    [PROFILE_COUNTER_BYTES_IN] = "bytes_in",
+    [PROFILE_COUNTER_BYTES_OUT] = "bytes_out",
+    [PROFILE_COUNTER_ALLOCATIONS] = "allocations",
+    [PROFILE_COUNTER_CODEC_NS] = "codec_ns",
+    [PROFILE_COUNTER_OCCLUSION_TESTED] = "occl_tested",
+    [PROFILE_COUNTER_OCCLUSION_CULLED] = "occl_culled",
+};
+
+uint64_t ProfileNowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void ProfileSleepUntilNs(uint64_t deadlineNs)
+{
+    struct timespec ts = {(time_t)(deadlineNs / 1000000000ull), (long)(deadlineNs % 1000000000ull)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        continue;
+}
+
+static int PmuOpen(ProfilePmuMode mode, int slot, int group)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = gPmuEvents[mode][slot].type;
+    attr.config = gPmuEvents[mode][slot].config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+// Events missing on this CPU leave their slot reading zero; only the group
+// leader is required.
+static bool PmuOpenGroup(ProfilePmuMode mode)
+{
+    int members = 0;
+    for (int k = 0; k < PROFILE_PMU_COUNT; k++)
+    {
+        int fd = PmuOpen(mode, k, k == 0 ? -1 : tPmuFd);
+        if (k == 0)
+        {
+            if (fd < 0)
+                return false;
+            tPmuFd = fd;
+        }
+        tPmuSlot[k] = fd >= 0 ? members++ : -1;
+    }
+    return true;
+}
+
+static void PmuRead(uint64_t out[PROFILE_PMU_COUNT])
+{
+    if (gProfile.pmuMode == PROFILE_PMU_RUSAGE)
+    {
+        struct rusage usage;
+        memset(out, 0, sizeof(uint64_t) * PROFILE_PMU_COUNT);
+        if (getrusage(RUSAGE_THREAD, &usage) != 0)
+            return;
+        out[0] = (uint64_t)usage.ru_minflt;
+        out[1] = (uint64_t)usage.ru_majflt;
+        out[2] = (uint64_t)usage.ru_nvcsw;
+        out[3] = (uint64_t)usage.ru_nivcsw;
+        return;
+    }
+    // PERF_FORMAT_GROUP: member count, then one value per member in open order.
+    uint64_t values[1 + PROFILE_PMU_COUNT] = {0};
+    if (tPmuFd < 0 || read(tPmuFd, values, sizeof(values)) <= 0)
+        values[0] = 0;
+    for (int k = 0; k < PROFILE_PMU_COUNT; k++)
+        out[k] = tPmuSlot[k] >= 0 && (uint64_t)tPmuSlot[k] < values[0] ? values[1 + tPmuSlot[k]] : 0;
+}
+
+static bool PmuThreadReady(void)
+{
+    if (gProfile.pmuMode == PROFILE_PMU_OFF)
+        return false;
+    if (!tPmuOpened)
+    {
+        tPmuOpened = true;
+        if (gProfile.pmuMode != PROFILE_PMU_RUSAGE)
+            PmuOpenGroup(gProfile.pmuMode);
+    }
+    return gProfile.pmuMode == PROFILE_PMU_RUSAGE || tPmuFd >= 0;
+}
+
+// Past PROFILE_ZONE_THREADS a thread keeps a private stack, and zones it
+// opens can only be closed on it.
+static uint64_t *ZoneStack(void)
+{
+    if (!tZoneStartNs)
+    {
+        uint32_t slot = __atomic_fetch_add(&gZoneThreadCount, 1, __ATOMIC_RELAXED);
+        tZoneStartNs = slot < PROFILE_ZONE_THREADS ? gZoneStarts[slot] : tZoneStartsLocal;
+    }
+    return tZoneStartNs;
+}
+
+static void ZonePopClosed(const uint64_t *starts)
+{
+    while (tPmuDepth > 0 && tPmuDepth <= PROFILE_PMU_DEPTH &&
+           __atomic_load_n(&starts[tPmuDepth - 1], __ATOMIC_RELAXED) == 0)
+        tPmuDepth--;
+}
+
+static void ZoneCloseElsewhere(uint64_t startNs)
+{
+    uint32_t count = __atomic_load_n(&gZoneThreadCount, __ATOMIC_RELAXED);
+    if (count > PROFILE_ZONE_THREADS)
+        count = PROFILE_ZONE_THREADS;
+    for (uint32_t t = 0; t < count; t++)
+    {
+        for (int d = 0; d < PROFILE_PMU_DEPTH; d++)
+        {
+            uint64_t expected = startNs;
+            if (__atomic_compare_exchange_n(&gZoneStarts[t][d], &expected, 0, false, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+                return;
+        }
+    }
+}
+
+uint64_t ProfileZoneBegin(void)
+{
+    uint64_t *starts = ZoneStack();
+    ZonePopClosed(starts);
+    if (PmuThreadReady() && tPmuDepth < PROFILE_PMU_DEPTH)
+        PmuRead(tPmuStart[tPmuDepth]);
+    uint64_t startNs = ProfileNowNs();
+    if (tPmuDepth < PROFILE_PMU_DEPTH)
+        __atomic_store_n(&starts[tPmuDepth], startNs, __ATOMIC_RELAXED);
+    tPmuDepth++;
+    return startNs;
+}
+
+void ProfileZoneEnd(ProfileZone zone, uint64_t startNs)
+{
+    __atomic_fetch_add(&gProfile.zoneNs[zone], ProfileNowNs() - startNs, __ATOMIC_RELAXED);
+    uint64_t *starts = ZoneStack();
+    ZonePopClosed(starts);
+    // A zone this thread did not open has no readings here; mark it closed
+    // on the thread that did, which drops it from its stack.
+    int top = tPmuDepth - 1;
+    if (top < 0 || (top < PROFILE_PMU_DEPTH && __atomic_load_n(&starts[top], __ATOMIC_RELAXED) != startNs))
+    {
+        ZoneCloseElsewhere(startNs);
+        return;
+    }
+    tPmuDepth = top;
+    if (top < PROFILE_PMU_DEPTH)
+        __atomic_store_n(&starts[top], 0, __ATOMIC_RELAXED);
+    if (tPmuDepth >= PROFILE_PMU_DEPTH || !PmuThreadReady())
+        return;
+    uint64_t now[PROFILE_PMU_COUNT];
+    PmuRead(now);
+    for (int k = 0; k < PROFILE_PMU_COUNT; k++)
+        __atomic_fetch_add(&gProfile.pmu[zone][k], now[k] - tPmuStart[tPmuDepth][k], __ATOMIC_RELAXED);
+}
+
+void ProfileCount(ProfileCounter counter, uint32_t amount)
+{
+    __atomic_fetch_add(&gProfile.counters[counter], amount, __ATOMIC_RELAXED);
+}
+
+void ProfileBeginFrame(void)
+{
+    if (gProfile.lastFrameEndNs == 0)
+        gProfile.lastFrameEndNs = ProfileNowNs();
+}
+
+void ProfileEndFrame(ProfileFrame *out)
+{
+    uint64_t now = ProfileNowNs();
+    if (out)
+    {
+        out->index = gProfile.frameIndex;
+        out->frameMs = (float)(now - gProfile.lastFrameEndNs) / 1e6f;
+        for (int i = 0; i < PROFILE_ZONE_COUNT; i++)
+            out->zoneMs[i] = (float)__atomic_load_n(&gProfile.zoneNs[i], __ATOMIC_RELAXED) / 1e6f;
+        for (int i = 0; i < PROFILE_COUNTER_COUNT; i++)
+            out->counters[i] = __atomic_load_n(&gProfile.counters[i], __ATOMIC_RELAXED);
+        for (int z = 0; z < PROFILE_ZONE_COUNT; z++)
+        {
+            for (int k = 0; k < PROFILE_PMU_COUNT; k++)
+                out->pmu[z][k] = __atomic_load_n(&gProfile.pmu[z][k], __ATOMIC_RELAXED);
+        }
+        out->activeEnemies = 0;
+    }
+    for (int i = 0; i < PROFILE_ZONE_COUNT; i++)
+        __atomic_store_n(&gProfile.zoneNs[i], 0, __ATOMIC_RELAXED);
+    for (int i = 0; i < PROFILE_COUNTER_COUNT; i++)
+        __atomic_store_n(&gProfile.counters[i], 0, __ATOMIC_RELAXED);
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++)
+    {
+        for (int k = 0; k < PROFILE_PMU_COUNT; k++)
+            __atomic_store_n(&gProfile.pmu[z][k], 0, __ATOMIC_RELAXED);
+    }
+    gProfile.lastFrameEndNs = now;
+    gProfile.frameIndex++;
+}
+
+const char *ProfileZoneName(ProfileZone zone)
+{
+    return (zone >= 0 && zone < PROFILE_ZONE_COUNT) ? gZoneNames[zone] : "?";
+}
+
+const char *ProfileCounterName(ProfileCounter counter)
+{
+    return (counter >= 0 && counter < PROFILE_COUNTER_COUNT) ? gCounterNames[counter] : "?";
+}
+
+ProfilePmuMode ProfileEnablePmu(void)
+{
+    if (gProfile.pmuMode != PROFILE_PMU_OFF)
+        return gProfile.pmuMode;
+    // Group members stay open for the life of the thread: closing one would
+    // also drop it from the leader's group.
+    tPmuOpened = true;
+    if (PmuOpenGroup(PROFILE_PMU_HARDWARE))
+        gProfile.pmuMode = PROFILE_PMU_HARDWARE;
+    else if (PmuOpenGroup(PROFILE_PMU_SOFTWARE))
+        gProfile.pmuMode = PROFILE_PMU_SOFTWARE;
+    else
+        gProfile.pmuMode = PROFILE_PMU_RUSAGE;
+    return gProfile.pmuMode;
+}
+
+ProfilePmuMode ProfilePmuActive(void)
+{
+    return gProfile.pmuMode;
+}
+
+const char *ProfilePmuName(int slot)
+{
+    if (gProfile.pmuMode == PROFILE_PMU_OFF || slot < 0 || slot >= PROFILE_PMU_COUNT)
+        return "?";
+    return gPmuEvents[gProfile.pmuMode][slot].name;
+}
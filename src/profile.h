@@ -0,0 +1,74 @@
+#ifndef U8_PROFILE_H
+#define U8_PROFILE_H
+
+#include <stdint.h>
+
+typedef enum ProfileZone
+{
+    PROFILE_ZONE_LAN,
+    PROFILE_ZONE_ZOMBIES,
+    PROFILE_ZONE_COMBAT,
+    PROFILE_ZONE_RENDER,
+    PROFILE_ZONE_PRESENT,
+    PROFILE_ZONE_CONTROL,
+    PROFILE_ZONE_COUNT
+} ProfileZone;
+
+typedef enum ProfileCounter
+{
+    PROFILE_COUNTER_PACKETS_IN,
+    PROFILE_COUNTER_PACKETS_OUT,
+    PROFILE_COUNTER_BYTES_IN,
+    PROFILE_COUNTER_BYTES_OUT,
+    PROFILE_COUNTER_ALLOCATIONS,
+    PROFILE_COUNTER_CODEC_NS,
+    PROFILE_COUNTER_OCCLUSION_TESTED,
+    PROFILE_COUNTER_OCCLUSION_CULLED,
+    PROFILE_COUNTER_COUNT
+} ProfileCounter;
+
+#define PROFILE_PMU_COUNT 4
+
+// What the per-zone CPU counters measure. Hardware is cycles, instructions,
+// cache misses and branch misses; without a PMU the same four slots hold
+// kernel software events, and without perf_event_open at all, getrusage.
+typedef enum ProfilePmuMode
+{
+    PROFILE_PMU_OFF,
+    PROFILE_PMU_HARDWARE,
+    PROFILE_PMU_SOFTWARE,
+    PROFILE_PMU_RUSAGE
+} ProfilePmuMode;
+
+typedef struct ProfileFrame
+{
+    uint64_t index;
+    float frameMs;
+    float zoneMs[PROFILE_ZONE_COUNT];
+    uint32_t counters[PROFILE_COUNTER_COUNT];
+    uint64_t pmu[PROFILE_ZONE_COUNT][PROFILE_PMU_COUNT];
+    int activeEnemies;
+} ProfileFrame;
+
+uint64_t ProfileNowNs(void);
+// Sleeps until ProfileNowNs() reaches deadlineNs, for fixed-rate loops.
+void ProfileSleepUntilNs(uint64_t deadlineNs);
+// Time is accumulated per zone for the frame across all threads. A zone must
+// close on the thread that opened it, in the reverse order zones opened there;
+// one closed elsewhere still counts its time but gets no PMU readings, and the
+// opening thread drops it from its stack at its next zone call.
+uint64_t ProfileZoneBegin(void);
+void ProfileZoneEnd(ProfileZone zone, uint64_t startNs);
+void ProfileCount(ProfileCounter counter, uint32_t amount);
+void ProfileBeginFrame(void);
+// Closes the frame and resets the accumulators; pass NULL to discard it (menus, loading).
+void ProfileEndFrame(ProfileFrame *out);
+const char *ProfileZoneName(ProfileZone zone);
+const char *ProfileCounterName(ProfileCounter counter);
+// Opt-in; picks the best counter source this machine allows. Threads open
+// their own counters the first time they enter a zone.
+ProfilePmuMode ProfileEnablePmu(void);
+ProfilePmuMode ProfilePmuActive(void);
+const char *ProfilePmuName(int slot);
+
+#endif
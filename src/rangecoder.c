@@ -0,0 +1,143 @@
+#include "rangecoder.h"
+
+#define RC_TOP (1u << 24)
+
+static void RcPutByte(RangeEncoder *rc, uint8_t byte)
+{
+    // The first byte out of the carry buffer is always zero; the decoder
+    // assumes it, so it never goes on the wire.
+    if (rc->first)
+    {
+        rc->first = false;
+        return;
+    }
+    if (rc->size >= rc->capacity)
+    {
+        rc->overflow = true;
+        return;
+    }
+    rc->out[rc->size++] = byte;
+}
+
+static void RcShiftLow(RangeEncoder *rc)
+{
+    if ((uint32_t)rc->low < 0xFF000000u || (rc->low >> 32) != 0)
+    {
+        uint8_t carry = (uint8_t)(rc->low >> 32);
+        uint8_t temp = rc->cache;
+        do
+        {
+            RcPutByte(rc, (uint8_t)(temp + carry));
+            temp = 0xFF;
+        } while (--rc->cacheSize != 0);
+        rc->cache = (uint8_t)((uint32_t)rc->low >> 24);
+    }
+    rc->cacheSize++;
+    rc->low = (uint64_t)((uint32_t)rc->low << 8);
+}
+
+void RcEncoderInit(RangeEncoder *rc, uint8_t *out, size_t capacity)
+{
+    rc->low = 0;
+    rc->range = 0xFFFFFFFFu;
+    rc->cache = 0;
+    rc->cacheSize = 1;
+    rc->first = true;
+    rc->out = out;
+    rc->size = 0;
+    rc->capacity = capacity;
+    rc->overflow = false;
+}
+
+void RcEncodeBit(RangeEncoder *rc, RcProb *prob, int bit)
+{
+    uint32_t bound = (rc->range >> RC_PROB_BITS) * *prob;
+    if (!bit)
+    {
+        rc->range = bound;
+        *prob += (RC_PROB_ONE - *prob) >> RC_ADAPT_SHIFT;
+    }
+    else
+    {
+        rc->low += bound;
+        rc->range -= bound;
+        *prob -= *prob >> RC_ADAPT_SHIFT;
+    }
+    while (rc->range < RC_TOP)
+    {
+        rc->range <<= 8;
+        RcShiftLow(rc);
+    }
+}
+
+void RcEncodeTree(RangeEncoder *rc, RcProb *probs, int numBits, uint32_t value)
+{
+    uint32_t m = 1;
+    for (int i = numBits - 1; i >= 0; i--)
+    {
+        int bit = (int)((value >> i) & 1u);
+        RcEncodeBit(rc, &probs[m], bit);
+        m = (m << 1) | (uint32_t)bit;
+    }
+}
+
+size_t RcEncoderFinish(RangeEncoder *rc)
+{
+    for (int i = 0; i < 5; i++)
+        RcShiftLow(rc);
+    if (rc->overflow)
+        return 0;
+    // The decoder reads zeros past the end, so trailing zeros are free to drop.
+    while (rc->size > 0 && rc->out[rc->size - 1] == 0)
+        rc->size--;
+    return rc->size;
+}
+
+static uint8_t RcNextByte(RangeDecoder *rc)
+{
+    return rc->pos < rc->size ? rc->in[rc->pos++] : 0;
+}
+
+void RcDecoderInit(RangeDecoder *rc, const uint8_t *in, size_t size)
+{
+    rc->in = in;
+    rc->size = size;
+    rc->pos = 0;
+    rc->range = 0xFFFFFFFFu;
+    rc->code = 0;
+    for (int i = 0; i < 4; i++)
+        rc->code = (rc->code << 8) | RcNextByte(rc);
+}
+
+int RcDecodeBit(RangeDecoder *rc, RcProb *prob)
+{
+    uint32_t bound = (rc->range >> RC_PROB_BITS) * *prob;
+    int bit;
+    if (rc->code < bound)
+    {
+        rc->range = bound;
+        *prob += (RC_PROB_ONE - *prob) >> RC_ADAPT_SHIFT;
+        bit = 0;
+    }
+    else
+    {
+        rc->code -= bound;
+        rc->range -= bound;
+        *prob -= *prob >> RC_ADAPT_SHIFT;
+        bit = 1;
+    }
+    while (rc->range < RC_TOP)
+    {
+        rc->range <<= 8;
+        rc->code = (rc->code << 8) | RcNextByte(rc);
+    }
+    return bit;
+}
+
+uint32_t RcDecodeTree(RangeDecoder *rc, RcProb *probs, int numBits)
+{
+    uint32_t m = 1;
+    for (int i = 0; i < numBits; i++)
+        m = (m << 1) | (uint32_t)RcDecodeBit(rc, &probs[m]);
+    return m - (1u << numBits);
+}
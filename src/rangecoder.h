@@ -0,0 +1,50 @@
+#ifndef U8_RANGECODER_H
+#define U8_RANGECODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary adaptive range coder: every decision is coded against an 11-bit
+// probability that moves toward the observed bit by 1/32 of the gap.
+#define RC_PROB_BITS 11
+#define RC_PROB_ONE (1u << RC_PROB_BITS)
+#define RC_PROB_HALF (RC_PROB_ONE / 2)
+#define RC_ADAPT_SHIFT 5
+
+typedef uint16_t RcProb;
+
+typedef struct RangeEncoder
+{
+    uint64_t low;
+    uint32_t range;
+    uint8_t cache;
+    uint32_t cacheSize;
+    bool first;
+    uint8_t *out;
+    size_t size;
+    size_t capacity;
+    bool overflow;
+} RangeEncoder;
+
+typedef struct RangeDecoder
+{
+    uint32_t code;
+    uint32_t range;
+    const uint8_t *in;
+    size_t size;
+    size_t pos;
+} RangeDecoder;
+
+void RcEncoderInit(RangeEncoder *rc, uint8_t *out, size_t capacity);
+void RcEncodeBit(RangeEncoder *rc, RcProb *prob, int bit);
+// Codes the low numBits of value MSB first through a (1 << numBits) entry tree.
+void RcEncodeTree(RangeEncoder *rc, RcProb *probs, int numBits, uint32_t value);
+// Returns the byte count, or 0 if the output buffer was too small.
+size_t RcEncoderFinish(RangeEncoder *rc);
+
+void RcDecoderInit(RangeDecoder *rc, const uint8_t *in, size_t size);
+int RcDecodeBit(RangeDecoder *rc, RcProb *prob);
+uint32_t RcDecodeTree(RangeDecoder *rc, RcProb *probs, int numBits);
+
+#endif
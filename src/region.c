@@ -0,0 +1,131 @@
+#include "region.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "profile.h"
+
+#define REGION_ALIGN 16
+
+typedef struct Region
+{
+    const char *name;
+    size_t budget;
+    uint8_t *base;
+    size_t used;
+    size_t highWater;
+    uint32_t allocations;
+    uint32_t overflows;
+} Region;
+
+static Region gRegions[MEM_REGION_COUNT] = {
+    [MEM_REGION_SIM] = {.name = "sim", .budget = 256 * 1024},
+    [MEM_REGION_NETWORK] = {.name = "network", .budget = 128 * 1024},
+    [MEM_REGION_FX] = {.name = "fx", .budget = 256 * 1024},
+    [MEM_REGION_AUDIO] = {.name = "audio", .budget = 256 * 1024},
+    [MEM_REGION_RENDER] = {.name = "render", .budget = 512 * 1024},
+    [MEM_REGION_SCRATCH] = {.name = "scratch", .budget = 128 * 1024},
+};
+
+static uint8_t *gReservation;
+
+size_t RegionTotalBudget(void)
+{
+    size_t total = 0;
+    for (int i = 0; i < MEM_REGION_COUNT; i++)
+        total += gRegions[i].budget;
+    return total;
+}
+
+bool RegionInit(void)
+{
+    size_t total = RegionTotalBudget();
+    gReservation = (uint8_t *)malloc(total);
+    if (!gReservation)
+        return false;
+    // Touch every page now so the resident size is fixed from the first frame.
+    memset(gReservation, 0, total);
+
+    uint8_t *cursor = gReservation;
+    for (int i = 0; i < MEM_REGION_COUNT; i++)
+    {
+        gRegions[i].base = cursor;
+        gRegions[i].used = 0;
+        gRegions[i].highWater = 0;
+        gRegions[i].allocations = 0;
+        gRegions[i].overflows = 0;
+        cursor += gRegions[i].budget;
+    }
+    return true;
+}
+
+void RegionShutdown(void)
+{
+    free(gReservation);
+    gReservation = NULL;
+    for (int i = 0; i < MEM_REGION_COUNT; i++)
+        gRegions[i].base = NULL;
+}
+
+void *RegionAlloc(MemRegion region, size_t size)
+{
+    if (region < 0 || region >= MEM_REGION_COUNT || !gRegions[region].base)
+        return NULL;
+
+    Region *r = &gRegions[region];
+    size_t aligned = (size + REGION_ALIGN - 1) & ~(size_t)(REGION_ALIGN - 1);
+    size_t offset = __atomic_load_n(&r->used, __ATOMIC_RELAXED);
+    do
+    {
+        if (offset + aligned > r->budget)
+        {
+            __atomic_fetch_add(&r->overflows, 1, __ATOMIC_RELAXED);
+            LogWrite(LOG_REGION_OVERFLOW, (int)region, (int)size, (int)(r->budget - offset));
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&r->used, &offset, offset + aligned, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    size_t high = __atomic_load_n(&r->highWater, __ATOMIC_RELAXED);
+    while (offset + aligned > high &&
+           !__atomic_compare_exchange_n(&r->highWater, &high, offset + aligned, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+    __atomic_fetch_add(&r->allocations, 1, __ATOMIC_RELAXED);
+    ProfileCount(PROFILE_COUNTER_ALLOCATIONS, 1);
+
+    void *ptr = r->base + offset;
+    // Scratch is recycled every frame; long-lived regions are still zero from RegionInit.
+    if (region == MEM_REGION_SCRATCH)
+        memset(ptr, 0, aligned);
+    return ptr;
+}
+
+void RegionResetScratch(void)
+{
+    __atomic_store_n(&gRegions[MEM_REGION_SCRATCH].used, 0, __ATOMIC_RELEASE);
+}
+
+RegionStats RegionGetStats(MemRegion region)
+{
+    RegionStats stats = {0};
+    if (region < 0 || region >= MEM_REGION_COUNT)
+        return stats;
+    const Region *r = &gRegions[region];
+    stats.name = r->name;
+    stats.budget = r->budget;
+    stats.used = __atomic_load_n(&r->used, __ATOMIC_RELAXED);
+    stats.highWater = __atomic_load_n(&r->highWater, __ATOMIC_RELAXED);
+    stats.allocations = __atomic_load_n(&r->allocations, __ATOMIC_RELAXED);
+    stats.overflows = __atomic_load_n(&r->overflows, __ATOMIC_RELAXED);
+    return stats;
+}
+
+void RegionLogReport(void)
+{
+    for (int i = 0; i < MEM_REGION_COUNT; i++)
+    {
+        RegionStats stats = RegionGetStats((MemRegion)i);
+        LogWrite(LOG_REGION_REPORT, i, (int)stats.highWater, (int)stats.budget, (int)stats.overflows);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef U8_REGION_H
+#define U8_REGION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// All long-lived game memory comes out of one reservation made at startup and
+// carved into fixed budgets, so the footprint is known before the first frame.
+typedef enum MemRegion
+{
+    MEM_REGION_SIM,
+    MEM_REGION_NETWORK,
+    MEM_REGION_FX,
+    MEM_REGION_AUDIO,
+    MEM_REGION_RENDER,
+    MEM_REGION_SCRATCH,
+    MEM_REGION_COUNT
+} MemRegion;
+
+typedef struct RegionStats
+{
+    const char *name;
+    size_t budget;
+    size_t used;
+    size_t highWater;
+    uint32_t allocations;
+    uint32_t overflows;
+} RegionStats;
+
+bool RegionInit(void);
+void RegionShutdown(void);
+// Returns zeroed, 16-byte aligned memory, or NULL (and records an overflow) when the budget is spent.
+void *RegionAlloc(MemRegion region, size_t size);
+// Per-frame scratch is released wholesale at the top of every frame.
+void RegionResetScratch(void);
+RegionStats RegionGetStats(MemRegion region);
+size_t RegionTotalBudget(void);
+void RegionLogReport(void);
+
+#endif
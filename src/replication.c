@@ -0,0 +1,84 @@
+#include "replication.h"
+
+#include <math.h>
+#include <string.h>
+
+#define REPLICATION_VISIBLE_SCALE 2.0f
+#define REPLICATION_CHANGE_BOOST 0.5f
+#define REPLICATION_SPAWN_BOOST 10.0f
+
+void ReplicationReset(ReplicationChannel *channel)
+{
+    memset(channel, 0, sizeof(*channel));
+}
+
+int ReplicationSelect(ReplicationChannel *channel,
+                      const ReplicaInfo *infos,
+                      int count,
+                      Vector3 viewer,
+                      float viewRange,
+                      float dt,
+                      int recordBytes,
+                      int budgetBytes,
+                      int *outIndices)
+{
+    if (count > REPLICATION_MAX_ENTITIES)
+        count = REPLICATION_MAX_ENTITIES;
+
+    int eligible = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const ReplicaInfo *info = &infos[i];
+        // Spawns and despawns must reach the client; idle dead slots never compete.
+        if (info->active != channel->sentActive[i])
+        {
+            channel->priority[i] += REPLICATION_SPAWN_BOOST;
+        }
+        else if (!info->active)
+        {
+            channel->priority[i] = 0.0f;
+            continue;
+        }
+        else
+        {
+            float dx = info->position.x - viewer.x;
+            float dz = info->position.z - viewer.z;
+            float dist = sqrtf(dx * dx + dz * dz);
+            float rate = 1.0f + 4.0f / (1.0f + dist * 0.25f);
+            if (dist < viewRange)
+                rate *= REPLICATION_VISIBLE_SCALE;
+            channel->priority[i] += rate * dt;
+            if (info->stateHash != channel->sentHash[i])
+                channel->priority[i] += REPLICATION_CHANGE_BOOST;
+        }
+        eligible++;
+    }
+
+    int slots = recordBytes > 0 ? budgetBytes / recordBytes : 0;
+    if (slots > eligible)
+        slots = eligible;
+
+    bool taken[REPLICATION_MAX_ENTITIES] = {0};
+    int selected = 0;
+    for (; selected < slots; selected++)
+    {
+        int best = -1;
+        for (int i = 0; i < count; i++)
+        {
+            if (taken[i] || (!infos[i].active && !channel->sentActive[i]))
+                continue;
+            if (best < 0 || channel->priority[i] > channel->priority[best])
+                best = i;
+        }
+        if (best < 0)
+            break;
+        taken[best] = true;
+        outIndices[selected] = best;
+        channel->priority[best] = 0.0f;
+        channel->sentHash[best] = infos[best].stateHash;
+        channel->sentActive[best] = infos[best].active;
+    }
+    channel->recordsSent += (uint32_t)selected;
+    channel->recordsDeferred += (uint32_t)(eligible - selected);
+    return selected;
+}
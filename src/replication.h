@@ -0,0 +1,43 @@
+#ifndef U8_REPLICATION_H
+#define U8_REPLICATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "raylib.h"
+
+#define REPLICATION_MAX_ENTITIES 64
+
+typedef struct ReplicaInfo
+{
+    Vector3 position;
+    bool active;
+    // Anything the receiver should see promptly (health, attack state); compared against the last sent value.
+    uint32_t stateHash;
+} ReplicaInfo;
+
+// One per receiving client: every entity accrues priority each tick until it
+// wins a slot in that client's packet, then starts again from zero.
+typedef struct ReplicationChannel
+{
+    float priority[REPLICATION_MAX_ENTITIES];
+    uint32_t sentHash[REPLICATION_MAX_ENTITIES];
+    bool sentActive[REPLICATION_MAX_ENTITIES];
+    uint32_t recordsSent;
+    uint32_t recordsDeferred;
+} ReplicationChannel;
+
+void ReplicationReset(ReplicationChannel *channel);
+// Grows priorities for the viewer, then returns the indices of the entities
+// that fit in budgetBytes at recordBytes each, highest priority first.
+int ReplicationSelect(ReplicationChannel *channel,
+                      const ReplicaInfo *infos,
+                      int count,
+                      Vector3 viewer,
+                      float viewRange,
+                      float dt,
+                      int recordBytes,
+                      int budgetBytes,
+                      int *outIndices);
+
+#endif
@@ -0,0 +1,309 @@
+#define _GNU_SOURCE
+#include "sampler.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+// backtrace() inside the handler starts at the handler itself, then the
+// kernel's signal trampoline; the interrupted code follows.
+#define SAMPLER_SKIP_FRAMES 2
+#define SAMPLER_LINE_BYTES 4096
+
+typedef struct SamplerState
+{
+    void *(*frames)[SAMPLER_MAX_DEPTH];
+    uint8_t *depth;
+    uint32_t count;
+    uint32_t dropped;
+    bool running;
+    bool threadTimer;
+    timer_t timer;
+    pthread_t thread;
+    struct sigaction previous;
+    bool writing;
+    bool writeDone;
+    bool writeOk;
+    pthread_t writer;
+    char writePath[256];
+} SamplerState;
+
+static SamplerState gSampler;
+
+static void SamplerHandler(int sig, siginfo_t *info, void *context)
+{
+    (void)sig;
+    (void)info;
+    (void)context;
+    if (!__atomic_load_n(&gSampler.running, __ATOMIC_ACQUIRE))
+        return;
+    // The process-wide fallback timer fires on whichever thread is burning CPU.
+    if (!gSampler.threadTimer && !pthread_equal(pthread_self(), gSampler.thread))
+        return;
+    uint32_t index = gSampler.count;
+    if (index >= SAMPLER_MAX_SAMPLES)
+    {
+        gSampler.dropped++;
+        return;
+    }
+    int savedErrno = errno;
+    int depth = backtrace(gSampler.frames[index], SAMPLER_MAX_DEPTH);
+    errno = savedErrno;
+    gSampler.depth[index] = (uint8_t)(depth > 0 ? depth : 0);
+    __atomic_store_n(&gSampler.count, index + 1, __ATOMIC_RELEASE);
+}
+
+// A per-thread CPU clock with SIGEV_THREAD_ID only ever interrupts the game
+// thread, and only while it runs, so idle vsync waits cost no samples.
+static bool SamplerArmThreadTimer(const struct timespec *interval)
+{
+    clockid_t clock;
+    if (pthread_getcpuclockid(pthread_self(), &clock) != 0)
+        return false;
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event._sigev_un._tid = (pid_t)syscall(SYS_gettid);
+    if (timer_create(clock, &event, &gSampler.timer) != 0)
+        return false;
+    struct itimerspec spec = {*interval, *interval};
+    if (timer_settime(gSampler.timer, 0, &spec, NULL) != 0)
+    {
+        timer_delete(gSampler.timer);
+        return false;
+    }
+    return true;
+}
+
+bool SamplerStart(int hz)
+{
+    if (gSampler.running || gSampler.writing || hz <= 0)
+        return false;
+    if (!gSampler.frames)
+    {
+        gSampler.frames = calloc(SAMPLER_MAX_SAMPLES, sizeof(*gSampler.frames));
+        gSampler.depth = calloc(SAMPLER_MAX_SAMPLES, sizeof(*gSampler.depth));
+        if (!gSampler.frames || !gSampler.depth)
+        {
+            free(gSampler.frames);
+            free(gSampler.depth);
+            gSampler.frames = NULL;
+            gSampler.depth = NULL;
+            return false;
+        }
+    }
+    // The first backtrace() loads the unwinder, which allocates; do it here
+    // rather than inside the handler.
+    void *warmup[4];
+    backtrace(warmup, 4);
+
+    gSampler.count = 0;
+    gSampler.dropped = 0;
+    gSampler.thread = pthread_self();
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = SamplerHandler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &gSampler.previous) != 0)
+        return false;
+
+    long periodNs = 1000000000L / hz;
+    struct timespec interval = {periodNs / 1000000000L, periodNs % 1000000000L};
+    __atomic_store_n(&gSampler.running, true, __ATOMIC_RELEASE);
+    gSampler.threadTimer = SamplerArmThreadTimer(&interval);
+    if (!gSampler.threadTimer)
+    {
+        struct itimerval timer = {{interval.tv_sec, interval.tv_nsec / 1000}, {interval.tv_sec, interval.tv_nsec / 1000}};
+        if (setitimer(ITIMER_PROF, &timer, NULL) != 0)
+        {
+            __atomic_store_n(&gSampler.running, false, __ATOMIC_RELEASE);
+            sigaction(SIGPROF, &gSampler.previous, NULL);
+            return false;
+        }
+    }
+    return true;
+}
+
+void SamplerStop(void)
+{
+    if (!gSampler.running)
+        return;
+    if (gSampler.threadTimer)
+    {
+        timer_delete(gSampler.timer);
+    }
+    else
+    {
+        struct itimerval off = {{0, 0}, {0, 0}};
+        setitimer(ITIMER_PROF, &off, NULL);
+    }
+    __atomic_store_n(&gSampler.running, false, __ATOMIC_RELEASE);
+    sigaction(SIGPROF, &gSampler.previous, NULL);
+}
+
+uint32_t SamplerSampleCount(void)
+{
+    return __atomic_load_n(&gSampler.count, __ATOMIC_ACQUIRE);
+}
+
+uint32_t SamplerDroppedCount(void)
+{
+    return gSampler.dropped;
+}
+
+static int SamplerCompareStacks(const void *a, const void *b)
+{
+    uint32_t ia = *(const uint32_t *)a;
+    uint32_t ib = *(const uint32_t *)b;
+    if (gSampler.depth[ia] != gSampler.depth[ib])
+        return gSampler.depth[ia] < gSampler.depth[ib] ? -1 : 1;
+    return memcmp(gSampler.frames[ia], gSampler.frames[ib], sizeof(void *) * gSampler.depth[ia]);
+}
+
+static int SamplerFrameName(void *address, bool returnAddress, char *out, size_t cap)
+{
+    // Return addresses point past the call; step back so a call at the very
+    // end of a function is not credited to the next one.
+    void *lookup = returnAddress ? (void *)((uintptr_t)address - 1) : address;
+    Dl_info info;
+    memset(&info, 0, sizeof(info));
+    bool found = dladdr(lookup, &info) != 0;
+    if (found && info.dli_sname)
+        return snprintf(out, cap, "%s", info.dli_sname);
+    if (found && info.dli_fname)
+    {
+        const char *slash = strrchr(info.dli_fname, '/');
+        return snprintf(out, cap, "%s+0x%lx", slash ? slash + 1 : info.dli_fname,
+                        (unsigned long)((uintptr_t)lookup - (uintptr_t)info.dli_fbase));
+    }
+    return snprintf(out, cap, "0x%lx", (unsigned long)(uintptr_t)lookup);
+}
+
+typedef struct SamplerLine
+{
+    char *text;
+    uint32_t count;
+} SamplerLine;
+
+static char *SamplerFormatStack(uint32_t index)
+{
+    char line[SAMPLER_LINE_BYTES];
+    size_t used = 0;
+    int depth = gSampler.depth[index];
+    for (int i = depth - 1; i >= SAMPLER_SKIP_FRAMES && used + 1 < sizeof(line); i--)
+    {
+        if (used > 0)
+            line[used++] = ';';
+        int n = SamplerFrameName(gSampler.frames[index][i], i > SAMPLER_SKIP_FRAMES, line + used, sizeof(line) - used);
+        if (n < 0)
+            break;
+        used += (size_t)n < sizeof(line) - used ? (size_t)n : sizeof(line) - used - 1;
+    }
+    line[used] = '\0';
+    return used > 0 ? strdup(line) : NULL;
+}
+
+static int SamplerCompareLines(const void *a, const void *b)
+{
+    return strcmp(((const SamplerLine *)a)->text, ((const SamplerLine *)b)->text);
+}
+
+// Raw stacks are grouped by address first so each distinct one is symbolised
+// once; different return addresses inside one function then fold together by
+// text.
+static bool SamplerWriteFile(const char *path)
+{
+    uint32_t count = SamplerSampleCount();
+    uint32_t *order = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+    SamplerLine *lines = malloc(sizeof(SamplerLine) * (count > 0 ? count : 1));
+    FILE *f = fopen(path, "w");
+    if (!order || !lines || !f)
+    {
+        free(order);
+        free(lines);
+        if (f)
+            fclose(f);
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++)
+        order[i] = i;
+    qsort(order, count, sizeof(uint32_t), SamplerCompareStacks);
+    uint32_t lineCount = 0;
+    for (uint32_t i = 0; i < count;)
+    {
+        uint32_t run = 1;
+        while (i + run < count && SamplerCompareStacks(&order[i], &order[i + run]) == 0)
+            run++;
+        char *text = SamplerFormatStack(order[i]);
+        if (text)
+            lines[lineCount++] = (SamplerLine){text, run};
+        i += run;
+    }
+    qsort(lines, lineCount, sizeof(SamplerLine), SamplerCompareLines);
+    for (uint32_t i = 0; i < lineCount;)
+    {
+        uint32_t total = lines[i].count;
+        uint32_t next = i + 1;
+        while (next < lineCount && strcmp(lines[i].text, lines[next].text) == 0)
+            total += lines[next++].count;
+        fprintf(f, "%s %u\n", lines[i].text, total);
+        i = next;
+    }
+    for (uint32_t i = 0; i < lineCount; i++)
+        free(lines[i].text);
+    fclose(f);
+    free(lines);
+    free(order);
+    return true;
+}
+
+bool SamplerWriteFolded(const char *path)
+{
+    if (gSampler.running || gSampler.writing || !gSampler.frames)
+        return false;
+    return SamplerWriteFile(path);
+}
+
+static void *SamplerWriterMain(void *arg)
+{
+    (void)arg;
+    gSampler.writeOk = SamplerWriteFile(gSampler.writePath);
+    __atomic_store_n(&gSampler.writeDone, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+bool SamplerWriteFoldedAsync(const char *path)
+{
+    if (gSampler.running || gSampler.writing || !gSampler.frames)
+        return false;
+    snprintf(gSampler.writePath, sizeof(gSampler.writePath), "%s", path);
+    gSampler.writeDone = false;
+    if (pthread_create(&gSampler.writer, NULL, SamplerWriterMain, NULL) != 0)
+        return false;
+    gSampler.writing = true;
+    return true;
+}
+
+bool SamplerWriteDone(bool wait, bool *ok)
+{
+    if (gSampler.writing)
+    {
+        if (!wait && !__atomic_load_n(&gSampler.writeDone, __ATOMIC_ACQUIRE))
+            return false;
+        pthread_join(gSampler.writer, NULL);
+        gSampler.writing = false;
+    }
+    *ok = gSampler.writeOk;
+    return true;
+}
@@ -0,0 +1,27 @@
+#ifndef U8_SAMPLER_H
+#define U8_SAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SAMPLER_MAX_SAMPLES 16384
+#define SAMPLER_MAX_DEPTH 32
+
+// Statistical profiler for the thread that starts it: a CPU-time timer raises
+// SIGPROF at the given rate and the handler copies the call stack into a buffer
+// allocated up front. Nothing is symbolised until the folded output is written.
+bool SamplerStart(int hz);
+void SamplerStop(void);
+// One "root;caller;callee count" line per distinct stack, as flamegraph.pl and
+// speedscope read it. Frames without a symbol are written as module+0xoffset.
+bool SamplerWriteFolded(const char *path);
+// The same output written on a background thread, so symbolising does not
+// stall the caller's frame. Sampling cannot restart until the write is done.
+bool SamplerWriteFoldedAsync(const char *path);
+// True once no background write is in flight, with the last one's result in
+// ok; wait blocks until then.
+bool SamplerWriteDone(bool wait, bool *ok);
+uint32_t SamplerSampleCount(void);
+uint32_t SamplerDroppedCount(void);
+
+#endif
@@ -0,0 +1,268 @@
+#define _POSIX_C_SOURCE 200809L
+#include "task.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "profile.h"
+
+#define TASK_DEQUE_CAPACITY 64
+
+// Chase-Lev work-stealing deque: the owner pushes and pops at the bottom,
+// thieves take from the top.
+typedef struct TaskDeque
+{
+    int64_t top;
+    char pad[56];
+    int64_t bottom;
+    int items[TASK_DEQUE_CAPACITY];
+} TaskDeque;
+
+typedef struct TaskScheduler
+{
+    TaskDeque deques[TASK_MAX_WORKERS];
+    pthread_t threads[TASK_MAX_WORKERS];
+    int workerCount;
+    TaskGraph *active;
+    uint32_t generation;
+    bool running;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+} TaskScheduler;
+
+static TaskScheduler gTasks = {.workerCount = 1};
+
+static void DequePush(TaskDeque *d, int item)
+{
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->items[b & (TASK_DEQUE_CAPACITY - 1)], item, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+static int DequePop(TaskDeque *d)
+{
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    if (t > b)
+    {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    int item = __atomic_load_n(&d->items[b & (TASK_DEQUE_CAPACITY - 1)], __ATOMIC_RELAXED);
+    if (t == b)
+    {
+        if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            item = -1;
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return item;
+}
+
+static int DequeSteal(TaskDeque *d)
+{
+    int64_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b)
+        return -1;
+    int item = __atomic_load_n(&d->items[t & (TASK_DEQUE_CAPACITY - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return -1;
+    return item;
+}
+
+static void TaskExecute(TaskGraph *graph, int index, int worker)
+{
+    TaskNode *node = &graph->tasks[index];
+    node->worker = worker;
+    node->startNs = ProfileNowNs();
+    node->fn(node->data);
+    node->endNs = ProfileNowNs();
+    for (int i = 0; i < node->successorCount; i++)
+    {
+        int next = node->successors[i];
+        if (__atomic_sub_fetch(&graph->tasks[next].pending, 1, __ATOMIC_ACQ_REL) == 0)
+            DequePush(&gTasks.deques[worker], next);
+    }
+    __atomic_sub_fetch(&graph->remaining, 1, __ATOMIC_ACQ_REL);
+}
+
+static bool TaskTryRunOne(TaskGraph *graph, int worker)
+{
+    int index = DequePop(&gTasks.deques[worker]);
+    for (int i = 1; index < 0 && i < gTasks.workerCount; i++)
+        index = DequeSteal(&gTasks.deques[(worker + i) % gTasks.workerCount]);
+    if (index < 0)
+        return false;
+    TaskExecute(graph, index, worker);
+    return true;
+}
+
+static void *TaskWorkerMain(void *arg)
+{
+    int worker = (int)(intptr_t)arg;
+    uint32_t seen = 0;
+    for (;;)
+    {
+        pthread_mutex_lock(&gTasks.mutex);
+        while (gTasks.running && gTasks.generation == seen)
+            pthread_cond_wait(&gTasks.wake, &gTasks.mutex);
+        bool running = gTasks.running;
+        seen = gTasks.generation;
+        TaskGraph *graph = gTasks.active;
+        pthread_mutex_unlock(&gTasks.mutex);
+        if (!running)
+            break;
+        if (!graph)
+            continue;
+        while (__atomic_load_n(&graph->remaining, __ATOMIC_ACQUIRE) > 0)
+        {
+            if (!TaskTryRunOne(graph, worker))
+                sched_yield();
+        }
+    }
+    return NULL;
+}
+
+bool TaskSchedulerInit(int workerCount)
+{
+    if (workerCount <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workerCount = cores > 1 ? (int)cores : 1;
+    }
+    if (workerCount > TASK_MAX_WORKERS)
+        workerCount = TASK_MAX_WORKERS;
+
+    memset(gTasks.deques, 0, sizeof(gTasks.deques));
+    pthread_mutex_init(&gTasks.mutex, NULL);
+    pthread_cond_init(&gTasks.wake, NULL);
+    gTasks.running = true;
+    gTasks.generation = 0;
+    gTasks.active = NULL;
+    gTasks.workerCount = 1;
+    for (int i = 1; i < workerCount; i++)
+    {
+        if (pthread_create(&gTasks.threads[i], NULL, TaskWorkerMain, (void *)(intptr_t)i) != 0)
+            break;
+        gTasks.workerCount++;
+    }
+    return true;
+}
+
+void TaskSchedulerShutdown(void)
+{
+    pthread_mutex_lock(&gTasks.mutex);
+    gTasks.running = false;
+    pthread_cond_broadcast(&gTasks.wake);
+    pthread_mutex_unlock(&gTasks.mutex);
+    for (int i = 1; i < gTasks.workerCount; i++)
+        pthread_join(gTasks.threads[i], NULL);
+    gTasks.workerCount = 1;
+    pthread_cond_destroy(&gTasks.wake);
+    pthread_mutex_destroy(&gTasks.mutex);
+}
+
+int TaskSchedulerWorkerCount(void)
+{
+    return gTasks.workerCount;
+}
+
+void TaskGraphInit(TaskGraph *graph)
+{
+    memset(graph, 0, sizeof(*graph));
+}
+
+int TaskGraphAdd(TaskGraph *graph, const char *name, TaskFn fn, void *data)
+{
+    if (graph->count >= TASK_MAX_TASKS)
+        return -1;
+    TaskNode *node = &graph->tasks[graph->count];
+    memset(node, 0, sizeof(*node));
+    node->name = name;
+    node->fn = fn;
+    node->data = data;
+    return graph->count++;
+}
+
+bool TaskGraphDepend(TaskGraph *graph, int task, int dependsOn)
+{
+    if (task < 0 || task >= graph->count || dependsOn < 0 || dependsOn >= task)
+        return false;
+    TaskNode *node = &graph->tasks[task];
+    node->deps[node->depCount++] = dependsOn;
+    TaskNode *before = &graph->tasks[dependsOn];
+    before->successors[before->successorCount++] = task;
+    return true;
+}
+
+// Longest chain of measured task durations through the dependency edges; that
+// chain bounds the frame no matter how many cores are available.
+static void TaskGraphMarkCriticalPath(TaskGraph *graph)
+{
+    float finish[TASK_MAX_TASKS];
+    int via[TASK_MAX_TASKS];
+    int last = -1;
+    graph->criticalMs = 0.0f;
+    graph->workMs = 0.0f;
+    for (int i = 0; i < graph->count; i++)
+    {
+        TaskNode *node = &graph->tasks[i];
+        float duration = (float)(node->endNs - node->startNs) / 1e6f;
+        graph->workMs += duration;
+        node->critical = false;
+        finish[i] = duration;
+        via[i] = -1;
+        for (int d = 0; d < node->depCount; d++)
+        {
+            int dep = node->deps[d];
+            if (finish[dep] + duration > finish[i])
+            {
+                finish[i] = finish[dep] + duration;
+                via[i] = dep;
+            }
+        }
+        if (finish[i] > graph->criticalMs)
+        {
+            graph->criticalMs = finish[i];
+            last = i;
+        }
+    }
+    for (int i = last; i >= 0; i = via[i])
+        graph->tasks[i].critical = true;
+}
+
+void TaskGraphRun(TaskGraph *graph)
+{
+    graph->runStartNs = ProfileNowNs();
+    for (int i = 0; i < graph->count; i++)
+        __atomic_store_n(&graph->tasks[i].pending, graph->tasks[i].depCount, __ATOMIC_RELAXED);
+    __atomic_store_n(&graph->remaining, graph->count, __ATOMIC_RELEASE);
+    for (int i = 0; i < graph->count; i++)
+    {
+        if (graph->tasks[i].depCount == 0)
+            DequePush(&gTasks.deques[0], i);
+    }
+
+    if (gTasks.workerCount > 1)
+    {
+        pthread_mutex_lock(&gTasks.mutex);
+        gTasks.active = graph;
+        gTasks.generation++;
+        pthread_cond_broadcast(&gTasks.wake);
+        pthread_mutex_unlock(&gTasks.mutex);
+    }
+
+    while (__atomic_load_n(&graph->remaining, __ATOMIC_ACQUIRE) > 0)
+    {
+        if (!TaskTryRunOne(graph, 0))
+            sched_yield();
+    }
+
+    graph->runEndNs = ProfileNowNs();
+    TaskGraphMarkCriticalPath(graph);
+}
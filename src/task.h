@@ -0,0 +1,52 @@
+#ifndef U8_TASK_H
+#define U8_TASK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TASK_MAX_TASKS 32
+#define TASK_MAX_WORKERS 8
+
+typedef void (*TaskFn)(void *data);
+
+typedef struct TaskNode
+{
+    const char *name;
+    TaskFn fn;
+    void *data;
+    int deps[TASK_MAX_TASKS];
+    int depCount;
+    int successors[TASK_MAX_TASKS];
+    int successorCount;
+    int pending;
+    int worker;
+    uint64_t startNs;
+    uint64_t endNs;
+    bool critical;
+} TaskNode;
+
+// A graph is built once and re-run every frame. Tasks must be added after the
+// tasks they depend on, which keeps the insertion order topological.
+typedef struct TaskGraph
+{
+    TaskNode tasks[TASK_MAX_TASKS];
+    int count;
+    int remaining;
+    uint64_t runStartNs;
+    uint64_t runEndNs;
+    float criticalMs;
+    float workMs;
+} TaskGraph;
+
+// workerCount <= 0 picks one worker per spare core; the calling thread is always worker 0.
+bool TaskSchedulerInit(int workerCount);
+void TaskSchedulerShutdown(void);
+int TaskSchedulerWorkerCount(void);
+
+void TaskGraphInit(TaskGraph *graph);
+int TaskGraphAdd(TaskGraph *graph, const char *name, TaskFn fn, void *data);
+bool TaskGraphDepend(TaskGraph *graph, int task, int dependsOn);
+// Runs every task once, blocking until the graph drains; the caller steals work too.
+void TaskGraphRun(TaskGraph *graph);
+
+#endif
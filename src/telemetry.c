@@ -0,0 +1,69 @@
+#define _POSIX_C_SOURCE 200809L
+#include "telemetry.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct TelemetryState
+{
+    TelemetrySegment *segment;
+    char name[64];
+} TelemetryState;
+
+static TelemetryState gTelemetry;
+
+bool TelemetryOpen(const char *name)
+{
+    if (gTelemetry.segment)
+        return true;
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, sizeof(TelemetrySegment)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, sizeof(TelemetrySegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    gTelemetry.segment = (TelemetrySegment *)map;
+    snprintf(gTelemetry.name, sizeof(gTelemetry.name), "%s", name);
+
+    // A reader left over from an older build may still be attached; the
+    // zeroed magic keeps it from trusting the header while it is rewritten.
+    TelemetrySegment *seg = gTelemetry.segment;
+    __atomic_store_n(&seg->magic, 0, __ATOMIC_RELEASE);
+    seg->version = TELEMETRY_VERSION;
+    seg->size = sizeof(TelemetrySegment);
+    __atomic_store_n(&seg->sequence, 0, __ATOMIC_RELEASE);
+    memset(&seg->snapshot, 0, sizeof(seg->snapshot));
+    __atomic_store_n(&seg->magic, TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+void TelemetryPublish(const TelemetrySnapshot *snapshot)
+{
+    TelemetrySegment *seg = gTelemetry.segment;
+    if (!seg)
+        return;
+    uint32_t sequence = seg->sequence;
+    __atomic_store_n(&seg->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&seg->snapshot, snapshot, sizeof(*snapshot));
+    __atomic_store_n(&seg->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+void TelemetryClose(void)
+{
+    if (!gTelemetry.segment)
+        return;
+    munmap(gTelemetry.segment, sizeof(TelemetrySegment));
+    shm_unlink(gTelemetry.name);
+    gTelemetry.segment = NULL;
+}
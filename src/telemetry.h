@@ -0,0 +1,76 @@
+#ifndef U8_TELEMETRY_H
+#define U8_TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Layout shared with external readers (see tools/telemetry_reader.c); bump
+// the version whenever a field moves.
+#define TELEMETRY_SHM_NAME "/u8_telemetry"
+#define TELEMETRY_MAGIC 0x45543855u
+#define TELEMETRY_VERSION 2
+#define TELEMETRY_MAX_PLAYERS 9
+#define TELEMETRY_NAME_BYTES 16
+#define TELEMETRY_ZONES 6
+
+enum
+{
+    TELEMETRY_PLAYER_SELF = 1 << 0,
+    TELEMETRY_PLAYER_HOST = 1 << 1,
+    TELEMETRY_PLAYER_DOWNED = 1 << 2
+};
+
+typedef struct TelemetryPlayer
+{
+    char name[TELEMETRY_NAME_BYTES];
+    float position[3];
+    float health;
+    int32_t score;
+    int32_t cash;
+    float rttMs;
+    uint8_t team;
+    uint8_t flags;
+    uint8_t reserved[2];
+} TelemetryPlayer;
+
+typedef struct TelemetrySnapshot
+{
+    uint64_t tick;
+    double matchTime;
+    uint32_t mode;
+    uint32_t variant;
+    int32_t wave;
+    int32_t activeEnemies;
+    int32_t teamScores[2];
+    uint32_t playerCount;
+    uint32_t reserved;
+    TelemetryPlayer players[TELEMETRY_MAX_PLAYERS];
+    float frameMs;
+    float zoneMs[TELEMETRY_ZONES];
+    float headroom;
+    uint32_t hitches;
+    uint32_t packetsIn;
+    uint32_t packetsOut;
+    uint32_t bytesIn;
+    uint32_t bytesOut;
+} TelemetrySnapshot;
+
+// Seqlock: the writer makes sequence odd, copies the snapshot, then makes it
+// even again. A reader copies out between two equal, even loads of sequence.
+typedef struct TelemetrySegment
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t sequence;
+    TelemetrySnapshot snapshot;
+} TelemetrySegment;
+
+// Creates (or reuses) the segment; readers attach to it by name.
+bool TelemetryOpen(const char *name);
+// Called once per tick from the game thread; a plain copy with no syscalls.
+void TelemetryPublish(const TelemetrySnapshot *snapshot);
+// Unmaps and unlinks, so readers see the segment go away with the game.
+void TelemetryClose(void);
+
+#endif
@@ -0,0 +1,125 @@
+#include "transfer.h"
+
+#include <string.h>
+
+static uint32_t TransferFullMask(int chunkCount)
+{
+    return chunkCount >= 32 ? 0xFFFFFFFFu : (1u << chunkCount) - 1u;
+}
+
+bool TransferBegin(TransferSender *tx, uint8_t id, const void *data, size_t size, double timeNow)
+{
+    if (size == 0 || size > TRANSFER_MAX_BYTES)
+        return false;
+    memcpy(tx->data, data, size);
+    tx->size = size;
+    tx->id = id;
+    tx->chunkCount = (int)((size + TRANSFER_CHUNK_BYTES - 1) / TRANSFER_CHUNK_BYTES);
+    tx->acked = 0;
+    for (int i = 0; i < TRANSFER_MAX_CHUNKS; i++)
+        tx->sentAt[i] = -1.0;
+    tx->startedAt = timeNow;
+    tx->active = true;
+    return true;
+}
+
+size_t TransferNextChunk(TransferSender *tx, double timeNow, double resendAfter, uint8_t *out, size_t cap)
+{
+    if (!tx->active || TransferDone(tx))
+        return 0;
+    for (int i = 0; i < tx->chunkCount; i++)
+    {
+        if (tx->acked & (1u << i))
+            continue;
+        if (tx->sentAt[i] >= 0.0 && timeNow - tx->sentAt[i] < resendAfter)
+            continue;
+        size_t offset = (size_t)i * TRANSFER_CHUNK_BYTES;
+        size_t len = tx->size - offset;
+        if (len > TRANSFER_CHUNK_BYTES)
+            len = TRANSFER_CHUNK_BYTES;
+        if (TRANSFER_HEADER_BYTES + len > cap)
+            return 0;
+        out[0] = TRANSFER_CHUNK_MAGIC;
+        out[1] = tx->id;
+        out[2] = (uint8_t)i;
+        out[3] = (uint8_t)tx->chunkCount;
+        out[4] = (uint8_t)len;
+        memcpy(out + TRANSFER_HEADER_BYTES, tx->data + offset, len);
+        tx->sentAt[i] = timeNow;
+        return TRANSFER_HEADER_BYTES + len;
+    }
+    return 0;
+}
+
+void TransferAck(TransferSender *tx, const uint8_t *in, size_t len)
+{
+    if (!tx->active || len < TRANSFER_ACK_BYTES || in[1] != tx->id)
+        return;
+    uint32_t mask = ((uint32_t)in[2] << 24) | ((uint32_t)in[3] << 16) | ((uint32_t)in[4] << 8) | in[5];
+    tx->acked |= mask & TransferFullMask(tx->chunkCount);
+}
+
+bool TransferDone(const TransferSender *tx)
+{
+    return tx->acked == TransferFullMask(tx->chunkCount);
+}
+
+void TransferReset(TransferReceiver *rx)
+{
+    rx->size = 0;
+    rx->chunkCount = 0;
+    rx->received = 0;
+    rx->started = false;
+    rx->complete = false;
+}
+
+bool TransferReceive(TransferReceiver *rx, const uint8_t *in, size_t len)
+{
+    if (len < TRANSFER_HEADER_BYTES)
+        return false;
+    uint8_t id = in[1];
+    int index = in[2];
+    int count = in[3];
+    size_t chunkLen = in[4];
+    if (count == 0 || count > TRANSFER_MAX_CHUNKS || index >= count || chunkLen > TRANSFER_CHUNK_BYTES ||
+        TRANSFER_HEADER_BYTES + chunkLen > len)
+        return false;
+    // Only the last chunk may be short, which is how the total size is learned.
+    if (index < count - 1 && chunkLen != TRANSFER_CHUNK_BYTES)
+        return false;
+
+    // A new id restarts the blob; chunks of a finished one are only re-acked by the caller.
+    if (!rx->started || id != rx->id)
+    {
+        rx->id = id;
+        rx->chunkCount = count;
+        rx->received = 0;
+        rx->size = 0;
+        rx->started = true;
+        rx->complete = false;
+    }
+    if (count != rx->chunkCount || rx->complete || (rx->received & (1u << index)))
+        return false;
+
+    memcpy(rx->data + (size_t)index * TRANSFER_CHUNK_BYTES, in + TRANSFER_HEADER_BYTES, chunkLen);
+    rx->received |= 1u << index;
+    if (index == count - 1)
+        rx->size = (size_t)index * TRANSFER_CHUNK_BYTES + chunkLen;
+    if (rx->received != TransferFullMask(count))
+        return false;
+    rx->complete = true;
+    return true;
+}
+
+size_t TransferWriteAck(const TransferReceiver *rx, uint8_t *out, size_t cap)
+{
+    if (!rx->started || cap < TRANSFER_ACK_BYTES)
+        return 0;
+    out[0] = TRANSFER_ACK_MAGIC;
+    out[1] = rx->id;
+    out[2] = (uint8_t)(rx->received >> 24);
+    out[3] = (uint8_t)(rx->received >> 16);
+    out[4] = (uint8_t)(rx->received >> 8);
+    out[5] = (uint8_t)rx->received;
+    return TRANSFER_ACK_BYTES;
+}
@@ -0,0 +1,52 @@
+#ifndef U8_TRANSFER_H
+#define U8_TRANSFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRANSFER_CHUNK_MAGIC 0xB1
+#define TRANSFER_ACK_MAGIC 0xB2
+#define TRANSFER_HEADER_BYTES 5
+#define TRANSFER_ACK_BYTES 6
+#define TRANSFER_CHUNK_BYTES 192
+#define TRANSFER_MAX_CHUNKS 16
+#define TRANSFER_MAX_BYTES (TRANSFER_CHUNK_BYTES * TRANSFER_MAX_CHUNKS)
+
+// A blob split into fixed chunks; each chunk is resent until the receiver's
+// ack bitmask covers it. Pacing is left to the caller.
+typedef struct TransferSender
+{
+    uint8_t data[TRANSFER_MAX_BYTES];
+    size_t size;
+    uint8_t id;
+    int chunkCount;
+    uint32_t acked;
+    double sentAt[TRANSFER_MAX_CHUNKS];
+    double startedAt;
+    bool active;
+} TransferSender;
+
+typedef struct TransferReceiver
+{
+    uint8_t data[TRANSFER_MAX_BYTES];
+    size_t size;
+    uint8_t id;
+    int chunkCount;
+    uint32_t received;
+    bool started;
+    bool complete;
+} TransferReceiver;
+
+bool TransferBegin(TransferSender *tx, uint8_t id, const void *data, size_t size, double timeNow);
+// Writes the next chunk that is unsent or overdue for a resend; returns 0 when none is due.
+size_t TransferNextChunk(TransferSender *tx, double timeNow, double resendAfter, uint8_t *out, size_t cap);
+void TransferAck(TransferSender *tx, const uint8_t *in, size_t len);
+bool TransferDone(const TransferSender *tx);
+
+void TransferReset(TransferReceiver *rx);
+// Stores a chunk; returns true only on the call that completes the blob.
+bool TransferReceive(TransferReceiver *rx, const uint8_t *in, size_t len);
+size_t TransferWriteAck(const TransferReceiver *rx, uint8_t *out, size_t cap);
+
+#endif
@@ -0,0 +1,367 @@
+#include "vat.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "raymath.h"
+#include "rlgl.h"
+
+#define VAT_ROWS (VAT_CLIP_COUNT * VAT_FRAMES_PER_CLIP)
+
+// The instance matrix's bottom row is free in an affine transform, so it
+// carries the two frame rows, their blend and the tint packed as 6:6:6:6.
+static const char *gVatVertexBody =
+    "in vec3 vertexPosition;\n"
+    "in vec2 vertexTexCoord;\n"
+    "in vec4 vertexColor;\n"
+    "in mat4 instanceTransform;\n"
+    "uniform mat4 mvp;\n"
+    "uniform sampler2D vatTexture;\n"
+    "uniform int vatColumn;\n"
+    "uniform float vatRange;\n"
+    "out vec2 fragTexCoord;\n"
+    "out vec4 fragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    mat4 tx = instanceTransform;\n"
+    "    vec4 anim = vec4(tx[0][3], tx[1][3], tx[2][3], tx[3][3]);\n"
+    "    tx[0][3] = 0.0; tx[1][3] = 0.0; tx[2][3] = 0.0; tx[3][3] = 1.0;\n"
+    "    int column = vatColumn + gl_VertexID;\n"
+    "    vec3 a = texelFetch(vatTexture, ivec2(column, int(anim.x)), 0).xyz;\n"
+    "    vec3 b = texelFetch(vatTexture, ivec2(column, int(anim.y)), 0).xyz;\n"
+    "    vec3 offset = (mix(a, b, anim.z) * 255.0 - 128.0) / 127.5 * vatRange;\n"
+    "    vec4 tint = vec4(floor(anim.w / 262144.0), mod(floor(anim.w / 4096.0), 64.0), mod(floor(anim.w / 64.0), 64.0), mod(anim.w, 64.0)) / 63.0;\n"
+    "    fragTexCoord = vertexTexCoord;\n"
+    "    fragColor = vertexColor * tint;\n"
+    "    gl_Position = mvp * tx * vec4(vertexPosition + offset, 1.0);\n"
+    "}\n";
+
+static const char *gVatFragmentBody =
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform vec4 colDiffuse;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    finalColor = texture(texture0, fragTexCoord) * fragColor * colDiffuse;\n"
+    "}\n";
+
+bool VatInit(VatSet *vat, MemRegion region)
+{
+    memset(vat, 0, sizeof(*vat));
+    for (int i = 0; i < LOWPOLY_MODEL_COUNT; i++)
+        vat->column[i] = -1;
+    vat->frames = (uint8_t *)RegionAlloc(region, (size_t)VAT_MAX_COLUMNS * VAT_ROWS * 4);
+    vat->transforms = (Matrix *)RegionAlloc(region, sizeof(Matrix) * VAT_MAX_INSTANCES);
+    vat->instances = (VatInstance *)RegionAlloc(region, sizeof(VatInstance) * VAT_MAX_INSTANCES);
+    return vat->frames && vat->transforms && vat->instances;
+}
+
+// Offset of one model-space vertex at normalised time t. Height in the unit
+// box drives most of it: feet scissor, shoulders sway and lean, and the whole
+// body folds towards the ground when it dies.
+static Vector3 VatPose(VatClip clip, float t, const LowPolyVertex *v)
+{
+    float height = Clamp(v->y + 0.5f, 0.0f, 1.0f);
+    float side = v->x >= 0.0f ? 1.0f : -1.0f;
+    Vector3 o = {0.0f, 0.0f, 0.0f};
+    switch (clip)
+    {
+    case VAT_CLIP_WALK:
+    {
+        float s = sinf(t * 2.0f * PI);
+        o.x = s * 0.06f * height;
+        o.y = fabsf(s) * 0.04f;
+        o.z = s * side * 0.12f * (1.0f - height);
+        break;
+    }
+    case VAT_CLIP_ATTACK:
+    {
+        float lean = t * t * (3.0f - 2.0f * t);
+        o.x = side * lean * 0.1f * height;
+        o.y = -lean * 0.08f * height;
+        o.z = lean * 0.3f * height * height;
+        break;
+    }
+    case VAT_CLIP_DEATH:
+    default:
+    {
+        float fall = t * t;
+        o.x = side * fall * 0.12f * (1.0f - height);
+        o.y = -fall * 0.85f * height;
+        o.z = fall * 0.45f * height;
+        break;
+    }
+    }
+    return o;
+}
+
+// 128 is exactly zero so the rest pose carries no bias; the shader decodes the same way.
+static uint8_t VatEncode(float offset)
+{
+    return (uint8_t)Clamp(roundf(offset / VAT_RANGE * 127.5f) + 128.0f, 0.0f, 255.0f);
+}
+
+static float VatDecode(uint8_t value)
+{
+    return ((float)value - 128.0f) / 127.5f * VAT_RANGE;
+}
+
+static void VatFrameRows(VatClip clip, float time, int *rowA, int *rowB, float *blend)
+{
+    float f;
+    int a, b;
+    if (clip == VAT_CLIP_WALK)
+    {
+        f = (time - floorf(time)) * VAT_FRAMES_PER_CLIP;
+        a = (int)f % VAT_FRAMES_PER_CLIP;
+        b = (a + 1) % VAT_FRAMES_PER_CLIP;
+    }
+    else
+    {
+        f = Clamp(time, 0.0f, 1.0f) * (VAT_FRAMES_PER_CLIP - 1);
+        a = (int)f;
+        b = a + 1 < VAT_FRAMES_PER_CLIP ? a + 1 : a;
+    }
+    *blend = f - floorf(f);
+    *rowA = clip * VAT_FRAMES_PER_CLIP + a;
+    *rowB = clip * VAT_FRAMES_PER_CLIP + b;
+}
+
+static bool VatLoadShader(VatSet *vat)
+{
+    const char *header = NULL;
+    int version = rlGetVersion();
+    if (version == RL_OPENGL_33 || version == RL_OPENGL_43)
+        header = "#version 330\n";
+    else if (version == RL_OPENGL_ES_30)
+        header = "#version 300 es\nprecision highp float;\nprecision highp int;\n";
+    if (!header)
+        return false;
+
+    char vs[2048];
+    char fs[1024];
+    snprintf(vs, sizeof(vs), "%s%s", header, gVatVertexBody);
+    snprintf(fs, sizeof(fs), "%s%s", header, gVatFragmentBody);
+    Shader shader = LoadShaderFromMemory(vs, fs);
+    if (shader.id == 0 || shader.id == rlGetShaderIdDefault())
+        return false;
+    shader.locs[SHADER_LOC_VERTEX_INSTANCE_TX] = GetShaderLocationAttrib(shader, "instanceTransform");
+    shader.locs[SHADER_LOC_MAP_NORMAL] = GetShaderLocation(shader, "vatTexture");
+    vat->columnLoc = GetShaderLocation(shader, "vatColumn");
+    float range = VAT_RANGE;
+    SetShaderValue(shader, GetShaderLocation(shader, "vatRange"), &range, SHADER_UNIFORM_FLOAT);
+    vat->shader = shader;
+    return true;
+}
+
+// Meshes keep only their GPU copy; the CPU arrays come from frame scratch.
+static bool VatUploadMeshes(VatSet *vat, const LowPolySet *models)
+{
+    for (int id = 0; id < LOWPOLY_MODEL_COUNT; id++)
+    {
+        if (vat->column[id] < 0)
+            continue;
+        const LowPolyModel *model = &models->models[id];
+        Mesh mesh = {0};
+        mesh.vertexCount = model->count;
+        mesh.triangleCount = model->count / 3;
+        mesh.vertices = (float *)RegionAlloc(MEM_REGION_SCRATCH, sizeof(float) * 3 * (size_t)model->count);
+        mesh.texcoords = (float *)RegionAlloc(MEM_REGION_SCRATCH, sizeof(float) * 2 * (size_t)model->count);
+        mesh.colors = (unsigned char *)RegionAlloc(MEM_REGION_SCRATCH, 4 * (size_t)model->count);
+        if (!mesh.vertices || !mesh.texcoords || !mesh.colors)
+            return false;
+        for (int k = 0; k < model->count; k++)
+        {
+            const LowPolyVertex *v = &models->vertices[model->first + k];
+            mesh.vertices[k * 3 + 0] = v->x;
+            mesh.vertices[k * 3 + 1] = v->y;
+            mesh.vertices[k * 3 + 2] = v->z;
+            mesh.texcoords[k * 2 + 0] = v->u;
+            mesh.texcoords[k * 2 + 1] = v->v;
+            mesh.colors[k * 4 + 0] = mesh.colors[k * 4 + 1] = mesh.colors[k * 4 + 2] = v->shade;
+            mesh.colors[k * 4 + 3] = 255;
+        }
+        UploadMesh(&mesh, false);
+        mesh.vertices = NULL;
+        mesh.texcoords = NULL;
+        mesh.colors = NULL;
+        vat->meshes[id] = mesh;
+    }
+    return true;
+}
+
+void VatBake(VatSet *vat, const LowPolySet *models)
+{
+    VatUnload(vat);
+    vat->columns = 0;
+    for (int i = 0; i < LOWPOLY_MODEL_COUNT; i++)
+        vat->column[i] = -1;
+    if (!vat->frames)
+        return;
+
+    for (int id = LOWPOLY_ZOMBIE; id <= LOWPOLY_BOSS; id++)
+    {
+        const LowPolyModel *model = &models->models[id];
+        if (model->count == 0 || vat->columns + model->count > VAT_MAX_COLUMNS)
+            continue;
+        vat->column[id] = vat->columns;
+        for (int row = 0; row < VAT_ROWS; row++)
+        {
+            VatClip clip = (VatClip)(row / VAT_FRAMES_PER_CLIP);
+            int frame = row % VAT_FRAMES_PER_CLIP;
+            float t = clip == VAT_CLIP_WALK ? (float)frame / VAT_FRAMES_PER_CLIP : (float)frame / (VAT_FRAMES_PER_CLIP - 1);
+            for (int k = 0; k < model->count; k++)
+            {
+                Vector3 o = VatPose(clip, t, &models->vertices[model->first + k]);
+                uint8_t *texel = &vat->frames[((size_t)row * VAT_MAX_COLUMNS + (size_t)(vat->columns + k)) * 4];
+                texel[0] = VatEncode(o.x);
+                texel[1] = VatEncode(o.y);
+                texel[2] = VatEncode(o.z);
+                texel[3] = 255;
+            }
+        }
+        vat->columns += model->count;
+    }
+    if (vat->columns == 0 || !VatLoadShader(vat))
+        return;
+
+    Image image = {vat->frames, VAT_MAX_COLUMNS, VAT_ROWS, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+    vat->texture = LoadTextureFromImage(image);
+    vat->material = LoadMaterialDefault();
+    vat->material.shader = vat->shader;
+    vat->material.maps[MATERIAL_MAP_NORMAL].texture = vat->texture;
+    vat->gpu = vat->texture.id != 0 && VatUploadMeshes(vat, models);
+}
+
+void VatUnload(VatSet *vat)
+{
+    for (int i = 0; i < LOWPOLY_MODEL_COUNT; i++)
+    {
+        if (vat->meshes[i].vaoId != 0 || vat->meshes[i].vboId)
+            UnloadMesh(vat->meshes[i]);
+        memset(&vat->meshes[i], 0, sizeof(vat->meshes[i]));
+    }
+    if (vat->material.maps)
+        MemFree(vat->material.maps);
+    vat->material = (Material){0};
+    if (vat->shader.id != 0)
+        UnloadShader(vat->shader);
+    vat->shader = (Shader){0};
+    if (vat->texture.id != 0)
+        UnloadTexture(vat->texture);
+    vat->texture = (Texture2D){0};
+    vat->gpu = false;
+}
+
+void VatQueue(VatSet *vat, LowPolyModelId model, Vector3 position, Vector3 scale, float yaw, Color tint, VatClip clip, float time)
+{
+    if (model < 0 || model >= LOWPOLY_MODEL_COUNT || !vat->instances)
+        return;
+    if (vat->instanceCount >= VAT_MAX_INSTANCES)
+    {
+        vat->dropped++;
+        return;
+    }
+    vat->instances[vat->instanceCount++] = (VatInstance){position, scale, yaw, tint, model, clip, time};
+}
+
+static void VatDrawCpu(const VatSet *vat, const LowPolySet *models, const VatInstance *inst)
+{
+    const LowPolyModel *model = &models->models[inst->model];
+    if (model->count == 0)
+        return;
+    int column = vat->column[inst->model];
+    int rowA, rowB;
+    float blend;
+    VatFrameRows(inst->clip, inst->time, &rowA, &rowB, &blend);
+    float c = cosf(inst->yaw);
+    float s = sinf(inst->yaw);
+    rlCheckRenderBatchLimit(model->count);
+    rlBegin(RL_TRIANGLES);
+    for (int k = 0; k < model->count; k++)
+    {
+        const LowPolyVertex *v = &models->vertices[model->first + k];
+        Vector3 p = {v->x, v->y, v->z};
+        if (column >= 0)
+        {
+            const uint8_t *a = &vat->frames[((size_t)rowA * VAT_MAX_COLUMNS + (size_t)(column + k)) * 4];
+            const uint8_t *b = &vat->frames[((size_t)rowB * VAT_MAX_COLUMNS + (size_t)(column + k)) * 4];
+            p.x += VatDecode(a[0]) + (VatDecode(b[0]) - VatDecode(a[0])) * blend;
+            p.y += VatDecode(a[1]) + (VatDecode(b[1]) - VatDecode(a[1])) * blend;
+            p.z += VatDecode(a[2]) + (VatDecode(b[2]) - VatDecode(a[2])) * blend;
+        }
+        float x = p.x * inst->scale.x;
+        float z = p.z * inst->scale.z;
+        rlColor4ub((unsigned char)(inst->tint.r * v->shade / 255),
+                   (unsigned char)(inst->tint.g * v->shade / 255),
+                   (unsigned char)(inst->tint.b * v->shade / 255),
+                   inst->tint.a);
+        rlTexCoord2f(v->u, v->v);
+        rlVertex3f(inst->position.x + x * c + z * s, inst->position.y + p.y * inst->scale.y, inst->position.z - x * s + z * c);
+    }
+    rlEnd();
+}
+
+static Matrix VatInstanceTransform(const VatInstance *inst)
+{
+    Matrix m = MatrixMultiply(MatrixMultiply(MatrixScale(inst->scale.x, inst->scale.y, inst->scale.z), MatrixRotateY(inst->yaw)),
+                              MatrixTranslate(inst->position.x, inst->position.y, inst->position.z));
+    int rowA, rowB;
+    float blend;
+    VatFrameRows(inst->clip, inst->time, &rowA, &rowB, &blend);
+    m.m3 = (float)rowA;
+    m.m7 = (float)rowB;
+    m.m11 = blend;
+    m.m15 = (float)(((uint32_t)(inst->tint.r >> 2) << 18) | ((uint32_t)(inst->tint.g >> 2) << 12) |
+                    ((uint32_t)(inst->tint.b >> 2) << 6) | (uint32_t)(inst->tint.a >> 2));
+    return m;
+}
+
+void VatFlush(VatSet *vat, const LowPolySet *models)
+{
+    vat->triangles = 0;
+    if (vat->instanceCount == 0)
+        return;
+
+    for (int i = 0; i < vat->instanceCount; i++)
+        vat->triangles += models->models[vat->instances[i].model].count / 3;
+
+    bool anyCpu = false;
+    for (int i = 0; i < vat->instanceCount && !anyCpu; i++)
+        anyCpu = !vat->gpu || vat->column[vat->instances[i].model] < 0;
+    if (anyCpu)
+    {
+        rlSetTexture(models->atlas.id);
+        for (int i = 0; i < vat->instanceCount; i++)
+        {
+            const VatInstance *inst = &vat->instances[i];
+            if (!vat->gpu || vat->column[inst->model] < 0)
+                VatDrawCpu(vat, models, inst);
+        }
+        rlSetTexture(0);
+    }
+
+    if (vat->gpu)
+    {
+        vat->material.maps[MATERIAL_MAP_DIFFUSE].texture = models->atlas;
+        for (int id = 0; id < LOWPOLY_MODEL_COUNT; id++)
+        {
+            if (vat->column[id] < 0)
+                continue;
+            int count = 0;
+            for (int i = 0; i < vat->instanceCount; i++)
+            {
+                if (vat->instances[i].model == (LowPolyModelId)id)
+                    vat->transforms[count++] = VatInstanceTransform(&vat->instances[i]);
+            }
+            if (count == 0)
+                continue;
+            SetShaderValue(vat->shader, vat->columnLoc, &vat->column[id], SHADER_UNIFORM_INT);
+            DrawMeshInstanced(vat->meshes[id], vat->material, vat->transforms, count);
+        }
+    }
+    vat->instanceCount = 0;
+}
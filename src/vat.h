@@ -0,0 +1,67 @@
+#ifndef U8_VAT_H
+#define U8_VAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lowpoly.h"
+#include "raylib.h"
+#include "region.h"
+
+#define VAT_FRAMES_PER_CLIP 16
+#define VAT_MAX_COLUMNS 1024
+#define VAT_MAX_INSTANCES 128
+#define VAT_RANGE 1.0f
+
+typedef enum VatClip
+{
+    VAT_CLIP_WALK,
+    VAT_CLIP_ATTACK,
+    VAT_CLIP_DEATH,
+    VAT_CLIP_COUNT
+} VatClip;
+
+typedef struct VatInstance
+{
+    Vector3 position;
+    Vector3 scale;
+    float yaw;
+    Color tint;
+    LowPolyModelId model;
+    VatClip clip;
+    float time;
+} VatInstance;
+
+// Baked vertex animation for the zombie models. Every frame of every clip is
+// one texture row of per-vertex offsets (RGBA8, model units scaled by
+// VAT_RANGE), and each model owns a run of columns. Instances carry only a
+// clip and a normalised time; the vertex shader does the sampling, and GL
+// versions without texelFetch fall back to the same table on the CPU.
+typedef struct VatSet
+{
+    uint8_t *frames;
+    int columns;
+    int column[LOWPOLY_MODEL_COUNT];
+    Texture2D texture;
+    bool gpu;
+    Shader shader;
+    int columnLoc;
+    Material material;
+    Mesh meshes[LOWPOLY_MODEL_COUNT];
+    Matrix *transforms;
+    VatInstance *instances;
+    int instanceCount;
+    int dropped;
+    int triangles;
+} VatSet;
+
+bool VatInit(VatSet *vat, MemRegion region);
+// Bakes the clips for the models just loaded into the set; call after LowPolyLoadArena.
+void VatBake(VatSet *vat, const LowPolySet *models);
+void VatUnload(VatSet *vat);
+// Walk loops over time in [0, 1); attack and death clamp at their last frame.
+void VatQueue(VatSet *vat, LowPolyModelId model, Vector3 position, Vector3 scale, float yaw, Color tint, VatClip clip, float time);
+// Submits and clears the queue with the models' atlas; call inside BeginMode3D.
+void VatFlush(VatSet *vat, const LowPolySet *models);
+
+#endif
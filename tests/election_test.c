@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "election.h"
+
+static int gFailures;
+
+static void Check(int ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("FAIL %s\n", what);
+        gFailures++;
+    }
+}
+
+static ElectionNode Node(uint32_t id, float headroom)
+{
+    ElectionNode node;
+    memset(&node, 0, sizeof(node));
+    node.id = id;
+    node.headroom = headroom;
+    return node;
+}
+
+// Scores of 255.0, 255.8 and 256.6: the first two tie, the last two tie, but
+// the first and last do not. Every machine must pick id 3 however its
+// reports happen to be ordered.
+static void TestBestIgnoresOrder(void)
+{
+    ElectionConfig config = {0.0f, 10.0f, 0.2f, 3.0f};
+    ElectionNode forward[3] = {Node(5, 0.50f), Node(3, 0.42f), Node(1, 0.34f)};
+    ElectionNode backward[3] = {forward[2], forward[1], forward[0]};
+    Check(ElectionBest(forward, 3, &config) == 3, "best of forward order");
+    Check(ElectionBest(backward, 3, &config) == 3, "best of backward order");
+}
+
+int main(void)
+{
+    TestBestIgnoresOrder();
+    if (gFailures > 0)
+        return 1;
+    printf("election_test: ok\n");
+    return 0;
+}
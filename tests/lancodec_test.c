@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lancodec.h"
+
+static int gFailures;
+
+static void Check(int ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("FAIL %s\n", what);
+        gFailures++;
+    }
+}
+
+// An enemy replica packet with seven records is exactly LAN_RAW_PAYLOAD_BYTES
+// long: magic, count, 4-byte sequence, then 7 x 8-byte records. The codec must
+// not take it for a player payload.
+static void TestEnemyPacketIsNotAPayload(void)
+{
+    uint8_t packet[LAN_RAW_PAYLOAD_BYTES];
+    memset(packet, 0x5A, sizeof(packet));
+    packet[0] = 0xE7;
+    packet[1] = 7;
+    LanCodecState rx = {0};
+    uint8_t raw[LAN_RAW_PAYLOAD_BYTES];
+    Check(6 + 7 * 8 == LAN_RAW_PAYLOAD_BYTES, "seven enemy records fill a raw payload");
+    Check(!LanCodecDecode(&rx, packet, sizeof(packet), raw), "62-byte enemy packet is rejected");
+}
+
+// A payload of noise cannot be coded smaller, so it goes out tagged and whole.
+static void TestRawPayloadRoundTrip(void)
+{
+    uint8_t payload[LAN_RAW_PAYLOAD_BYTES];
+    srand(7);
+    for (int i = 0; i < LAN_RAW_PAYLOAD_BYTES; i++)
+        payload[i] = (uint8_t)rand();
+    LanCodecState tx = {0};
+    LanCodecState rx = {0};
+    uint8_t wire[512];
+    bool keyframe = false;
+    size_t size = LanCodecEncode(&tx, payload, wire, sizeof(wire), &keyframe);
+    Check(size == LAN_CODEC_RAW_BYTES, "incompressible payload is sent raw");
+    Check(wire[0] == LAN_CODEC_RAW_MAGIC, "raw payload carries its tag");
+    Check(keyframe, "raw payload counts as a keyframe");
+    uint8_t decoded[LAN_RAW_PAYLOAD_BYTES];
+    Check(LanCodecDecode(&rx, wire, size, decoded), "tagged raw payload decodes");
+    Check(memcmp(decoded, payload, sizeof(payload)) == 0, "tagged raw payload round-trips");
+}
+
+static void TestCodedPayloadRoundTrip(void)
+{
+    uint8_t payload[LAN_RAW_PAYLOAD_BYTES] = {0x01, 0x20, 0x00, 0x80, 0xFF, 0x10, 2, 0, 30, 200};
+    LanCodecState tx = {0};
+    LanCodecState rx = {0};
+    for (int frame = 0; frame < 2 * LAN_CODEC_KEYFRAME_INTERVAL; frame++)
+    {
+        payload[1] = (uint8_t)(0x20 + frame);
+        uint8_t wire[512];
+        size_t size = LanCodecEncode(&tx, payload, wire, sizeof(wire), NULL);
+        uint8_t decoded[LAN_RAW_PAYLOAD_BYTES];
+        Check(size > 0 && size < LAN_RAW_PAYLOAD_BYTES, "quiet payload is coded smaller");
+        Check(LanCodecDecode(&rx, wire, size, decoded), "coded payload decodes");
+        Check(memcmp(decoded, payload, sizeof(payload)) == 0, "coded payload round-trips");
+    }
+}
+
+int main(void)
+{
+    LanCodecInit();
+    TestEnemyPacketIsNotAPayload();
+    TestRawPayloadRoundTrip();
+    TestCodedPayloadRoundTrip();
+    if (gFailures > 0)
+        return 1;
+    printf("lancodec_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,99 @@
+#define _POSIX_C_SOURCE 200809L
+#include "telemetry.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+// Example reader for the game's shared-memory telemetry. After the mapping is
+// set up, every poll is plain loads: no syscalls and nothing the game waits on.
+//   build/telemetry_reader [segment] [--once]
+
+static bool ReadSnapshot(const TelemetrySegment *seg, TelemetrySnapshot *out)
+{
+    for (int attempt = 0; attempt < 1000; attempt++)
+    {
+        uint32_t before = __atomic_load_n(&seg->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1u)
+            continue;
+        memcpy(out, (const void *)&seg->snapshot, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&seg->sequence, __ATOMIC_RELAXED) == before)
+            return true;
+    }
+    return false;
+}
+
+static void PrintSnapshot(const TelemetrySnapshot *s)
+{
+    static const char *modes[] = {"multiplayer", "zombies"};
+    printf("tick %llu  match %.1f s  %s  wave %d  enemies %d  scores %d:%d\n", (unsigned long long)s->tick, s->matchTime,
+           s->mode < 2 ? modes[s->mode] : "?", s->wave, s->activeEnemies, s->teamScores[0], s->teamScores[1]);
+    printf("  frame %.2f ms  headroom %.0f%%  hitches %u  in %u pkt/%u B  out %u pkt/%u B\n", s->frameMs, s->headroom * 100.0f,
+           s->hitches, s->packetsIn, s->bytesIn, s->packetsOut, s->bytesOut);
+    for (uint32_t i = 0; i < s->playerCount && i < TELEMETRY_MAX_PLAYERS; i++)
+    {
+        const TelemetryPlayer *p = &s->players[i];
+        printf("  %c %-15.15s team %u  hp %5.1f  score %5d  cash %5d  rtt %5.1f ms%s%s\n",
+               (p->flags & TELEMETRY_PLAYER_SELF) ? '*' : ' ', p->name, p->team, p->health, p->score, p->cash, p->rttMs,
+               (p->flags & TELEMETRY_PLAYER_HOST) ? "  host" : "", (p->flags & TELEMETRY_PLAYER_DOWNED) ? "  downed" : "");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = TELEMETRY_SHM_NAME;
+    bool once = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--once") == 0)
+            once = true;
+        else
+            name = argv[i];
+    }
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "telemetry: no segment %s (start the game with --telemetry)\n", name);
+        return 1;
+    }
+    const TelemetrySegment *seg = mmap(NULL, sizeof(TelemetrySegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED)
+    {
+        perror("telemetry: mmap");
+        return 1;
+    }
+    if (__atomic_load_n(&seg->magic, __ATOMIC_ACQUIRE) != TELEMETRY_MAGIC || seg->version != TELEMETRY_VERSION ||
+        seg->size != sizeof(TelemetrySegment))
+    {
+        fprintf(stderr, "telemetry: %s is version %u (%u bytes), this reader expects %u (%zu bytes)\n", name, seg->version,
+                seg->size, TELEMETRY_VERSION, sizeof(TelemetrySegment));
+        return 1;
+    }
+
+    uint64_t lastTick = 0;
+    struct timespec pause = {0, 250000000L};
+    for (;;)
+    {
+        TelemetrySnapshot snapshot;
+        if (ReadSnapshot(seg, &snapshot) && snapshot.tick != lastTick)
+        {
+            PrintSnapshot(&snapshot);
+            fflush(stdout);
+            lastTick = snapshot.tick;
+            if (once)
+                break;
+        }
+        if (__atomic_load_n(&seg->magic, __ATOMIC_ACQUIRE) != TELEMETRY_MAGIC)
+            break;
+        nanosleep(&pause, NULL);
+    }
+    munmap((void *)seg, sizeof(TelemetrySegment));
+    return 0;
+}